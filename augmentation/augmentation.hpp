@@ -13,7 +13,13 @@
 #define MODELS_AUGMENTATION_AUGMENTATION_HPP
 
 #include <mlpack.hpp>
-#include <boost/regex.hpp>
+#include <augmentation/image_resize.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <type_traits>
 
 namespace mlpack {
 namespace models {
@@ -22,6 +28,32 @@ namespace models {
  * Augmentation class used to perform augmentations by transforming the data.
  * For the list of supported augmentation, take a look at our wiki page.
  *
+ * Augmentation strings are parsed once by the constructor into a list of
+ * operations, so applying the augmentations to a batch or a single data point
+ * doesn't handle any strings.
+ *
+ * Resize is applied to every data point with bilinear interpolation, or with
+ * nearest neighbour or area interpolation if the string contains "nearest" or
+ * "area", e.g. "resize-area = (56, 56)". All other augmentations are random,
+ * each of them is applied to a data point with the augmentation probability:
+ *  - "horizontal-flip" and "vertical-flip" mirror the data point.
+ *  - "random-crop = p" pads the data point with p zeros on every side and
+ *    crops a random window of the original size.
+ *  - "random-scale = s" zooms the data point about its center by a factor in
+ *    [1 - s, 1 + s], pixels moved in from outside are set to zero.
+ *  - "brightness = b" multiplies all values by a factor in [1 - b, 1 + b].
+ *  - "contrast = c" scales the distance of all values to their mean by a
+ *    factor in [1 - c, 1 + c].
+ *  - "noise = s" adds gaussian noise with standard deviation s.
+ *
+ * Random augmentations expect data points stored channel by channel, i.e.
+ * element x + width * (y + height * c), as used by the resize augmentation
+ * and the convolutional layers of mlpack.
+ *
+ * Flips, crops and scales move the objects of an image. For object detection
+ * datasets, RandomTransform() also returns the affine map of every data
+ * point, which BoxStore::Transform() applies to all bounding boxes at once.
+ *
  * @code
  * Augmentation augmentation({"horizontal-flip", "resize = (224, 224)"}, 0.2);
  * augmentation.Transform(dataloader.TrainFeatures);
@@ -33,7 +65,10 @@ class Augmentation
   //! Create the augmentation class object.
   Augmentation() :
       augmentations(std::vector<std::string>()),
-      augmentationProbability(0.2)
+      augmentationProbability(0.2),
+      resizeWidth(0),
+      resizeHeight(0),
+      resizeMethod(ImageResize::Method::Bilinear)
   {
     // Nothing to do here.
   }
@@ -51,23 +86,96 @@ class Augmentation
   Augmentation(const std::vector<std::string>& augmentations,
                const double augmentationProbability) :
                augmentations(augmentations),
-               augmentationProbability(augmentationProbability)
+               augmentationProbability(augmentationProbability),
+               resizeWidth(0),
+               resizeHeight(0),
+               resizeMethod(ImageResize::Method::Bilinear)
   {
     // Convert strings to lower case.
     for (size_t i = 0; i < augmentations.size(); i++)
       this->augmentations[i] = mlpack::util::ToLower(augmentations[i]);
 
-    // Sort the vector to place resize parameter to the front of the string.
-    // This prevents constant lookups for resize.
-    sort(this->augmentations.begin(), this->augmentations.end(), [](
-        std::string& str1, std::string& str2)
+    // Move resize parameters to the front, otherwise the order given by the
+    // user is kept.
+    std::stable_partition(this->augmentations.begin(),
+        this->augmentations.end(), [](const std::string& augmentation)
         {
-          return str1.find("resize") != std::string::npos;
+          return HasResizeParam(augmentation);
         });
+
+    for (size_t i = 0; i < this->augmentations.size(); i++)
+    {
+      const std::string& augmentation = this->augmentations[i];
+      Operation operation;
+      operation.outputWidth = 0;
+      operation.outputHeight = 0;
+      operation.method = ImageResize::Method::Bilinear;
+      operation.value = 0;
+      if (HasResizeParam(augmentation))
+      {
+        operation.type = OperationType::Resize;
+        GetResizeParam(operation.outputWidth, operation.outputHeight,
+            augmentation);
+        if (augmentation.find("nearest") != std::string::npos)
+          operation.method = ImageResize::Method::Nearest;
+        else if (augmentation.find("area") != std::string::npos)
+          operation.method = ImageResize::Method::Area;
+
+        // Shape of the data points is given by the first resize.
+        if (operations.empty())
+        {
+          resizeWidth = operation.outputWidth;
+          resizeHeight = operation.outputHeight;
+          resizeMethod = operation.method;
+        }
+      }
+      else if (augmentation.find("horizontal-flip") != std::string::npos)
+      {
+        operation.type = OperationType::HorizontalFlip;
+      }
+      else if (augmentation.find("vertical-flip") != std::string::npos)
+      {
+        operation.type = OperationType::VerticalFlip;
+      }
+      else if (augmentation.find("random-crop") != std::string::npos)
+      {
+        operation.type = OperationType::RandomCrop;
+        operation.value = GetParam(augmentation);
+      }
+      else if (augmentation.find("random-scale") != std::string::npos)
+      {
+        operation.type = OperationType::RandomScale;
+        operation.value = GetParam(augmentation);
+      }
+      else if (augmentation.find("brightness") != std::string::npos)
+      {
+        operation.type = OperationType::Brightness;
+        operation.value = GetParam(augmentation);
+      }
+      else if (augmentation.find("contrast") != std::string::npos)
+      {
+        operation.type = OperationType::Contrast;
+        operation.value = GetParam(augmentation);
+      }
+      else if (augmentation.find("noise") != std::string::npos)
+      {
+        operation.type = OperationType::Noise;
+        operation.value = GetParam(augmentation);
+      }
+      else
+      {
+        mlpack::Log::Warn << "Unknown augmentation : \'" <<
+            augmentation << "\' not found!" << std::endl;
+        continue;
+      }
+
+      operations.push_back(operation);
+    }
   }
 
   /**
-   * Applies augmentation to the passed dataset.
+   * Applies augmentation to the passed dataset. Resize is applied first, then
+   * random augmentations are drawn from mlpack's random number generator.
    *
    * @tparam DatasetType Datatype on which augmentation will be done.
    * 
@@ -83,7 +191,89 @@ class Augmentation
   void Transform(DatasetType& dataset,
                  const size_t datapointWidth,
                  const size_t datapointHeight,
-                 const size_t datapointDepth = 1);
+                 const size_t datapointDepth = 1) const;
+
+  /**
+   * Applies the random augmentations to every data point of the dataset in
+   * place. Data points are augmented in parallel (if OpenMP is available),
+   * each one with its own generator seeded by the given seed and its column,
+   * so the result doesn't depend on the number of threads.
+   *
+   * @tparam DatasetType Datatype on which augmentation will be done.
+   *
+   * @param dataset Dataset on which augmentation will be applied.
+   * @param datapointWidth Width of a single data point.
+   * @param datapointHeight Height of a single data point.
+   * @param datapointDepth Depth of a single data point.
+   * @param seed Seed of the random augmentations.
+   */
+  template<typename DatasetType>
+  void RandomTransform(DatasetType& dataset,
+                       const size_t datapointWidth,
+                       const size_t datapointHeight,
+                       const size_t datapointDepth,
+                       const size_t seed) const;
+
+  /**
+   * Applies the random augmentations to every data point of the dataset in
+   * place, as the overload above, and stores how each data point was moved.
+   * Column i of the transforms holds (scaleX, offsetX, scaleY, offsetY), a
+   * point (x, y) of data point i is moved to (scaleX * x + offsetX,
+   * scaleY * y + offsetY). Points are continuous pixel coordinates, i.e. in
+   * the range [0, width] x [0, height].
+   *
+   * @tparam DatasetType Datatype on which augmentation will be done.
+   *
+   * @param dataset Dataset on which augmentation will be applied.
+   * @param datapointWidth Width of a single data point.
+   * @param datapointHeight Height of a single data point.
+   * @param datapointDepth Depth of a single data point.
+   * @param seed Seed of the random augmentations.
+   * @param transforms Matrix where the map of every data point is stored.
+   */
+  template<typename DatasetType>
+  void RandomTransform(DatasetType& dataset,
+                       const size_t datapointWidth,
+                       const size_t datapointHeight,
+                       const size_t datapointDepth,
+                       const size_t seed,
+                       arma::mat& transforms) const;
+
+  /**
+   * Applies the random augmentations to a single data point in place.
+   *
+   * @tparam ElemType Type of the values of the data point.
+   * @tparam GeneratorType Type of the random number generator.
+   *
+   * @param datapoint Pointer to the values of the data point.
+   * @param datapointWidth Width of the data point.
+   * @param datapointHeight Height of the data point.
+   * @param datapointDepth Depth of the data point.
+   * @param generator Generator the augmentations are drawn from.
+   */
+  template<typename ElemType, typename GeneratorType>
+  void RandomTransform(ElemType* datapoint,
+                       const size_t datapointWidth,
+                       const size_t datapointHeight,
+                       const size_t datapointDepth,
+                       GeneratorType& generator) const;
+
+  /**
+   * Applies the first resize augmentation to the entire dataset. Does nothing
+   * if no resize augmentation was given.
+   *
+   * @tparam DatasetType Datatype on which augmentation will be done.
+   *
+   * @param dataset Dataset on which augmentation will be applied.
+   * @param datapointWidth Width of a single data point.
+   * @param datapointHeight Height of a single data point.
+   * @param datapointDepth Depth of a single data point.
+   */
+  template<typename DatasetType>
+  void ResizeTransform(DatasetType& dataset,
+                       const size_t datapointWidth,
+                       const size_t datapointHeight,
+                       const size_t datapointDepth) const;
 
   /**
    * Applies resize transform to the entire dataset.
@@ -104,83 +294,340 @@ class Augmentation
                        const size_t datapointWidth,
                        const size_t datapointHeight,
                        const size_t datapointDepth,
-                       const std::string& augmentation);
+                       const std::string& augmentation) const;
+
+  //! Get whether a resize augmentation was given.
+  bool HasResize() const { return !operations.empty() &&
+      operations[0].type == OperationType::Resize; }
+
+  //! Get whether any random augmentation was given.
+  bool HasRandomTransform() const
+  {
+    for (const Operation& operation : operations)
+    {
+      if (operation.type != OperationType::Resize)
+        return true;
+    }
+
+    return false;
+  }
+
+  //! Get the probability of applying a random augmentation.
+  double AugmentationProbability() const { return augmentationProbability; }
+
+  //! Get the width of data points after the first resize, zero if no resize
+  //! augmentation was given.
+  size_t ResizeWidth() const { return resizeWidth; }
+
+  //! Get the height of data points after the first resize, zero if no resize
+  //! augmentation was given.
+  size_t ResizeHeight() const { return resizeHeight; }
+
+  //! Get the interpolation method of the first resize.
+  ImageResize::Method ResizeMethod() const { return resizeMethod; }
 
  private:
+  //! Types of the supported augmentations.
+  enum class OperationType
+  {
+    //! Resize with bilinear interpolation.
+    Resize,
+    //! Mirror along the vertical axis.
+    HorizontalFlip,
+    //! Mirror along the horizontal axis.
+    VerticalFlip,
+    //! Random translation with zero padding.
+    RandomCrop,
+    //! Random zoom about the center.
+    RandomScale,
+    //! Random scaling of all values.
+    Brightness,
+    //! Random scaling around the mean.
+    Contrast,
+    //! Additive gaussian noise.
+    Noise
+  };
+
+  //! Augmentation parsed from its string.
+  struct Operation
+  {
+    //! Type of the augmentation.
+    OperationType type;
+    //! Width of resized data points.
+    size_t outputWidth;
+    //! Height of resized data points.
+    size_t outputHeight;
+    //! Interpolation method of resize.
+    ImageResize::Method method;
+    //! Parameter of random augmentations.
+    double value;
+  };
+
   /**
-   * Function to determine if augmentation has Resize function.
+   * Resizes data points, unless they already have the output shape.
    *
-   * @param augmentation Optional argument to check if a string has
-   *                     resize substring.
+   * @param dataset Dataset which will be resized.
+   * @param datapointWidth Width of a single data point.
+   * @param datapointHeight Height of a single data point.
+   * @param datapointDepth Depth of a single data point.
+   * @param outputWidth Width of a resized data point.
+   * @param outputHeight Height of a resized data point.
+   * @param method Interpolation method.
    */
-  bool HasResizeParam(const std::string& augmentation = "")
-  {
-    if (augmentation.length())
-      return augmentation.find("resize") != std::string::npos;
+  template<typename DatasetType>
+  void Resize(DatasetType& dataset,
+              const size_t datapointWidth,
+              const size_t datapointHeight,
+              const size_t datapointDepth,
+              const size_t outputWidth,
+              const size_t outputHeight,
+              const ImageResize::Method method) const;
 
+  /**
+   * Applies the random augmentations to a single data point in place and
+   * composes the map of every geometric augmentation into the transform.
+   *
+   * @param datapoint Pointer to the values of the data point.
+   * @param datapointWidth Width of the data point.
+   * @param datapointHeight Height of the data point.
+   * @param datapointDepth Depth of the data point.
+   * @param generator Generator the augmentations are drawn from.
+   * @param buffer Buffer for a copy of one channel, resized if needed.
+   * @param transform Map (scaleX, offsetX, scaleY, offsetY) of the data
+   *                  point, updated by every geometric augmentation.
+   */
+  template<typename ElemType, typename GeneratorType>
+  void TransformDatapoint(ElemType* datapoint,
+                          const size_t datapointWidth,
+                          const size_t datapointHeight,
+                          const size_t datapointDepth,
+                          GeneratorType& generator,
+                          std::vector<double>& buffer,
+                          double* transform) const;
 
-    // Search in augmentation vector.
-    return augmentations.size() <= 0 ? false :
-        augmentations[0].find("resize") != std::string::npos;
+  /**
+   * Function to determine if augmentation has Resize function.
+   *
+   * @param augmentation String of an augmentation.
+   */
+  static bool HasResizeParam(const std::string& augmentation)
+  {
+    return augmentation.find("resize") != std::string::npos;
   }
 
   /**
-   * Sets size of output width and output height of the new data.
+   * Sets size of output width and output height of the new data. If only a
+   * single number is given, output width and output height are set to it.
    *
    * @param outWidth Output width of resized data point.
    * @param outHeight Output height of resized data point.
    * @param augmentation String from which output width and height
    *                     are extracted.
    */
-  void GetResizeParam(size_t& outWidth,
-                      size_t& outHeight,
-                      const std::string& augmentation)
+  static void GetResizeParam(size_t& outWidth,
+                             size_t& outHeight,
+                             const std::string& augmentation)
   {
-    if (!HasResizeParam())
-      return;
-
-    outWidth = 0;
-    outHeight = 0;
-
-    // Use regex to find one or two numbers. If only one provided
-    // set output width equal to output height.
-    boost::regex regex{"[0-9]+"};
+    std::vector<size_t> numbers;
+    for (size_t i = 0; i < augmentation.length() && numbers.size() < 2; i++)
+    {
+      if (!std::isdigit(static_cast<unsigned char>(augmentation[i])))
+        continue;
 
-    // Create an iterator to find matches.
-    boost::sregex_token_iterator matches(augmentation.begin(),
-        augmentation.end(), regex, 0), end;
+      size_t number = 0;
+      for (; i < augmentation.length() &&
+          std::isdigit(static_cast<unsigned char>(augmentation[i])); i++)
+        number = 10 * number + (augmentation[i] - '0');
 
-    size_t matchesCount = std::distance(matches, end);
+      numbers.push_back(number);
+    }
 
-    if (matchesCount == 0)
+    if (numbers.empty())
     {
       mlpack::Log::Fatal << "Invalid size / shape in " <<
           augmentation << std::endl;
     }
 
-    if (matchesCount == 1)
+    outWidth = numbers[0];
+    outHeight = numbers.back();
+  }
+
+  /**
+   * Get the parameter of a random augmentation, i.e. the first number in the
+   * string.
+   *
+   * @param augmentation String from which the parameter is extracted.
+   */
+  static double GetParam(const std::string& augmentation)
+  {
+    const size_t begin = augmentation.find_first_of("0123456789.");
+    if (begin == std::string::npos)
+    {
+      mlpack::Log::Fatal << "Missing parameter in " << augmentation <<
+          std::endl;
+    }
+
+    return std::strtod(augmentation.c_str() + begin, nullptr);
+  }
+
+  /**
+   * Moves all values of a data point by the given offset in place. Values
+   * moved in from outside of the data point are set to zero.
+   *
+   * @param datapoint Pointer to the values of the data point.
+   * @param width Width of the data point.
+   * @param height Height of the data point.
+   * @param depth Depth of the data point.
+   * @param dx Horizontal offset.
+   * @param dy Vertical offset.
+   */
+  template<typename ElemType>
+  static void Shift(ElemType* datapoint,
+                    const size_t width,
+                    const size_t height,
+                    const size_t depth,
+                    const std::ptrdiff_t dx,
+                    const std::ptrdiff_t dy)
+  {
+    const std::ptrdiff_t w = width, h = height;
+    for (size_t c = 0; c < depth; c++)
     {
-      outWidth = std::stoi(*matches);
-      outHeight = outWidth;
+      // Values are visited opposite to the direction of the offset, so every
+      // value is read before it's overwritten.
+      ElemType* plane = datapoint + width * height * c;
+      for (std::ptrdiff_t k = 0; k < h; k++)
+      {
+        const std::ptrdiff_t y = dy > 0 ? h - 1 - k : k;
+        const std::ptrdiff_t sourceY = y - dy;
+        for (std::ptrdiff_t l = 0; l < w; l++)
+        {
+          const std::ptrdiff_t x = dx > 0 ? w - 1 - l : l;
+          const std::ptrdiff_t sourceX = x - dx;
+          plane[x + w * y] = (sourceX >= 0 && sourceX < w && sourceY >= 0 &&
+              sourceY < h) ? plane[sourceX + w * sourceY] : ElemType(0);
+        }
+      }
     }
-    else
+  }
+
+  /**
+   * Zooms a data point about its center in place with bilinear
+   * interpolation. Values sampled from outside of the data point are zero.
+   *
+   * @param datapoint Pointer to the values of the data point.
+   * @param width Width of the data point.
+   * @param height Height of the data point.
+   * @param depth Depth of the data point.
+   * @param factor Zoom factor, values above one enlarge the content.
+   * @param buffer Buffer for a copy of one channel, resized if needed.
+   */
+  template<typename ElemType>
+  static void Zoom(ElemType* datapoint,
+                   const size_t width,
+                   const size_t height,
+                   const size_t depth,
+                   const double factor,
+                   std::vector<double>& buffer)
+  {
+    const std::is_floating_point<ElemType> floatingPoint;
+    const std::ptrdiff_t w = width, h = height;
+    buffer.resize(width * height);
+    for (size_t c = 0; c < depth; c++)
     {
-      outWidth = std::stoi(*matches);
-      matches++;
-      outHeight = std::stoi(*matches);
+      ElemType* plane = datapoint + width * height * c;
+      std::copy(plane, plane + width * height, buffer.begin());
+      for (std::ptrdiff_t y = 0; y < h; y++)
+      {
+        // Center of the output pixel is mapped back to the input.
+        const double sourceY = (y + 0.5 - h / 2.0) / factor + h / 2.0 - 0.5;
+        const std::ptrdiff_t y0 = (std::ptrdiff_t) std::floor(sourceY);
+        const double deltaY = sourceY - y0;
+        for (std::ptrdiff_t x = 0; x < w; x++)
+        {
+          const double sourceX = (x + 0.5 - w / 2.0) / factor + w / 2.0 -
+              0.5;
+          const std::ptrdiff_t x0 = (std::ptrdiff_t) std::floor(sourceX);
+          const double deltaX = sourceX - x0;
+
+          double value = 0;
+          for (std::ptrdiff_t k = 0; k < 2; k++)
+          {
+            const std::ptrdiff_t sy = y0 + k;
+            if (sy < 0 || sy >= h)
+              continue;
+
+            const double weightY = k ? deltaY : 1.0 - deltaY;
+            for (std::ptrdiff_t l = 0; l < 2; l++)
+            {
+              const std::ptrdiff_t sx = x0 + l;
+              if (sx >= 0 && sx < w)
+              {
+                value += weightY * (l ? deltaX : 1.0 - deltaX) *
+                    buffer[sx + w * sy];
+              }
+            }
+          }
+
+          plane[x + w * y] = Saturate<ElemType>(value, floatingPoint);
+        }
+      }
     }
   }
 
+  //! Converts a floating point value to the element type.
+  template<typename ElemType>
+  static ElemType Saturate(const double value,
+                           const std::true_type /* floatingPoint */)
+  {
+    return ElemType(value);
+  }
+
+  //! Converts a value to an integer element type with rounding, values out of
+  //! range of the type are clamped.
+  template<typename ElemType>
+  static ElemType Saturate(const double value,
+                           const std::false_type /* floatingPoint */)
+  {
+    return ElemType(std::round(std::min(std::max(value,
+        (double) std::numeric_limits<ElemType>::min()),
+        (double) std::numeric_limits<ElemType>::max())));
+  }
+
+  //! Mixes the bits of a seed and an index into a new seed.
+  static size_t MixSeed(const size_t seed, const size_t index)
+  {
+    uint64_t z = uint64_t(seed) + 0x9E3779B97F4A7C15ULL * (uint64_t(index) + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return size_t(z ^ (z >> 31));
+  }
+
   //! Locally held augmentations and transforms that need to be applied.
   std::vector<std::string> augmentations;
 
   //! Locally held value of augmentation probability.
   double augmentationProbability;
 
+  //! Locally held augmentations parsed from their strings.
+  std::vector<Operation> operations;
+
+  //! Locally held width of data points after the first resize.
+  size_t resizeWidth;
+
+  //! Locally held height of data points after the first resize.
+  size_t resizeHeight;
+
+  //! Locally held interpolation method of the first resize.
+  ImageResize::Method resizeMethod;
+
   // The dataloader class should have access to internal functions of
   // the augmentation class.
   template<typename DatasetX, typename DatasetY, class ScalerType>
   friend class DataLoader;
+
+  // Batches are resized by the batch iterator as they are decoded.
+  template<typename DatasetX, typename DatasetY, typename SourceType>
+  friend class BatchIterator;
 };
 
 } // namespace models
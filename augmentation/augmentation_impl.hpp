@@ -22,53 +22,267 @@ template<typename DatasetType>
 void Augmentation::Transform(DatasetType& dataset,
                              const size_t datapointWidth,
                              const size_t datapointHeight,
-                             const size_t datapointDepth)
+                             const size_t datapointDepth) const
 {
-  // Initialize the augmentation map.
-  std::unordered_map<std::string, void(*)(DatasetType&,
-       size_t, size_t, size_t, std::string&)> augmentationMap;
-
-  for (size_t i = 0; i < augmentations.size(); i++)
+  // Shape of the data points after the previous augmentation.
+  size_t width = datapointWidth, height = datapointHeight;
+  for (const Operation& operation : operations)
   {
-    if (augmentationMap.count(augmentations[i]))
+    switch (operation.type)
     {
-      augmentationMap[augmentations[i]](dataset, datapointWidth,
-        datapointHeight, datapointDepth, augmentations[i]);
+      case OperationType::Resize:
+        Resize(dataset, width, height, datapointDepth, operation.outputWidth,
+            operation.outputHeight, operation.method);
+        width = operation.outputWidth;
+        height = operation.outputHeight;
+        break;
+      default:
+        break;
     }
-    else if (this->HasResizeParam(augmentations[i]))
+  }
+
+  if (HasRandomTransform())
+  {
+    RandomTransform(dataset, width, height, datapointDepth,
+        mlpack::RandInt(std::numeric_limits<int>::max()));
+  }
+}
+
+template<typename DatasetType>
+void Augmentation::RandomTransform(DatasetType& dataset,
+                                   const size_t datapointWidth,
+                                   const size_t datapointHeight,
+                                   const size_t datapointDepth,
+                                   const size_t seed) const
+{
+  arma::mat transforms;
+  RandomTransform(dataset, datapointWidth, datapointHeight, datapointDepth,
+      seed, transforms);
+}
+
+template<typename DatasetType>
+void Augmentation::RandomTransform(DatasetType& dataset,
+                                   const size_t datapointWidth,
+                                   const size_t datapointHeight,
+                                   const size_t datapointDepth,
+                                   const size_t seed,
+                                   arma::mat& transforms) const
+{
+  if (dataset.n_rows != datapointWidth * datapointHeight * datapointDepth)
+  {
+    mlpack::Log::Fatal << "Data points of shape " << datapointWidth << " x "
+        << datapointHeight << " x " << datapointDepth << " don't match the "
+        << dataset.n_rows << " rows of the dataset." << std::endl;
+  }
+
+  // Every data point starts with the identity map.
+  transforms.set_size(4, dataset.n_cols);
+  transforms.row(0).ones();
+  transforms.row(1).zeros();
+  transforms.row(2).ones();
+  transforms.row(3).zeros();
+
+  #pragma omp parallel
+  {
+    std::vector<double> buffer;
+
+    #pragma omp for schedule(static)
+    for (size_t i = 0; i < dataset.n_cols; i++)
     {
-      this->ResizeTransform(dataset, datapointWidth, datapointHeight,
-        datapointDepth, augmentations[i]);
+      std::mt19937 generator(MixSeed(seed, i));
+      TransformDatapoint(dataset.colptr(i), datapointWidth, datapointHeight,
+          datapointDepth, generator, buffer, transforms.colptr(i));
     }
-    else
+  }
+}
+
+template<typename ElemType, typename GeneratorType>
+void Augmentation::RandomTransform(ElemType* datapoint,
+                                   const size_t datapointWidth,
+                                   const size_t datapointHeight,
+                                   const size_t datapointDepth,
+                                   GeneratorType& generator) const
+{
+  std::vector<double> buffer;
+  double transform[4] = {1.0, 0.0, 1.0, 0.0};
+  TransformDatapoint(datapoint, datapointWidth, datapointHeight,
+      datapointDepth, generator, buffer, transform);
+}
+
+template<typename ElemType, typename GeneratorType>
+void Augmentation::TransformDatapoint(ElemType* datapoint,
+                                      const size_t datapointWidth,
+                                      const size_t datapointHeight,
+                                      const size_t datapointDepth,
+                                      GeneratorType& generator,
+                                      std::vector<double>& buffer,
+                                      double* transform) const
+{
+  const size_t planeSize = datapointWidth * datapointHeight;
+  const size_t size = planeSize * datapointDepth;
+  const std::is_floating_point<ElemType> floatingPoint;
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  for (const Operation& operation : operations)
+  {
+    if (operation.type == OperationType::Resize ||
+        uniform(generator) >= augmentationProbability)
+      continue;
+
+    switch (operation.type)
     {
-      mlpack::Log::Warn << "Unknown augmentation : \'" <<
-          augmentations[i] << "\' not found!" << std::endl;
+      case OperationType::HorizontalFlip:
+        for (size_t row = 0; row < datapointHeight * datapointDepth; row++)
+        {
+          ElemType* begin = datapoint + row * datapointWidth;
+          std::reverse(begin, begin + datapointWidth);
+        }
+
+        // x is moved to width - x.
+        transform[0] = -transform[0];
+        transform[1] = datapointWidth - transform[1];
+        break;
+      case OperationType::VerticalFlip:
+        for (size_t c = 0; c < datapointDepth; c++)
+        {
+          ElemType* plane = datapoint + c * planeSize;
+          for (size_t y = 0; y < datapointHeight / 2; y++)
+          {
+            std::swap_ranges(plane + y * datapointWidth,
+                plane + (y + 1) * datapointWidth,
+                plane + (datapointHeight - 1 - y) * datapointWidth);
+          }
+        }
+
+        transform[2] = -transform[2];
+        transform[3] = datapointHeight - transform[3];
+        break;
+      case OperationType::RandomCrop:
+      {
+        const std::ptrdiff_t padding = (std::ptrdiff_t) operation.value;
+        std::uniform_int_distribution<std::ptrdiff_t> offset(-padding,
+            padding);
+        const std::ptrdiff_t dx = offset(generator);
+        const std::ptrdiff_t dy = offset(generator);
+        Shift(datapoint, datapointWidth, datapointHeight, datapointDepth, dx,
+            dy);
+        transform[1] += dx;
+        transform[3] += dy;
+        break;
+      }
+      case OperationType::RandomScale:
+      {
+        const double factor = 1.0 + operation.value *
+            (2.0 * uniform(generator) - 1.0);
+        if (factor <= 0)
+          break;
+
+        Zoom(datapoint, datapointWidth, datapointHeight, datapointDepth,
+            factor, buffer);
+
+        // Points are scaled about the center.
+        const double centerX = datapointWidth / 2.0;
+        const double centerY = datapointHeight / 2.0;
+        transform[0] *= factor;
+        transform[1] = (transform[1] - centerX) * factor + centerX;
+        transform[2] *= factor;
+        transform[3] = (transform[3] - centerY) * factor + centerY;
+        break;
+      }
+      case OperationType::Brightness:
+      {
+        const double factor = 1.0 + operation.value *
+            (2.0 * uniform(generator) - 1.0);
+        for (size_t i = 0; i < size; i++)
+        {
+          datapoint[i] = Saturate<ElemType>(factor * datapoint[i],
+              floatingPoint);
+        }
+        break;
+      }
+      case OperationType::Contrast:
+      {
+        const double factor = 1.0 + operation.value *
+            (2.0 * uniform(generator) - 1.0);
+        double mean = 0;
+        for (size_t i = 0; i < size; i++)
+          mean += datapoint[i];
+        mean /= std::max<size_t>(size, 1);
+
+        for (size_t i = 0; i < size; i++)
+        {
+          datapoint[i] = Saturate<ElemType>(mean + factor *
+              (datapoint[i] - mean), floatingPoint);
+        }
+        break;
+      }
+      case OperationType::Noise:
+      {
+        if (operation.value <= 0)
+          break;
+
+        std::normal_distribution<double> noise(0.0, operation.value);
+        for (size_t i = 0; i < size; i++)
+        {
+          datapoint[i] = Saturate<ElemType>(datapoint[i] + noise(generator),
+              floatingPoint);
+        }
+        break;
+      }
+      default:
+        break;
     }
   }
 }
 
+template<typename DatasetType>
+void Augmentation::ResizeTransform(
+    DatasetType& dataset,
+    const size_t datapointWidth,
+    const size_t datapointHeight,
+    const size_t datapointDepth) const
+{
+  if (!HasResize())
+    return;
+
+  Resize(dataset, datapointWidth, datapointHeight, datapointDepth,
+      resizeWidth, resizeHeight, resizeMethod);
+}
+
 template<typename DatasetType>
 void Augmentation::ResizeTransform(
     DatasetType& dataset,
     const size_t datapointWidth,
     const size_t datapointHeight,
     const size_t datapointDepth,
-    const std::string& augmentation)
+    const std::string& augmentation) const
 {
   size_t outputWidth = 0, outputHeight = 0;
 
   // Get output width and output height.
   GetResizeParam(outputWidth, outputHeight, augmentation);
 
-  // We will use mlpack's bilinear interpolation layer to
-  // resize the input.
-  mlpack::BilinearInterpolation<DatasetType, DatasetType> resizeLayer(
-      datapointWidth, datapointHeight, outputWidth, outputHeight,
-      datapointDepth);
+  Resize(dataset, datapointWidth, datapointHeight, datapointDepth,
+      outputWidth, outputHeight, ImageResize::Method::Bilinear);
+}
+
+template<typename DatasetType>
+void Augmentation::Resize(DatasetType& dataset,
+                          const size_t datapointWidth,
+                          const size_t datapointHeight,
+                          const size_t datapointDepth,
+                          const size_t outputWidth,
+                          const size_t outputHeight,
+                          const ImageResize::Method method) const
+{
+  if (datapointWidth == outputWidth && datapointHeight == outputHeight)
+    return;
 
+  // Integer pixels are interpolated in double precision and rounded back.
+  ImageResize resize(datapointWidth, datapointHeight, datapointDepth,
+      outputWidth, outputHeight, method);
   DatasetType output;
-  resizeLayer.Forward(dataset, output);
+  resize.Resize(dataset, output);
   dataset = std::move(output);
 }
 
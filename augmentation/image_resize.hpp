@@ -0,0 +1,311 @@
+/**
+ * @file image_resize.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of ImageResize, which resizes images stored as columns of a
+ * matrix with bilinear, nearest neighbour or area interpolation.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_AUGMENTATION_IMAGE_RESIZE_HPP
+#define MODELS_AUGMENTATION_IMAGE_RESIZE_HPP
+
+#include <mlpack.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * ImageResize resizes images channel by channel, i.e. element
+ * x + width * (y + height * c) of an image, as used by mlpack's bilinear
+ * interpolation layer. Interpolation is separable: every row of the output
+ * is first blended from contiguous rows of the input, which the compiler can
+ * vectorize, and then sampled along the row. Source positions and weights of
+ * both axes are computed once by the constructor, so the same object can
+ * resize any number of images, from any number of threads.
+ *
+ * Bilinear interpolation gives the same result as
+ * mlpack::BilinearInterpolation. Area interpolation averages all input
+ * pixels covered by an output pixel, which avoids aliasing when images are
+ * shrunk.
+ *
+ * @code
+ * ImageResize resize(500, 375, 3, 224, 224);
+ *
+ * // Images are resized in parallel into the preallocated output.
+ * arma::mat output(resize.OutputSize(), images.n_cols);
+ * resize.Resize(images, output);
+ * @endcode
+ */
+class ImageResize
+{
+ public:
+  //! Supported interpolation methods.
+  enum class Method
+  {
+    //! Bilinear interpolation of the four nearest pixels.
+    Bilinear,
+    //! Value of the nearest pixel.
+    Nearest,
+    //! Average of all pixels covered by an output pixel.
+    Area
+  };
+
+  /**
+   * Create the ImageResize object.
+   *
+   * @param inputWidth Width of an input image.
+   * @param inputHeight Height of an input image.
+   * @param depth Number of channels of an image.
+   * @param outputWidth Width of a resized image.
+   * @param outputHeight Height of a resized image.
+   * @param method Interpolation method.
+   */
+  ImageResize(const size_t inputWidth,
+              const size_t inputHeight,
+              const size_t depth,
+              const size_t outputWidth,
+              const size_t outputHeight,
+              const Method method = Method::Bilinear) :
+      inputWidth(inputWidth),
+      inputHeight(inputHeight),
+      depth(depth),
+      outputWidth(outputWidth),
+      outputHeight(outputHeight)
+  {
+    if (inputWidth == 0 || inputHeight == 0 || outputWidth == 0 ||
+        outputHeight == 0)
+    {
+      mlpack::Log::Fatal << "Unable to resize images of shape {" << inputWidth
+          << ", " << inputHeight << "} to {" << outputWidth << ", "
+          << outputHeight << "}." << std::endl;
+    }
+
+    horizontal = Filter(inputWidth, outputWidth, method);
+    vertical = Filter(inputHeight, outputHeight, method);
+  }
+
+  /**
+   * Resizes a single image.
+   *
+   * @tparam InputType Type of the values of the input image.
+   * @tparam OutputType Type of the values of the output image.
+   *
+   * @param input Pointer to the input image.
+   * @param output Pointer to the output image, which holds OutputSize()
+   *               values. Must not overlap with the input.
+   * @param buffer Buffer for one blended row of the input, resized if
+   *               needed. Reusing it between calls avoids allocations.
+   */
+  template<typename InputType, typename OutputType>
+  void Resize(const InputType* input,
+              OutputType* output,
+              std::vector<double>& buffer) const
+  {
+    buffer.resize(inputWidth);
+    const std::is_floating_point<OutputType> floatingPoint;
+    for (size_t c = 0; c < depth; c++)
+    {
+      const InputType* inputPlane = input + c * inputWidth * inputHeight;
+      OutputType* outputPlane = output + c * outputWidth * outputHeight;
+      for (size_t y = 0; y < outputHeight; y++)
+      {
+        // Blend the input rows of the output row, contiguous in memory.
+        double* row = buffer.data();
+        std::fill(row, row + inputWidth, 0.0);
+        for (size_t k = vertical.offsets[y]; k < vertical.offsets[y + 1]; k++)
+        {
+          const InputType* inputRow = inputPlane + vertical.sources[k] *
+              inputWidth;
+          const double weight = vertical.weights[k];
+          for (size_t x = 0; x < inputWidth; x++)
+            row[x] += weight * inputRow[x];
+        }
+
+        // Sample the blended row.
+        OutputType* outputRow = outputPlane + y * outputWidth;
+        for (size_t x = 0; x < outputWidth; x++)
+        {
+          double value = 0;
+          for (size_t k = horizontal.offsets[x]; k < horizontal.offsets[x + 1];
+              k++)
+            value += horizontal.weights[k] * row[horizontal.sources[k]];
+
+          outputRow[x] = Saturate<OutputType>(value, floatingPoint);
+        }
+      }
+    }
+  }
+
+  /**
+   * Resizes every column of the input. Images are resized in parallel (if
+   * OpenMP is available). Memory of the output is reused if it already has
+   * the right shape.
+   *
+   * @tparam InputMatType Type of the input images.
+   * @tparam OutputMatType Type of the output images.
+   *
+   * @param input Input images, one image per column.
+   * @param output Matrix where resized images will be stored. Must not be the
+   *               input.
+   */
+  template<typename InputMatType, typename OutputMatType>
+  void Resize(const InputMatType& input, OutputMatType& output) const
+  {
+    if (input.n_rows != InputSize())
+    {
+      mlpack::Log::Fatal << "Images of shape {" << inputWidth << ", "
+          << inputHeight << ", " << depth << "} don't match the "
+          << input.n_rows << " rows of the input." << std::endl;
+    }
+
+    output.set_size(OutputSize(), input.n_cols);
+
+    #pragma omp parallel
+    {
+      std::vector<double> buffer(inputWidth);
+
+      #pragma omp for schedule(static)
+      for (size_t i = 0; i < input.n_cols; i++)
+        Resize(input.colptr(i), output.colptr(i), buffer);
+    }
+  }
+
+  //! Get the number of values of an input image.
+  size_t InputSize() const { return inputWidth * inputHeight * depth; }
+
+  //! Get the number of values of a resized image.
+  size_t OutputSize() const { return outputWidth * outputHeight * depth; }
+
+  //! Get the width of a resized image.
+  size_t OutputWidth() const { return outputWidth; }
+
+  //! Get the height of a resized image.
+  size_t OutputHeight() const { return outputHeight; }
+
+ private:
+  /**
+   * Input positions and weights of every output position along one axis.
+   * The inputs of output position i are the entries in the range
+   * [offsets[i], offsets[i + 1]).
+   */
+  struct Filter
+  {
+    //! Create an empty filter.
+    Filter() { }
+
+    /**
+     * Computes the filter of an axis.
+     *
+     * @param in Size of the input along the axis.
+     * @param out Size of the output along the axis.
+     * @param method Interpolation method.
+     */
+    Filter(const size_t in, const size_t out, const Method method) :
+        offsets(1, 0)
+    {
+      const double scale = (double) in / (double) out;
+      for (size_t i = 0; i < out; i++)
+      {
+        if (method == Method::Nearest)
+        {
+          Add(std::min((size_t) std::floor(i * scale), in - 1), 1.0);
+        }
+        else if (method == Method::Area)
+        {
+          // Weight of every input pixel is the part of it that's covered.
+          const double begin = i * scale, end = (i + 1) * scale;
+          for (size_t j = (size_t) std::floor(begin); j < in && j < end; j++)
+          {
+            Add(j, (std::min(end, j + 1.0) - std::max(begin, (double) j)) /
+                scale);
+          }
+        }
+        else if (in == 1)
+        {
+          Add(0, 1.0);
+        }
+        else
+        {
+          // Same origin and distance as mlpack::BilinearInterpolation.
+          size_t origin = (size_t) std::floor(i * scale);
+          if (origin > in - 2)
+            origin = in - 2;
+
+          const double delta = std::min(i * scale - origin, 1.0);
+          Add(origin, 1.0 - delta);
+          Add(origin + 1, delta);
+        }
+
+        offsets.push_back(sources.size());
+      }
+    }
+
+    //! Adds an input position with its weight to the current output.
+    void Add(const size_t source, const double weight)
+    {
+      sources.push_back(source);
+      weights.push_back(weight);
+    }
+
+    //! Index of the first entry of every output position, followed by the
+    //! total number of entries.
+    std::vector<size_t> offsets;
+    //! Input position of every entry.
+    std::vector<size_t> sources;
+    //! Weight of every entry.
+    std::vector<double> weights;
+  };
+
+  //! Converts a value to a floating point output type.
+  template<typename OutputType>
+  static OutputType Saturate(const double value,
+                             const std::true_type /* floatingPoint */)
+  {
+    return OutputType(value);
+  }
+
+  //! Converts a value to an integer output type with rounding, values out of
+  //! range of the type are clamped.
+  template<typename OutputType>
+  static OutputType Saturate(const double value,
+                             const std::false_type /* floatingPoint */)
+  {
+    return OutputType(std::round(std::min(std::max(value,
+        (double) std::numeric_limits<OutputType>::min()),
+        (double) std::numeric_limits<OutputType>::max())));
+  }
+
+  //! Locally stored width of an input image.
+  size_t inputWidth;
+
+  //! Locally stored height of an input image.
+  size_t inputHeight;
+
+  //! Locally stored number of channels.
+  size_t depth;
+
+  //! Locally stored width of a resized image.
+  size_t outputWidth;
+
+  //! Locally stored height of a resized image.
+  size_t outputHeight;
+
+  //! Locally stored filter along the width.
+  Filter horizontal;
+
+  //! Locally stored filter along the height.
+  Filter vertical;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
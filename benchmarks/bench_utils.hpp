@@ -0,0 +1,188 @@
+/**
+ * @file bench_utils.hpp
+ * @author Kartik Dutt
+ *
+ * Utilities shared by the benchmark programs: a timer, the median of timings
+ * and the parsing of command line options.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_BENCHMARKS_BENCH_UTILS_HPP
+#define MODELS_BENCHMARKS_BENCH_UTILS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mlpack {
+namespace models {
+namespace bench {
+
+/**
+ * Wall clock timer.
+ */
+class Timer
+{
+ public:
+  //! Create the timer, started.
+  Timer() : start(Clock::now())
+  {
+    // Nothing to do here.
+  }
+
+  //! Restart the timer.
+  void Start() { start = Clock::now(); }
+
+  //! Get the seconds since the timer was started.
+  double Seconds() const
+  {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  //! Locally stored time the timer was started.
+  Clock::time_point start;
+};
+
+/**
+ * Get the median of the given timings, which is less affected by a single
+ * slow run than the mean, or 0 if there are none.
+ */
+inline double Median(std::vector<double> times)
+{
+  if (times.empty())
+    return 0.0;
+
+  std::nth_element(times.begin(), times.begin() + times.size() / 2,
+      times.end());
+  return times[times.size() / 2];
+}
+
+/**
+ * Command line options of the form "--name value" or "--name=value". Only
+ * the options given defaults are known; lists of values are separated by
+ * commas.
+ */
+class Options
+{
+ public:
+  /**
+   * Parse the given command line.
+   *
+   * @param argc Number of arguments, including the program name.
+   * @param argv Arguments, including the program name.
+   * @param defaults Known options and their default values.
+   */
+  Options(const int argc,
+          char** argv,
+          const std::vector<std::pair<std::string, std::string>>& defaults) :
+      defaults(defaults),
+      valid(true)
+  {
+    for (const std::pair<std::string, std::string>& option : defaults)
+      values[option.first] = option.second;
+
+    for (int i = 1; i < argc && valid; i++)
+    {
+      std::string name = argv[i];
+      if (name.compare(0, 2, "--") != 0)
+      {
+        valid = false;
+        break;
+      }
+
+      name = name.substr(2);
+      std::string value;
+      const size_t equals = name.find('=');
+      if (equals != std::string::npos)
+      {
+        value = name.substr(equals + 1);
+        name = name.substr(0, equals);
+      }
+      else if (i + 1 < argc)
+      {
+        value = argv[++i];
+      }
+      else
+      {
+        valid = false;
+      }
+
+      if (values.count(name) == 0)
+        valid = false;
+      else
+        values[name] = value;
+    }
+  }
+
+  //! Get whether the command line was valid.
+  bool Valid() const { return valid; }
+
+  //! Get the value of the given option.
+  const std::string& Get(const std::string& name) const
+  {
+    return values.at(name);
+  }
+
+  //! Get the comma separated values of the given option.
+  std::vector<std::string> List(const std::string& name) const
+  {
+    std::vector<std::string> list;
+    std::istringstream stream(Get(name));
+    std::string value;
+    while (std::getline(stream, value, ','))
+    {
+      if (!value.empty())
+        list.push_back(value);
+    }
+
+    return list;
+  }
+
+  //! Get the comma separated sizes of the given option.
+  std::vector<size_t> Sizes(const std::string& name) const
+  {
+    std::vector<size_t> sizes;
+    for (const std::string& value : List(name))
+      sizes.push_back(std::stoul(value));
+    return sizes;
+  }
+
+  //! Get the usage of the known options, with their defaults.
+  std::string Usage() const
+  {
+    std::ostringstream usage;
+    for (const std::pair<std::string, std::string>& option : defaults)
+    {
+      usage << "[--" << option.first << " <value> (default: \""
+          << option.second << "\")] ";
+    }
+
+    return usage.str();
+  }
+
+ private:
+  //! Locally stored known options and their defaults, in order.
+  std::vector<std::pair<std::string, std::string>> defaults;
+
+  //! Locally stored values of the options.
+  std::map<std::string, std::string> values;
+
+  //! Locally stored whether the command line was valid.
+  bool valid;
+};
+
+} // namespace bench
+} // namespace models
+} // namespace mlpack
+
+#endif
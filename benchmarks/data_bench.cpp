@@ -0,0 +1,284 @@
+/**
+ * @file data_bench.cpp
+ * @author Kartik Dutt
+ *
+ * Benchmarks the data pipeline: loading CSV files, image directories and
+ * object detection datasets, every augmentation and the preprocessing of
+ * batches. All benchmarks run on synthetic fixtures of the given size, which
+ * are written to a directory before and removed after the run.
+ *
+ * Every benchmark prints one JSON object per line, so the results of two
+ * versions can be compared line by line.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include <mlpack.hpp>
+#include <augmentation/augmentation.hpp>
+#include <dataloader/dataloader.hpp>
+#include <dataloader/preprocessor.hpp>
+#include "bench_utils.hpp"
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <functional>
+
+using namespace mlpack;
+using namespace mlpack::models;
+
+//! Classes of the synthetic object detection dataset.
+static const std::vector<std::string> classes = { "background", "circle",
+    "square", "triangle" };
+
+/**
+ * Writes a CSV file of random values, the last column holds integer labels.
+ *
+ * @param path Path of the file.
+ * @param rows Number of rows.
+ * @param cols Number of columns, including the labels.
+ * @return Size of the file in bytes.
+ */
+size_t WriteCSV(const std::string& path, const size_t rows, const size_t cols)
+{
+  std::ofstream file(path);
+  arma::mat values(cols, rows, arma::fill::randu);
+  for (size_t i = 0; i < rows; i++)
+  {
+    for (size_t j = 0; j + 1 < cols; j++)
+      file << values(j, i) << ",";
+    file << size_t(values(cols - 1, i) * 10) << "\n";
+  }
+
+  file.close();
+  return boost::filesystem::file_size(path);
+}
+
+/**
+ * Writes random PNG images and a Pascal VOC annotation with random boxes for
+ * every image.
+ *
+ * @param imagesPath Directory of the images.
+ * @param annotationsPath Directory of the annotations.
+ * @param images Number of images.
+ * @param imageSize Width and height of the images.
+ * @param boxes Number of bounding boxes of every image.
+ */
+void WriteImages(const std::string& imagesPath,
+                 const std::string& annotationsPath,
+                 const size_t images,
+                 const size_t imageSize,
+                 const size_t boxes)
+{
+  data::ImageInfo info(imageSize, imageSize, 3);
+  for (size_t i = 0; i < images; i++)
+  {
+    const std::string name = "image_" + std::to_string(i) + ".png";
+    arma::Mat<unsigned char> image = arma::conv_to<arma::Mat<unsigned char>>::
+        from(arma::randi<arma::imat>(imageSize * imageSize * 3, 1,
+        arma::distr_param(0, 255)));
+    data::Save(imagesPath + name, image, info, true);
+
+    std::ofstream annotation(annotationsPath + "image_" + std::to_string(i) +
+        ".xml");
+    annotation << "<annotation>\n  <filename>" << name << "</filename>\n"
+        << "  <size>\n    <width>" << imageSize << "</width>\n    <height>"
+        << imageSize << "</height>\n    <depth>3</depth>\n  </size>\n";
+    for (size_t b = 0; b < boxes; b++)
+    {
+      const size_t x = arma::randi(arma::distr_param(0, imageSize / 2));
+      const size_t y = arma::randi(arma::distr_param(0, imageSize / 2));
+      annotation << "  <object>\n    <name>"
+          << classes[1 + b % (classes.size() - 1)] << "</name>\n"
+          << "    <bndbox>\n      <xmin>" << x << "</xmin>\n      <ymin>" << y
+          << "</ymin>\n      <xmax>" << x + imageSize / 2 << "</xmax>\n"
+          << "      <ymax>" << y + imageSize / 2 << "</ymax>\n"
+          << "    </bndbox>\n  </object>\n";
+    }
+    annotation << "</annotation>\n";
+  }
+}
+
+/**
+ * Times the given function and prints a line with its median time.
+ *
+ * @param output Stream the results are printed to.
+ * @param name Name of the benchmark.
+ * @param iterations Number of timed runs.
+ * @param rate Name of the throughput, e.g. "images_per_second".
+ * @param work Amount of work of a single run the throughput is computed of.
+ * @param prepare Function called before every run, not timed.
+ * @param run Function being timed.
+ */
+void Time(std::ostream& output,
+          const std::string& name,
+          const size_t iterations,
+          const std::string& rate,
+          const double work,
+          const std::function<void()>& prepare,
+          const std::function<void()>& run)
+{
+  bench::Timer timer;
+  std::vector<double> times;
+  for (size_t i = 0; i < iterations; i++)
+  {
+    prepare();
+    timer.Start();
+    run();
+    times.push_back(timer.Seconds());
+  }
+
+  const double seconds = bench::Median(times);
+  output << "{\"benchmark\":\"" << name << "\",\"seconds\":" << seconds
+      << ",\"" << rate << "\":" << (seconds > 0.0 ? work / seconds : 0.0)
+      << "}" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  bench::Options options(argc, argv, {
+      { "fixtures", "bench_fixtures" },
+      { "csv-rows", "100000" },
+      { "csv-cols", "20" },
+      { "images", "256" },
+      { "image-size", "128" },
+      { "boxes", "3" },
+      { "batch-size", "64" },
+      { "resize-sizes", "32,64,224" },
+      { "iterations", "3" },
+      { "output", "" } });
+  if (!options.Valid())
+  {
+    std::cerr << "Usage: data_bench " << options.Usage() << std::endl
+        << "The fixtures directory is relative to the working directory."
+        << std::endl;
+    return 1;
+  }
+
+  std::ofstream file;
+  if (!options.Get("output").empty())
+    file.open(options.Get("output"));
+  std::ostream& output = file.is_open() ? file : std::cout;
+
+  const size_t iterations = std::max<size_t>(1,
+      std::stoul(options.Get("iterations")));
+  const size_t images = std::stoul(options.Get("images"));
+  const size_t imageSize = std::stoul(options.Get("image-size"));
+  const size_t boxes = std::stoul(options.Get("boxes"));
+  const size_t batchSize = std::stoul(options.Get("batch-size"));
+
+  // The loaders expect paths relative to the working directory.
+  const std::string fixtures = options.Get("fixtures") + "/";
+  const std::string imagesPath = fixtures + "images/";
+  const std::string annotationsPath = fixtures + "annotations/";
+  boost::filesystem::create_directories(imagesPath);
+  boost::filesystem::create_directories(annotationsPath);
+
+  const std::string csvPath = fixtures + "data.csv";
+  const size_t csvBytes = WriteCSV(csvPath,
+      std::stoul(options.Get("csv-rows")), std::stoul(options.Get("csv-cols")));
+  WriteImages(imagesPath, annotationsPath, images, imageSize, boxes);
+
+  std::function<void()> nothing = []() { };
+
+  Time(output, "load_csv", iterations, "mb_per_second", csvBytes / 1e6,
+      nothing, [&]()
+      {
+        DataLoader<> dataloader;
+        dataloader.LoadCSV(csvPath, true, false, 0.25, false, 0, -2, -1, -1);
+      });
+
+  Time(output, "load_all_images_from_directory", iterations,
+      "images_per_second", images, nothing, [&]()
+      {
+        DataLoader<> dataloader;
+        arma::mat dataset, labels;
+        dataloader.LoadAllImagesFromDirectory(imagesPath, dataset, labels,
+            imageSize, imageSize, 3);
+      });
+
+  const std::string resize = "resize = (" + std::to_string(imageSize) + ", " +
+      std::to_string(imageSize) + ")";
+  Time(output, "load_object_detection_dataset", iterations,
+      "annotations_per_second", images * boxes, nothing, [&]()
+      {
+        DataLoader<arma::mat, arma::field<arma::vec>> dataloader;
+        dataloader.LoadObjectDetectionDataset(annotationsPath, imagesPath,
+            classes, 0.0, false, { resize });
+      });
+
+  // Batches are stored channel by channel, as the augmentations expect.
+  const arma::mat batch(imageSize * imageSize * 3, batchSize,
+      arma::fill::randu);
+  arma::mat input;
+  std::function<void()> copy = [&]() { input = batch; };
+
+  for (const size_t size : options.Sizes("resize-sizes"))
+  {
+    for (const std::string method : { "", "-nearest", "-area" })
+    {
+      const Augmentation augmentation({ "resize" + method + " = (" +
+          std::to_string(size) + ", " + std::to_string(size) + ")" }, 1.0);
+      Time(output, "augmentation_resize" + method + "_" +
+          std::to_string(size), iterations, "images_per_second", batchSize,
+          copy, [&]()
+          {
+            augmentation.ResizeTransform(input, imageSize, imageSize, 3);
+          });
+    }
+  }
+
+  const std::vector<std::pair<std::string, std::string>> operations = {
+      { "horizontal_flip", "horizontal-flip" },
+      { "vertical_flip", "vertical-flip" },
+      { "random_crop", "random-crop = 8" },
+      { "random_scale", "random-scale = 0.2" },
+      { "brightness", "brightness = 0.2" },
+      { "contrast", "contrast = 0.2" },
+      { "noise", "noise = 0.05" } };
+  for (const std::pair<std::string, std::string>& operation : operations)
+  {
+    // Every operation is applied to every image.
+    const Augmentation augmentation({ operation.second }, 1.0);
+    size_t seed = 0;
+    Time(output, "augmentation_" + operation.first, iterations,
+        "images_per_second", batchSize, copy, [&]()
+        {
+          augmentation.RandomTransform(input, imageSize, imageSize, 3,
+              seed++);
+        });
+  }
+
+  BoxStore annotations;
+  annotations.Reserve(batchSize, batchSize * boxes);
+  for (size_t i = 0; i < batchSize; i++)
+  {
+    arma::vec imageBoxes(5 * boxes);
+    for (size_t b = 0; b < boxes; b++)
+    {
+      const double x = arma::randu() * imageSize / 2;
+      const double y = arma::randu() * imageSize / 2;
+      imageBoxes.subvec(5 * b, 5 * b + 4) = arma::vec({ double(1 + b % 3), x,
+          y, x + imageSize / 2.0, y + imageSize / 2.0 });
+    }
+    annotations.Add(imageBoxes);
+  }
+
+  arma::mat targets;
+  Time(output, "yolo_preprocessor", iterations, "images_per_second",
+      batchSize, nothing, [&]()
+      {
+        PreProcessor<>::YOLOPreProcessor(annotations,
+            targets, 1, imageSize, imageSize);
+      });
+
+  Time(output, "channel_first_images", iterations, "images_per_second",
+      batchSize, copy, [&]()
+      {
+        PreProcessor<>::ChannelFirstImages(input,
+            imageSize, imageSize, 3);
+      });
+
+  boost::filesystem::remove_all(fixtures);
+  return 0;
+}
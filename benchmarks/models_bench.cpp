@@ -0,0 +1,252 @@
+/**
+ * @file models_bench.cpp
+ * @author Kartik Dutt
+ *
+ * Benchmarks the forward pass, the backward pass and a full training step of
+ * the models for several batch sizes, thread counts and element types.
+ *
+ * Every configuration prints one JSON object per line, so the results of two
+ * versions can be compared line by line.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include <mlpack.hpp>
+#include <models/alexnet/alexnet.hpp>
+#include <models/darknet/darknet.hpp>
+#include <models/mobilenet/mobilenet_v1.hpp>
+#include <models/resnet/resnet.hpp>
+#include <models/squeezenet/squeezenet.hpp>
+#include <models/vgg/vgg.hpp>
+#include <models/xception/xception.hpp>
+#include <models/yolo/yolo.hpp>
+#include <ensmallen_utils/training_telemetry.hpp>
+#include "bench_utils.hpp"
+#include <fstream>
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::models;
+
+//! Names of all benchmarked models.
+static const char* allModels =
+    "alexnet,vgg16,squeezenet,xception,resnet18,resnet50,mobilenet,"
+    "darknet19,darknet53,yolo";
+
+/**
+ * Creates the given model of those that compute in any precision.
+ *
+ * @param name Name of the model, e.g. "resnet50".
+ * @param inputSize Set to the width and height of its input images.
+ * @return The model, nullptr if the name is unknown.
+ */
+template<typename MatType>
+Layer<MatType>* MakeModel(const std::string& name, size_t& inputSize)
+{
+  inputSize = 224;
+  if (name == "resnet18")
+    return new ResNetType<MatType, 18>(1000);
+  else if (name == "resnet50")
+    return new ResNetType<MatType, 50>(1000);
+  else if (name == "mobilenet")
+    return new MobileNetV1Type<MatType>(1000);
+  else if (name == "darknet19")
+    return new DarkNetType<MatType, 19>(1000);
+  else if (name == "darknet53")
+    return new DarkNetType<MatType, 53>(1000);
+
+  if (name == "yolo")
+  {
+    inputSize = 448;
+    return new YOLOType<MatType>("v1-tiny");
+  }
+
+  return nullptr;
+}
+
+/**
+ * Creates the given model computing in double precision.
+ *
+ * @param name Name of the model, e.g. "resnet50".
+ * @param inputSize Set to the width and height of its input images.
+ * @return The model, nullptr if the name is unknown.
+ */
+Layer<arma::mat>* MakeModel(const std::string& name,
+                            size_t& inputSize,
+                            const arma::mat& /* tag */)
+{
+  inputSize = 224;
+  if (name == "alexnet")
+    return new AlexNet(1000);
+  else if (name == "vgg16")
+    return new VGG16(1000);
+  else if (name == "squeezenet")
+    return new SqueezeNet1(1000);
+
+  if (name == "xception")
+  {
+    inputSize = 299;
+    return new Xception(1000);
+  }
+
+  return MakeModel<arma::mat>(name, inputSize);
+}
+
+/**
+ * Creates the given model computing in single precision. AlexNet, VGG,
+ * SqueezeNet and Xception are built of double precision layers, so they
+ * aren't available.
+ *
+ * @param name Name of the model, e.g. "resnet50".
+ * @param inputSize Set to the width and height of its input images.
+ * @return The model, nullptr if the name is unknown or the model isn't
+ *     available in single precision.
+ */
+Layer<arma::fmat>* MakeModel(const std::string& name,
+                             size_t& inputSize,
+                             const arma::fmat& /* tag */)
+{
+  return MakeModel<arma::fmat>(name, inputSize);
+}
+
+/**
+ * Benchmarks one configuration of a model and prints a line per phase.
+ *
+ * @param name Name of the model.
+ * @param type Name of the element type.
+ * @param batchSize Number of images of a batch.
+ * @param threads Number of OpenMP threads.
+ * @param iterations Number of timed passes of every phase.
+ * @param output Stream the results are printed to.
+ */
+template<typename MatType>
+void Benchmark(const std::string& name,
+               const std::string& type,
+               const size_t batchSize,
+               const size_t threads,
+               const size_t iterations,
+               std::ostream& output)
+{
+  size_t inputSize;
+  Layer<MatType>* model = MakeModel(name, inputSize, MatType());
+  if (model == nullptr)
+  {
+    output << "{\"model\":\"" << name << "\",\"type\":\"" << type
+        << "\",\"skipped\":true}" << std::endl;
+    return;
+  }
+
+  #ifdef _OPENMP
+    omp_set_num_threads(threads);
+  #endif
+
+  FFN<MeanSquaredError, RandomInitialization, MatType> network;
+  network.InputDimensions() = std::vector<size_t>({inputSize, inputSize, 3});
+  network.Add(model);
+  network.Reset();
+
+  MatType input(inputSize * inputSize * 3, batchSize, arma::fill::randu);
+  MatType outputs, gradient;
+  network.Predict(input, outputs, batchSize);
+  MatType target(outputs.n_rows, batchSize, arma::fill::randu);
+
+  bench::Timer timer;
+  std::vector<double> forward, backward, step;
+  for (size_t i = 0; i <= iterations; i++)
+  {
+    // The first pass of every phase allocates, so it isn't timed.
+    timer.Start();
+    network.Predict(input, outputs, batchSize);
+    if (i > 0)
+      forward.push_back(timer.Seconds());
+
+    network.SetNetworkMode(true);
+    network.Forward(input, outputs);
+    timer.Start();
+    network.Backward(input, target, gradient);
+    if (i > 0)
+      backward.push_back(timer.Seconds());
+
+    timer.Start();
+    network.Forward(input, outputs);
+    network.Backward(input, target, gradient);
+    network.Parameters() -= 1e-6 * gradient;
+    if (i > 0)
+      step.push_back(timer.Seconds());
+  }
+
+  const std::string prefix = "{\"model\":\"" + name + "\",\"type\":\"" + type +
+      "\",\"batch_size\":" + std::to_string(batchSize) + ",\"threads\":" +
+      std::to_string(threads);
+  const char* phases[] = { "forward", "backward", "train_step" };
+  const std::vector<double>* times[] = { &forward, &backward, &step };
+  for (size_t p = 0; p < 3; p++)
+  {
+    const double seconds = bench::Median(*times[p]);
+    output << prefix << ",\"phase\":\"" << phases[p]
+        << "\",\"seconds_per_batch\":" << seconds
+        << ",\"images_per_second\":" << batchSize / seconds
+        << ",\"peak_memory_bytes\":" << ens::TrainingTelemetry::PeakMemory()
+        << "}" << std::endl;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  bench::Options options(argc, argv, {
+      { "models", allModels },
+      { "batch-sizes", "1,8,32" },
+      { "threads", "1" },
+      { "types", "double,float" },
+      { "iterations", "3" },
+      { "output", "" } });
+  if (!options.Valid())
+  {
+    std::cerr << "Usage: models_bench " << options.Usage() << std::endl
+        << "Peak memory is the peak of the process so far; benchmark a single "
+        << "configuration per run to compare it." << std::endl;
+    return 1;
+  }
+
+  std::ofstream file;
+  if (!options.Get("output").empty())
+    file.open(options.Get("output"));
+  std::ostream& output = file.is_open() ? file : std::cout;
+
+  const size_t iterations = std::max<size_t>(1,
+      std::stoul(options.Get("iterations")));
+  for (const std::string& name : options.List("models"))
+  {
+    for (const std::string& type : options.List("types"))
+    {
+      for (const size_t batchSize : options.Sizes("batch-sizes"))
+      {
+        for (const size_t threads : options.Sizes("threads"))
+        {
+          if (type == "double")
+          {
+            Benchmark<arma::mat>(name, type, batchSize, threads, iterations,
+                output);
+          }
+          else if (type == "float")
+          {
+            Benchmark<arma::fmat>(name, type, batchSize, threads, iterations,
+                output);
+          }
+          else
+          {
+            std::cerr << "Unknown element type " << type << "; expected "
+                << "double or float." << std::endl;
+            return 1;
+          }
+        }
+      }
+    }
+  }
+
+  return 0;
+}
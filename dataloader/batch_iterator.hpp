@@ -0,0 +1,547 @@
+/**
+ * @file batch_iterator.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of FileIndex and BatchIterator used for streaming image datasets
+ * from disk in mini-batches.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_DATALOADER_BATCH_ITERATOR_HPP
+#define MODELS_DATALOADER_BATCH_ITERATOR_HPP
+
+#include <mlpack.hpp>
+#include <augmentation/augmentation.hpp>
+#include <dataloader/box_store.hpp>
+#include <dataloader/image_decoder.hpp>
+#include <random>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * A light-weight index over images stored on disk. Only paths, labels and
+ * shapes are held in memory, images are decoded when a batch is requested.
+ */
+struct FileIndex
+{
+  //! Create an empty index.
+  FileIndex() : depth(0)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Add a file to the index.
+   *
+   * @param file Path to the image.
+   * @param label Label of the image. This is a single element for
+   *              classification or bounding boxes for object detection.
+   * @param width Width of the image stored on disk.
+   * @param height Height of the image stored on disk.
+   */
+  void Add(const std::string& file,
+           const arma::vec& label,
+           const size_t width,
+           const size_t height)
+  {
+    files.push_back(file);
+    labels.push_back(label);
+    widths.push_back(width);
+    heights.push_back(height);
+  }
+
+  /**
+   * Creates a new index holding the entries in given order.
+   *
+   * @param indices Indices of the entries that will be copied.
+   */
+  FileIndex Subset(const arma::uvec& indices) const
+  {
+    FileIndex subset;
+    subset.depth = depth;
+    for (size_t i = 0; i < indices.n_elem; i++)
+    {
+      subset.Add(files[indices[i]], labels[indices[i]], widths[indices[i]],
+          heights[indices[i]]);
+    }
+
+    return subset;
+  }
+
+  //! Get the number of files in the index.
+  size_t Size() const { return files.size(); }
+
+  //! Paths to the images.
+  std::vector<std::string> files;
+
+  //! Label of each image.
+  std::vector<arma::vec> labels;
+
+  //! Width of each image on disk.
+  std::vector<size_t> widths;
+
+  //! Height of each image on disk.
+  std::vector<size_t> heights;
+
+  //! Depth shared by all images.
+  size_t depth;
+};
+
+/**
+ * BatchIterator streams a dataset described by a FileIndex in fixed size
+ * mini-batches. Images of a batch are decoded (and resized if resize
+ * augmentation is given) only when the batch is requested, so peak memory
+ * depends on the batch size rather than on the size of the dataset.
+ *
+ * BatchIterator can also iterate over a dataset that is already in memory.
+ * Shuffling then permutes the order of data points, only the columns of the
+ * requested batch are copied. The dataset can be stored in a more compact
+ * type than the batches, e.g. raw pixels as arma::Mat<uint8_t>, conversion
+ * and scaling are done while a batch is copied.
+ *
+ * Random augmentations such as flips are applied to every batch as it's
+ * assembled, so a different version of every data point is seen in every
+ * epoch without storing augmented copies. Data points of a batch are
+ * augmented in parallel and in place. Augmentations are drawn from the seed
+ * of the epoch, so an epoch started with Reset(seed) is reproducible. Flips,
+ * crops and scales of object detection batches move the bounding boxes along
+ * with the images.
+ *
+ * Each batch is a regular matrix with one data point per column, so it can be
+ * handed to the model and ensmallen directly.
+ *
+ * @code
+ * DataLoader<> dataloader;
+ * dataloader.IndexImageDatasetFromDirectory("./../data/cifar10/", 32, 32, 3);
+ *
+ * BatchIterator<> batches = dataloader.TrainBatches(32);
+ * ens::Adam optimizer(0.001, 32, 0.9, 0.999, 1e-8, 32);
+ * optimizer.ResetPolicy() = false;
+ *
+ * arma::mat features, labels;
+ * for (size_t epoch = 0; epoch < 10; epoch++)
+ * {
+ *   batches.Reset();
+ *   while (batches.Next(features, labels))
+ *     model.Train(features, labels, optimizer);
+ * }
+ * @endcode
+ *
+ * @tparam DatasetX Datatype for input features of a batch.
+ * @tparam DatasetY Datatype for labels.
+ * @tparam SourceType Datatype of input features of a dataset in memory.
+ */
+template<
+  typename DatasetX = arma::mat,
+  typename DatasetY = arma::mat,
+  typename SourceType = DatasetX
+>
+class BatchIterator
+{
+ public:
+  //! Create an empty BatchIterator object.
+  BatchIterator();
+
+  /**
+   * Create BatchIterator object over the given index.
+   *
+   * @param index Index of files that will be streamed.
+   * @param batchSize Number of data points in each batch.
+   * @param shuffle Boolean to determine whether the order of data points is
+   *                shuffled every epoch.
+   * @param augmentation Vector strings of augmentations supported by mlpack.
+   * @param augmentationProbability Probability of applying augmentation
+   *                                to a particular image.
+   * @param scale Factor every feature of a batch is multiplied with, e.g.
+   *              1.0 / 255 to normalize pixels.
+   */
+  BatchIterator(const FileIndex& index,
+                const size_t batchSize = 32,
+                const bool shuffle = true,
+                const std::vector<std::string>& augmentation =
+                    std::vector<std::string>(),
+                const double augmentationProbability = 0.2,
+                const double scale = 1.0);
+
+  /**
+   * Create BatchIterator object over a dataset in memory. The dataset isn't
+   * copied and must outlive the BatchIterator.
+   *
+   * @param features Features of the dataset, one data point per column.
+   * @param labels Labels of the dataset, one data point per column.
+   * @param batchSize Number of data points in each batch.
+   * @param shuffle Boolean to determine whether the order of data points is
+   *                shuffled every epoch.
+   * @param scale Factor every feature of a batch is multiplied with, e.g.
+   *              1.0 / 255 to normalize pixels.
+   * @param augmentation Vector strings of augmentations supported by mlpack.
+   *                     Resize is ignored, the dataset is expected to be
+   *                     resized already.
+   * @param augmentationProbability Probability of applying augmentation
+   *                                to a particular image.
+   * @param width Width of a single data point, needed for augmentation.
+   * @param height Height of a single data point.
+   * @param depth Depth of a single data point.
+   */
+  BatchIterator(const SourceType& features,
+                const DatasetY& labels,
+                const size_t batchSize = 32,
+                const bool shuffle = true,
+                const double scale = 1.0,
+                const std::vector<std::string>& augmentation =
+                    std::vector<std::string>(),
+                const double augmentationProbability = 0.2,
+                const size_t width = 0,
+                const size_t height = 0,
+                const size_t depth = 1);
+
+  /**
+   * Starts a new epoch. The order of data points is shuffled if shuffle
+   * was set.
+   */
+  void Reset();
+
+  /**
+   * Starts a new epoch. If shuffle was set, the order of data points is
+   * shuffled with a generator seeded by the given seed, so the same seed
+   * always gives the same order.
+   *
+   * @param seed Seed used to shuffle the order of data points.
+   */
+  void Reset(const size_t seed);
+
+  //! Returns true if there are batches left in the current epoch.
+  bool HasNext() const { return position < NumSamples(); }
+
+  /**
+   * Decodes the next batch of the current epoch. The last batch of an epoch
+   * can be smaller than the batch size.
+   *
+   * @param features Matrix where decoded images will be stored.
+   * @param labels Labels corresponding to decoded images.
+   * @return false if the epoch has no batches left, otherwise true.
+   */
+  bool Next(DatasetX& features, DatasetY& labels);
+
+  /**
+   * Decodes the batch at given position of the current epoch.
+   *
+   * @param batch Index of the batch in the current epoch.
+   * @param features Matrix where decoded images will be stored.
+   * @param labels Labels corresponding to decoded images.
+   */
+  void Batch(const size_t batch, DatasetX& features, DatasetY& labels);
+
+  //! Get the number of batches in an epoch.
+  size_t NumBatches() const
+  {
+    return (NumSamples() + batchSize - 1) / batchSize;
+  }
+
+  //! Get the number of data points.
+  size_t NumSamples() const
+  {
+    return sourceFeatures ? sourceFeatures->n_cols : index.Size();
+  }
+
+  //! Get the batch size.
+  size_t BatchSize() const { return batchSize; }
+  //! Modify the batch size.
+  size_t& BatchSize() { return batchSize; }
+
+  //! Get the factor features of a batch are multiplied with.
+  double Scale() const { return scale; }
+  //! Modify the factor features of a batch are multiplied with.
+  double& Scale() { return scale; }
+
+  //! Get whether random augmentations are applied to batches.
+  bool RandomAugmentation() const { return randomAugmentation; }
+  //! Modify whether random augmentations are applied to batches, e.g. to
+  //! disable them for validation.
+  bool& RandomAugmentation() { return randomAugmentation; }
+
+  //! Get the number of rows of a single data point in the batch.
+  size_t OutputSize() const
+  {
+    return sourceFeatures ? sourceFeatures->n_rows :
+        outputWidth * outputHeight * index.depth;
+  }
+
+  //! Get the file index. The index is empty for datasets in memory.
+  const FileIndex& Index() const { return index; }
+
+  //! Get the order of data points in the current epoch.
+  const arma::uvec& Order() const { return order; }
+
+ private:
+  /**
+   * Decodes data points in the given range of the current order.
+   *
+   * @param begin Position of the first data point.
+   * @param size Number of data points to decode.
+   * @param features Matrix where decoded images will be stored.
+   * @param labels Labels corresponding to decoded images.
+   */
+  void Decode(const size_t begin,
+              const size_t size,
+              DatasetX& features,
+              DatasetY& labels);
+
+  /**
+   * Copies the given data points of a dataset in memory, converting them to
+   * the batch type.
+   *
+   * @param indices Indices of the data points.
+   * @param features Matrix where features will be stored.
+   * @param labels Labels corresponding to the features.
+   */
+  void Gather(const arma::uvec& indices,
+              DatasetX& features,
+              DatasetY& labels) const;
+
+  //! Get whether random augmentations are applied to the batches.
+  bool Augments() const
+  {
+    return randomAugmentation && augmentation.HasRandomTransform() &&
+        outputWidth > 0;
+  }
+
+  /**
+   * Applies random augmentations to a batch with matrix type labels.
+   *
+   * @param begin Position of the first data point of the batch.
+   * @param features Features of the batch, augmented in place.
+   */
+  template<typename eT>
+  void Augment(const size_t begin,
+               DatasetX& features,
+               arma::Mat<eT>& /* labels */) const
+  {
+    if (!Augments())
+      return;
+
+    augmentation.RandomTransform(features, outputWidth, outputHeight,
+        outputDepth, epochSeed + begin);
+  }
+
+  /**
+   * Applies random augmentations to a batch of an object detection dataset.
+   * Bounding boxes are moved along with their images.
+   *
+   * @param begin Position of the first data point of the batch.
+   * @param features Features of the batch, augmented in place.
+   * @param labels Bounding boxes of the batch, moved in place.
+   */
+  void Augment(const size_t begin,
+               DatasetX& features,
+               BoxStore& labels) const
+  {
+    if (!Augments())
+      return;
+
+    arma::mat transforms;
+    augmentation.RandomTransform(features, outputWidth, outputHeight,
+        outputDepth, epochSeed + begin, transforms);
+    labels.Transform(transforms, outputWidth, outputHeight);
+  }
+
+  /**
+   * Applies random augmentations to a batch of an object detection dataset
+   * with field type labels. Bounding boxes are moved along with their images.
+   *
+   * @param begin Position of the first data point of the batch.
+   * @param features Features of the batch, augmented in place.
+   * @param labels Bounding boxes of the batch, moved in place.
+   */
+  void Augment(const size_t begin,
+               DatasetX& features,
+               arma::field<arma::vec>& labels) const
+  {
+    if (!Augments())
+      return;
+
+    // Boxes of all images are moved at once in a BoxStore.
+    BoxStore boxes;
+    for (size_t i = 0; i < labels.n_elem; i++)
+      boxes.Add(labels(i));
+
+    Augment(begin, features, boxes);
+    for (size_t i = 0; i < labels.n_elem; i++)
+      labels(i) = boxes.Boxes(i);
+  }
+
+  //! Copies field type labels of the given data points.
+  static void GatherLabels(const arma::field<arma::vec>& source,
+                           const arma::uvec& indices,
+                           arma::field<arma::vec>& labels)
+  {
+    labels.set_size(1, indices.n_elem);
+    for (size_t i = 0; i < indices.n_elem; i++)
+      labels(0, i) = source(0, indices[i]);
+  }
+
+  //! Copies BoxStore type labels of the given data points.
+  static void GatherLabels(const BoxStore& source,
+                           const arma::uvec& indices,
+                           BoxStore& labels)
+  {
+    labels = source.Subset(indices);
+  }
+
+  //! Copies matrix type labels of the given data points. Labels are left
+  //! empty if the dataset has no labels.
+  template<typename eT>
+  static void GatherLabels(const arma::Mat<eT>& source,
+                           const arma::uvec& indices,
+                           arma::Mat<eT>& labels)
+  {
+    if (source.n_cols == 0)
+      labels.reset();
+    else
+      labels = source.cols(indices);
+  }
+
+  /**
+   * Allocates field type labels for a batch.
+   *
+   * @param labels Labels of the batch.
+   * @param size Number of data points in the batch.
+   */
+  void InitLabels(arma::field<arma::vec>& labels,
+                  const size_t /* rows */,
+                  const size_t size)
+  {
+    labels.set_size(1, size);
+  }
+
+  /**
+   * Clears BoxStore type labels for a batch. Memory of the previous batch is
+   * reused.
+   *
+   * @param labels Labels of the batch.
+   */
+  void InitLabels(BoxStore& labels,
+                  const size_t /* rows */,
+                  const size_t /* size */)
+  {
+    labels.Clear();
+  }
+
+  /**
+   * Allocates matrix type labels for a batch. All labels are expected to have
+   * the same number of elements.
+   *
+   * @param labels Labels of the batch.
+   * @param rows Number of elements in a single label.
+   * @param size Number of data points in the batch.
+   */
+  template<typename eT>
+  void InitLabels(arma::Mat<eT>& labels, const size_t rows, const size_t size)
+  {
+    labels.set_size(rows, size);
+  }
+
+  /**
+   * Fills label of a data point for field type labels.
+   *
+   * @param labels Labels of the batch.
+   * @param i Column of the data point in the batch.
+   * @param label Label of the data point.
+   */
+  void SetLabel(arma::field<arma::vec>& labels,
+                const size_t i,
+                const arma::vec& label)
+  {
+    labels(0, i) = label;
+  }
+
+  /**
+   * Fills label of a data point for BoxStore type labels. Labels must be
+   * filled in order of their columns.
+   *
+   * @param labels Labels of the batch.
+   * @param label Label of the data point.
+   */
+  void SetLabel(BoxStore& labels,
+                const size_t /* i */,
+                const arma::vec& label)
+  {
+    labels.Add(label);
+  }
+
+  /**
+   * Fills label of a data point for matrix type labels.
+   *
+   * @param labels Labels of the batch.
+   * @param i Column of the data point in the batch.
+   * @param label Label of the data point.
+   */
+  template<typename eT>
+  void SetLabel(arma::Mat<eT>& labels,
+                const size_t i,
+                const arma::vec& label)
+  {
+    if (label.n_elem != labels.n_rows)
+    {
+      mlpack::Log::Fatal << "Labels of a batch must have the same number of "
+          << "elements, use field type for variable sized labels."
+          << std::endl;
+    }
+
+    labels.col(i) = arma::conv_to<arma::Col<eT>>::from(label);
+  }
+
+  //! Locally stored index of files.
+  FileIndex index;
+
+  //! Locally stored pointer to features of a dataset in memory.
+  const SourceType* sourceFeatures;
+
+  //! Locally stored pointer to labels of a dataset in memory.
+  const DatasetY* sourceLabels;
+
+  //! Locally stored size of a batch.
+  size_t batchSize;
+
+  //! Locally stored value to determine whether data is shuffled every epoch.
+  bool shuffle;
+
+  //! Locally stored factor features of a batch are multiplied with.
+  double scale;
+
+  //! Locally stored augmentations applied to every batch.
+  Augmentation augmentation;
+
+  //! Locally stored width of a data point in the batch.
+  size_t outputWidth;
+
+  //! Locally stored height of a data point in the batch.
+  size_t outputHeight;
+
+  //! Locally stored depth of a data point in the batch.
+  size_t outputDepth;
+
+  //! Locally stored value to determine whether random augmentations are
+  //! applied.
+  bool randomAugmentation;
+
+  //! Locally stored seed of the random augmentations of the current epoch.
+  size_t epochSeed;
+
+  //! Locally stored order of data points in the current epoch.
+  arma::uvec order;
+
+  //! Locally stored position in the current epoch.
+  size_t position;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#include "batch_iterator_impl.hpp" // Include implementation.
+
+#endif
@@ -0,0 +1,274 @@
+/**
+ * @file batch_iterator_impl.hpp
+ * @author Kartik Dutt
+ *
+ * Implementation of BatchIterator.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_DATALOADER_BATCH_ITERATOR_IMPL_HPP
+#define MODELS_DATALOADER_BATCH_ITERATOR_IMPL_HPP
+
+#include "batch_iterator.hpp"
+
+namespace mlpack {
+namespace models {
+
+template<typename DatasetX, typename DatasetY, typename SourceType>
+BatchIterator<DatasetX, DatasetY, SourceType>::BatchIterator() :
+    sourceFeatures(nullptr),
+    sourceLabels(nullptr),
+    batchSize(32),
+    shuffle(false),
+    scale(1.0),
+    outputWidth(0),
+    outputHeight(0),
+    outputDepth(0),
+    randomAugmentation(true),
+    epochSeed(0),
+    position(0)
+{
+  // Nothing to do here.
+}
+
+template<typename DatasetX, typename DatasetY, typename SourceType>
+BatchIterator<DatasetX, DatasetY, SourceType>::BatchIterator(
+    const FileIndex& index,
+    const size_t batchSize,
+    const bool shuffle,
+    const std::vector<std::string>& augmentation,
+    const double augmentationProbability,
+    const double scale) :
+    index(index),
+    sourceFeatures(nullptr),
+    sourceLabels(nullptr),
+    batchSize(batchSize),
+    shuffle(shuffle),
+    scale(scale),
+    augmentation(augmentation, augmentationProbability),
+    outputWidth(0),
+    outputHeight(0),
+    outputDepth(index.depth),
+    randomAugmentation(true),
+    epochSeed(0),
+    position(0)
+{
+  if (batchSize == 0)
+    mlpack::Log::Fatal << "Batch size must be greater than zero." << std::endl;
+
+  if (index.Size() > 0)
+  {
+    outputWidth = index.widths[0];
+    outputHeight = index.heights[0];
+  }
+
+  // Every image is resized as soon as it's decoded.
+  if (this->augmentation.HasResize())
+  {
+    outputWidth = this->augmentation.ResizeWidth();
+    outputHeight = this->augmentation.ResizeHeight();
+  }
+
+  Reset();
+}
+
+template<typename DatasetX, typename DatasetY, typename SourceType>
+BatchIterator<DatasetX, DatasetY, SourceType>::BatchIterator(
+    const SourceType& features,
+    const DatasetY& labels,
+    const size_t batchSize,
+    const bool shuffle,
+    const double scale,
+    const std::vector<std::string>& augmentation,
+    const double augmentationProbability,
+    const size_t width,
+    const size_t height,
+    const size_t depth) :
+    sourceFeatures(&features),
+    sourceLabels(&labels),
+    batchSize(batchSize),
+    shuffle(shuffle),
+    scale(scale),
+    augmentation(augmentation, augmentationProbability),
+    outputWidth(width),
+    outputHeight(height),
+    outputDepth(depth),
+    randomAugmentation(true),
+    epochSeed(0),
+    position(0)
+{
+  if (batchSize == 0)
+    mlpack::Log::Fatal << "Batch size must be greater than zero." << std::endl;
+
+  if (width > 0 && width * height * depth != features.n_rows)
+  {
+    mlpack::Log::Fatal << "Data points of shape " << width << " x " << height
+        << " x " << depth << " don't match the " << features.n_rows
+        << " rows of the dataset." << std::endl;
+  }
+
+  Reset();
+}
+
+template<typename DatasetX, typename DatasetY, typename SourceType>
+void BatchIterator<DatasetX, DatasetY, SourceType>::Reset()
+{
+  position = 0;
+  epochSeed = mlpack::RandInt(std::numeric_limits<int>::max());
+  if (NumSamples() == 0)
+  {
+    order.reset();
+    return;
+  }
+
+  // Only the order of data points is shuffled, data is copied batch by batch.
+  order = arma::linspace<arma::uvec>(0, NumSamples() - 1, NumSamples());
+  if (shuffle)
+    order = arma::shuffle(order);
+}
+
+template<typename DatasetX, typename DatasetY, typename SourceType>
+void BatchIterator<DatasetX, DatasetY, SourceType>::Reset(const size_t seed)
+{
+  position = 0;
+  epochSeed = seed;
+  if (NumSamples() == 0)
+  {
+    order.reset();
+    return;
+  }
+
+  order = arma::linspace<arma::uvec>(0, NumSamples() - 1, NumSamples());
+  if (shuffle)
+  {
+    std::mt19937 generator(seed);
+    std::shuffle(order.begin(), order.end(), generator);
+  }
+}
+
+template<typename DatasetX, typename DatasetY, typename SourceType>
+bool BatchIterator<DatasetX, DatasetY, SourceType>::Next(
+    DatasetX& features,
+    DatasetY& labels)
+{
+  if (!HasNext())
+    return false;
+
+  const size_t size = std::min(batchSize, NumSamples() - position);
+  Decode(position, size, features, labels);
+  position += size;
+  return true;
+}
+
+template<typename DatasetX, typename DatasetY, typename SourceType>
+void BatchIterator<DatasetX, DatasetY, SourceType>::Batch(
+    const size_t batch,
+    DatasetX& features,
+    DatasetY& labels)
+{
+  if (batch >= NumBatches())
+  {
+    mlpack::Log::Fatal << "Batch " << batch << " is out of range, an epoch "
+        << "has only " << NumBatches() << " batches." << std::endl;
+  }
+
+  const size_t begin = batch * batchSize;
+  Decode(begin, std::min(batchSize, NumSamples() - begin), features, labels);
+}
+
+template<typename DatasetX, typename DatasetY, typename SourceType>
+void BatchIterator<DatasetX, DatasetY, SourceType>::Decode(
+    const size_t begin,
+    const size_t size,
+    DatasetX& features,
+    DatasetY& labels)
+{
+  if (sourceFeatures)
+  {
+    Gather(order.subvec(begin, begin + size - 1), features, labels);
+    Augment(begin, features, labels);
+    return;
+  }
+
+  // Memory of the previous batch is reused if the shape doesn't change.
+  features.set_size(OutputSize(), size);
+  InitLabels(labels, index.labels[order[begin]].n_elem, size);
+
+  // Images of the batch are decoded in parallel, each one straight into its
+  // own column.
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < size; i++)
+  {
+    const size_t sample = order[begin + i];
+    const size_t width = index.widths[sample];
+    const size_t height = index.heights[sample];
+
+    DatasetX image;
+    const bool decoded = ImageDecoder::Decode(index.files[sample], width,
+        height, index.depth, image);
+    if (decoded)
+      augmentation.ResizeTransform(image, width, height, index.depth);
+
+    if (!decoded || image.n_elem != features.n_rows)
+    {
+      #pragma omp critical
+      mlpack::Log::Warn << "Unable to decode " << index.files[sample] <<
+          " with shape {" << width << ", " << height << ", " << index.depth <<
+          "}. It will be filled with zeros." << std::endl;
+      features.col(i).zeros();
+    }
+    else
+    {
+      features.col(i) = image;
+      if (scale != 1.0)
+        features.col(i) *= scale;
+    }
+  }
+
+  for (size_t i = 0; i < size; i++)
+    SetLabel(labels, i, index.labels[order[begin + i]]);
+
+  Augment(begin, features, labels);
+}
+
+template<typename DatasetX, typename DatasetY, typename SourceType>
+void BatchIterator<DatasetX, DatasetY, SourceType>::Gather(
+    const arma::uvec& indices,
+    DatasetX& features,
+    DatasetY& labels) const
+{
+  typedef typename DatasetX::elem_type ElemType;
+  typedef typename SourceType::elem_type SourceElemType;
+
+  // Conversion to the batch type and scaling are fused into the copy, so
+  // data points can be stored in a compact type such as uint8.
+  const size_t rows = sourceFeatures->n_rows;
+  features.set_size(rows, indices.n_elem);
+
+  #pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < indices.n_elem; i++)
+  {
+    const SourceElemType* input = sourceFeatures->colptr(indices[i]);
+    ElemType* output = features.colptr(i);
+    if (scale == 1.0)
+    {
+      for (size_t r = 0; r < rows; r++)
+        output[r] = ElemType(input[r]);
+    }
+    else
+    {
+      for (size_t r = 0; r < rows; r++)
+        output[r] = ElemType(scale * input[r]);
+    }
+  }
+
+  GatherLabels(*sourceLabels, indices, labels);
+}
+
+} // namespace models
+} // namespace mlpack
+
+#endif
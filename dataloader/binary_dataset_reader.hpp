@@ -0,0 +1,259 @@
+/**
+ * @file binary_dataset_reader.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of BinaryDatasetReader, which reads datasets stored in their
+ * original binary formats such as MNIST IDX files and CIFAR-10 batches.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_DATALOADER_BINARY_DATASET_READER_HPP
+#define MODELS_DATALOADER_BINARY_DATASET_READER_HPP
+
+#include <mlpack.hpp>
+#include <utils/mapped_file.hpp>
+#include <algorithm>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * BinaryDatasetReader maps files of binary dataset formats into memory and
+ * converts their bytes straight into the output matrices, so no text has to
+ * be parsed and no image has to be decoded. Items are converted in parallel
+ * (if OpenMP is available).
+ *
+ * Supported formats are:
+ *  - IDX files of unsigned bytes, as used by MNIST. Every item is stored as
+ *    one column in the order of the file, e.g. row by row for images.
+ *  - CIFAR-10 binary batches. Images are stored in the interleaved layout
+ *    produced by the image loader, i.e. channel c of pixel (x, y) is element
+ *    c + 3 * (x + 32 * y), so they match images decoded from PNG files.
+ *
+ * @code
+ * arma::mat images, labels;
+ * BinaryDatasetReader::LoadIDX("./../data/train-images-idx3-ubyte", images);
+ * BinaryDatasetReader::LoadIDX("./../data/train-labels-idx1-ubyte", labels);
+ * @endcode
+ */
+class BinaryDatasetReader
+{
+ public:
+  /**
+   * Checks whether all the given files exist.
+   *
+   * @param files Paths to the files.
+   * @return false if no file is given or any file is missing.
+   */
+  static bool Exists(const std::vector<std::string>& files)
+  {
+    if (files.empty())
+      return false;
+
+    for (const std::string& file : files)
+    {
+      if (!boost::filesystem::exists(file))
+        return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Loads an IDX file of unsigned bytes. The first dimension of the file is
+   * the number of items, every item is stored as a column holding the
+   * product of the remaining dimensions.
+   *
+   * @tparam MatType Type of the output.
+   *
+   * @param path Path to the IDX file.
+   * @param output Matrix where items will be stored.
+   * @return false if the file couldn't be mapped or isn't a valid IDX file.
+   */
+  template<typename MatType>
+  static bool LoadIDX(const std::string& path, MatType& output)
+  {
+    return LoadIDX(path, output, AllItems);
+  }
+
+  /**
+   * Loads the selected items of an IDX file of unsigned bytes. Items that
+   * aren't selected are never converted.
+   *
+   * @tparam MatType Type of the output.
+   * @tparam SelectorType Type of the function selecting items.
+   *
+   * @param path Path to the IDX file.
+   * @param output Matrix where the selected items will be stored.
+   * @param select Function called as select(items) with the number of items
+   *               in the file, returns indices of the items to load.
+   * @return false if the file couldn't be mapped or isn't a valid IDX file.
+   */
+  template<typename MatType, typename SelectorType>
+  static bool LoadIDX(const std::string& path,
+                      MatType& output,
+                      SelectorType select)
+  {
+    typedef typename MatType::elem_type ElemType;
+
+    MappedFile file(path);
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(
+        file.Data());
+
+    // Magic number is two zero bytes, the type of the data and the number of
+    // dimensions. Only unsigned bytes (0x08) are supported.
+    if (!file.IsOpen() || file.Size() < 4 || data[0] != 0 || data[1] != 0 ||
+        data[2] != 0x08 || data[3] == 0 || file.Size() < 4 + 4 * data[3])
+    {
+      mlpack::Log::Warn << "Unable to read IDX file " << path << "."
+          << std::endl;
+      return false;
+    }
+
+    const size_t dimensions = data[3];
+    const size_t items = ReadBigEndian(data + 4);
+    size_t itemSize = 1;
+    for (size_t i = 1; i < dimensions; i++)
+      itemSize *= ReadBigEndian(data + 4 + 4 * i);
+
+    const size_t headerSize = 4 + 4 * dimensions;
+    if (file.Size() != headerSize + items * itemSize)
+    {
+      mlpack::Log::Warn << "Size of IDX file " << path << " doesn't match "
+          << "its header." << std::endl;
+      return false;
+    }
+
+    const arma::uvec selected = select(items);
+    output.set_size(itemSize, selected.n_elem);
+    const unsigned char* values = data + headerSize;
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < selected.n_elem; i++)
+    {
+      const unsigned char* item = values + selected[i] * itemSize;
+      ElemType* column = output.colptr(i);
+      for (size_t j = 0; j < itemSize; j++)
+        column[j] = ElemType(item[j]);
+    }
+
+    return true;
+  }
+
+  /**
+   * Loads CIFAR-10 binary batches. Every record of a batch holds the label
+   * followed by the red, green and blue planes of a 32 x 32 image. Images of
+   * all batches are stored in the order of the batches.
+   *
+   * @tparam MatType Type of the images.
+   * @tparam LabelsType Type of the labels.
+   *
+   * @param batches Paths to the batches.
+   * @param images Matrix where images will be stored, one image per column.
+   * @param labels Row vector where class labels will be stored.
+   * @return false if a batch couldn't be mapped or has an invalid size.
+   */
+  template<typename MatType, typename LabelsType>
+  static bool LoadCIFAR(const std::vector<std::string>& batches,
+                        MatType& images,
+                        LabelsType& labels)
+  {
+    return LoadCIFAR(batches, images, labels, AllItems);
+  }
+
+  /**
+   * Loads the selected records of CIFAR-10 binary batches. Records are
+   * numbered over all batches in the order of the batches.
+   *
+   * @tparam MatType Type of the images.
+   * @tparam LabelsType Type of the labels.
+   * @tparam SelectorType Type of the function selecting records.
+   *
+   * @param batches Paths to the batches.
+   * @param images Matrix where images will be stored, one image per column.
+   * @param labels Row vector where class labels will be stored.
+   * @param select Function called as select(records) with the number of
+   *               records in all batches, returns indices of the records to
+   *               load.
+   * @return false if a batch couldn't be mapped or has an invalid size.
+   */
+  template<typename MatType, typename LabelsType, typename SelectorType>
+  static bool LoadCIFAR(const std::vector<std::string>& batches,
+                        MatType& images,
+                        LabelsType& labels,
+                        SelectorType select)
+  {
+    typedef typename MatType::elem_type ElemType;
+    typedef typename LabelsType::elem_type LabelType;
+
+    const size_t pixels = 32 * 32;
+    const size_t recordSize = 1 + 3 * pixels;
+
+    // Index of the first record of every batch, followed by the total
+    // number of records.
+    std::vector<MappedFile> files(batches.size());
+    std::vector<size_t> offsets(1, 0);
+    for (size_t b = 0; b < batches.size(); b++)
+    {
+      if (!files[b].Open(batches[b]) || files[b].Size() % recordSize != 0)
+      {
+        mlpack::Log::Warn << "Unable to read CIFAR batch " << batches[b] << "."
+            << std::endl;
+        return false;
+      }
+
+      offsets.push_back(offsets.back() + files[b].Size() / recordSize);
+    }
+
+    const arma::uvec selected = select(offsets.back());
+    images.set_size(3 * pixels, selected.n_elem);
+    labels.set_size(1, selected.n_elem);
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < selected.n_elem; i++)
+    {
+      const size_t b = std::upper_bound(offsets.begin(), offsets.end(),
+          selected[i]) - offsets.begin() - 1;
+      const unsigned char* record = reinterpret_cast<const unsigned char*>(
+          files[b].Data()) + (selected[i] - offsets[b]) * recordSize;
+      labels(0, i) = LabelType(record[0]);
+
+      // Planes of the record are interleaved, so every plane is read as a
+      // contiguous run.
+      ElemType* image = images.colptr(i);
+      for (size_t c = 0; c < 3; c++)
+      {
+        const unsigned char* plane = record + 1 + c * pixels;
+        for (size_t p = 0; p < pixels; p++)
+          image[c + 3 * p] = ElemType(plane[p]);
+      }
+    }
+
+    return true;
+  }
+
+ private:
+  //! Selects all items of a file.
+  static arma::uvec AllItems(const size_t items)
+  {
+    arma::uvec selected;
+    if (items > 0)
+      selected = arma::linspace<arma::uvec>(0, items - 1, items);
+    return selected;
+  }
+
+  //! Reads a big endian 32-bit integer, as used by IDX headers.
+  static size_t ReadBigEndian(const unsigned char* data)
+  {
+    return (size_t(data[0]) << 24) | (size_t(data[1]) << 16) |
+        (size_t(data[2]) << 8) | size_t(data[3]);
+  }
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,318 @@
+/**
+ * @file box_store.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of BoxStore, a contiguous container for bounding boxes of an
+ * object detection dataset.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_DATALOADER_BOX_STORE_HPP
+#define MODELS_DATALOADER_BOX_STORE_HPP
+
+#include <mlpack.hpp>
+#include <algorithm>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * BoxStore holds the bounding boxes of all images of a dataset in compressed
+ * sparse row layout. Coordinates of all boxes are stored in a single matrix
+ * with one box (x1, y1, x2, y2) per column, class labels are stored in a
+ * single vector and the boxes of image i are the columns in the range
+ * [Offset(i), Offset(i + 1)). Selecting the boxes of a batch only requires
+ * slicing the offsets, no memory is allocated per image.
+ *
+ * Coordinates are continuous pixel coordinates, i.e. a box covering the
+ * whole image of width w and height h is (0, 0, w, h).
+ *
+ * BoxStore can be used as labels type of the DataLoader and the BatchIterator
+ * for object detection datasets.
+ *
+ * @code
+ * DataLoader<arma::mat, BoxStore> dataloader;
+ * dataloader.LoadObjectDetectionDataset("./../data/annotations/",
+ *     "./../data/images/", classes);
+ *
+ * const BoxStore& boxes = dataloader.TrainLabels();
+ * for (size_t i = 0; i < boxes.NumImages(); i++)
+ * {
+ *   for (size_t b = boxes.Offset(i); b < boxes.Offset(i + 1); b++)
+ *   {
+ *     std::cout << boxes.Classes()(b) << " : "
+ *         << boxes.Coordinates().col(b).t();
+ *   }
+ * }
+ * @endcode
+ */
+class BoxStore
+{
+ public:
+  //! Create an empty BoxStore object.
+  BoxStore() : offsets(1, 0), boxes(0)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Reserves memory for the given number of images and boxes, so that adding
+   * them doesn't reallocate.
+   *
+   * @param images Number of images that will be added.
+   * @param totalBoxes Number of boxes that will be added over all images.
+   */
+  void Reserve(const size_t images, const size_t totalBoxes)
+  {
+    offsets.reserve(images + 1);
+    if (totalBoxes > coordinates.n_cols)
+    {
+      coordinates.resize(4, totalBoxes);
+      classes.resize(totalBoxes);
+    }
+  }
+
+  /**
+   * Adds an image with the given boxes. Boxes are given in the format used by
+   * the DataLoader for field type labels, i.e. five elements per box holding
+   * class label, x1, y1, x2 and y2.
+   *
+   * @param imageBoxes Class label and coordinates of all boxes of the image.
+   */
+  void Add(const arma::vec& imageBoxes)
+  {
+    const size_t numBoxes = imageBoxes.n_elem / 5;
+    Grow(numBoxes);
+
+    for (size_t i = 0; i < numBoxes; i++)
+    {
+      classes(boxes + i) = imageBoxes(5 * i);
+      coordinates.col(boxes + i) = imageBoxes.subvec(5 * i + 1, 5 * i + 4);
+    }
+
+    boxes += numBoxes;
+    offsets.push_back(boxes);
+  }
+
+  /**
+   * Adds the boxes of an image of another BoxStore.
+   *
+   * @param other BoxStore holding the image.
+   * @param image Index of the image in the other BoxStore.
+   */
+  void Add(const BoxStore& other, const size_t image)
+  {
+    const size_t begin = other.Offset(image);
+    const size_t numBoxes = other.NumBoxes(image);
+    Grow(numBoxes);
+
+    if (numBoxes > 0)
+    {
+      classes.subvec(boxes, boxes + numBoxes - 1) =
+          other.classes.subvec(begin, begin + numBoxes - 1);
+      coordinates.cols(boxes, boxes + numBoxes - 1) =
+          other.coordinates.cols(begin, begin + numBoxes - 1);
+    }
+
+    boxes += numBoxes;
+    offsets.push_back(boxes);
+  }
+
+  /**
+   * Creates a new BoxStore holding the images in given order.
+   *
+   * @param indices Indices of the images that will be copied.
+   */
+  BoxStore Subset(const arma::uvec& indices) const
+  {
+    size_t totalBoxes = 0;
+    for (size_t i = 0; i < indices.n_elem; i++)
+      totalBoxes += NumBoxes(indices[i]);
+
+    BoxStore subset;
+    subset.Reserve(indices.n_elem, totalBoxes);
+    for (size_t i = 0; i < indices.n_elem; i++)
+      subset.Add(*this, indices[i]);
+
+    return subset;
+  }
+
+  /**
+   * Get boxes of an image in the format used for field type labels, i.e. five
+   * elements per box holding class label, x1, y1, x2 and y2.
+   *
+   * @param image Index of the image.
+   */
+  arma::vec Boxes(const size_t image) const
+  {
+    const size_t begin = Offset(image);
+    arma::vec imageBoxes(5 * NumBoxes(image));
+    for (size_t i = 0; i < NumBoxes(image); i++)
+    {
+      imageBoxes(5 * i) = classes(begin + i);
+      imageBoxes.subvec(5 * i + 1, 5 * i + 4) = coordinates.col(begin + i);
+    }
+
+    return imageBoxes;
+  }
+
+  /**
+   * Moves the boxes of every image by an affine map, as returned by
+   * Augmentation::RandomTransform(). Column i of the transforms holds
+   * (scaleX, offsetX, scaleY, offsetY) of image i. Moved boxes are clipped to
+   * the image and boxes that end up outside of the image are removed. Images
+   * are transformed in parallel (if OpenMP is available).
+   *
+   * @param transforms Affine map of every image, one column per image.
+   * @param width Width of the images.
+   * @param height Height of the images.
+   */
+  void Transform(const arma::mat& transforms,
+                 const double width,
+                 const double height)
+  {
+    if (transforms.n_rows != 4 || transforms.n_cols != NumImages())
+    {
+      mlpack::Log::Fatal << "Expected 4 x " << NumImages() << " transforms, "
+          << "but got " << transforms.n_rows << " x " << transforms.n_cols
+          << "." << std::endl;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < NumImages(); i++)
+    {
+      const double* transform = transforms.colptr(i);
+      for (size_t b = offsets[i]; b < offsets[i + 1]; b++)
+      {
+        // A flip swaps the corners of a box.
+        double* box = coordinates.colptr(b);
+        const double x1 = transform[0] * box[0] + transform[1];
+        const double x2 = transform[0] * box[2] + transform[1];
+        const double y1 = transform[2] * box[1] + transform[3];
+        const double y2 = transform[2] * box[3] + transform[3];
+        box[0] = Clip(std::min(x1, x2), width);
+        box[1] = Clip(std::min(y1, y2), height);
+        box[2] = Clip(std::max(x1, x2), width);
+        box[3] = Clip(std::max(y1, y2), height);
+      }
+    }
+
+    RemoveEmpty();
+  }
+
+  /**
+   * Removes boxes without area, e.g. boxes cropped away by an augmentation.
+   * Remaining boxes keep their order, all boxes are moved in a single pass.
+   */
+  void RemoveEmpty()
+  {
+    size_t kept = 0;
+    for (size_t i = 0; i < NumImages(); i++)
+    {
+      const size_t begin = offsets[i], end = offsets[i + 1];
+      offsets[i] = kept;
+      for (size_t b = begin; b < end; b++)
+      {
+        if (coordinates(2, b) <= coordinates(0, b) ||
+            coordinates(3, b) <= coordinates(1, b))
+          continue;
+
+        if (kept != b)
+        {
+          coordinates.col(kept) = coordinates.col(b);
+          classes(kept) = classes(b);
+        }
+
+        kept++;
+      }
+    }
+
+    offsets.back() = kept;
+    boxes = kept;
+  }
+
+  //! Removes all images. Allocated memory is kept for images added later.
+  void Clear()
+  {
+    offsets.assign(1, 0);
+    boxes = 0;
+  }
+
+  //! Get the number of images.
+  size_t NumImages() const { return offsets.size() - 1; }
+
+  //! Get the total number of boxes.
+  size_t NumBoxes() const { return boxes; }
+
+  //! Get the number of boxes of an image.
+  size_t NumBoxes(const size_t image) const
+  {
+    return offsets[image + 1] - offsets[image];
+  }
+
+  //! Get the index of the first box of an image. Offset(NumImages()) is the
+  //! total number of boxes.
+  size_t Offset(const size_t image) const { return offsets[image]; }
+
+  //! Get the coordinates, one box (x1, y1, x2, y2) per column. Only the first
+  //! NumBoxes() columns are valid.
+  const arma::mat& Coordinates() const { return coordinates; }
+
+  //! Get the class label of every box. Only the first NumBoxes() elements are
+  //! valid.
+  const arma::vec& Classes() const { return classes; }
+
+  //! Serialize the BoxStore.
+  template<typename Archive>
+  void serialize(Archive& ar, const uint32_t /* version */)
+  {
+    ar(CEREAL_NVP(offsets));
+    ar(CEREAL_NVP(boxes));
+    ar(CEREAL_NVP(coordinates));
+    ar(CEREAL_NVP(classes));
+  }
+
+ private:
+  /**
+   * Makes room for the given number of boxes. Capacity is doubled so that
+   * appending images is amortized constant time.
+   *
+   * @param numBoxes Number of boxes that will be added.
+   */
+  void Grow(const size_t numBoxes)
+  {
+    if (boxes + numBoxes <= coordinates.n_cols)
+      return;
+
+    const size_t capacity = std::max(boxes + numBoxes, 2 * coordinates.n_cols);
+    coordinates.resize(4, capacity);
+    classes.resize(capacity);
+  }
+
+  //! Clips a coordinate to the range [0, size].
+  static double Clip(const double value, const double size)
+  {
+    return std::min(std::max(value, 0.0), size);
+  }
+
+  //! Locally stored index of the first box of every image, followed by the
+  //! total number of boxes.
+  std::vector<size_t> offsets;
+
+  //! Locally stored total number of boxes.
+  size_t boxes;
+
+  //! Locally stored coordinates of all boxes.
+  arma::mat coordinates;
+
+  //! Locally stored class labels of all boxes.
+  arma::vec classes;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
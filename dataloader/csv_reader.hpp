@@ -0,0 +1,277 @@
+/**
+ * @file csv_reader.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of CSVReader, which parses numeric CSV files in fixed size
+ * chunks.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_DATALOADER_CSV_READER_HPP
+#define MODELS_DATALOADER_CSV_READER_HPP
+
+#include <mlpack.hpp>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * CSVReader streams a numeric CSV file in chunks of fixed size, so memory
+ * used for parsing doesn't depend on the size of the file. Only the requested
+ * range of columns is converted and every value is handed to a callback along
+ * with its row and column, which lets the caller write values straight into
+ * their final location. Lines of a chunk are parsed in parallel (if OpenMP is
+ * available).
+ *
+ * Empty lines are skipped. As with mlpack::data::Load(), a value that can't
+ * be parsed is read as zero.
+ *
+ * @code
+ * CSVReader reader("./../data/iris.csv");
+ * size_t rows, cols;
+ * reader.Scan(rows, cols);
+ *
+ * // Load the first four columns, one data point per column.
+ * arma::mat features(4, rows);
+ * reader.Parse(0, 3, [&](const size_t row, const size_t col, const double x)
+ * {
+ *   features(col, row) = x;
+ * });
+ * @endcode
+ */
+class CSVReader
+{
+ public:
+  /**
+   * Create the CSVReader object.
+   *
+   * @param path Path to the CSV file.
+   * @param chunkSize Number of bytes read from the file at once. Lines longer
+   *                  than the chunk size are still read as a whole.
+   * @param delimiter Character separating values of a line.
+   */
+  CSVReader(const std::string& path,
+            const size_t chunkSize = 1 << 24,
+            const char delimiter = ',') :
+      path(path),
+      chunkSize(std::max<size_t>(chunkSize, 1)),
+      delimiter(delimiter)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Counts the number of rows and columns in the file. The number of columns
+   * is taken from the first row.
+   *
+   * @param rows Set to the number of non-empty lines.
+   * @param cols Set to the number of values in the first line.
+   * @return false if the file couldn't be opened.
+   */
+  bool Scan(size_t& rows, size_t& cols)
+  {
+    rows = 0;
+    cols = 0;
+    return ForEachChunk([&](const std::vector<const char*>& lines)
+    {
+      // Columns are counted only once.
+      if (rows == 0 && lines.size() > 1)
+      {
+        cols = 1;
+        for (const char* c = lines[0]; *c != '\n'; c++)
+          cols += (*c == delimiter);
+      }
+
+      rows += lines.size() - 1;
+    });
+  }
+
+  /**
+   * Parses the given range of columns of every row. Function is called as
+   * function(row, column, value) for every value in the range. Rows of a
+   * chunk are parsed in parallel, so function must be safe to call from
+   * multiple threads for different rows. Missing values of short rows are
+   * read as zero.
+   *
+   * @tparam FunctionType Type of the function called for every value.
+   *
+   * @param firstColumn First column that will be parsed.
+   * @param lastColumn Last column that will be parsed.
+   * @param function Function called for every value.
+   * @return false if the file couldn't be opened.
+   */
+  template<typename FunctionType>
+  bool Parse(const size_t firstColumn,
+             const size_t lastColumn,
+             FunctionType function)
+  {
+    return Parse(firstColumn, lastColumn, function,
+        [](const size_t /* row */) { return true; });
+  }
+
+  /**
+   * Parses the given range of columns of the rows accepted by the filter.
+   * Rows that aren't accepted are skipped without being parsed, which is
+   * used to read a single shard of a file.
+   *
+   * @tparam FunctionType Type of the function called for every value.
+   * @tparam FilterType Type of the function called for every row.
+   *
+   * @param firstColumn First column that will be parsed.
+   * @param lastColumn Last column that will be parsed.
+   * @param function Function called for every value.
+   * @param filter Function called as filter(row), returns true for rows that
+   *               will be parsed.
+   * @return false if the file couldn't be opened.
+   */
+  template<typename FunctionType, typename FilterType>
+  bool Parse(const size_t firstColumn,
+             const size_t lastColumn,
+             FunctionType function,
+             FilterType filter)
+  {
+    size_t rowOffset = 0;
+    return ForEachChunk([&](const std::vector<const char*>& lines)
+    {
+      const size_t numLines = lines.size() - 1;
+
+      #pragma omp parallel for schedule(static)
+      for (size_t i = 0; i < numLines; i++)
+      {
+        const char* position = lines[i];
+        const size_t row = rowOffset + i;
+        if (!filter(row))
+          continue;
+
+        // Skip values before the first requested column.
+        size_t col = 0;
+        for (; col < firstColumn && *position != '\n'; position++)
+          col += (*position == delimiter);
+
+        for (; col <= lastColumn; col++)
+        {
+          // Leading whitespace is skipped here, strtod() would also skip
+          // the end of the line.
+          while (*position != '\n' && *position != delimiter &&
+              std::isspace(static_cast<unsigned char>(*position)))
+            position++;
+
+          double value = 0;
+          if (*position != '\n' && *position != delimiter)
+          {
+            char* end;
+            value = std::strtod(position, &end);
+            position = end;
+          }
+
+          // Move to the next value.
+          while (*position != delimiter && *position != '\n')
+            position++;
+          if (*position == delimiter)
+            position++;
+
+          function(row, col, value);
+        }
+      }
+
+      rowOffset += numLines;
+    });
+  }
+
+ private:
+  /**
+   * Reads the file chunk by chunk. Function is called for every chunk with
+   * the start of every non-empty, complete line of the chunk, followed by the
+   * end of the last line. Every line of a chunk ends with '\n'.
+   *
+   * @tparam FunctionType Type of the function called for every chunk.
+   *
+   * @param function Function called for every chunk.
+   * @return false if the file couldn't be opened.
+   */
+  template<typename FunctionType>
+  bool ForEachChunk(FunctionType function)
+  {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open())
+      return false;
+
+    // Buffer holds the incomplete last line of the previous chunk followed
+    // by the new chunk.
+    std::vector<char> buffer;
+    std::vector<const char*> lines;
+    size_t leftover = 0;
+    while (true)
+    {
+      buffer.resize(leftover + chunkSize + 1);
+      file.read(buffer.data() + leftover, chunkSize);
+      const size_t size = leftover + file.gcount();
+      const bool lastChunk = !file;
+
+      // Terminate the last line of the file.
+      size_t end = size;
+      if (lastChunk && size > 0 && buffer[size - 1] != '\n')
+        buffer[end++] = '\n';
+
+      lines.clear();
+      size_t lineBegin = 0;
+      const char* data = buffer.data();
+      while (lineBegin < end)
+      {
+        const char* newline = static_cast<const char*>(
+            std::memchr(data + lineBegin, '\n', end - lineBegin));
+        if (newline == nullptr)
+          break;
+
+        if (!IsEmpty(data + lineBegin, newline))
+          lines.push_back(data + lineBegin);
+
+        lineBegin = newline - data + 1;
+      }
+
+      lines.push_back(data + lineBegin);
+      if (lines.size() > 1)
+        function(lines);
+
+      if (lastChunk)
+        return true;
+
+      // Move the incomplete line to the beginning of the buffer.
+      leftover = size - lineBegin;
+      std::memmove(buffer.data(), buffer.data() + lineBegin, leftover);
+    }
+  }
+
+  //! Returns true if the line holds only whitespace.
+  static bool IsEmpty(const char* begin, const char* end)
+  {
+    for (; begin != end; begin++)
+    {
+      if (!std::isspace(static_cast<unsigned char>(*begin)))
+        return false;
+    }
+
+    return true;
+  }
+
+  //! Locally stored path to the CSV file.
+  std::string path;
+
+  //! Locally stored number of bytes read at once.
+  size_t chunkSize;
+
+  //! Locally stored delimiter.
+  char delimiter;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
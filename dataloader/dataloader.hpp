@@ -13,13 +13,22 @@
 #define MODELS_DATALOADER_DATALOADER_HPP
 
 #include <mlpack.hpp>
-#include <boost/property_tree/xml_parser.hpp>
-#include <boost/property_tree/ptree.hpp>
 #include <augmentation/augmentation.hpp>
+#include <dataloader/batch_iterator.hpp>
+#include <dataloader/binary_dataset_reader.hpp>
+#include <dataloader/box_store.hpp>
+#include <dataloader/csv_reader.hpp>
+#include <dataloader/dataset_cache.hpp>
+#include <dataloader/image_decoder.hpp>
+#include <dataloader/prefetch_iterator.hpp>
 #include <dataloader/datasets.hpp>
-#include <boost/foreach.hpp>
+#include <dataloader/xml_tag_extractor.hpp>
 #include <utils/utils.hpp>
+#include <limits>
+#include <numeric>
+#include <random>
 #include <set>
+#include <type_traits>
 
 namespace mlpack {
 namespace models {
@@ -70,6 +79,13 @@ class DataLoader
    * @param useScaler Use feature scaler for pre-processing the dataset.
    * @param augmentation Adds augmentation to training data only.
    * @param augmentationProbability Probability of applying augmentation on dataset.
+   * @param cacheDirectory Directory where decoded image datasets are cached.
+   *                       Caching is disabled if empty.
+   * @param shardRank Index of the shard that will be loaded, refer to
+   *                  Shard() for details.
+   * @param worldSize Number of shards the dataset is partitioned into.
+   * @param shardSeed Seed shared by all shards for partitioning the dataset.
+   *                  It's only used if worldSize is larger than 1.
    */
   DataLoader(const std::string& dataset,
              const bool shuffle,
@@ -77,11 +93,67 @@ class DataLoader
              const bool useScaler = true,
              const std::vector<std::string> augmentation =
                  std::vector<std::string>(),
-             const double augmentationProbability = 0.2);
+             const double augmentationProbability = 0.2,
+             const std::string& cacheDirectory = "",
+             const size_t shardRank = 0,
+             const size_t worldSize = 1,
+             const size_t shardSeed = 0);
+
+  //! Copy the given DataLoader. The training and validation sets of the copy
+  //! alias a copy of the split they alias in the given DataLoader.
+  DataLoader(const DataLoader& other);
+
+  //! Take ownership of the given DataLoader.
+  DataLoader(DataLoader&& other);
+
+  //! Copy the given DataLoader. The training and validation sets of the copy
+  //! alias a copy of the split they alias in the given DataLoader.
+  DataLoader& operator=(const DataLoader& other);
+
+  //! Take ownership of the given DataLoader.
+  DataLoader& operator=(DataLoader&& other);
+
+  /**
+   * Restricts all following loads to a single shard of every dataset, for
+   * training with multiple processes. Every process passes its own rank and
+   * the same world size and seed. Data points of a dataset are partitioned
+   * by a permutation drawn from the seed, so the shards of all processes are
+   * disjoint, cover the dataset and hold a balanced mix of classes. Only the
+   * data points of the shard are read, decoded and kept in memory, and the
+   * split into training and validation sets is done within the shard, and
+   * shuffled with the same seed. Passing a seed with a world size of 1 makes
+   * shuffled splits reproducible without sharding.
+   *
+   * @code
+   * DataLoader<> dataloader;
+   * dataloader.Shard(rank, worldSize, 42);
+   * dataloader.LoadImageDatasetFromDirectory("./../data/cifar10/", 32, 32, 3);
+   * @endcode
+   *
+   * @param shardRank Index of the shard of this process, in [0, worldSize).
+   * @param worldSize Number of shards the dataset is partitioned into.
+   * @param shardSeed Seed shared by all shards for partitioning the dataset.
+   */
+  void Shard(const size_t shardRank,
+             const size_t worldSize,
+             const size_t shardSeed);
+
+  /**
+   * Restricts all following loads to a single shard of every dataset, with a
+   * seed of 0. If worldSize is 1, shuffled splits are drawn from mlpack's
+   * random number generator, as they are without calling Shard().
+   *
+   * @param shardRank Index of the shard of this process, in [0, worldSize).
+   * @param worldSize Number of shards the dataset is partitioned into.
+   */
+  void Shard(const size_t shardRank, const size_t worldSize);
 
   /**
    * Function to load and preprocess train or test data stored in CSV files.
-   * 
+   * The file is parsed in chunks and only the requested columns are written,
+   * straight into the train, validation or test matrices, so the whole file
+   * is never held in memory.
+   *
    * @param datasetPath Path to the dataset.
    * @param loadTrainData Boolean to determine whether data will be stored for
    *                      training or testing. If true, data will be loaded for training.
@@ -130,7 +202,11 @@ class DataLoader
    * 5. Each object tag should contain bndbox tag containing xmin, ymin, xmax, ymax.
    *
    * NOTE : Labels are assigned using classes vector. Set verbose to 1 to print labels
-   * and their corresponding class. The labels type should be field type here.
+   * and their corresponding class. The labels type should be field type or
+   * BoxStore here. BoxStore keeps all bounding boxes in contiguous memory.
+   *
+   * Random augmentations such as flips, crops and scales are applied by
+   * TrainBatches(), which moves the bounding boxes along with the images.
    *
    * @param pathToAnnotations Path to the folder containing XML type annotation files.
    * @param pathToImages Path to folder containing images corresponding to annotations.
@@ -190,8 +266,8 @@ class DataLoader
    * @param imageDepth Depth of images in dataset.
    * @param label Label which will be assigned to image.
    * @param augmentation Vector strings of augmentations supported by mlpack.
-   * @param augmentationProbability Probability of applying augmentation
-   *                                to a particular image.
+   *                     Only resize is applied, right after every image is
+   *                     decoded.
    */
   void LoadAllImagesFromDirectory(const std::string& imagesPath,
                                   DatasetX& dataset,
@@ -199,7 +275,10 @@ class DataLoader
                                   const size_t imageWidth,
                                   const size_t imageHeight,
                                   const size_t imageDepth,
-                                  const size_t label = 0);
+                                  const size_t label = 0,
+                                  const std::vector<std::string>&
+                                      augmentation =
+                                      std::vector<std::string>());
 
   /**
    * Load all images from directory.
@@ -214,6 +293,11 @@ class DataLoader
    * @param augmentation Vector strings of augmentations supported by mlpack.
    * @param augmentationProbability Probability of applying augmentation
    *                                to a particular image.
+   * @param cacheDirectory Directory where decoded (and resized) images are
+   *                       cached. Later calls with the same directory listing,
+   *                       image shape and resize parameter map the cache file
+   *                       instead of decoding any image. Caching is disabled
+   *                       if empty.
    */
   void LoadImageDatasetFromDirectory(const std::string& pathToDataset,
                                      const size_t imageWidth,
@@ -225,57 +309,250 @@ class DataLoader
                                      const std::vector<std::string>&
                                       augmentation = std::vector<std::string>(),
                                      const double augmentationProbability =
-                                        0.2);
+                                        0.2,
+                                     const std::string& cacheDirectory = "");
+
+  /**
+   * Builds an index of all images in the directory without decoding them.
+   * Images are decoded lazily, batch by batch, by the iterators returned
+   * from TrainBatches(), ValidBatches() and TestBatches(). This keeps peak
+   * memory proportional to the batch size instead of the dataset size.
+   *
+   * @param pathToDataset Path to all folders containing all images.
+   * @param imageWidth Width of images in dataset.
+   * @param imageHeight Height of images in dataset.
+   * @param imageDepth Depth of images in dataset.
+   * @param trainData Determines whether data is training set or test set.
+   * @param validRatio Ratio of dataset to be used for validation set.
+   * @param shuffle Boolean to determine whether or not to shuffle the data.
+   * @param augmentation Vector strings of augmentations supported by mlpack.
+   * @param augmentationProbability Probability of applying augmentation
+   *                                to a particular image.
+   */
+  void IndexImageDatasetFromDirectory(const std::string& pathToDataset,
+                                      const size_t imageWidth,
+                                      const size_t imageHeight,
+                                      const size_t imageDepth,
+                                      const bool trainData = true,
+                                      const double validRatio = 0.2,
+                                      const bool shuffle = true,
+                                      const std::vector<std::string>&
+                                          augmentation =
+                                          std::vector<std::string>(),
+                                      const double augmentationProbability =
+                                          0.2);
+
+  /**
+   * Builds an index of an object detection dataset. Annotations are parsed
+   * and kept in memory while images are decoded lazily, batch by batch, by
+   * the iterators returned from TrainBatches() and ValidBatches(). Refer to
+   * LoadObjectDetectionDataset() for the expected format of the dataset and
+   * description of the parameters.
+   */
+  void IndexObjectDetectionDataset(const std::string& pathToAnnotations,
+                                   const std::string& pathToImages,
+                                   const std::vector<std::string>& classes,
+                                   const double validRatio = 0.2,
+                                   const bool shuffle = true,
+                                   const std::vector<std::string>&
+                                       augmentation =
+                                       std::vector<std::string>(),
+                                   const double augmentationProbability = 0.2,
+                                   const bool absolutePath = false,
+                                   const std::string& baseXMLTag =
+                                       "annotation",
+                                   const std::string& imageNameXMLTag =
+                                       "filename",
+                                   const std::string& sizeXMLTag = "size",
+                                   const std::string& objectXMLTag = "object",
+                                   const std::string& bndboxXMLTag = "bndbox",
+                                   const std::string& classNameXMLTag = "name",
+                                   const std::string& x1XMLTag = "xmin",
+                                   const std::string& y1XMLTag = "ymin",
+                                   const std::string& x2XMLTag = "xmax",
+                                   const std::string& y2XMLTag = "ymax");
+
+  /**
+   * Creates an epoch iterator over the training set. If the training set was
+   * indexed, images are decoded batch by batch. Otherwise the iterator walks
+   * the loaded training set, shuffling only the order of data points, and
+   * must not outlive the DataLoader.
+   *
+   * Features may be stored in a compact type, e.g. arma::Mat<uint8_t>, and
+   * converted to BatchType only when a batch is gathered. Scale is applied
+   * during the same pass, so no converted copy of the dataset is created.
+   *
+   * Random augmentations given when the images were loaded, e.g. flips, are
+   * applied to every batch of the training set as it's assembled.
+   *
+   * @code
+   * DataLoader<arma::Mat<uint8_t>, arma::mat> dataloader;
+   * dataloader.LoadImageDatasetFromDirectory("./../data/cifar10/", 32, 32, 3);
+   *
+   * // Batches hold doubles in the range [0, 1].
+   * auto batches = dataloader.TrainBatches<arma::mat>(32, true, 1.0 / 255.0);
+   * @endcode
+   *
+   * @tparam BatchType Datatype for input features of a batch.
+   *
+   * @param batchSize Number of data points in each batch.
+   * @param shuffle Boolean to determine whether the order of data points is
+   *                shuffled every epoch.
+   * @param scale Factor every feature is multiplied by when a batch is
+   *              gathered.
+   */
+  template<typename BatchType = DatasetX>
+  BatchIterator<BatchType, DatasetY, DatasetX> TrainBatches(
+      const size_t batchSize = 32,
+      const bool shuffle = true,
+      const double scale = 1.0) const
+  {
+    if (trainIndex.Size() == 0)
+    {
+      return BatchIterator<BatchType, DatasetY, DatasetX>(trainFeatures,
+          trainLabels, batchSize, shuffle, scale, augmentation,
+          augmentationProbability, datasetWidth, datasetHeight,
+          datasetDepth);
+    }
+
+    return BatchIterator<BatchType, DatasetY, DatasetX>(trainIndex, batchSize,
+        shuffle, augmentation, augmentationProbability, scale);
+  }
+
+  /**
+   * Creates an epoch iterator over the validation set. Refer to
+   * TrainBatches() for details.
+   *
+   * @tparam BatchType Datatype for input features of a batch.
+   *
+   * @param batchSize Number of data points in each batch.
+   * @param scale Factor every feature is multiplied by when a batch is
+   *              gathered.
+   */
+  template<typename BatchType = DatasetX>
+  BatchIterator<BatchType, DatasetY, DatasetX> ValidBatches(
+      const size_t batchSize = 32,
+      const double scale = 1.0) const
+  {
+    if (validIndex.Size() == 0)
+    {
+      return BatchIterator<BatchType, DatasetY, DatasetX>(validFeatures,
+          validLabels, batchSize, false, scale);
+    }
+
+    // Random augmentations are only applied to the training set.
+    BatchIterator<BatchType, DatasetY, DatasetX> batches(validIndex, batchSize,
+        false, augmentation, augmentationProbability, scale);
+    batches.RandomAugmentation() = false;
+    return batches;
+  }
+
+  /**
+   * Creates an epoch iterator over the test set. Refer to TrainBatches() for
+   * details.
+   *
+   * @tparam BatchType Datatype for input features of a batch.
+   *
+   * @param batchSize Number of data points in each batch.
+   * @param scale Factor every feature is multiplied by when a batch is
+   *              gathered.
+   */
+  template<typename BatchType = DatasetX>
+  BatchIterator<BatchType, DatasetY, DatasetX> TestBatches(
+      const size_t batchSize = 32,
+      const double scale = 1.0) const
+  {
+    if (testIndex.Size() == 0)
+    {
+      return BatchIterator<BatchType, DatasetY, DatasetX>(testFeatures,
+          testLabels, batchSize, false, scale);
+    }
+
+    // Random augmentations are only applied to the training set.
+    BatchIterator<BatchType, DatasetY, DatasetX> batches(testIndex, batchSize,
+        false, augmentation, augmentationProbability, scale);
+    batches.RandomAugmentation() = false;
+    return batches;
+  }
+
+  //! Get the index of the training set.
+  const FileIndex& TrainIndex() const { return trainIndex; }
+
+  //! Get the index of the validation set.
+  const FileIndex& ValidIndex() const { return validIndex; }
+
+  //! Get the index of the test set.
+  const FileIndex& TestIndex() const { return testIndex; }
 
   //! Get the training dataset features.
-  DatasetX TrainFeatures() const { return trainFeatures; }
+  const DatasetX& TrainFeatures() const { return trainFeatures; }
 
   //! Modify the training dataset features.
   DatasetX& TrainFeatures() { return trainFeatures; }
 
   //! Get the training dataset labels.
-  DatasetY TrainLabels() const { return trainLabels; }
+  const DatasetY& TrainLabels() const { return trainLabels; }
   //! Modify the training dataset labels.
   DatasetY& TrainLabels() { return trainLabels; }
 
   //! Get the test dataset features.
-  DatasetX TestFeatures() const { return testFeatures; }
+  const DatasetX& TestFeatures() const { return testFeatures; }
   //! Modify the test dataset features.
   DatasetX& TestFeatures() { return testFeatures; }
 
   //! Get the test dataset labels.
-  DatasetY TestLabels() const { return testLabels; }
+  const DatasetY& TestLabels() const { return testLabels; }
   //! Modify the test dataset labels.
   DatasetY& TestLabels() { return testLabels; }
 
   //! Get the validation dataset features.
-  DatasetX ValidFeatures() const { return validFeatures; }
+  const DatasetX& ValidFeatures() const { return validFeatures; }
   //! Modify the validation dataset features.
   DatasetX& ValidFeatures() { return validFeatures; }
 
   //! Get the validation dataset labels.
-  DatasetY ValidLabels() const { return validLabels; }
+  const DatasetY& ValidLabels() const { return validLabels; }
   //! Modify the validation dataset labels.
   DatasetY& ValidLabels() { return validLabels; }
 
-  //! Get the training dataset.
-  std::tuple<DatasetX, DatasetY> TrainSet() const
+  //! Get the training dataset. The tuple holds references to the features
+  //! and labels, copy it into std::tuple<DatasetX, DatasetY> to keep a copy.
+  std::tuple<const DatasetX&, const DatasetY&> TrainSet() const
   {
-    return std::tuple<DatasetX, DatasetY>(trainFeatures, trainLabels);
+    return std::tie(trainFeatures, trainLabels);
   }
 
-  //! Get the validation dataset.
-  std::tuple<DatasetX, DatasetY> ValidSet() const
+  //! Get the validation dataset. The tuple holds references to the features
+  //! and labels.
+  std::tuple<const DatasetX&, const DatasetY&> ValidSet() const
   {
-    return std::tuple<DatasetX, DatasetY>(validFeatures, validLabels);
+    return std::tie(validFeatures, validLabels);
   }
 
-  //! Get the testing dataset.
-  std::tuple<DatasetX, DatasetY> TestSet() const
+  //! Get the testing dataset. The tuple holds references to the features
+  //! and labels.
+  std::tuple<const DatasetX&, const DatasetY&> TestSet() const
   {
-    return std::tuple<DatasetX, DatasetY>(testFeatures, testLabels);
+    return std::tie(testFeatures, testLabels);
   }
 
+  //! Get the indices of the loaded data points that form the training set,
+  //! in the order they are stored in the training features.
+  const arma::uvec& TrainIndices() const { return trainIndices; }
+
+  //! Get the indices of the loaded data points that form the validation set,
+  //! in the order they are stored in the validation features.
+  const arma::uvec& ValidIndices() const { return validIndices; }
+
+  //! Get the index of the shard that is loaded.
+  size_t ShardRank() const { return shardRank; }
+
+  //! Get the number of shards datasets are partitioned into.
+  size_t WorldSize() const { return worldSize; }
+
+  //! Get the seed used for partitioning datasets into shards.
+  size_t ShardSeed() const { return shardSeed; }
+
   //! Get the Scaler.
   ScalerType Scaler() const { return scaler; }
   //! Modify the Scaler.
@@ -289,20 +566,20 @@ class DataLoader
    */
   void DownloadDataset(const std::string& dataset)
   {
-    if (datasetMap[dataset].zipFile && (!Utils::PathExists(
-        datasetMap[dataset].trainPath) ||
-        !Utils::PathExists(datasetMap[dataset].testPath) ||
-        !Utils::PathExists(datasetMap[dataset].trainingImagesPath) ||
-        !Utils::PathExists(datasetMap[dataset].trainingAnnotationPath) ||
-        !Utils::PathExists(datasetMap[dataset].testingImagesPath)))
+    const DatasetDetails<DatasetX, DatasetY>& details = datasetMap[dataset];
+    if (details.zipFile && (!Utils::PathExists(details.trainPath) ||
+        !Utils::PathExists(details.testPath) ||
+        !Utils::PathExists(details.trainingImagesPath) ||
+        !Utils::PathExists(details.trainingAnnotationPath) ||
+        !Utils::PathExists(details.testingImagesPath)))
     {
-      Utils::DownloadFile(datasetMap[dataset].datasetURL,
-          datasetMap[dataset].datasetPath, dataset + "_training_data.",
-          false, false, datasetMap[dataset].serverName,
-          datasetMap[dataset].zipFile);
+      // The archive is checked while it's downloaded and extracted right
+      // after.
+      const std::vector<char> downloaded = Utils::DownloadFiles(
+          {DownloadTask(details.datasetURL, details.datasetPath,
+          details.datasetHash, details.serverName, true)}, 1, false);
 
-      if (!Utils::CompareCRC32(datasetMap[dataset].datasetPath,
-          datasetMap[dataset].datasetHash))
+      if (!downloaded[0])
       {
         mlpack::Log::Fatal << "Corrupted Data for " << dataset <<
             " downloaded." << std::endl;
@@ -311,35 +588,54 @@ class DataLoader
       return;
     }
 
-    if (!Utils::PathExists(datasetMap[dataset].trainPath))
+    // Training and testing data are downloaded concurrently.
+    std::vector<DownloadTask> tasks;
+    std::vector<std::string> names;
+    if (!Utils::PathExists(details.trainPath))
     {
-      Utils::DownloadFile(datasetMap[dataset].trainDownloadURL,
-          datasetMap[dataset].trainPath, dataset + "_training_data.",
-          false, false, datasetMap[dataset].serverName);
+      tasks.emplace_back(details.trainDownloadURL, details.trainPath,
+          details.trainHash, details.serverName);
+      names.push_back("Training");
+    }
 
-      if (!Utils::CompareCRC32(datasetMap[dataset].trainPath,
-          datasetMap[dataset].trainHash))
-      {
-        mlpack::Log::Fatal << "Corrupted Training Data for " <<
-            dataset << " downloaded." << std::endl;
-      }
+    if (!Utils::PathExists(details.testPath))
+    {
+      tasks.emplace_back(details.testDownloadURL, details.testPath,
+          details.testHash, details.serverName);
+      names.push_back("Testing");
     }
 
-    if (!Utils::PathExists(datasetMap[dataset].testPath))
+    const std::vector<char> downloaded = Utils::DownloadFiles(tasks,
+        tasks.size(), false);
+    for (size_t i = 0; i < tasks.size(); i++)
     {
-      Utils::DownloadFile(datasetMap[dataset].trainDownloadURL,
-          datasetMap[dataset].testPath, dataset + "_testing_data.",
-          false, false, datasetMap[dataset].serverName);
-
-      if (!Utils::CompareCRC32(datasetMap[dataset].testPath,
-          datasetMap[dataset].testHash))
-        {
-          mlpack::Log::Fatal << "Corrupted Testing Data for " <<
+      if (!downloaded[i])
+      {
+        mlpack::Log::Fatal << "Corrupted " << names[i] << " Data for " <<
             dataset << " downloaded." << std::endl;
-        }
+      }
     }
   }
 
+  /**
+   * Loads a dataset from the files of its binary format, if all of them
+   * exist. The training files are split into training and validation set and
+   * labels of the testing files are stored as test labels.
+   *
+   * @param details Details of the dataset.
+   * @param shuffle Boolean to determine whether the dataset is shuffled before
+   *                it is split.
+   * @param validRatio Ratio of dataset to be used for validation set.
+   * @param useScaler Boolean to determine whether the scaler is fit to the
+   *                  training features and applied to all features.
+   * @return false if the dataset has no binary format, its files don't exist
+   *     or they couldn't be read.
+   */
+  bool LoadBinaryDataset(const DatasetDetails<DatasetX, DatasetY>& details,
+                         const bool shuffle,
+                         const double validRatio,
+                         const bool useScaler);
+
   /**
    * Intializes dataset map to provide access to dataset details.
    */
@@ -351,6 +647,373 @@ class DataLoader
     datasetMap.insert({"cifar10", Datasets<DatasetX, DatasetY>::CIFAR10()});
   }
 
+  /**
+   * Fills a vector with paths of all supported images in the directory.
+   *
+   * @param imagesPath Path to all images.
+   * @param files Vector of paths to be filled.
+   */
+  void ListImages(const std::string& imagesPath,
+                  std::vector<std::string>& files)
+  {
+    std::vector<boost::filesystem::path> imagesDirectory;
+    Utils::ListDir(imagesPath, imagesDirectory);
+
+    std::set<std::string> supportedExtentions = {".jpg", ".png", ".tga",
+        ".bmp", ".psd", ".gif", ".hdr", ".pic", ".pnm"};
+
+    for (boost::filesystem::path imageName : imagesDirectory)
+    {
+      if (imageName.string().length() <= 3 ||
+          !boost::filesystem::is_regular_file(imageName) ||
+          !supportedExtentions.count(imageName.extension().string()))
+      {
+        continue;
+      }
+
+      files.push_back(imageName.string());
+    }
+  }
+
+  /**
+   * Decodes images in parallel and prepends them to the dataset. To keep
+   * the column order of earlier releases, which inserted images at the front
+   * one at a time, the last file occupies the first column. Images that can't
+   * be decoded, or don't have the given shape, are skipped.
+   *
+   * @param files Paths to the images.
+   * @param fileLabels Label of each image.
+   * @param imageWidth Width of images in dataset.
+   * @param imageHeight Height of images in dataset.
+   * @param imageDepth Depth of images in dataset.
+   * @param dataset Armadillo type where images will be loaded.
+   * @param labels Armadillo type where labels will be loaded.
+   * @param augmentation Augmentation whose resize is applied right after an
+   *                     image is decoded.
+   */
+  void DecodeImages(const std::vector<std::string>& files,
+                    const std::vector<size_t>& fileLabels,
+                    const size_t imageWidth,
+                    const size_t imageHeight,
+                    const size_t imageDepth,
+                    DatasetX& dataset,
+                    DatasetY& labels,
+                    const Augmentation& augmentation = Augmentation());
+
+  /**
+   * Fills a vector with paths of all XML files in the directory.
+   *
+   * @param pathToAnnotations Path to the folder containing annotation files.
+   * @param absolutePath Boolean to determine if absolute path is used.
+   * @param files Vector of paths to be filled.
+   */
+  void ListAnnotations(const std::string& pathToAnnotations,
+                       const bool absolutePath,
+                       std::vector<std::string>& files)
+  {
+    std::vector<boost::filesystem::path> annotationsDirectory;
+    Utils::ListDir(pathToAnnotations, annotationsDirectory, absolutePath);
+
+    for (boost::filesystem::path annotationFile : annotationsDirectory)
+    {
+      if (annotationFile.string().length() > 3 &&
+          annotationFile.string().substr(
+          annotationFile.string().length() - 3) == "xml")
+      {
+        files.push_back(annotationFile.string());
+      }
+    }
+  }
+
+  /**
+   * Reads a single XML annotation file. Only the configured tags are
+   * extracted, no tree of the document is built. Bounding boxes are scaled
+   * to the output size if one is given. This function can be called from
+   * multiple threads.
+   *
+   * @param annotationFile Path to the XML file.
+   * @param pathToImages Path to folder containing images.
+   * @param absolutePath Boolean to determine if absolute path is used.
+   * @param classMap Mapping from class name to label.
+   * @param indexMap Mapping from XML tag to position in bounding box.
+   * @param outputWidth Width of the image after resize, 0 if not resized.
+   * @param outputHeight Height of the image after resize, 0 if not resized.
+   * @param imagePath Path to the image corresponding to the annotation.
+   * @param imageWidth Width of the image stored on disk.
+   * @param imageHeight Height of the image stored on disk.
+   * @param imageDepth Depth of the image stored on disk.
+   * @param boundingBoxes Class label and coordinates of every object.
+   * @return false if the annotation is invalid or the corresponding image
+   *     doesn't exist.
+   */
+  bool ReadAnnotation(const std::string& annotationFile,
+                      const std::string& pathToImages,
+                      const bool absolutePath,
+                      const std::unordered_map<std::string, size_t>& classMap,
+                      const std::unordered_map<std::string, size_t>& indexMap,
+                      const std::string& baseXMLTag,
+                      const std::string& imageNameXMLTag,
+                      const std::string& sizeXMLTag,
+                      const std::string& objectXMLTag,
+                      const std::string& bndboxXMLTag,
+                      const std::string& classNameXMLTag,
+                      const size_t outputWidth,
+                      const size_t outputHeight,
+                      std::string& imagePath,
+                      size_t& imageWidth,
+                      size_t& imageHeight,
+                      size_t& imageDepth,
+                      arma::vec& boundingBoxes);
+
+  /**
+   * Computes indices of the train / validation split. Sharded data points,
+   * or those of a DataLoader given a seed by Shard(), are shuffled with a
+   * generator drawn from the shard seed, so the split is the same on every
+   * run with the same seed. Otherwise the generator is drawn from mlpack's
+   * random number generator, like the order of a BatchIterator.
+   *
+   * @param size Number of data points in the dataset.
+   * @param validRatio Ratio of dataset to be used for validation set.
+   * @param shuffle Boolean to determine whether or not to shuffle the data.
+   * @param trainIndices Indices of data points in training set.
+   * @param validIndices Indices of data points in validation set.
+   */
+  void SplitIndices(const size_t size,
+                    const double validRatio,
+                    const bool shuffle,
+                    arma::uvec& trainIndices,
+                    arma::uvec& validIndices)
+  {
+    const size_t validSize = static_cast<size_t>(size * validRatio);
+    const size_t trainSize = size - validSize;
+
+    std::vector<size_t> order(size);
+    std::iota(order.begin(), order.end(), 0);
+    if (shuffle)
+    {
+      const size_t seed = (worldSize > 1 || seeded) ? shardSeed :
+          mlpack::RandInt(std::numeric_limits<int>::max());
+      std::mt19937 generator(seed);
+      std::shuffle(order.begin(), order.end(), generator);
+    }
+
+    trainIndices.set_size(trainSize);
+    validIndices.set_size(validSize);
+    for (size_t i = 0; i < trainSize; i++)
+      trainIndices[i] = order[i];
+    for (size_t i = 0; i < validSize; i++)
+      validIndices[i] = order[trainSize + i];
+  }
+
+  /**
+   * Splits the columns of the given matrix into the training and validation
+   * sets given by SplitIndices(), in place. The columns are permuted so that
+   * the training set is followed by the validation set, the matrix is moved
+   * into the given store and both sets alias their columns of it, so the
+   * dataset is never copied.
+   *
+   * @param dataset Matrix to split, moved into the store.
+   * @param store Matrix holding the columns of both sets.
+   * @param train Training set, alias of the first columns of the store.
+   * @param valid Validation set, alias of the last columns of the store.
+   */
+  template<typename MatType>
+  void SplitColumns(MatType& dataset,
+                    MatType& store,
+                    MatType& train,
+                    MatType& valid) const
+  {
+    // Column i of the split is column order[i] of the dataset. Every cycle
+    // of the permutation is followed with a single column held aside.
+    const size_t trainSize = trainIndices.n_elem;
+    std::vector<size_t> order(dataset.n_cols);
+    for (size_t i = 0; i < trainSize; i++)
+      order[i] = trainIndices[i];
+    for (size_t i = 0; i < validIndices.n_elem; i++)
+      order[trainSize + i] = validIndices[i];
+
+    std::vector<char> placed(order.size(), 0);
+    arma::Col<typename MatType::elem_type> column;
+    for (size_t start = 0; start < order.size(); start++)
+    {
+      if (placed[start])
+        continue;
+
+      column = dataset.col(start);
+      size_t i = start;
+      while (order[i] != start)
+      {
+        dataset.col(i) = dataset.col(order[i]);
+        placed[i] = 1;
+        i = order[i];
+      }
+
+      dataset.col(i) = column;
+      placed[i] = 1;
+    }
+
+    store = std::move(dataset);
+    MakeAlias(train, store, store.n_rows, trainSize, 0, false);
+    MakeAlias(valid, store, store.n_rows, validIndices.n_elem,
+        store.n_rows * trainSize, false);
+  }
+
+  /**
+   * Checks whether the given training and validation sets still alias the
+   * columns of the store they were split into by SplitColumns(). The sets no
+   * longer alias the store once they are assigned, or if a later load
+   * copied them.
+   *
+   * @param store Matrix holding the columns of both sets.
+   * @param train Training set.
+   * @param valid Validation set.
+   */
+  template<typename MatType>
+  static bool AliasesSplit(const MatType& store,
+                           const MatType& train,
+                           const MatType& valid)
+  {
+    return !store.is_empty() && train.n_rows == store.n_rows &&
+        valid.n_rows == store.n_rows &&
+        train.n_cols + valid.n_cols == store.n_cols &&
+        train.memptr() == store.memptr() &&
+        (valid.n_elem == 0 || valid.memptr() == store.memptr() + train.n_elem);
+  }
+
+  /**
+   * Copies the training and validation sets of another DataLoader. Sets that
+   * alias the store of the other DataLoader alias a copy of it, so the split
+   * is copied once; other sets are copied on their own.
+   *
+   * @param otherStore Store of the other DataLoader.
+   * @param otherTrain Training set of the other DataLoader.
+   * @param otherValid Validation set of the other DataLoader.
+   * @param store Store of this DataLoader.
+   * @param train Training set of this DataLoader.
+   * @param valid Validation set of this DataLoader.
+   */
+  template<typename MatType>
+  static void CopySplit(const MatType& otherStore,
+                        const MatType& otherTrain,
+                        const MatType& otherValid,
+                        MatType& store,
+                        MatType& train,
+                        MatType& valid)
+  {
+    // The sets are emptied first, since they may alias the store.
+    train.reset();
+    valid.reset();
+    if (AliasesSplit(otherStore, otherTrain, otherValid))
+    {
+      store = otherStore;
+      MakeAlias(train, store, store.n_rows, otherTrain.n_cols, 0, false);
+      MakeAlias(valid, store, store.n_rows, otherValid.n_cols,
+          otherTrain.n_elem, false);
+    }
+    else
+    {
+      store.reset();
+      train = otherTrain;
+      valid = otherValid;
+    }
+  }
+
+  /**
+   * Takes the training and validation sets of another DataLoader. Sets that
+   * alias the store of the other DataLoader are aliased again after the
+   * store is moved, since a small store is copied instead of stolen.
+   *
+   * @param otherStore Store of the other DataLoader.
+   * @param otherTrain Training set of the other DataLoader.
+   * @param otherValid Validation set of the other DataLoader.
+   * @param store Store of this DataLoader.
+   * @param train Training set of this DataLoader.
+   * @param valid Validation set of this DataLoader.
+   */
+  template<typename MatType>
+  static void MoveSplit(MatType& otherStore,
+                        MatType& otherTrain,
+                        MatType& otherValid,
+                        MatType& store,
+                        MatType& train,
+                        MatType& valid)
+  {
+    // The sets are emptied first, since they may alias the store.
+    train.reset();
+    valid.reset();
+    if (AliasesSplit(otherStore, otherTrain, otherValid))
+    {
+      const size_t trainSize = otherTrain.n_cols;
+      const size_t validSize = otherValid.n_cols;
+      otherTrain.reset();
+      otherValid.reset();
+
+      store = std::move(otherStore);
+      MakeAlias(train, store, store.n_rows, trainSize, 0, false);
+      MakeAlias(valid, store, store.n_rows, validSize,
+          store.n_rows * trainSize, false);
+    }
+    else
+    {
+      store.reset();
+      otherStore.reset();
+      train = std::move(otherTrain);
+      valid = std::move(otherValid);
+    }
+  }
+
+  /**
+   * Get the indices of the data points of a dataset that belong to the shard
+   * of this process, in ascending order so that files are read sequentially.
+   * All shards use the same permutation of the dataset, drawn from the shard
+   * seed, and shard r holds positions [r * size / worldSize,
+   * (r + 1) * size / worldSize) of it.
+   *
+   * @param size Number of data points in the dataset.
+   */
+  arma::uvec ShardIndices(const size_t size) const
+  {
+    if (worldSize == 1)
+    {
+      arma::uvec all;
+      if (size > 0)
+        all = arma::linspace<arma::uvec>(0, size - 1, size);
+      return all;
+    }
+
+    std::vector<size_t> permutation(size);
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::mt19937 generator(shardSeed);
+    std::shuffle(permutation.begin(), permutation.end(), generator);
+
+    const size_t begin = shardRank * size / worldSize;
+    const size_t end = (shardRank + 1) * size / worldSize;
+    arma::uvec shard(end - begin);
+    for (size_t i = begin; i < end; i++)
+      shard[i - begin] = permutation[i];
+
+    return arma::sort(shard);
+  }
+
+  /**
+   * Keeps only the elements that belong to the shard of this process.
+   *
+   * @param items Items of the dataset, e.g. paths to its files.
+   */
+  template<typename ItemType>
+  void SelectShard(std::vector<ItemType>& items) const
+  {
+    if (worldSize == 1)
+      return;
+
+    const arma::uvec shard = ShardIndices(items.size());
+    std::vector<ItemType> selected(shard.n_elem);
+    for (size_t i = 0; i < shard.n_elem; i++)
+      selected[i] = std::move(items[shard[i]]);
+
+    items = std::move(selected);
+  }
+
   /**
    * Utility Function to wrap indices.
    *
@@ -367,98 +1030,121 @@ class DataLoader
   }
 
   /**
-   * Performs train test split.
+   * Performs train test split of an object detection dataset into field type
+   * labels.
    *
-   * @tparam DatasetType Type of input dataset.
-   * @tparam LabelsType Type of input labels.
-   *
-   * @param dataset Features of dataset.
-   * @param labels Labels of the dataset.
+   * @param dataset Features of dataset, moved into the training and
+   *     validation sets.
+   * @param labels Bounding boxes of the dataset.
+   * @param trainFeatures Features of the training set.
+   * @param trainLabels Bounding boxes of the training set.
+   * @param validFeatures Features of the validation set.
+   * @param validLabels Bounding boxes of the validation set.
    * @param validRatio Ratio for train-test split.
    * @param shuffle Boolean to determine shuffling of dataset.
    */
   void TrainTestSplit(DatasetX& dataset,
-                      std::deque<arma::vec>& labels,
-                      DatasetX& /* trainFeatures */,
-                      arma::field<arma::vec>& /* trainLabels */,
-                      DatasetX& /* validFeatures */,
-                      arma::field<arma::vec>& /* validLabels */,
+                      const BoxStore& labels,
+                      DatasetX& trainFeatures,
+                      arma::field<arma::vec>& trainLabels,
+                      DatasetX& validFeatures,
+                      arma::field<arma::vec>& validLabels,
                       const double validRatio,
                       const bool shuffle)
   {
-    const size_t validSize = static_cast<size_t>(dataset.n_cols * validRatio);
-    const size_t trainSize = dataset.n_cols - validSize;
+    SplitIndices(dataset.n_cols, validRatio, shuffle, trainIndices,
+        validIndices);
 
-    arma::uvec order = arma::linspace<arma::uvec>(0, dataset.n_cols - 1,
-        dataset.n_cols);
-    if (shuffle)
-      order = arma::shuffle(order);
+    SplitColumns(dataset, splitFeatures, trainFeatures, validFeatures);
 
-    if (trainSize > 0)
-    {
-      trainLabels.set_size(1, trainSize);
-      trainFeatures = dataset.cols(order.subvec(0, trainSize - 1));
+    // Field type has fixed size so we can't use span and assignment
+    // operator.
+    trainLabels.set_size(1, trainIndices.n_elem);
+    for (size_t i = 0; i < trainIndices.n_elem; i++)
+      trainLabels(0, i) = labels.Boxes(trainIndices[i]);
 
-      // Field type has fixed size so we can't use span and assignment
-      // operator.
-      for (size_t i = 0; i < trainSize; i++)
-        trainLabels(0, i) = labels[i];
-    }
-
-    if (validSize <= dataset.n_cols)
-    {
-      validFeatures = dataset.cols(order.subvec(trainSize,
-          dataset.n_cols - 1));
-      validLabels.set_size(1, validSize);
-      for (size_t i = trainSize; i < dataset.n_cols; i++)
-        validLabels(0, i - trainSize) = labels[i];
-    }
-    return;
+    validLabels.set_size(1, validIndices.n_elem);
+    for (size_t i = 0; i < validIndices.n_elem; i++)
+      validLabels(0, i) = labels.Boxes(validIndices[i]);
   }
 
   /**
-   * Performs train/test split.
+   * Performs train test split of an object detection dataset. Only the
+   * offsets of the selected images are copied.
    *
-   * @tparam DatasetType Type of input dataset.
-   * @tparam LabelsType Type of input labels.
+   * @param dataset Features of dataset, moved into the training and
+   *     validation sets.
+   * @param labels Bounding boxes of the dataset.
+   * @param trainFeatures Features of the training set.
+   * @param trainLabels Bounding boxes of the training set.
+   * @param validFeatures Features of the validation set.
+   * @param validLabels Bounding boxes of the validation set.
+   * @param validRatio Ratio for train-test split.
+   * @param shuffle Boolean to determine shuffling of dataset.
+   */
+  void TrainTestSplit(DatasetX& dataset,
+                      const BoxStore& labels,
+                      DatasetX& trainFeatures,
+                      BoxStore& trainLabels,
+                      DatasetX& validFeatures,
+                      BoxStore& validLabels,
+                      const double validRatio,
+                      const bool shuffle)
+  {
+    SplitIndices(dataset.n_cols, validRatio, shuffle, trainIndices,
+        validIndices);
+
+    SplitColumns(dataset, splitFeatures, trainFeatures, validFeatures);
+    trainLabels = labels.Subset(trainIndices);
+    validLabels = labels.Subset(validIndices);
+  }
+
+  /**
+   * Performs train/test split of an object detection dataset where every
+   * image has the same number of objects.
    *
-   * @param dataset Features of dataset.
-   * @param labels Labels of the dataset.
+   * @param dataset Features of dataset, moved into the training and
+   *     validation sets.
+   * @param labels Bounding boxes of the dataset.
+   * @param trainFeatures Features of the training set.
+   * @param trainLabels Bounding boxes of the training set.
+   * @param validFeatures Features of the validation set.
+   * @param validLabels Bounding boxes of the validation set.
    * @param validRatio Ratio for train-test split.
    * @param shuffle Boolean to determine shuffling of dataset.
    */
   void TrainTestSplit(DatasetX& dataset,
-                      std::deque<arma::vec>& labels,
-                      DatasetX& /* trainFeatures */,
-                      arma::mat& /* trainLabels */,
-                      DatasetX& /* validFeatures */,
-                      arma::mat& /* validLabels */,
+                      const BoxStore& labels,
+                      DatasetX& trainFeatures,
+                      arma::mat& trainLabels,
+                      DatasetX& validFeatures,
+                      arma::mat& validLabels,
                       const double validRatio,
                       const bool shuffle)
   {
     // Calculate number of objects in the image.
-    size_t numberOfObjects = labels[0].n_rows;
-    DatasetY labelsTemp(numberOfObjects, labels.size());
-
-    for (size_t i = 0; i < labels.size(); i++)
-      labelsTemp.col(i) = labels[i];
-
-    DatasetX completeDataset = arma::join_cols(dataset, labelsTemp);
-    mlpack::data::Split(completeDataset, trainFeatures, validFeatures,
-        validRatio, shuffle);
-
-    // Features are all rows except the last 5 rows which correspond
-    // to bounding box.
-    trainLabels = trainFeatures.rows(trainFeatures.n_rows -
-        numberOfObjects, trainFeatures.n_rows - 1);
-    trainFeatures = trainFeatures.rows(0, trainFeatures.n_rows -
-        numberOfObjects - 1);
-
-    validLabels = validFeatures.rows(validFeatures.n_rows -
-        numberOfObjects, validFeatures.n_rows - 1);
-    validFeatures = validFeatures.rows(0, validFeatures.n_rows -
-        numberOfObjects - 1);
-    return;
+    size_t numberOfObjects = labels.NumImages() > 0 ?
+        5 * labels.NumBoxes(0) : 0;
+    DatasetY labelsTemp(numberOfObjects, labels.NumImages());
+
+    for (size_t i = 0; i < labels.NumImages(); i++)
+    {
+      if (labels.NumBoxes(i) != labels.NumBoxes(0))
+      {
+        mlpack::Log::Fatal << "All images must have the same number of " <<
+            "objects for matrix type labels, use field type or BoxStore " <<
+            "for variable number of objects." << std::endl;
+      }
+
+      labelsTemp.col(i) = labels.Boxes(i);
+    }
+
+    SplitIndices(dataset.n_cols, validRatio, shuffle, trainIndices,
+        validIndices);
+
+    SplitColumns(dataset, splitFeatures, trainFeatures, validFeatures);
+    trainLabels = labelsTemp.cols(trainIndices);
+    validLabels = labelsTemp.cols(validIndices);
   }
 
   //! Locally stored mappings for some well known datasets.
@@ -479,6 +1165,25 @@ class DataLoader
   //! Locally stored labels for testing.
   DatasetY testLabels;
 
+  //! Locally stored features of the training and validation sets, which
+  //! alias their columns.
+  DatasetX splitFeatures;
+  //! Locally stored labels of the training and validation sets, which alias
+  //! their columns.
+  DatasetY splitLabels;
+
+  //! Locally stored indices of data points in the training set.
+  arma::uvec trainIndices;
+  //! Locally stored indices of data points in the validation set.
+  arma::uvec validIndices;
+
+  //! Locally stored index of training images.
+  FileIndex trainIndex;
+  //! Locally stored index of validation images.
+  FileIndex validIndex;
+  //! Locally stored index of testing images.
+  FileIndex testIndex;
+
   //! Locally Stored scaler.
   ScalerType scaler;
 
@@ -496,6 +1201,27 @@ class DataLoader
 
   //! Locally stored augmentation probability.
   double augmentationProbability;
+
+  //! Locally stored width of images of a dataset in memory.
+  size_t datasetWidth;
+
+  //! Locally stored height of images of a dataset in memory.
+  size_t datasetHeight;
+
+  //! Locally stored depth of images of a dataset in memory.
+  size_t datasetDepth;
+
+  //! Locally stored index of the shard that is loaded.
+  size_t shardRank;
+
+  //! Locally stored number of shards datasets are partitioned into.
+  size_t worldSize;
+
+  //! Locally stored seed for partitioning datasets into shards.
+  size_t shardSeed;
+
+  //! Locally stored flag set if the seed was passed to Shard().
+  bool seeded;
 };
 
 } // namespace models
@@ -26,7 +26,16 @@ template<
   class ScalerType
 >DataLoader<
     DatasetX, DatasetY, ScalerType
->::DataLoader()
+>::DataLoader() :
+    ratio(0.25),
+    augmentationProbability(0.2),
+    datasetWidth(0),
+    datasetHeight(0),
+    datasetDepth(0),
+    shardRank(0),
+    worldSize(1),
+    shardSeed(0),
+    seeded(false)
 {
   // Nothing to do here.
 }
@@ -42,15 +51,44 @@ template<
               const double validRatio,
               const bool useScaler,
               const std::vector<std::string> augmentation,
-              const double augmentationProbability)
+              const double augmentationProbability,
+              const std::string& cacheDirectory,
+              const size_t shardRank,
+              const size_t worldSize,
+              const size_t shardSeed) :
+    ratio(validRatio),
+    augmentationProbability(augmentationProbability),
+    datasetWidth(0),
+    datasetHeight(0),
+    datasetDepth(0),
+    shardRank(0),
+    worldSize(1),
+    shardSeed(0),
+    seeded(false)
 {
+  if (worldSize > 1)
+    Shard(shardRank, worldSize, shardSeed);
+  else
+    Shard(shardRank, worldSize);
+
   InitializeDatasets();
   if (datasetMap.count(dataset))
   {
+    // Datasets present in their binary format are mapped directly instead
+    // of being downloaded and parsed.
+    const bool binary = LoadBinaryDataset(datasetMap[dataset], shuffle,
+        validRatio, useScaler);
+
     // Use utility functions to download the dataset.
-    DownloadDataset(dataset);
+    if (!binary)
+      DownloadDataset(dataset);
 
-    if (datasetMap[dataset].datasetType == "csv")
+    if (binary)
+    {
+      mlpack::Log::Info << "Loaded " << dataset << " from its binary files."
+          << std::endl;
+    }
+    else if (datasetMap[dataset].datasetType == "csv")
     {
       LoadCSV(datasetMap[dataset].trainPath, true, shuffle, validRatio,
               useScaler, datasetMap[dataset].startTrainingInputFeatures,
@@ -87,7 +125,8 @@ template<
       {
         LoadAllImagesFromDirectory(datasetMap[dataset].testingImagesPath,
             testFeatures, testLabels, datasetMap[dataset].imageWidth,
-            datasetMap[dataset].imageHeight, datasetMap[dataset].imageDepth);
+            datasetMap[dataset].imageHeight, datasetMap[dataset].imageDepth,
+            0, augmentations);
       }
     }
     else if (datasetMap[dataset].datasetType == "image-classification")
@@ -95,13 +134,14 @@ template<
       LoadImageDatasetFromDirectory(datasetMap[dataset].trainingImagesPath,
           datasetMap[dataset].imageWidth, datasetMap[dataset].imageHeight,
           datasetMap[dataset].imageDepth, true, validRatio, shuffle,
-          augmentation, augmentationProbability);
+          augmentation, augmentationProbability, cacheDirectory);
 
       if (datasetMap[dataset].testingImagesPath.length() > 0)
       {
         LoadAllImagesFromDirectory(datasetMap[dataset].testingImagesPath,
             testFeatures, testLabels, datasetMap[dataset].imageWidth,
-            datasetMap[dataset].imageHeight, datasetMap[dataset].imageDepth);
+            datasetMap[dataset].imageHeight, datasetMap[dataset].imageDepth,
+            0, augmentation);
       }
     }
 
@@ -119,6 +159,192 @@ template<
 }
 
 
+template<
+  typename DatasetX,
+  typename DatasetY,
+  class ScalerType
+>DataLoader<
+    DatasetX, DatasetY, ScalerType
+>::DataLoader(const DataLoader& other) :
+    datasetMap(other.datasetMap),
+    testFeatures(other.testFeatures),
+    testLabels(other.testLabels),
+    trainIndices(other.trainIndices),
+    validIndices(other.validIndices),
+    trainIndex(other.trainIndex),
+    validIndex(other.validIndex),
+    testIndex(other.testIndex),
+    scaler(other.scaler),
+    trainDatasetPath(other.trainDatasetPath),
+    testDatasetPath(other.testDatasetPath),
+    ratio(other.ratio),
+    augmentation(other.augmentation),
+    augmentationProbability(other.augmentationProbability),
+    datasetWidth(other.datasetWidth),
+    datasetHeight(other.datasetHeight),
+    datasetDepth(other.datasetDepth),
+    shardRank(other.shardRank),
+    worldSize(other.worldSize),
+    shardSeed(other.shardSeed),
+    seeded(other.seeded)
+{
+  CopySplit(other.splitFeatures, other.trainFeatures, other.validFeatures,
+      splitFeatures, trainFeatures, validFeatures);
+  CopySplit(other.splitLabels, other.trainLabels, other.validLabels,
+      splitLabels, trainLabels, validLabels);
+}
+
+template<
+  typename DatasetX,
+  typename DatasetY,
+  class ScalerType
+>DataLoader<
+    DatasetX, DatasetY, ScalerType
+>::DataLoader(DataLoader&& other) :
+    datasetMap(std::move(other.datasetMap)),
+    testFeatures(std::move(other.testFeatures)),
+    testLabels(std::move(other.testLabels)),
+    trainIndices(std::move(other.trainIndices)),
+    validIndices(std::move(other.validIndices)),
+    trainIndex(std::move(other.trainIndex)),
+    validIndex(std::move(other.validIndex)),
+    testIndex(std::move(other.testIndex)),
+    scaler(std::move(other.scaler)),
+    trainDatasetPath(std::move(other.trainDatasetPath)),
+    testDatasetPath(std::move(other.testDatasetPath)),
+    ratio(std::move(other.ratio)),
+    augmentation(std::move(other.augmentation)),
+    augmentationProbability(std::move(other.augmentationProbability)),
+    datasetWidth(std::move(other.datasetWidth)),
+    datasetHeight(std::move(other.datasetHeight)),
+    datasetDepth(std::move(other.datasetDepth)),
+    shardRank(std::move(other.shardRank)),
+    worldSize(std::move(other.worldSize)),
+    shardSeed(std::move(other.shardSeed)),
+    seeded(std::move(other.seeded))
+{
+  MoveSplit(other.splitFeatures, other.trainFeatures, other.validFeatures,
+      splitFeatures, trainFeatures, validFeatures);
+  MoveSplit(other.splitLabels, other.trainLabels, other.validLabels,
+      splitLabels, trainLabels, validLabels);
+}
+
+template<
+  typename DatasetX,
+  typename DatasetY,
+  class ScalerType
+> DataLoader<DatasetX, DatasetY, ScalerType>& DataLoader<
+    DatasetX, DatasetY, ScalerType
+>::operator=(const DataLoader& other)
+{
+  if (this != &other)
+  {
+    datasetMap = other.datasetMap;
+    testFeatures = other.testFeatures;
+    testLabels = other.testLabels;
+    trainIndices = other.trainIndices;
+    validIndices = other.validIndices;
+    trainIndex = other.trainIndex;
+    validIndex = other.validIndex;
+    testIndex = other.testIndex;
+    scaler = other.scaler;
+    trainDatasetPath = other.trainDatasetPath;
+    testDatasetPath = other.testDatasetPath;
+    ratio = other.ratio;
+    augmentation = other.augmentation;
+    augmentationProbability = other.augmentationProbability;
+    datasetWidth = other.datasetWidth;
+    datasetHeight = other.datasetHeight;
+    datasetDepth = other.datasetDepth;
+    shardRank = other.shardRank;
+    worldSize = other.worldSize;
+    shardSeed = other.shardSeed;
+    seeded = other.seeded;
+
+    CopySplit(other.splitFeatures, other.trainFeatures, other.validFeatures,
+        splitFeatures, trainFeatures, validFeatures);
+    CopySplit(other.splitLabels, other.trainLabels, other.validLabels,
+        splitLabels, trainLabels, validLabels);
+  }
+
+  return *this;
+}
+
+template<
+  typename DatasetX,
+  typename DatasetY,
+  class ScalerType
+> DataLoader<DatasetX, DatasetY, ScalerType>& DataLoader<
+    DatasetX, DatasetY, ScalerType
+>::operator=(DataLoader&& other)
+{
+  if (this != &other)
+  {
+    datasetMap = std::move(other.datasetMap);
+    testFeatures = std::move(other.testFeatures);
+    testLabels = std::move(other.testLabels);
+    trainIndices = std::move(other.trainIndices);
+    validIndices = std::move(other.validIndices);
+    trainIndex = std::move(other.trainIndex);
+    validIndex = std::move(other.validIndex);
+    testIndex = std::move(other.testIndex);
+    scaler = std::move(other.scaler);
+    trainDatasetPath = std::move(other.trainDatasetPath);
+    testDatasetPath = std::move(other.testDatasetPath);
+    ratio = std::move(other.ratio);
+    augmentation = std::move(other.augmentation);
+    augmentationProbability = std::move(other.augmentationProbability);
+    datasetWidth = std::move(other.datasetWidth);
+    datasetHeight = std::move(other.datasetHeight);
+    datasetDepth = std::move(other.datasetDepth);
+    shardRank = std::move(other.shardRank);
+    worldSize = std::move(other.worldSize);
+    shardSeed = std::move(other.shardSeed);
+    seeded = std::move(other.seeded);
+
+    MoveSplit(other.splitFeatures, other.trainFeatures, other.validFeatures,
+        splitFeatures, trainFeatures, validFeatures);
+    MoveSplit(other.splitLabels, other.trainLabels, other.validLabels,
+        splitLabels, trainLabels, validLabels);
+  }
+
+  return *this;
+}
+
+template<
+  typename DatasetX,
+  typename DatasetY,
+  class ScalerType
+> void DataLoader<
+    DatasetX, DatasetY, ScalerType
+>::Shard(const size_t shardRank,
+         const size_t worldSize,
+         const size_t shardSeed)
+{
+  if (worldSize == 0 || shardRank >= worldSize)
+  {
+    mlpack::Log::Fatal << "Shard rank " << shardRank << " is out of range "
+        << "for a world size of " << worldSize << "." << std::endl;
+  }
+
+  this->shardRank = shardRank;
+  this->worldSize = worldSize;
+  this->shardSeed = shardSeed;
+  seeded = true;
+}
+
+template<
+  typename DatasetX,
+  typename DatasetY,
+  class ScalerType
+> void DataLoader<
+    DatasetX, DatasetY, ScalerType
+>::Shard(const size_t shardRank, const size_t worldSize)
+{
+  Shard(shardRank, worldSize, 0);
+  seeded = false;
+}
+
 template<
   typename DatasetX,
   typename DatasetY,
@@ -137,29 +363,74 @@ template<
            const std::vector<std::string> augmentation,
            const double augmentationProbability)
 {
-  arma::mat dataset;
-  data::Load(datasetPath, dataset, true);
-
-  if (loadTrainData)
+  // The file is streamed twice, once to get its shape and then to parse the
+  // requested columns straight into the final matrices.
+  CSVReader reader(datasetPath);
+  size_t numPoints = 0, numColumns = 0;
+  if (!reader.Scan(numPoints, numColumns) || numColumns == 0)
   {
-    arma::mat trainDataset, validDataset;
-    data::Split(dataset, trainDataset, validDataset, validRatio, shuffle);
+    mlpack::Log::Fatal << "Unable to load CSV file " << datasetPath << "." <<
+        std::endl;
+  }
+
+  // Data points of a CSV file aren't images.
+  datasetWidth = 0;
 
-    trainFeatures = trainDataset.rows(WrapIndex(startInputFeatures,
-        trainDataset.n_rows), WrapIndex(endInputFeatures,
-        trainDataset.n_rows));
+  const size_t inputBegin = WrapIndex(startInputFeatures, numColumns);
+  const size_t inputEnd = WrapIndex(endInputFeatures, numColumns);
+  const size_t predictionBegin = WrapIndex(startPredictionFeatures,
+      numColumns);
+  const size_t predictionEnd = WrapIndex(endPredictionFeatures, numColumns);
 
-    trainLabels = trainDataset.rows(WrapIndex(startPredictionFeatures,
-        trainDataset.n_rows), WrapIndex(endPredictionFeatures,
-        trainDataset.n_rows));
+  // Rows of other shards are skipped without being parsed.
+  const arma::uvec shard = ShardIndices(numPoints);
+  std::vector<char> inShard(numPoints, 0);
+  for (size_t i = 0; i < shard.n_elem; i++)
+    inShard[shard[i]] = 1;
+  auto shardFilter = [&](const size_t point) { return inShard[point] != 0; };
 
-    validFeatures = validDataset.rows(WrapIndex(startInputFeatures,
-        validDataset.n_rows), WrapIndex(endInputFeatures,
-        validDataset.n_rows));
+  if (loadTrainData)
+  {
+    SplitIndices(shard.n_elem, validRatio, shuffle, trainIndices,
+        validIndices);
+
+    // Destination of every data point, points at position >= trainSize
+    // belong to the validation set.
+    const size_t trainSize = trainIndices.n_elem;
+    std::vector<size_t> destination(numPoints);
+    for (size_t i = 0; i < trainSize; i++)
+      destination[shard[trainIndices[i]]] = i;
+    for (size_t i = 0; i < validIndices.n_elem; i++)
+      destination[shard[validIndices[i]]] = trainSize + i;
+
+    trainFeatures.set_size(inputEnd - inputBegin + 1, trainSize);
+    validFeatures.set_size(inputEnd - inputBegin + 1, validIndices.n_elem);
+    trainLabels.set_size(predictionEnd - predictionBegin + 1, trainSize);
+    validLabels.set_size(predictionEnd - predictionBegin + 1,
+        validIndices.n_elem);
+
+    reader.Parse(std::min(inputBegin, predictionBegin),
+        std::max(inputEnd, predictionEnd),
+        [&](const size_t point, const size_t column, const double value)
+    {
+      const size_t col = destination[point];
+      const bool train = col < trainSize;
+      if (column >= inputBegin && column <= inputEnd)
+      {
+        if (train)
+          trainFeatures(column - inputBegin, col) = value;
+        else
+          validFeatures(column - inputBegin, col - trainSize) = value;
+      }
 
-    validLabels = validDataset.rows(WrapIndex(startPredictionFeatures,
-        validDataset.n_rows), WrapIndex(endPredictionFeatures,
-        validDataset.n_rows));
+      if (column >= predictionBegin && column <= predictionEnd)
+      {
+        if (train)
+          trainLabels(column - predictionBegin, col) = value;
+        else
+          validLabels(column - predictionBegin, col - trainSize) = value;
+      }
+    }, shardFilter);
 
     if (useScaler)
     {
@@ -168,25 +439,117 @@ template<
       scaler.Transform(validFeatures, validFeatures);
     }
 
+    // Every data point is a column of the selected input features, so both
+    // sets are resized alike.
     Augmentation augmentations(augmentation, augmentationProbability);
-    augmentations.Transform(trainFeatures, 1, dataset.n_rows, 1);
+    augmentations.ResizeTransform(trainFeatures, 1, trainFeatures.n_rows, 1);
+    augmentations.ResizeTransform(validFeatures, 1, validFeatures.n_rows, 1);
 
     mlpack::Log::Info << "Training Dataset Loaded." << std::endl;
   }
   else
   {
+    // Position of every data point of the shard in the test set.
+    std::vector<size_t> destination(numPoints);
+    for (size_t i = 0; i < shard.n_elem; i++)
+      destination[shard[i]] = i;
+
+    testFeatures.set_size(inputEnd - inputBegin + 1, shard.n_elem);
+    reader.Parse(inputBegin, inputEnd,
+        [&](const size_t point, const size_t column, const double value)
+    {
+      testFeatures(column - inputBegin, destination[point]) = value;
+    }, shardFilter);
+
     if (useScaler)
     {
-      scaler.Transform(dataset, dataset);
+      scaler.Transform(testFeatures, testFeatures);
     }
 
-    testFeatures = dataset.rows(WrapIndex(startInputFeatures, dataset.n_rows),
-        WrapIndex(endInputFeatures, dataset.n_rows));
-
     mlpack::Log::Info << "Testing Dataset Loaded." << std::endl;
   }
 }
 
+template<
+  typename DatasetX,
+  typename DatasetY,
+  class ScalerType
+> bool DataLoader<
+    DatasetX, DatasetY, ScalerType
+>::LoadBinaryDataset(const DatasetDetails<DatasetX, DatasetY>& details,
+                     const bool shuffle,
+                     const double validRatio,
+                     const bool useScaler)
+{
+  if (details.binaryFormat.empty() ||
+      !BinaryDatasetReader::Exists(details.trainBinaryPaths) ||
+      !BinaryDatasetReader::Exists(details.testBinaryPaths))
+  {
+    return false;
+  }
+
+  // Only items of the shard are converted.
+  auto selectShard = [this](const size_t items) { return ShardIndices(items); };
+
+  DatasetX dataset;
+  DatasetY labels;
+  if (details.binaryFormat == "idx")
+  {
+    if (details.trainBinaryPaths.size() != 2 ||
+        details.testBinaryPaths.size() != 2 ||
+        !BinaryDatasetReader::LoadIDX(details.trainBinaryPaths[0], dataset,
+            selectShard) ||
+        !BinaryDatasetReader::LoadIDX(details.trainBinaryPaths[1], labels,
+            selectShard) ||
+        !BinaryDatasetReader::LoadIDX(details.testBinaryPaths[0],
+            testFeatures, selectShard) ||
+        !BinaryDatasetReader::LoadIDX(details.testBinaryPaths[1], testLabels,
+            selectShard))
+    {
+      return false;
+    }
+  }
+  else if (details.binaryFormat == "cifar-binary")
+  {
+    if (!BinaryDatasetReader::LoadCIFAR(details.trainBinaryPaths, dataset,
+        labels, selectShard) || !BinaryDatasetReader::LoadCIFAR(
+        details.testBinaryPaths, testFeatures, testLabels, selectShard))
+    {
+      return false;
+    }
+  }
+  else
+  {
+    mlpack::Log::Warn << "Unknown binary format " << details.binaryFormat <<
+        " of " << details.datasetName << "." << std::endl;
+    return false;
+  }
+
+  if (dataset.n_cols != labels.n_cols || testFeatures.n_cols !=
+      testLabels.n_cols)
+  {
+    mlpack::Log::Warn << "Number of images and labels of " <<
+        details.datasetName << " don't match." << std::endl;
+    return false;
+  }
+
+  SplitIndices(dataset.n_cols, validRatio, shuffle, trainIndices,
+      validIndices);
+
+  SplitColumns(dataset, splitFeatures, trainFeatures, validFeatures);
+  SplitColumns(labels, splitLabels, trainLabels, validLabels);
+
+  if (useScaler)
+  {
+    scaler.Fit(trainFeatures);
+    scaler.Transform(trainFeatures, trainFeatures);
+    scaler.Transform(validFeatures, validFeatures);
+    scaler.Transform(testFeatures, testFeatures);
+  }
+
+  return true;
+}
+
 template<
   typename DatasetX,
   typename DatasetY,
@@ -214,14 +577,6 @@ template<
 {
   Augmentation augmentation(augmentations, augmentationProbability);
 
-  std::vector<boost::filesystem::path> annotationsDirectory;
-
-  DatasetX dataset;
-  std::deque<arma::vec> labels;
-
-  // Fill the directory.
-  Utils::ListDir(pathToAnnotations, annotationsDirectory, absolutePath);
-
   // Create a map for labels and corresponding class name.
   // This provides faster access to class labels.
   std::unordered_map<std::string, size_t> classMap;
@@ -236,125 +591,123 @@ template<
   indexMap.insert(std::make_pair(x2XMLTag, 3));
   indexMap.insert(std::make_pair(y2XMLTag, 4));
 
-  // Keep track of files loaded.
-  size_t totalFiles = annotationsDirectory.size(), loadedFiles = 0;
-  size_t imageWidth = 0, imageHeight = 0, imageDepth = 0;
-
-  // Read the XML file.
-  for (boost::filesystem::path annotationFile : annotationsDirectory)
+  // Output shape of the images, if resize augmentation is given.
+  size_t outputWidth = 0, outputHeight = 0;
+  if (augmentation.HasResize())
   {
-    if (annotationFile.string().length() <= 3 ||
-        annotationFile.string().substr(
-        annotationFile.string().length() - 3) != "xml")
-    {
-      continue;
-    }
+    outputWidth = augmentation.ResizeWidth();
+    outputHeight = augmentation.ResizeHeight();
+  }
 
-    loadedFiles++;
-    Log::Info << "Files Loaded : " << loadedFiles << " out of " <<
-        totalFiles << "\r" << std::endl;
+  // Parse all annotations in parallel.
+  std::vector<std::string> annotationFiles;
+  ListAnnotations(pathToAnnotations, absolutePath, annotationFiles);
+  SelectShard(annotationFiles);
 
-    // Read the XML file.
-    boost::property_tree::ptree xmlFile;
-    boost::property_tree::read_xml(annotationFile.string(), xmlFile);
+  const size_t totalFiles = annotationFiles.size();
+  std::vector<std::string> imagePaths(totalFiles);
+  std::vector<arma::vec> boundingBoxes(totalFiles);
+  std::vector<size_t> widths(totalFiles), heights(totalFiles),
+      depths(totalFiles);
+  std::vector<char> parsed(totalFiles, 0);
 
-    // Get annotation from XML file.
-    boost::property_tree::ptree annotation = xmlFile.get_child(baseXMLTag);
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < totalFiles; i++)
+  {
+    parsed[i] = ReadAnnotation(annotationFiles[i], pathToImages, absolutePath,
+        classMap, indexMap, baseXMLTag, imageNameXMLTag, sizeXMLTag,
+        objectXMLTag, bndboxXMLTag, classNameXMLTag, outputWidth,
+        outputHeight, imagePaths[i], widths[i], heights[i], depths[i],
+        boundingBoxes[i]);
+  }
 
-    // Read properties inside annotation file.
-    // Get image name.
-    std::string imgName = annotation.get_child(imageNameXMLTag).data();
+  // To keep the column order of earlier releases, which inserted images at
+  // the front one at a time, the last annotation occupies the first column.
+  std::vector<size_t> samples;
+  for (size_t i = totalFiles; i > 0; i--)
+  {
+    if (parsed[i - 1])
+      samples.push_back(i - 1);
+  }
 
-    // If image doesn't exist then skip the current XML file.
-    if (!Utils::PathExists(pathToImages + imgName, absolutePath))
+  size_t imageWidth = 0, imageHeight = 0, imageDepth = 0;
+  if (samples.size() > 0)
+  {
+    imageWidth = outputWidth > 0 ? outputWidth : widths[samples[0]];
+    imageHeight = outputHeight > 0 ? outputHeight : heights[samples[0]];
+    imageDepth = depths[samples[0]];
+  }
+
+  // Decode and resize all images in parallel, straight into their columns.
+  DatasetX dataset(imageWidth * imageHeight * imageDepth, samples.size());
+  std::vector<char> decoded(samples.size(), 0);
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < samples.size(); i++)
+  {
+    const size_t sample = samples[i];
+    DatasetX image;
+    if (!ImageDecoder::Decode(imagePaths[sample], widths[sample],
+        heights[sample], depths[sample], image))
     {
-      mlpack::Log::Warn << "Image not found! Tried finding " <<
-          pathToImages + imgName << std::endl;
       continue;
     }
 
-    // Get the size of image to create image info required
-    // by mlpack::data::Load function.
-    boost::property_tree::ptree sizeInfo = annotation.get_child(sizeXMLTag);
-    imageWidth = std::stoi(sizeInfo.get_child("width").data());
-    imageHeight = std::stoi(sizeInfo.get_child("height").data());
-    imageDepth = std::stoi(sizeInfo.get_child("depth").data());
-    mlpack::data::ImageInfo imageInfo(imageWidth, imageHeight, imageDepth);
-
-    // Load the image.
-    // The image loaded here will be in column format i.e. Output will
-    // be matrix with the following shape {1, cols * rows * slices} in
-    // column major format.
-    DatasetX image;
-    mlpack::data::Load(pathToImages + imgName, image, imageInfo);
+    augmentation.ResizeTransform(image, widths[sample], heights[sample],
+        depths[sample]);
 
-    double horizontalScale = 1.0, verticalScale = 1.0;
-    if (augmentation.HasResizeParam())
+    if (image.n_elem == dataset.n_rows)
     {
-      augmentation.ResizeTransform(image, imageWidth, imageHeight, imageDepth,
-          augmentation.augmentations[0]);
-
-      size_t outputWidth = 0, outputHeight = 0;
-      augmentation.GetResizeParam(outputWidth, outputHeight,
-          augmentation.augmentations[0]);
-      horizontalScale = 1.0 * outputWidth / imageWidth;
-      verticalScale = 1.0 * outputHeight / imageHeight;
-      imageWidth = outputWidth;
-      imageHeight = outputHeight;
+      dataset.col(i) = image;
+      decoded[i] = 1;
     }
+  }
+
+  size_t totalBoxes = 0;
+  for (size_t i = 0; i < samples.size(); i++)
+    totalBoxes += boundingBoxes[samples[i]].n_elem / 5;
 
-    // Iterate over all object in annotation.
-    arma::vec boundingBoxes;
-    BOOST_FOREACH(boost::property_tree::ptree::value_type const& object,
-        annotation)
+  BoxStore labels;
+  labels.Reserve(samples.size(), totalBoxes);
+  arma::uvec decodedColumns(samples.size());
+  size_t totalDecoded = 0;
+  for (size_t i = 0; i < samples.size(); i++)
+  {
+    if (!decoded[i])
     {
-      arma::vec predictions(5);
-      // Iterate over property of the object to get class label and
-      // bounding box coordinates.
-      if (object.first == objectXMLTag)
-      {
-        if (classMap.count(object.second.get_child(classNameXMLTag).data()))
-        {
-          predictions(indexMap[classNameXMLTag]) = classMap[
-              object.second.get_child(classNameXMLTag).data()];
-          boost::property_tree::ptree const &boundingBox =
-              object.second.get_child(bndboxXMLTag);
-
-          BOOST_FOREACH(boost::property_tree::ptree::value_type
-              const& coordinate, boundingBox)
-          {
-            if (indexMap.count(coordinate.first))
-            {
-              predictions(indexMap[coordinate.first]) =
-                  std::stoi(coordinate.second.data());
-            }
-          }
-
-          // Scale predictions.
-          predictions(indexMap[x1XMLTag]) = std::floor(
-              predictions(indexMap[x1XMLTag]) * horizontalScale);
-          predictions(indexMap[x2XMLTag]) = std::floor(
-              predictions(indexMap[x2XMLTag]) * horizontalScale);
-          predictions(indexMap[y1XMLTag]) = std::floor(
-              predictions(indexMap[y1XMLTag]) * verticalScale);
-          predictions(indexMap[y2XMLTag]) = std::floor(
-              predictions(indexMap[y2XMLTag]) * verticalScale);
-          boundingBoxes.insert_rows(0, predictions);
-        }
-      }
+      mlpack::Log::Warn << "Unable to load " << imagePaths[samples[i]] <<
+          "." << std::endl;
+      continue;
     }
 
-    // Add object to training set.
-    dataset.insert_cols(0, image);
-    labels.push_front(boundingBoxes);
+    decodedColumns[totalDecoded++] = i;
+    labels.Add(boundingBoxes[samples[i]]);
+  }
+
+  // Remove columns of images that couldn't be decoded.
+  if (totalDecoded < samples.size())
+  {
+    DatasetX decodedImages = dataset.cols(decodedColumns.head(totalDecoded));
+    dataset = std::move(decodedImages);
   }
 
+  mlpack::Log::Info << "Loaded " << totalDecoded << " out of " << totalFiles <<
+      " annotated images." << std::endl;
+
+  // Random augmentations are applied by TrainBatches() to images and boxes
+  // together, as batches are assembled.
+  // Boxes of matrix type labels aren't moved, so their images aren't
+  // augmented either.
+  const bool boxLabels = std::is_same<DatasetY, BoxStore>::value ||
+      std::is_same<DatasetY, arma::field<arma::vec>>::value;
+  this->augmentation = augmentations;
+  this->augmentationProbability = augmentationProbability;
+  datasetWidth = boxLabels ? imageWidth : 0;
+  datasetHeight = imageHeight;
+  datasetDepth = imageDepth;
+
+  // Images were resized while they were decoded.
   TrainTestSplit(dataset, labels, this->trainFeatures, this->trainLabels,
       this->validFeatures, this->validLabels, validRatio, shuffle);
-
-  // Augment the training data.
-  augmentation.Transform(this->trainFeatures, imageWidth, imageHeight,
-      imageDepth);
 }
 
 template<
@@ -369,48 +722,106 @@ template<
                               const size_t imageWidth,
                               const size_t imageHeight,
                               const size_t imageDepth,
-                              const size_t label)
+                              const size_t label,
+                              const std::vector<std::string>& augmentation)
 {
-  // Get all files in given directory.
-  std::vector<boost::filesystem::path> imagesDirectory;
-  Utils::ListDir(imagesPath, imagesDirectory);
-
-  std::set<std::string> supportedExtentions = {".jpg", ".png", ".tga",
-      ".bmp", ".psd", ".gif", ".hdr", ".pic", ".pnm"};
+  // Get all images in given directory.
+  std::vector<std::string> imagesDirectory;
+  ListImages(imagesPath, imagesDirectory);
+  SelectShard(imagesDirectory);
 
-  // We use to endls here as one of them will be replaced by print
-  // command below.
   mlpack::Log::Info << "Found " << imagesDirectory.size() << " belonging to " <<
-      label << " class." << std::endl << std::endl;
+      label << " class." << std::endl;
+
+  DecodeImages(imagesDirectory, std::vector<size_t>(imagesDirectory.size(),
+      label), imageWidth, imageHeight, imageDepth, dataset, labels,
+      Augmentation(augmentation, augmentationProbability));
+}
 
-  size_t loadedImages = 0;
-  for (boost::filesystem::path imageName : imagesDirectory)
+template<
+  typename DatasetX,
+  typename DatasetY,
+  class ScalerType
+> void DataLoader<
+    DatasetX, DatasetY, ScalerType
+>::DecodeImages(const std::vector<std::string>& files,
+                const std::vector<size_t>& fileLabels,
+                const size_t imageWidth,
+                const size_t imageHeight,
+                const size_t imageDepth,
+                DatasetX& dataset,
+                DatasetY& labels,
+                const Augmentation& augmentation)
+{
+  const size_t outputWidth = augmentation.HasResize() ?
+      augmentation.ResizeWidth() : imageWidth;
+  const size_t outputHeight = augmentation.HasResize() ?
+      augmentation.ResizeHeight() : imageHeight;
+  if (dataset.n_elem > 0 &&
+      dataset.n_rows != outputWidth * outputHeight * imageDepth)
   {
-    if (imageName.string().length() <= 3 ||
-        !boost::filesystem::is_regular_file(imageName) ||
-        !supportedExtentions.count(imageName.extension().string()))
+    mlpack::Log::Warn << "Images of shape {" << outputWidth << ", " <<
+        outputHeight << ", " << imageDepth << "} don't match the shape of " <<
+        "the dataset. No images were loaded." << std::endl;
+    return;
+  }
+
+  // The whole output is allocated once and every image is decoded, and
+  // resized, straight into its own column.
+  std::vector<std::string> reversedFiles(files.rbegin(), files.rend());
+  DatasetX images;
+  std::vector<char> decoded;
+  size_t totalDecoded = 0;
+  if (outputWidth != imageWidth || outputHeight != imageHeight)
+  {
+    const ImageResize resize(imageWidth, imageHeight, imageDepth, outputWidth,
+        outputHeight, augmentation.ResizeMethod());
+    totalDecoded = ImageDecoder::Decode(reversedFiles, imageWidth,
+        imageHeight, imageDepth, resize, images, decoded);
+  }
+  else
+  {
+    totalDecoded = ImageDecoder::Decode(reversedFiles, imageWidth,
+        imageHeight, imageDepth, images, decoded);
+  }
+
+  DatasetY imageLabels(1, totalDecoded);
+  arma::uvec decodedColumns(totalDecoded);
+  for (size_t i = 0, j = 0; i < reversedFiles.size(); i++)
+  {
+    if (!decoded[i])
     {
+      mlpack::Log::Warn << "Unable to load " << reversedFiles[i] <<
+          " with shape {" << imageWidth << ", " << imageHeight << ", " <<
+          imageDepth << "}." << std::endl;
       continue;
     }
-    mlpack::data::ImageInfo imageInfo(imageWidth, imageHeight, imageDepth);
 
-    // Load the image.
-    // The image loaded here will be in column format i.e. Output will
-    // be matrix with the following shape {1, cols * rows * slices} in
-    // column major format.
-    DatasetX image;
-    mlpack::data::Load(imageName.string(), image, imageInfo);
+    decodedColumns[j] = i;
+    imageLabels(0, j) = fileLabels[files.size() - 1 - i];
+    j++;
+  }
 
-    // Add object to training set.
-    if (image.n_rows == dataset.n_rows || dataset.n_elem == 0)
-    {
-      labels.insert_cols(0, arma::vec(1).fill(label));
-      dataset.insert_cols(0, image);
-      loadedImages++;
-      mlpack::Log::Info << "Loaded " << loadedImages << " out of " <<
-          imagesDirectory.size() << "\r" << std::endl;
-    }
+  // Remove columns of images that couldn't be decoded.
+  if (totalDecoded < reversedFiles.size())
+  {
+    DatasetX decodedImages = images.cols(decodedColumns);
+    images = std::move(decodedImages);
+  }
+
+  if (dataset.n_elem == 0)
+  {
+    dataset = std::move(images);
+    labels = std::move(imageLabels);
   }
+  else
+  {
+    dataset = arma::join_rows(images, dataset);
+    labels = arma::join_rows(imageLabels, labels);
+  }
+
+  mlpack::Log::Info << "Loaded " << totalDecoded << " out of " <<
+      files.size() << " images." << std::endl;
 }
 
 template<
@@ -427,7 +838,8 @@ template<
                                  const double validRatio,
                                  const bool shuffle,
                                  const std::vector<std::string>& augmentation,
-                                 const double augmentationProbability)
+                                 const double augmentationProbability,
+                                 const std::string& cacheDirectory)
 {
   Augmentation augmentations(augmentation, augmentationProbability);
   size_t totalClasses = 0;
@@ -437,62 +849,363 @@ template<
   std::vector<boost::filesystem::path> classes;
   Utils::ListDir(pathToDataset, classes);
 
-  DatasetX dataset;
-  DatasetY labels;
-
-  // Iterate the directory.
+  // Collect images of every class first so that all of them are decoded
+  // with a single allocation.
+  std::vector<std::string> files;
+  std::vector<size_t> fileLabels;
   for (boost::filesystem::path className : classes)
   {
     if (boost::filesystem::is_directory(className))
     {
-      LoadAllImagesFromDirectory(className.string() +
-        "/", dataset, labels, imageWidth, imageHeight, imageDepth,
-        totalClasses);
+      const size_t previousFiles = files.size();
+      ListImages(className.string() + "/", files);
+      fileLabels.resize(files.size(), totalClasses);
+
+      mlpack::Log::Info << "Found " << files.size() - previousFiles <<
+          " belonging to " << totalClasses << " class." << std::endl;
       classMap[className.string()] = totalClasses;
       totalClasses++;
     }
   }
 
+  // Both vectors have the same size, so the same files are selected.
+  SelectShard(files);
+  SelectShard(fileLabels);
+
+  // Every image is resized right after it's decoded, so full resolution
+  // images never accumulate and the cache holds the resized images.
+  std::string resizeParam;
+  if (augmentations.HasResize())
+  {
+    resizeParam = std::to_string(augmentations.ResizeWidth()) + "x" +
+        std::to_string(augmentations.ResizeHeight());
+  }
+
+  DatasetCache cache;
+  std::string cachePath;
+  DatasetX dataset;
+  DatasetY labels;
+  bool cached = false;
+  if (cacheDirectory.length() > 0)
+  {
+    std::stringstream parameters;
+    parameters << imageWidth << "x" << imageHeight << "x" << imageDepth <<
+        ":" << resizeParam << ":" << sizeof(typename DatasetX::elem_type);
+    cachePath = cacheDirectory + "/" + DatasetCache::Fingerprint(files,
+        parameters.str()) + ".bin";
+    cached = cache.Load(cachePath, dataset, labels);
+  }
+
+  if (!cached)
+  {
+    DecodeImages(files, fileLabels, imageWidth, imageHeight, imageDepth,
+        dataset, labels, augmentations);
+
+    if (cacheDirectory.length() > 0)
+      DatasetCache::Save(cachePath, dataset, labels);
+  }
+
   if (!trainData)
   {
-    testFeatures = std::move(dataset);
+    // Features loaded from the cache only live as long as the cache, so they
+    // are copied here.
+    testFeatures = dataset;
     testLabels = std::move(labels);
+    return;
+  }
 
-    // Only resize augmentation will be applied on test set.
-    if (augmentations.HasResizeParam())
+  // Random augmentations are applied by TrainBatches() as batches are
+  // assembled.
+  this->augmentation = augmentation;
+  this->augmentationProbability = augmentationProbability;
+  datasetWidth = augmentations.HasResize() ? augmentations.ResizeWidth() :
+      imageWidth;
+  datasetHeight = augmentations.HasResize() ? augmentations.ResizeHeight() :
+      imageHeight;
+  datasetDepth = imageDepth;
+
+  // Train-validation data split. Features and labels are split in place
+  // through the same permutation, so they don't have to be joined for
+  // shuffling. Features loaded from the cache only live as long as the
+  // cache, so they are copied once first.
+  SplitIndices(dataset.n_cols, validRatio, shuffle, trainIndices,
+      validIndices);
+
+  DatasetX features;
+  if (cached)
+    features = dataset;
+  else
+    features = std::move(dataset);
+
+  SplitColumns(features, splitFeatures, trainFeatures, validFeatures);
+  SplitColumns(labels, splitLabels, trainLabels, validLabels);
+
+  mlpack::Log::Info << "Found " << totalClasses << " classes." << std::endl;
+
+  // Print class-label mappings for ease.
+  for (std::pair<std::string, int> classMapping : classMap)
+  {
+    mlpack::Log::Info << classMapping.first << " : " << classMapping.second <<
+        std::endl;
+  }
+}
+
+template<
+  typename DatasetX,
+  typename DatasetY,
+  class ScalerType
+> void DataLoader<
+    DatasetX, DatasetY, ScalerType
+>::IndexImageDatasetFromDirectory(const std::string& pathToDataset,
+                                  const size_t imageWidth,
+                                  const size_t imageHeight,
+                                  const size_t imageDepth,
+                                  const bool trainData,
+                                  const double validRatio,
+                                  const bool shuffle,
+                                  const std::vector<std::string>& augmentation,
+                                  const double augmentationProbability)
+{
+  this->augmentation = augmentation;
+  this->augmentationProbability = augmentationProbability;
+
+  // Fill classes in the vector.
+  std::vector<boost::filesystem::path> classes;
+  Utils::ListDir(pathToDataset, classes);
+
+  FileIndex index;
+  index.depth = imageDepth;
+
+  size_t totalClasses = 0;
+  for (boost::filesystem::path className : classes)
+  {
+    if (!boost::filesystem::is_directory(className))
+      continue;
+
+    std::vector<std::string> images;
+    ListImages(className.string() + "/", images);
+    for (const std::string& image : images)
     {
-      augmentations.ResizeTransform(testFeatures, imageWidth, imageHeight,
-          imageDepth, augmentations.augmentations[0]);
+      index.Add(image, arma::vec(1).fill(totalClasses), imageWidth,
+          imageHeight);
     }
 
+    mlpack::Log::Info << className.string() << " : " << totalClasses <<
+        std::endl;
+    totalClasses++;
+  }
+
+  if (worldSize > 1)
+    index = index.Subset(ShardIndices(index.Size()));
+
+  mlpack::Log::Info << "Indexed " << index.Size() << " images belonging to " <<
+      totalClasses << " classes." << std::endl;
+
+  if (!trainData)
+  {
+    testIndex = std::move(index);
     return;
   }
 
-  // Train-validation data split.
-  arma::mat completeDataset = arma::join_cols(dataset, labels);
-  arma::mat trainingData, validationData;
-  mlpack::data::Split(completeDataset, trainingData, validationData,
-      validRatio, shuffle);
+  SplitIndices(index.Size(), validRatio, shuffle, trainIndices, validIndices);
+  trainIndex = index.Subset(trainIndices);
+  validIndex = index.Subset(validIndices);
+}
 
-  trainFeatures = trainingData.rows(0, trainingData.n_rows - 2);
-  trainLabels = trainingData.rows(trainingData.n_rows - 1,
-      trainingData.n_rows - 1);
+template<
+  typename DatasetX,
+  typename DatasetY,
+  class ScalerType
+> void DataLoader<
+    DatasetX, DatasetY, ScalerType
+>::IndexObjectDetectionDataset(const std::string& pathToAnnotations,
+                               const std::string& pathToImages,
+                               const std::vector<std::string>& classes,
+                               const double validRatio,
+                               const bool shuffle,
+                               const std::vector<std::string>& augmentations,
+                               const double augmentationProbability,
+                               const bool absolutePath,
+                               const std::string& baseXMLTag,
+                               const std::string& imageNameXMLTag,
+                               const std::string& sizeXMLTag,
+                               const std::string& objectXMLTag,
+                               const std::string& bndboxXMLTag,
+                               const std::string& classNameXMLTag,
+                               const std::string& x1XMLTag,
+                               const std::string& y1XMLTag,
+                               const std::string& x2XMLTag,
+                               const std::string& y2XMLTag)
+{
+  this->augmentation = augmentations;
+  this->augmentationProbability = augmentationProbability;
+  Augmentation augmentation(augmentations, augmentationProbability);
+
+  std::unordered_map<std::string, size_t> classMap;
+  for (size_t i = 0; i < classes.size(); i++)
+    classMap.insert(std::make_pair(classes[i], i));
+
+  std::unordered_map<std::string, size_t> indexMap;
+  indexMap.insert(std::make_pair(classNameXMLTag, 0));
+  indexMap.insert(std::make_pair(x1XMLTag, 1));
+  indexMap.insert(std::make_pair(y1XMLTag, 2));
+  indexMap.insert(std::make_pair(x2XMLTag, 3));
+  indexMap.insert(std::make_pair(y2XMLTag, 4));
 
-  validFeatures = validationData.rows(0, validationData.n_rows - 2);
-  validLabels = validationData.rows(validationData.n_rows - 1,
-      validationData.n_rows - 1);
+  size_t outputWidth = 0, outputHeight = 0;
+  if (augmentation.HasResize())
+  {
+    outputWidth = augmentation.ResizeWidth();
+    outputHeight = augmentation.ResizeHeight();
+  }
 
-  augmentations.Transform(trainFeatures, imageWidth, imageHeight, imageDepth);
-  augmentations.Transform(validFeatures, imageWidth, imageHeight, imageDepth);
+  std::vector<std::string> annotationFiles;
+  ListAnnotations(pathToAnnotations, absolutePath, annotationFiles);
+  SelectShard(annotationFiles);
 
-  mlpack::Log::Info << "Found " << totalClasses << " classes." << std::endl;
+  const size_t totalFiles = annotationFiles.size();
+  std::vector<std::string> imagePaths(totalFiles);
+  std::vector<arma::vec> boundingBoxes(totalFiles);
+  std::vector<size_t> widths(totalFiles), heights(totalFiles),
+      depths(totalFiles);
+  std::vector<char> parsed(totalFiles, 0);
 
-  // Print class-label mappings for ease.
-  for (std::pair<std::string, int> classMapping : classMap)
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < totalFiles; i++)
   {
-    mlpack::Log::Info << classMapping.first << " : " << classMapping.second <<
-        std::endl;
+    parsed[i] = ReadAnnotation(annotationFiles[i], pathToImages, absolutePath,
+        classMap, indexMap, baseXMLTag, imageNameXMLTag, sizeXMLTag,
+        objectXMLTag, bndboxXMLTag, classNameXMLTag, outputWidth,
+        outputHeight, imagePaths[i], widths[i], heights[i], depths[i],
+        boundingBoxes[i]);
+  }
+
+  FileIndex index;
+  for (size_t i = 0; i < totalFiles; i++)
+  {
+    if (!parsed[i])
+      continue;
+
+    index.depth = depths[i];
+    index.Add(imagePaths[i], boundingBoxes[i], widths[i], heights[i]);
+  }
+
+  mlpack::Log::Info << "Indexed " << index.Size() << " annotated images." <<
+      std::endl;
+
+  SplitIndices(index.Size(), validRatio, shuffle, trainIndices, validIndices);
+  trainIndex = index.Subset(trainIndices);
+  validIndex = index.Subset(validIndices);
+}
+
+template<
+  typename DatasetX,
+  typename DatasetY,
+  class ScalerType
+> bool DataLoader<
+    DatasetX, DatasetY, ScalerType
+>::ReadAnnotation(const std::string& annotationFile,
+                  const std::string& pathToImages,
+                  const bool absolutePath,
+                  const std::unordered_map<std::string, size_t>& classMap,
+                  const std::unordered_map<std::string, size_t>& indexMap,
+                  const std::string& baseXMLTag,
+                  const std::string& imageNameXMLTag,
+                  const std::string& sizeXMLTag,
+                  const std::string& objectXMLTag,
+                  const std::string& bndboxXMLTag,
+                  const std::string& classNameXMLTag,
+                  const size_t outputWidth,
+                  const size_t outputHeight,
+                  std::string& imagePath,
+                  size_t& imageWidth,
+                  size_t& imageHeight,
+                  size_t& imageDepth,
+                  arma::vec& boundingBoxes)
+{
+  // Read the XML file.
+  std::ifstream file(annotationFile, std::ios::in | std::ios::binary);
+  const std::string document((std::istreambuf_iterator<char>(file)),
+      std::istreambuf_iterator<char>());
+  XMLTagExtractor xml(document);
+
+  // Get annotation, image name and size from XML file.
+  XMLTagExtractor::Element annotation, imageName, sizeInfo, value;
+  if (!xml.Child(xml.Root(), baseXMLTag, annotation) ||
+      !xml.Child(annotation, imageNameXMLTag, imageName) ||
+      !xml.Child(annotation, sizeXMLTag, sizeInfo))
+  {
+    #pragma omp critical
+    mlpack::Log::Warn << "Skipping " << annotationFile << ", required XML " <<
+        "tags weren't found." << std::endl;
+    return false;
   }
+
+  imagePath = pathToImages + xml.Text(imageName);
+
+  // If image doesn't exist then skip the current XML file.
+  if (!Utils::PathExists(imagePath, absolutePath))
+  {
+    #pragma omp critical
+    mlpack::Log::Warn << "Image not found! Tried finding " <<
+        imagePath << std::endl;
+    return false;
+  }
+
+  // Get the size of image which is required by mlpack::data::Load function.
+  imageWidth = xml.Child(sizeInfo, "width", value) ? xml.Integer(value) : 0;
+  imageHeight = xml.Child(sizeInfo, "height", value) ? xml.Integer(value) : 0;
+  imageDepth = xml.Child(sizeInfo, "depth", value) ? xml.Integer(value) : 0;
+
+  double horizontalScale = 1.0, verticalScale = 1.0;
+  if (outputWidth > 0 && outputHeight > 0)
+  {
+    horizontalScale = 1.0 * outputWidth / imageWidth;
+    verticalScale = 1.0 * outputHeight / imageHeight;
+  }
+
+  // Iterate over all object in annotation.
+  boundingBoxes.reset();
+  xml.ForEachChild(annotation, [&](const char* name, const size_t length,
+      const XMLTagExtractor::Element& object)
+  {
+    XMLTagExtractor::Element className, boundingBox;
+    if (objectXMLTag.compare(0, std::string::npos, name, length) != 0 ||
+        !xml.Child(object, classNameXMLTag, className))
+      return;
+
+    const std::unordered_map<std::string, size_t>::const_iterator label =
+        classMap.find(xml.Text(className));
+    if (label == classMap.end())
+      return;
+
+    arma::vec predictions(5, arma::fill::zeros);
+    predictions(0) = label->second;
+
+    // Iterate over property of the object to get bounding box coordinates.
+    if (xml.Child(object, bndboxXMLTag, boundingBox))
+    {
+      xml.ForEachChild(boundingBox, [&](const char* coordinateName,
+          const size_t coordinateLength,
+          const XMLTagExtractor::Element& coordinate)
+      {
+        const std::unordered_map<std::string, size_t>::const_iterator index =
+            indexMap.find(std::string(coordinateName, coordinateLength));
+        if (index != indexMap.end() && index->second > 0)
+          predictions(index->second) = xml.Integer(coordinate);
+      });
+    }
+
+    // Scale predictions. Coordinates are stored as x1, y1, x2, y2
+    // after the class label.
+    predictions(1) = std::floor(predictions(1) * horizontalScale);
+    predictions(3) = std::floor(predictions(3) * horizontalScale);
+    predictions(2) = std::floor(predictions(2) * verticalScale);
+    predictions(4) = std::floor(predictions(4) * verticalScale);
+    boundingBoxes.insert_rows(0, predictions);
+  });
+
+  return true;
 }
 
 } // namespace models
@@ -0,0 +1,246 @@
+/**
+ * @file dataset_cache.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of DatasetCache class, which stores decoded datasets in a binary
+ * file that can be memory-mapped by later runs.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_DATALOADER_DATASET_CACHE_HPP
+#define MODELS_DATALOADER_DATASET_CACHE_HPP
+
+#include <mlpack.hpp>
+#include <utils/utils.hpp>
+#include <utils/mapped_file.hpp>
+#include <cstring>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * DatasetCache writes a decoded dataset and its labels to a single binary
+ * file and maps it back into memory. The file starts with a fixed size
+ * header, followed by the features and the labels in column major order.
+ * Features loaded from the cache alias the mapped memory, so they are only
+ * valid while the DatasetCache object that loaded them is alive.
+ *
+ * @code
+ * const std::string path = "./../data/cache/" +
+ *     DatasetCache::Fingerprint(files, "32x32x3") + ".bin";
+ *
+ * DatasetCache cache;
+ * arma::mat dataset, labels;
+ * if (!cache.Load(path, dataset, labels))
+ * {
+ *   // Decode the dataset.
+ *   DatasetCache::Save(path, dataset, labels);
+ * }
+ * @endcode
+ */
+class DatasetCache
+{
+ public:
+  //! Create an empty DatasetCache object.
+  DatasetCache()
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Computes a fingerprint of the given files. The fingerprint changes if a
+   * file is added, removed, resized or modified, or if the parameters change.
+   *
+   * @param files Paths to the files of the dataset.
+   * @param parameters Any parameters that change the decoded dataset, e.g.
+   *                   shape of the images and resize parameter.
+   * @returns String of CRC32 checksum of the listing.
+   */
+  static std::string Fingerprint(const std::vector<std::string>& files,
+                                 const std::string& parameters)
+  {
+    std::stringstream listing;
+    listing << parameters << ";";
+    for (const std::string& file : files)
+    {
+      boost::system::error_code error;
+      const boost::uintmax_t fileSize = boost::filesystem::file_size(file,
+          error);
+      const std::time_t modified = boost::filesystem::last_write_time(file,
+          error);
+      listing << file << ":" << fileSize << ":" << modified << ";";
+    }
+
+    return Utils::GetStringCRC32(listing.str());
+  }
+
+  /**
+   * Writes the dataset and labels to the given path. The file is written
+   * under a temporary name and renamed once complete, so a cache file is
+   * never partially written.
+   *
+   * @tparam MatType Type of the features.
+   * @tparam LabelsType Type of the labels.
+   *
+   * @param path Path of the cache file.
+   * @param features Features of the dataset.
+   * @param labels Labels of the dataset.
+   * @return true if the cache file was written.
+   */
+  template<typename MatType, typename LabelsType>
+  static bool Save(const std::string& path,
+                   const MatType& features,
+                   const LabelsType& labels)
+  {
+    typedef typename MatType::elem_type FeatureType;
+    typedef typename LabelsType::elem_type LabelType;
+
+    const boost::filesystem::path cacheFolder =
+        boost::filesystem::path(path).parent_path();
+    if (!cacheFolder.empty())
+    {
+      boost::system::error_code error;
+      boost::filesystem::create_directories(cacheFolder, error);
+    }
+
+    Header header;
+    std::memcpy(header.magic, Magic(), sizeof(header.magic));
+    header.featureSize = sizeof(FeatureType);
+    header.labelSize = sizeof(LabelType);
+    header.rows = features.n_rows;
+    header.cols = features.n_cols;
+    header.labelRows = labels.n_rows;
+    header.labelCols = labels.n_cols;
+
+    const std::string temporaryPath = path + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::out | std::ios::binary |
+        std::ios::trunc);
+    if (!file.is_open())
+    {
+      mlpack::Log::Warn << "Unable to write dataset cache " << path << "."
+          << std::endl;
+      return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    file.write(reinterpret_cast<const char*>(features.memptr()),
+        features.n_elem * sizeof(FeatureType));
+    file.write(reinterpret_cast<const char*>(labels.memptr()),
+        labels.n_elem * sizeof(LabelType));
+    file.close();
+
+    if (!file)
+    {
+      std::remove(temporaryPath.c_str());
+      mlpack::Log::Warn << "Unable to write dataset cache " << path << "."
+          << std::endl;
+      return false;
+    }
+
+    boost::system::error_code error;
+    boost::filesystem::rename(temporaryPath, path, error);
+    if (error)
+    {
+      std::remove(temporaryPath.c_str());
+      return false;
+    }
+
+    mlpack::Log::Info << "Dataset cached to " << path << "." << std::endl;
+    return true;
+  }
+
+  /**
+   * Maps the cache file. Features alias the mapped memory and labels are
+   * copied.
+   *
+   * @tparam eT Type of elements of the features.
+   * @tparam LabelsType Type of the labels.
+   *
+   * @param path Path of the cache file.
+   * @param features Matrix that will alias features of the dataset.
+   * @param labels Labels of the dataset.
+   * @return false if the cache file doesn't exist or doesn't match the
+   *     requested types.
+   */
+  template<typename eT, typename LabelsType>
+  bool Load(const std::string& path,
+            arma::Mat<eT>& features,
+            LabelsType& labels)
+  {
+    typedef typename LabelsType::elem_type LabelType;
+
+    if (!boost::filesystem::exists(path) || !file.Open(path))
+      return false;
+
+    if (file.Size() < sizeof(Header))
+    {
+      file.Close();
+      return false;
+    }
+
+    Header header;
+    std::memcpy(&header, file.Data(), sizeof(Header));
+    const size_t featureBytes = header.rows * header.cols * sizeof(eT);
+    const size_t labelBytes = header.labelRows * header.labelCols *
+        sizeof(LabelType);
+    if (std::memcmp(header.magic, Magic(), sizeof(header.magic)) != 0 ||
+        header.featureSize != sizeof(eT) ||
+        header.labelSize != sizeof(LabelType) ||
+        file.Size() != sizeof(Header) + featureBytes + labelBytes)
+    {
+      mlpack::Log::Warn << "Ignoring invalid dataset cache " << path << "."
+          << std::endl;
+      file.Close();
+      return false;
+    }
+
+    eT* featureMemory = reinterpret_cast<eT*>(file.Data() + sizeof(Header));
+    features.~Mat();
+    new (&features) arma::Mat<eT>(featureMemory, header.rows, header.cols,
+        false, true);
+
+    labels.set_size(header.labelRows, header.labelCols);
+    std::memcpy(labels.memptr(), file.Data() + sizeof(Header) + featureBytes,
+        labelBytes);
+
+    mlpack::Log::Info << "Dataset loaded from cache " << path << "."
+        << std::endl;
+    return true;
+  }
+
+ private:
+  //! Header stored at the beginning of the cache file.
+  struct Header
+  {
+    //! Identifies the file as a dataset cache.
+    char magic[8];
+    //! Size of a single element of features in bytes.
+    uint64_t featureSize;
+    //! Size of a single element of labels in bytes.
+    uint64_t labelSize;
+    //! Number of rows of features.
+    uint64_t rows;
+    //! Number of columns of features.
+    uint64_t cols;
+    //! Number of rows of labels.
+    uint64_t labelRows;
+    //! Number of columns of labels.
+    uint64_t labelCols;
+    //! Reserved to keep features aligned.
+    uint64_t reserved;
+  };
+
+  //! Get the identifier of cache files.
+  static const char* Magic() { return "MLPKDSC1"; }
+
+  //! Locally stored mapping of the cache file.
+  MappedFile file;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
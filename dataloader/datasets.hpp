@@ -115,6 +115,21 @@ struct DatasetDetails
   //! Locally stored depth of images.
   size_t imageDepth;
 
+  // The following data members correspond to datasets that are also
+  // distributed in a binary format. Binary files are used instead of the
+  // dataset above whenever all of them exist.
+  //! Locally stored binary format of the dataset, either "idx" or
+  //! "cifar-binary". Empty if the dataset has no binary format.
+  std::string binaryFormat;
+
+  //! Locally stored paths to binary files of training data. For IDX the
+  //! images file is followed by the labels file, for CIFAR every batch is
+  //! listed.
+  std::vector<std::string> trainBinaryPaths;
+
+  //! Locally stored paths to binary files of testing data.
+  std::vector<std::string> testBinaryPaths;
+
   // Default constructor.
   DatasetDetails() :
       datasetName(""),
@@ -143,7 +158,8 @@ struct DatasetDetails
       classes(std::vector<std::string>()),
       imageWidth(0),
       imageHeight(0),
-      imageDepth(0)
+      imageDepth(0),
+      binaryFormat("")
   {/* Nothing to do here. */}
 
   /**
@@ -193,7 +209,8 @@ struct DatasetDetails
                  classes(std::vector<std::string>()),
                  imageWidth(0),
                  imageHeight(0),
-                 imageDepth(0)
+                 imageDepth(0),
+                 binaryFormat("")
   {
     // Nothing to do here.
   }
@@ -247,7 +264,8 @@ struct DatasetDetails
                  classes(std::vector<std::string>()),
                  imageWidth(0),
                  imageHeight(0),
-                 imageDepth(0)
+                 imageDepth(0),
+                 binaryFormat("")
   {
     // Nothing to do here.
   }
@@ -290,6 +308,15 @@ class Datasets
     mnistDetails.startTrainingPredictionFeatures = 0;
     mnistDetails.endTrainingPredictionFeatures = 0;
     mnistDetails.dropHeader = true;
+
+    // Original IDX files are used if they are present.
+    mnistDetails.binaryFormat = "idx";
+    mnistDetails.trainBinaryPaths = {
+        "./../data/mnist-dataset/train-images-idx3-ubyte",
+        "./../data/mnist-dataset/train-labels-idx1-ubyte"};
+    mnistDetails.testBinaryPaths = {
+        "./../data/mnist-dataset/t10k-images-idx3-ubyte",
+        "./../data/mnist-dataset/t10k-labels-idx1-ubyte"};
     return mnistDetails;
   }
 
@@ -331,6 +358,20 @@ class Datasets
 
     CIFAR10Detail.trainingImagesPath = "./../data/cifar10/train/";
     CIFAR10Detail.testingImagesPath = "./../data/cifar10/test/";
+    CIFAR10Detail.imageWidth = 32;
+    CIFAR10Detail.imageHeight = 32;
+    CIFAR10Detail.imageDepth = 3;
+
+    // Original binary batches are used if they are present.
+    CIFAR10Detail.binaryFormat = "cifar-binary";
+    CIFAR10Detail.trainBinaryPaths = {
+        "./../data/cifar-10-batches-bin/data_batch_1.bin",
+        "./../data/cifar-10-batches-bin/data_batch_2.bin",
+        "./../data/cifar-10-batches-bin/data_batch_3.bin",
+        "./../data/cifar-10-batches-bin/data_batch_4.bin",
+        "./../data/cifar-10-batches-bin/data_batch_5.bin"};
+    CIFAR10Detail.testBinaryPaths = {
+        "./../data/cifar-10-batches-bin/test_batch.bin"};
 
     CIFAR10Detail.serverName = "www.mlpack.org";
     CIFAR10Detail.PreProcess = PreProcessor<DatasetX, DatasetY>::CIFAR10;
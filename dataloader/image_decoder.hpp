@@ -0,0 +1,166 @@
+/**
+ * @file image_decoder.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of ImageDecoder class, which decodes images from disk straight
+ * into preallocated columns of a matrix.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_DATALOADER_IMAGE_DECODER_HPP
+#define MODELS_DATALOADER_IMAGE_DECODER_HPP
+
+#include <mlpack.hpp>
+#include <augmentation/image_resize.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * ImageDecoder provides functions to decode images using mlpack's image
+ * loader. Multiple images are decoded in parallel (if OpenMP is available)
+ * and every worker writes directly into its own column of the output, so the
+ * output is allocated only once.
+ */
+class ImageDecoder
+{
+ public:
+  /**
+   * Decodes a single image.
+   *
+   * @tparam MatType Type of matrix the image will be decoded into.
+   *
+   * @param file Path to the image.
+   * @param imageWidth Width of the image.
+   * @param imageHeight Height of the image.
+   * @param imageDepth Depth of the image.
+   * @param image Column vector where the image will be stored.
+   * @return true if the image was decoded and has the given shape.
+   */
+  template<typename MatType>
+  static bool Decode(const std::string& file,
+                     const size_t imageWidth,
+                     const size_t imageHeight,
+                     const size_t imageDepth,
+                     MatType& image)
+  {
+    mlpack::data::ImageInfo imageInfo(imageWidth, imageHeight, imageDepth);
+
+    // The image loaded here will be in column format i.e. Output will
+    // be matrix with the following shape {1, cols * rows * slices} in
+    // column major format.
+    if (!mlpack::data::Load(file, image, imageInfo))
+      return false;
+
+    return image.n_elem == imageWidth * imageHeight * imageDepth;
+  }
+
+  /**
+   * Decodes all images into the columns of the output. Column i of the output
+   * holds files[i]. Columns of images that couldn't be decoded, or don't have
+   * the given shape, are filled with zeros and marked in the decoded vector.
+   *
+   * @tparam MatType Type of matrix the images will be decoded into.
+   *
+   * @param files Paths to the images.
+   * @param imageWidth Width of the images.
+   * @param imageHeight Height of the images.
+   * @param imageDepth Depth of the images.
+   * @param output Matrix where images will be stored.
+   * @param decoded Set to 1 for every image that was decoded and 0 otherwise.
+   * @return Number of images that were decoded.
+   */
+  template<typename MatType>
+  static size_t Decode(const std::vector<std::string>& files,
+                       const size_t imageWidth,
+                       const size_t imageHeight,
+                       const size_t imageDepth,
+                       MatType& output,
+                       std::vector<char>& decoded)
+  {
+    output.set_size(imageWidth * imageHeight * imageDepth, files.size());
+    decoded.assign(files.size(), 0);
+
+    size_t totalDecoded = 0;
+    #pragma omp parallel for schedule(dynamic) reduction(+:totalDecoded)
+    for (size_t i = 0; i < files.size(); i++)
+    {
+      MatType image;
+      if (Decode(files[i], imageWidth, imageHeight, imageDepth, image))
+      {
+        output.col(i) = image;
+        decoded[i] = 1;
+        totalDecoded++;
+      }
+      else
+      {
+        output.col(i).zeros();
+      }
+    }
+
+    return totalDecoded;
+  }
+
+  /**
+   * Decodes all images and resizes each one right after it's decoded, so
+   * only one image per thread is held at full resolution. Column i of the
+   * output holds the resized files[i]. Columns of images that couldn't be
+   * decoded, or don't have the given shape, are filled with zeros and marked
+   * in the decoded vector.
+   *
+   * @tparam MatType Type of matrix the images will be decoded into.
+   *
+   * @param files Paths to the images.
+   * @param imageWidth Width of the images.
+   * @param imageHeight Height of the images.
+   * @param imageDepth Depth of the images.
+   * @param resize Resize applied to every image.
+   * @param output Matrix where resized images will be stored.
+   * @param decoded Set to 1 for every image that was decoded and 0 otherwise.
+   * @return Number of images that were decoded.
+   */
+  template<typename MatType>
+  static size_t Decode(const std::vector<std::string>& files,
+                       const size_t imageWidth,
+                       const size_t imageHeight,
+                       const size_t imageDepth,
+                       const ImageResize& resize,
+                       MatType& output,
+                       std::vector<char>& decoded)
+  {
+    output.set_size(resize.OutputSize(), files.size());
+    decoded.assign(files.size(), 0);
+
+    size_t totalDecoded = 0;
+    #pragma omp parallel reduction(+:totalDecoded)
+    {
+      MatType image;
+      std::vector<double> buffer;
+
+      #pragma omp for schedule(dynamic)
+      for (size_t i = 0; i < files.size(); i++)
+      {
+        if (Decode(files[i], imageWidth, imageHeight, imageDepth, image))
+        {
+          resize.Resize(image.memptr(), output.colptr(i), buffer);
+          decoded[i] = 1;
+          totalDecoded++;
+        }
+        else
+        {
+          output.col(i).zeros();
+        }
+      }
+    }
+
+    return totalDecoded;
+  }
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
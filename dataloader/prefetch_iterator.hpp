@@ -0,0 +1,298 @@
+/**
+ * @file prefetch_iterator.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of PrefetchIterator, which prepares batches of a BatchIterator
+ * on background threads.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_DATALOADER_PREFETCH_ITERATOR_HPP
+#define MODELS_DATALOADER_PREFETCH_ITERATOR_HPP
+
+#include <mlpack.hpp>
+#include <dataloader/batch_iterator.hpp>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * PrefetchIterator decodes and augments batches of a BatchIterator on a pool
+ * of worker threads while the caller trains on the current batch. Ready
+ * batches are kept in a bounded ring, workers wait once the ring is full, so
+ * at most bufferSize batches are held in memory. Batches are handed out in
+ * the order of the epoch, independent of the number of workers, and the
+ * order of every epoch is determined by the seed and the epoch number.
+ *
+ * Memory of the batches is recycled: Next() swaps the ready batch with the
+ * matrices passed by the caller, which are filled again by the workers.
+ *
+ * @code
+ * DataLoader<> dataloader;
+ * dataloader.IndexImageDatasetFromDirectory("./../data/cifar10/", 32, 32, 3);
+ *
+ * // Four workers keep up to three batches ready.
+ * PrefetchIterator<> batches(dataloader.TrainBatches(32), 4, 3);
+ *
+ * arma::mat features, labels;
+ * for (size_t epoch = 0; epoch < 10; epoch++)
+ * {
+ *   batches.Reset();
+ *   while (batches.Next(features, labels))
+ *     model.Train(features, labels, optimizer);
+ * }
+ * @endcode
+ *
+ * @tparam DatasetX Datatype for input features of a batch.
+ * @tparam DatasetY Datatype for labels.
+ * @tparam SourceType Datatype of input features of a dataset in memory.
+ */
+template<
+  typename DatasetX = arma::mat,
+  typename DatasetY = arma::mat,
+  typename SourceType = DatasetX
+>
+class PrefetchIterator
+{
+ public:
+  /**
+   * Create the PrefetchIterator object and start preparing the first epoch.
+   *
+   * @param batches Iterator whose batches are prepared.
+   * @param workers Number of worker threads.
+   * @param bufferSize Maximum number of batches that are prepared ahead.
+   * @param seed Seed used for shuffling, epoch i is shuffled with seed + i.
+   */
+  PrefetchIterator(const BatchIterator<DatasetX, DatasetY, SourceType>& batches,
+                   const size_t workers = 2,
+                   const size_t bufferSize = 2,
+                   const size_t seed = 0) :
+      batches(batches),
+      ring(std::max<size_t>(bufferSize, 1)),
+      seed(seed),
+      epoch(0),
+      scheduled(0),
+      consumed(0),
+      inFlight(0),
+      stopping(false)
+  {
+    this->batches.Reset(seed);
+    for (size_t i = 0; i < std::max<size_t>(workers, 1); i++)
+      threads.emplace_back(&PrefetchIterator::Worker, this);
+  }
+
+  //! Stops the workers.
+  ~PrefetchIterator() { Stop(); }
+
+  // The workers refer to the object, so it can't be copied or moved.
+  PrefetchIterator(const PrefetchIterator&) = delete;
+  PrefetchIterator& operator=(const PrefetchIterator&) = delete;
+
+  /**
+   * Starts a new epoch. Batches of the previous epoch that weren't consumed
+   * are dropped.
+   */
+  void Reset()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Batches being prepared use the order of the current epoch.
+    idle.wait(lock, [this] { return inFlight == 0; });
+
+    // The first epoch is prepared by the constructor, it is only started
+    // again if any of its batches were consumed.
+    if (epoch > 0 || consumed > 0)
+    {
+      epoch++;
+      batches.Reset(seed + epoch);
+      for (Slot& slot : ring)
+        slot.ready = false;
+      scheduled = 0;
+      consumed = 0;
+    }
+
+    work.notify_all();
+  }
+
+  /**
+   * Get the next batch of the current epoch. Waits until the batch is ready.
+   *
+   * @param features Matrix where features of the batch will be stored.
+   * @param labels Labels corresponding to the features.
+   * @return false if the epoch has no batches left, otherwise true.
+   */
+  bool Next(DatasetX& features, DatasetY& labels)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (consumed >= batches.NumBatches())
+      return false;
+
+    Slot& slot = ring[consumed % ring.size()];
+    ready.wait(lock, [this, &slot]
+    {
+      return error || (slot.ready && slot.batch == consumed);
+    });
+
+    if (error)
+      std::rethrow_exception(error);
+
+    // Buffers of the caller are filled by the workers next time.
+    std::swap(features, slot.features);
+    std::swap(labels, slot.labels);
+    slot.ready = false;
+    consumed++;
+
+    work.notify_all();
+    return true;
+  }
+
+  /**
+   * Stops and joins all workers. Called by the destructor, Next() must not be
+   * called afterwards.
+   */
+  void Stop()
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      stopping = true;
+    }
+
+    work.notify_all();
+    for (std::thread& thread : threads)
+    {
+      if (thread.joinable())
+        thread.join();
+    }
+
+    threads.clear();
+  }
+
+  //! Get the number of batches in an epoch.
+  size_t NumBatches() const { return batches.NumBatches(); }
+
+  //! Get the number of the current epoch, starting at zero.
+  size_t Epoch() const { return epoch; }
+
+  //! Get the number of worker threads.
+  size_t Workers() const { return threads.size(); }
+
+  //! Get the maximum number of batches that are prepared ahead.
+  size_t BufferSize() const { return ring.size(); }
+
+ private:
+  //! Batch in the ring.
+  struct Slot
+  {
+    Slot() : batch(0), ready(false)
+    {
+      // Nothing to do here.
+    }
+
+    //! Features of the batch.
+    DatasetX features;
+    //! Labels of the batch.
+    DatasetY labels;
+    //! Index of the batch in the epoch.
+    size_t batch;
+    //! Whether the batch can be handed out.
+    bool ready;
+  };
+
+  //! Prepares batches until the iterator is stopped.
+  void Worker()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+      // Wait until there is a batch left that fits in the ring.
+      work.wait(lock, [this]
+      {
+        return stopping || (!error && scheduled < batches.NumBatches() &&
+            scheduled < consumed + ring.size());
+      });
+
+      if (stopping)
+        return;
+
+      const size_t batch = scheduled++;
+      Slot& slot = ring[batch % ring.size()];
+      inFlight++;
+      lock.unlock();
+
+      // The slot was consumed already, so it's only used by this worker.
+      std::exception_ptr batchError;
+      try
+      {
+        batches.Batch(batch, slot.features, slot.labels);
+      }
+      catch (...)
+      {
+        batchError = std::current_exception();
+      }
+
+      lock.lock();
+      inFlight--;
+      if (batchError)
+        error = batchError;
+
+      slot.batch = batch;
+      slot.ready = true;
+      ready.notify_all();
+      idle.notify_all();
+    }
+  }
+
+  //! Locally stored iterator whose batches are prepared.
+  BatchIterator<DatasetX, DatasetY, SourceType> batches;
+
+  //! Locally stored ring of batches.
+  std::vector<Slot> ring;
+
+  //! Locally stored worker threads.
+  std::vector<std::thread> threads;
+
+  //! Locally stored seed of the first epoch.
+  size_t seed;
+
+  //! Locally stored number of the current epoch.
+  size_t epoch;
+
+  //! Locally stored number of batches of the epoch given to workers.
+  size_t scheduled;
+
+  //! Locally stored number of batches of the epoch handed out.
+  size_t consumed;
+
+  //! Locally stored number of batches being prepared.
+  size_t inFlight;
+
+  //! Locally stored value to determine whether workers should stop.
+  bool stopping;
+
+  //! Locally stored error raised by a worker.
+  std::exception_ptr error;
+
+  //! Mutex guarding the state of the ring.
+  std::mutex mutex;
+
+  //! Signaled when a worker can prepare a batch.
+  std::condition_variable work;
+
+  //! Signaled when a batch is ready.
+  std::condition_variable ready;
+
+  //! Signaled when a worker finished a batch.
+  std::condition_variable idle;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
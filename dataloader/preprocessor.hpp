@@ -14,6 +14,7 @@
 #define MODELS_DATALOADER_PREPROCESSOR_HPP
 
 #include <mlpack.hpp>
+#include <dataloader/box_store.hpp>
 
 namespace mlpack {
 namespace models {
@@ -60,41 +61,91 @@ class PreProcessor
   }
 
   /**
-   * Converts image to channel first format used in PyTorch. Performs the same function
-   * as torch.transforms.ToTensor().
+   * Converts images from the interleaved layout produced by the image loader
+   * (height x width x channels, channels changing fastest) to channel first
+   * format used in PyTorch. Performs the same function as
+   * torch.transforms.ToTensor(). Images are converted in place.
    *
-   * @param trainFeatures Input features that will be converted into channel first format.
+   * @param trainFeatures Input features that will be converted into channel
+   *     first format, one image per column.
    * @param imageWidth Width of the image in dataset.
    * @param imageHeight Height of the image in dataset.
    * @param imageDepth Depth / Number of channels of the image in dataset.
+   * @param normalize Boolean to determine whether pixels are converted to
+   *     uint8 and divided by 255.
    */
   static void ChannelFirstImages(DatasetX& trainFeatures,
-      const size_t imageWidth,
-      const size_t imageHeight,
-      const size_t imageDepth,
-      bool normalize = true)
+                                 const size_t imageWidth,
+                                 const size_t imageHeight,
+                                 const size_t imageDepth,
+                                 const bool normalize = true)
   {
-    for (size_t idx = 0; idx < trainFeatures.n_cols; idx++)
-    {
-        // Create a copy of the current image so that the image isn't affected.
-        arma::cube inputTemp(trainFeatures.col(idx).memptr(), 3, 224, 224);
+    ConvertLayout(trainFeatures, imageWidth, imageHeight, imageDepth, true,
+        normalize);
+  }
 
-        size_t currentOffset = 0;
-        for (size_t i = 0; i < inputTemp.n_slices; i++)
-        {
-          trainFeatures.col(idx)(arma::span(currentOffset, currentOffset +
-              inputTemp.slice(i).n_elem - 1), arma::span()) =
-              arma::vectorise(inputTemp.slice(i).t());
-          currentOffset += inputTemp.slice(i).n_elem;
-        }
-    }
+  /**
+   * Converts images to channel first format as above, writing the result to
+   * a matrix of a different type, e.g. uint8 pixels to normalized floats in
+   * a single pass.
+   *
+   * @param input Images in interleaved layout, one image per column.
+   * @param output Matrix where images in channel first format will be stored.
+   * @param imageWidth Width of the image in dataset.
+   * @param imageHeight Height of the image in dataset.
+   * @param imageDepth Depth / Number of channels of the image in dataset.
+   * @param normalize Boolean to determine whether pixels are converted to
+   *     uint8 and divided by 255.
+   */
+  template<typename InputType, typename OutputType>
+  static void ChannelFirstImages(const InputType& input,
+                                 OutputType& output,
+                                 const size_t imageWidth,
+                                 const size_t imageHeight,
+                                 const size_t imageDepth,
+                                 const bool normalize = true)
+  {
+    ConvertLayout(input, output, imageWidth, imageHeight, imageDepth, true,
+        normalize);
+  }
 
-    if (normalize)
-    {
-      // Convert each element to uint8 first and then divide by 255.
-      for (size_t i = 0; i < trainFeatures.n_elem; i++)
-          trainFeatures(i) = ((uint8_t)(trainFeatures(i)) / 255.0);
-    }
+  /**
+   * Converts images from channel first format back to the interleaved layout
+   * used by the image loader and the augmentation. Images are converted in
+   * place and pixel values aren't changed.
+   *
+   * @param features Images in channel first format, one image per column.
+   * @param imageWidth Width of the image in dataset.
+   * @param imageHeight Height of the image in dataset.
+   * @param imageDepth Depth / Number of channels of the image in dataset.
+   */
+  static void ChannelLastImages(DatasetX& features,
+                                const size_t imageWidth,
+                                const size_t imageHeight,
+                                const size_t imageDepth)
+  {
+    ConvertLayout(features, imageWidth, imageHeight, imageDepth, false, false);
+  }
+
+  /**
+   * Converts images from channel first format back to the interleaved layout,
+   * writing the result to a matrix of a different type.
+   *
+   * @param input Images in channel first format, one image per column.
+   * @param output Matrix where images in interleaved layout will be stored.
+   * @param imageWidth Width of the image in dataset.
+   * @param imageHeight Height of the image in dataset.
+   * @param imageDepth Depth / Number of channels of the image in dataset.
+   */
+  template<typename InputType, typename OutputType>
+  static void ChannelLastImages(const InputType& input,
+                                OutputType& output,
+                                const size_t imageWidth,
+                                const size_t imageHeight,
+                                const size_t imageDepth)
+  {
+    ConvertLayout(input, output, imageWidth, imageHeight, imageDepth, false,
+        false);
   }
 
   /**
@@ -117,7 +168,51 @@ class PreProcessor
    * Note : This function must be called manually before model is used.
    */
   template<typename eT>
-  static void YOLOPreProcessor(const DatasetY& annotations,
+  static void YOLOPreProcessor(const arma::field<arma::vec>& annotations,
+                               arma::Mat<eT>& output,
+                               const size_t version = 1,
+                               const size_t imageWidth = 224,
+                               const size_t imageHeight = 224,
+                               const size_t gridWidth = 7,
+                               const size_t gridHeight = 7,
+                               const size_t numBoxes = 2,
+                               const size_t numClasses = 20,
+                               const bool normalize = true)
+  {
+    size_t totalBoxes = 0;
+    for (size_t i = 0; i < annotations.n_cols; i++)
+      totalBoxes += annotations(0, i).n_elem / 5;
+
+    BoxStore boxes;
+    boxes.Reserve(annotations.n_cols, totalBoxes);
+    for (size_t i = 0; i < annotations.n_cols; i++)
+      boxes.Add(annotations(0, i));
+
+    YOLOPreProcessor(boxes, output, version, imageWidth, imageHeight,
+        gridWidth, gridHeight, numBoxes, numClasses, normalize);
+  }
+
+  /**
+   * PreProcessor for YOLO model. Converts BoxStore type annotations to
+   * arma::mat type for training YOLO model. Each column in target matrix has
+   * the size : gridWidth * gridHeight * (5 * numBoxes + classes).
+   *
+   * @param annotations BoxStore object created using model's dataloader
+   *     containing annotation for images.
+   * @param output Output matrix where output will be stored.
+   * @param imageWidth Width of image used for training YOLO model.
+   * @param imageHeight Height of image used for training YOLO model.
+   * @param gridWidth Width of output feature map of YOLO model.
+   * @param gridHeight Height of output feature map of YOLO model.
+   * @param numBoxes Number of bounding boxes per grid.
+   * @param numClasses Number of classes in training set.
+   * @param normalize Boolean to determine whether coordinates are to
+   *    to be normalized or not. Defaults to true.
+   *
+   * Note : This function must be called manually before model is used.
+   */
+  template<typename eT>
+  static void YOLOPreProcessor(const BoxStore& annotations,
                                arma::Mat<eT>& output,
                                const size_t version = 1,
                                const size_t imageWidth = 224,
@@ -132,10 +227,7 @@ class PreProcessor
     mlpack::Log::Assert(version >= 1 && version <= 3, "Supported YOLO versions \
         are version 1 to version 3.");
 
-    mlpack::Log::Assert(typeid(annotations) == typeid(arma::field<arma::vec>),
-        "Use Field type to represent annotations.");
-
-    size_t batchSize = annotations.n_cols;
+    const size_t batchSize = annotations.NumImages();
     size_t numPredictions = 5 * numBoxes + numClasses;
     if (version > 1)
     {
@@ -143,126 +235,283 @@ class PreProcessor
       numPredictions = numBoxes * (5 + numClasses);
     }
 
-    double cellSizeHeight = (double) 1.0 / gridHeight;
-    double cellSizeWidth = (double) 1.0 / gridWidth;
+    const double cellSizeHeight = (double) 1.0 / gridHeight;
+    const double cellSizeWidth = (double) 1.0 / gridWidth;
+
+    // Each column is a gridHeight x gridWidth x numPredictions cube stored
+    // in column major order, the grid x coordinate indexes its rows.
+    const size_t gridSize = gridWidth * gridHeight;
+    output.set_size(gridSize * numPredictions, batchSize);
 
-    // Set size of output and use cubes convenience.
-    output.set_size(gridWidth * gridHeight * numPredictions, batchSize);
-    output.zeros();
+    const arma::mat& coordinates = annotations.Coordinates();
+    const arma::vec& classes = annotations.Classes();
 
-    // Use offset to create a cube for a particular column / batch.
-    size_t offset = 0;
+    // Images are encoded in parallel, each one into its own column.
+    #pragma omp parallel for schedule(dynamic)
     for (size_t boxIdx = 0; boxIdx < batchSize; boxIdx++)
     {
-      arma::cube outputTemp(const_cast<arma::Mat<eT> &>(output).memptr() +
-          offset, gridHeight, gridWidth, numPredictions, false, false);
-      offset += gridWidth * gridHeight * numPredictions;
-
-      // Get the bounding box and labels corresponding to current image.
-      arma::mat labels(1, annotations(0, boxIdx).n_elem / 5);
-      arma::mat boundingBoxes(4, annotations(0, boxIdx).n_elem / 5);
-      for (size_t i = 0; i < boundingBoxes.n_cols; i++)
-      {
-        labels.col(i)(0) = annotations(0, boxIdx)(i * 5);
-        boundingBoxes.col(i) = annotations(0, boxIdx)(arma::span(i * 5 + 1,
-            (i + 1) * 5 - 1));
-      }
+      eT* target = output.colptr(boxIdx);
+      std::fill(target, target + output.n_rows, eT(0));
 
       // For YOLOv2 or higher, each bounding box can represent a class
-      // so we don't repeat labels as done for YOLOv1. We will use map
-      // to store last inserted bounding box.
-      std::map<std::pair<size_t, size_t>, size_t> boundingBoxOffset;
-
-      // Normalize the coordinates.
-      boundingBoxes.row(0) /= imageWidth;
-      boundingBoxes.row(2) /= imageWidth;
-      boundingBoxes.row(1) /= imageHeight;
-      boundingBoxes.row(3) /= imageHeight;
-
-      // Get width and height as well as centres for the bounding box.
-      arma::mat widthAndHeight(2, boundingBoxes.n_cols);
-      widthAndHeight.row(0) = (boundingBoxes.row(2) - boundingBoxes.row(0));
-      widthAndHeight.row(1) = (boundingBoxes.row(3) - boundingBoxes.row(1));
-
-      arma::mat centres(2, boundingBoxes.n_cols);
-      centres.row(0) = (boundingBoxes.row(2) + boundingBoxes.row(0)) / 2.0;
-      centres.row(1) = (boundingBoxes.row(3) + boundingBoxes.row(1)) / 2.0;
-
-      // Assign bounding boxes to the grid.
-      for (size_t i = 0; i < boundingBoxes.n_cols; i++)
+      // so we don't repeat labels as done for YOLOv1. Every thread keeps
+      // the number of boxes assigned to each grid cell, cells are reset
+      // once the image is encoded.
+      std::vector<size_t>& gridBoxes = GridOccupancy(gridSize);
+
+      // Assign bounding boxes of the current image to the grid.
+      const size_t begin = annotations.Offset(boxIdx);
+      const size_t end = annotations.Offset(boxIdx + 1);
+      for (size_t i = begin; i < end; i++)
       {
-        // Index for representing bounding box on grid.
-        arma::vec gridCoordinates = centres.col(i);
-        arma::vec centreCoordinates = centres.col(i);
+        // Normalize the coordinates.
+        const double x1 = coordinates(0, i) / imageWidth;
+        const double y1 = coordinates(1, i) / imageHeight;
+        const double x2 = coordinates(2, i) / imageWidth;
+        const double y2 = coordinates(3, i) / imageHeight;
+        const size_t label = classes(i);
+
+        // Get width and height as well as centres for the bounding box.
+        const double width = x2 - x1;
+        const double height = y2 - y1;
+        const double centreX = (x2 + x1) / 2.0;
+        const double centreY = (y2 + y1) / 2.0;
 
+        // Index for representing bounding box on grid.
+        double gridCoordinateX, gridCoordinateY;
         if (normalize)
         {
-          gridCoordinates(0) = std::ceil(gridCoordinates(0) /
-              cellSizeWidth) - 1;
-          gridCoordinates(1) = std::ceil(gridCoordinates(1) /
-              cellSizeHeight) - 1;
+          gridCoordinateX = std::ceil(centreX / cellSizeWidth) - 1;
+          gridCoordinateY = std::ceil(centreY / cellSizeHeight) - 1;
         }
         else
         {
-          gridCoordinates(0) = std::ceil((gridCoordinates(0) /
-              imageWidth) / cellSizeWidth) - 1;
-          gridCoordinates(1) = std::ceil((gridCoordinates(1) /
-              imageHeight) / cellSizeHeight) - 1;
+          gridCoordinateX = std::ceil((centreX / imageWidth) /
+              cellSizeWidth) - 1;
+          gridCoordinateY = std::ceil((centreY / imageHeight) /
+              cellSizeHeight) - 1;
         }
 
-        size_t gridX = gridCoordinates(0);
-        size_t gridY = gridCoordinates(1);
-        gridCoordinates(0) = gridCoordinates(0) * cellSizeWidth;
-        gridCoordinates(1) = gridCoordinates(1) * cellSizeHeight;
+        // Boxes whose centre lies outside of the grid can't be assigned.
+        if (gridCoordinateX < 0 || gridCoordinateY < 0 ||
+            gridCoordinateX >= gridHeight || gridCoordinateY >= gridWidth)
+          continue;
 
-        // Normalize to 1.0.
-        gridCoordinates = centres.col(i) - gridCoordinates;
-        gridCoordinates(0) /= cellSizeWidth;
-        gridCoordinates(1) /= cellSizeHeight;
+        const size_t gridX = gridCoordinateX;
+        const size_t gridY = gridCoordinateY;
+        const size_t cell = gridX + gridHeight * gridY;
 
+        // Normalize to 1.0.
+        double centreCoordinateX = centreX, centreCoordinateY = centreY;
         if (normalize)
-          centreCoordinates = gridCoordinates;
+        {
+          centreCoordinateX = (centreX - gridCoordinateX * cellSizeWidth) /
+              cellSizeWidth;
+          centreCoordinateY = (centreY - gridCoordinateY * cellSizeHeight) /
+              cellSizeHeight;
+        }
+
+        size_t bBoxOffset = 0;
+        if (version > 1)
+        {
+          // Only numBoxes boxes can be assigned to a single grid cell.
+          const size_t s = gridBoxes[cell]++;
+          if (s >= numBoxes)
+            continue;
+
+          bBoxOffset = (5 + numClasses) * s;
+        }
 
-        if (version == 1)
+        // Fill elements in the grid. YOLOv1 repeats the box for every
+        // prediction of the cell and stores a single class.
+        const size_t repeats = (version == 1) ? numBoxes : 1;
+        for (size_t k = 0; k < repeats; k++)
         {
-          // Fill elements in the grid.
-          for (size_t k = 0; k < numBoxes; k++)
+          const size_t s = (version == 1) ? 5 * k : bBoxOffset;
+          eT* prediction = target + cell + gridSize * s;
+          prediction[0] = centreCoordinateX;
+          prediction[gridSize] = centreCoordinateY;
+          prediction[2 * gridSize] = width;
+          prediction[3 * gridSize] = height;
+          prediction[4 * gridSize] = 1.0;
+        }
+
+        const size_t classOffset = (version == 1) ? 5 * numBoxes + label :
+            bBoxOffset + 5 + label;
+        target[cell + gridSize * classOffset] = 1;
+      }
+
+      // Reset grid cells used by the image.
+      if (version > 1)
+        std::fill(gridBoxes.begin(), gridBoxes.end(), 0);
+    }
+  }
+
+ private:
+  /**
+   * Checks that images have the given shape, raises an error otherwise.
+   *
+   * @param rows Number of rows of the images.
+   * @param imageWidth Width of the image in dataset.
+   * @param imageHeight Height of the image in dataset.
+   * @param imageDepth Depth / Number of channels of the image in dataset.
+   */
+  static void CheckImageShape(const size_t rows,
+                              const size_t imageWidth,
+                              const size_t imageHeight,
+                              const size_t imageDepth)
+  {
+    if (rows != imageWidth * imageHeight * imageDepth)
+    {
+      mlpack::Log::Fatal << "Images of shape {" << imageWidth << ", " <<
+          imageHeight << ", " << imageDepth << "} don't match the " << rows <<
+          " rows of the dataset." << std::endl;
+    }
+  }
+
+  /**
+   * Converts the layout of all images in place. Every thread converts its
+   * images through its own buffer of a single image.
+   *
+   * @param features Images that will be converted, one image per column.
+   * @param imageWidth Width of the image in dataset.
+   * @param imageHeight Height of the image in dataset.
+   * @param imageDepth Depth / Number of channels of the image in dataset.
+   * @param channelFirst Boolean to determine whether images are converted to
+   *     channel first format or back to interleaved layout.
+   * @param normalize Boolean to determine whether pixels are normalized.
+   */
+  static void ConvertLayout(DatasetX& features,
+                            const size_t imageWidth,
+                            const size_t imageHeight,
+                            const size_t imageDepth,
+                            const bool channelFirst,
+                            const bool normalize)
+  {
+    typedef typename DatasetX::elem_type ElemType;
+
+    CheckImageShape(features.n_rows, imageWidth, imageHeight, imageDepth);
+    const size_t imageSize = features.n_rows;
+
+    #pragma omp parallel
+    {
+      std::vector<ElemType> image(imageSize);
+
+      #pragma omp for schedule(static)
+      for (size_t i = 0; i < features.n_cols; i++)
+      {
+        std::copy(features.colptr(i), features.colptr(i) + imageSize,
+            image.begin());
+        ConvertImage(image.data(), features.colptr(i),
+            imageWidth * imageHeight, imageDepth, channelFirst, normalize);
+      }
+    }
+  }
+
+  /**
+   * Converts the layout of all images into another matrix.
+   *
+   * @param input Images that will be converted, one image per column.
+   * @param output Matrix where converted images will be stored.
+   * @param imageWidth Width of the image in dataset.
+   * @param imageHeight Height of the image in dataset.
+   * @param imageDepth Depth / Number of channels of the image in dataset.
+   * @param channelFirst Boolean to determine whether images are converted to
+   *     channel first format or back to interleaved layout.
+   * @param normalize Boolean to determine whether pixels are normalized.
+   */
+  template<typename InputType, typename OutputType>
+  static void ConvertLayout(const InputType& input,
+                            OutputType& output,
+                            const size_t imageWidth,
+                            const size_t imageHeight,
+                            const size_t imageDepth,
+                            const bool channelFirst,
+                            const bool normalize)
+  {
+    CheckImageShape(input.n_rows, imageWidth, imageHeight, imageDepth);
+    output.set_size(input.n_rows, input.n_cols);
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < input.n_cols; i++)
+    {
+      ConvertImage(input.colptr(i), output.colptr(i),
+          imageWidth * imageHeight, imageDepth, channelFirst, normalize);
+    }
+  }
+
+  /**
+   * Converts a single image between interleaved layout, where element
+   * c + depth * p holds channel c of pixel p, and channel first format, where
+   * element p + pixels * c holds it. This is a transpose of a depth x pixels
+   * matrix, so pixels are processed in tiles: the strided side of a tile
+   * stays in cache while every channel of the tile is read or written as a
+   * contiguous run, which the compiler can vectorize.
+   *
+   * @param input Pointer to the image that will be converted.
+   * @param output Pointer to the converted image, must not alias input.
+   * @param pixels Number of pixels of the image, i.e. width * height.
+   * @param depth Number of channels of the image.
+   * @param channelFirst Boolean to determine whether the image is converted to
+   *     channel first format or back to interleaved layout.
+   * @param normalize Boolean to determine whether pixels are converted to
+   *     uint8 and divided by 255.
+   */
+  template<typename InputElemType, typename OutputElemType>
+  static void ConvertImage(const InputElemType* input,
+                           OutputElemType* output,
+                           const size_t pixels,
+                           const size_t depth,
+                           const bool channelFirst,
+                           const bool normalize)
+  {
+    // Number of pixels of a tile.
+    const size_t tileSize = 256;
+    for (size_t begin = 0; begin < pixels; begin += tileSize)
+    {
+      const size_t end = std::min(begin + tileSize, pixels);
+      for (size_t c = 0; c < depth; c++)
+      {
+        if (!channelFirst)
+        {
+          const InputElemType* channel = input + c * pixels;
+          for (size_t p = begin; p < end; p++)
+            output[c + depth * p] = OutputElemType(channel[p]);
+        }
+        else if (normalize)
+        {
+          OutputElemType* channel = output + c * pixels;
+          for (size_t p = begin; p < end; p++)
           {
-            size_t s = 5 * k;
-            outputTemp(arma::span(gridX), arma::span(gridY),
-                arma::span(s, s + 1)) = centreCoordinates;
-            outputTemp(arma::span(gridX), arma::span(gridY),
-                arma::span(s + 2, s + 3)) = widthAndHeight.col(i);
-            outputTemp(gridX, gridY, s + 4) = 1.0;
+            channel[p] = OutputElemType(
+                ((uint8_t) input[c + depth * p]) / 255.0);
           }
-          outputTemp(gridX, gridY, 5 * numBoxes + labels.col(i)(0)) = 1;
         }
         else
         {
-          size_t s = 0;
-          if (boundingBoxOffset.count({gridX, gridY}))
-          {
-            s = boundingBoxOffset[{gridX, gridY}] + 1;
-            boundingBoxOffset[{gridX, gridY}]++;
-          }
-          else
-            boundingBoxOffset.insert({{gridX, gridY}, s});
-
-          if (s > numBoxes)
-            continue;
-
-          size_t bBoxOffset = (5 + numClasses) * s;
-          outputTemp(arma::span(gridX), arma::span(gridY),
-              arma::span(bBoxOffset, bBoxOffset + 1)) = centreCoordinates;
-          outputTemp(arma::span(gridX), arma::span(gridY),
-              arma::span(bBoxOffset + 2,
-                  bBoxOffset + 3)) = widthAndHeight.col(i);
-          outputTemp(gridX, gridY, bBoxOffset + 4) = 1.0;
-          outputTemp(gridX, gridY, bBoxOffset + 5 + labels.col(i)(0)) = 1;
+          OutputElemType* channel = output + c * pixels;
+          for (size_t p = begin; p < end; p++)
+            channel[p] = OutputElemType(input[c + depth * p]);
         }
       }
     }
   }
+
+  /**
+   * Get the number of boxes assigned to each grid cell. The buffer is local
+   * to the calling thread and kept across calls, so encoding a batch doesn't
+   * allocate once the grid size is known. All cells are zero between images.
+   *
+   * @param gridSize Number of cells in the grid.
+   */
+  static std::vector<size_t>& GridOccupancy(const size_t gridSize)
+  {
+    static thread_local std::vector<size_t> gridBoxes;
+    if (gridBoxes.size() != gridSize)
+      gridBoxes.assign(gridSize, 0);
+
+    return gridBoxes;
+  }
 };
 
 } // namespace models
@@ -0,0 +1,248 @@
+/**
+ * @file xml_tag_extractor.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of XMLTagExtractor, a light-weight reader for the elements of
+ * simple XML documents such as annotation files.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_DATALOADER_XML_TAG_EXTRACTOR_HPP
+#define MODELS_DATALOADER_XML_TAG_EXTRACTOR_HPP
+
+#include <cctype>
+#include <cstdlib>
+#include <string>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * XMLTagExtractor finds elements of an XML document by tag name without
+ * building a tree of the document. Elements are located by scanning the
+ * document for their opening and closing tags, only the children of an
+ * element are visited and nested elements are skipped over. Attributes,
+ * namespaces and entities are not interpreted, which is sufficient for
+ * annotation files such as PASCAL VOC.
+ *
+ * All functions are const, so a single document can be read from multiple
+ * threads.
+ *
+ * @code
+ * XMLTagExtractor xml(document);
+ * XMLTagExtractor::Element annotation, filename;
+ * if (xml.Child(xml.Root(), "annotation", annotation) &&
+ *     xml.Child(annotation, "filename", filename))
+ *   std::cout << xml.Text(filename) << std::endl;
+ * @endcode
+ */
+class XMLTagExtractor
+{
+ public:
+  //! Range of the contents of an element in the document.
+  struct Element
+  {
+    //! Position of the first character of the contents.
+    size_t begin;
+    //! Position after the last character of the contents.
+    size_t end;
+  };
+
+  /**
+   * Create the XMLTagExtractor object. The document isn't copied and must
+   * outlive the extractor.
+   *
+   * @param document Contents of the XML document.
+   */
+  XMLTagExtractor(const std::string& document) : document(document)
+  {
+    // Nothing to do here.
+  }
+
+  //! Get the element holding the whole document.
+  Element Root() const { return Element{0, document.size()}; }
+
+  /**
+   * Visits the children of an element.
+   *
+   * @tparam FunctionType Type of the function called for every child.
+   *
+   * @param parent Element whose children are visited.
+   * @param function Function called as function(name, length, element) for
+   *                 every child, where name points to the first character of
+   *                 the tag name and length is the length of the tag name.
+   */
+  template<typename FunctionType>
+  void ForEachChild(const Element& parent, FunctionType function) const
+  {
+    size_t position = parent.begin;
+    size_t nameBegin, nameLength;
+    Element child;
+    while (NextChild(position, parent.end, nameBegin, nameLength, child))
+      function(document.data() + nameBegin, nameLength, child);
+  }
+
+  /**
+   * Finds the first child of an element with the given tag name.
+   *
+   * @param parent Element whose children are searched.
+   * @param tag Name of the tag.
+   * @param child Set to the child, if found.
+   * @return true if the child was found.
+   */
+  bool Child(const Element& parent,
+             const std::string& tag,
+             Element& child) const
+  {
+    size_t position = parent.begin;
+    size_t nameBegin, nameLength;
+    while (NextChild(position, parent.end, nameBegin, nameLength, child))
+    {
+      if (nameLength == tag.size() &&
+          document.compare(nameBegin, nameLength, tag) == 0)
+        return true;
+    }
+
+    return false;
+  }
+
+  //! Get the contents of an element with surrounding whitespace removed.
+  std::string Text(const Element& element) const
+  {
+    size_t begin = element.begin, end = element.end;
+    while (begin < end && std::isspace(document[begin]))
+      begin++;
+    while (end > begin && std::isspace(document[end - 1]))
+      end--;
+
+    return document.substr(begin, end - begin);
+  }
+
+  /**
+   * Get the contents of an element as an integer. As with std::stoi(),
+   * parsing stops at the first character that isn't part of an integer, so
+   * "273.5" is read as 273. Zero is returned if an integer can't be read.
+   */
+  long Integer(const Element& element) const
+  {
+    return std::strtol(document.c_str() + element.begin, nullptr, 10);
+  }
+
+ private:
+  /**
+   * Finds the next child element starting at the given position.
+   *
+   * @param position Position to search from, moved past the child.
+   * @param end Position after the last character of the parent's contents.
+   * @param nameBegin Set to position of the tag name of the child.
+   * @param nameLength Set to length of the tag name of the child.
+   * @param child Set to the contents of the child.
+   * @return false if there is no child left.
+   */
+  bool NextChild(size_t& position,
+                 const size_t end,
+                 size_t& nameBegin,
+                 size_t& nameLength,
+                 Element& child) const
+  {
+    while (true)
+    {
+      position = document.find('<', position);
+      if (position == std::string::npos || position + 1 >= end)
+        return false;
+
+      // Skip comments, declarations and processing instructions.
+      if (document.compare(position, 4, "<!--") == 0)
+      {
+        position = document.find("-->", position);
+        if (position == std::string::npos)
+          return false;
+        position += 3;
+        continue;
+      }
+      else if (document[position + 1] == '?' || document[position + 1] == '!')
+      {
+        position = document.find('>', position);
+        if (position == std::string::npos)
+          return false;
+        position++;
+        continue;
+      }
+      else if (document[position + 1] == '/')
+      {
+        // Closing tag of the parent.
+        return false;
+      }
+
+      break;
+    }
+
+    nameBegin = position + 1;
+    const size_t nameEnd = document.find_first_of(" \t\r\n/>", nameBegin);
+    if (nameEnd == std::string::npos)
+      return false;
+    nameLength = nameEnd - nameBegin;
+
+    const size_t tagEnd = document.find('>', nameEnd);
+    if (tagEnd == std::string::npos || tagEnd >= end)
+      return false;
+
+    // Self closing tag has no contents.
+    if (document[tagEnd - 1] == '/')
+    {
+      child.begin = child.end = tagEnd + 1;
+      position = tagEnd + 1;
+      return true;
+    }
+
+    child.begin = tagEnd + 1;
+
+    // Find the matching closing tag, skipping over nested elements with the
+    // same name.
+    size_t depth = 1;
+    size_t scan = child.begin;
+    while (true)
+    {
+      scan = document.find('<', scan);
+      if (scan == std::string::npos || scan >= end)
+        return false;
+
+      const bool closing = (document[scan + 1] == '/');
+      const size_t scanName = scan + (closing ? 2 : 1);
+      if (document.compare(scanName, nameLength, document, nameBegin,
+          nameLength) == 0 && scanName + nameLength < document.size() &&
+          std::string(" \t\r\n/>").find(document[scanName + nameLength]) !=
+          std::string::npos)
+      {
+        if (closing && --depth == 0)
+        {
+          child.end = scan;
+          position = document.find('>', scanName);
+          if (position == std::string::npos)
+            return false;
+          position++;
+          return true;
+        }
+        else if (!closing)
+        {
+          const size_t nestedEnd = document.find('>', scanName);
+          if (nestedEnd != std::string::npos && document[nestedEnd - 1] != '/')
+            depth++;
+        }
+      }
+
+      scan++;
+    }
+  }
+
+  //! Locally stored reference to the document.
+  const std::string& document;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ * @file network_snapshot.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of NetworkSnapshot, which holds a copy of what a network learned
+ * for callbacks working on a background thread.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+
+#ifndef ENSMALLEN_CALLBACKS_NETWORK_SNAPSHOT_HPP
+#define ENSMALLEN_CALLBACKS_NETWORK_SNAPSHOT_HPP
+
+#include <mlpack.hpp>
+#include <models/common/batch_norm_statistics.hpp>
+#include <memory>
+
+namespace ens {
+
+/**
+ * A copy of the layers of a network, whose parameters and batch
+ * normalization statistics are set to those of the network by every
+ * Update(). Only the layers are copied, not e.g. the training data held by
+ * the network, and the layers are only copied once; later updates copy the
+ * parameters and statistics in place.
+ *
+ * @tparam AnnType Type of the network being copied.
+ */
+template<typename AnnType>
+class NetworkSnapshot
+{
+ public:
+  /**
+   * Sets the copy to what the given network learned so far, copying its
+   * layers the first time.
+   *
+   * @param network Network being copied.
+   */
+  void Update(AnnType& network)
+  {
+    if (!snapshot)
+    {
+      snapshot.reset(new AnnType());
+      for (auto* layer : network.Network())
+        snapshot->Add(layer->Clone());
+      snapshot->InputDimensions() = network.InputDimensions();
+      snapshot->Reset();
+    }
+
+    // The layers of the copy alias its parameters, so they are copied in
+    // place.
+    snapshot->Parameters() = network.Parameters();
+    mlpack::models::BatchNormStatistics::Copy(network.Network(),
+        snapshot->Network());
+  }
+
+  //! Get whether the network was copied yet.
+  bool Empty() const { return !snapshot; }
+
+  //! Get the copy of the network, only once it was updated.
+  AnnType& Network() { return *snapshot; }
+
+ private:
+  // Locally held copy of the network.
+  std::unique_ptr<AnnType> snapshot;
+};
+
+} // namespace ens
+
+#endif
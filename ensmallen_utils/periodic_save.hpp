@@ -14,14 +14,30 @@
 #define ENSMALLEN_CALLBACKS_PERIODIC_SAVE_HPP
 
 #include <ensmallen.hpp>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <future>
 #define MLPACK_ENABLE_ANN_SERIALIZATION
 #include <mlpack.hpp>
+#include "network_snapshot.hpp"
 
 namespace ens {
 
 /**
  * Saves model being trained periodically.
  *
+ * Every model is written to a temporary file that is renamed once it is
+ * complete, so a crash while saving never leaves a partial model behind.
+ * Only the given number of the latest models are kept.
+ *
+ * In asynchronous mode the parameters and batch normalization statistics are
+ * copied into a copy of the layers of the network at the end of the epoch, and the copy is serialized and written on a
+ * background thread while training goes on. If an earlier save is still
+ * running, the epoch isn't saved, so training never waits for it; if no
+ * later epoch is saved, the trained network is saved at the end of the
+ * optimization, named after the last epoch.
+ *
  * @tparam ANNType Type of model which will be used for evaluating metric.
  */
 template<typename AnnType>
@@ -39,23 +55,41 @@ class PeriodicSave
    * @param silent Boolean to determine whether or not to print saving
    *    of model.
    * @param output Outputstream where output will be directed.
+   * @param asynchronous Boolean to determine whether the model is saved on
+   *    a background thread.
+   * @param keep Number of latest models kept; all models are kept if 0.
    */
   PeriodicSave(AnnType& network,
                const std::string filePath = "./",
                const std::string modelPrefix = "model",
                const size_t period = 1,
                const bool silent = false,
-               std::ostream& output = arma::get_cout_stream()) :
+               std::ostream& output = arma::get_cout_stream(),
+               const bool asynchronous = false,
+               const size_t keep = 0) :
                network(network),
                filePath(filePath),
                modelPrefix(modelPrefix),
                period(period),
                silent(silent),
-               output(output)
+               output(output),
+               asynchronous(asynchronous),
+               keep(keep),
+               skippedSaves(0),
+               pending(false),
+               lastEpoch(0),
+               lastObjective(0.0)
   {
     // Nothing to do here.
   }
 
+  //! Wait for the save running in the background, if any.
+  ~PeriodicSave()
+  {
+    if (saving.valid())
+      saving.wait();
+  }
+
   template<typename OptimizerType, typename FunctionType, typename MatType>
   bool EndEpoch(OptimizerType& /* optimizer */,
                 FunctionType& /* function */,
@@ -63,21 +97,97 @@ class PeriodicSave
                 const size_t epoch,
                 const double objective)
   {
+    lastEpoch = epoch;
+    lastObjective = objective;
     if (epoch % period == 0)
     {
-      std::string objectiveString = std::to_string(objective);
-      std::replace(objectiveString.begin(), objectiveString.end(), '.', '_');
-      std::string modelName = modelPrefix + "_" + std::to_string(epoch) + "_" +
-          objectiveString;
-      mlpack::data::Save(filePath + modelName + ".bin", modelPrefix, network);
-      if (!silent)
-        output << "Model saved as " << modelName << std::endl;
+      const std::string modelName = ModelName(epoch, objective);
+      if (!asynchronous)
+      {
+        Save(network, modelName);
+        return false;
+      }
+
+      if (saving.valid() && saving.wait_for(std::chrono::seconds(0)) !=
+          std::future_status::ready)
+      {
+        skippedSaves++;
+        pending = true;
+        return false;
+      }
+
+      snapshot.Update(network);
+      pending = false;
+      saving = std::async(std::launch::async, [this, modelName]()
+      {
+        Save(snapshot.Network(), modelName);
+      });
     }
 
     return false;
   }
 
+  template<typename OptimizerType, typename FunctionType, typename MatType>
+  void EndOptimization(OptimizerType& /* optimizer */,
+                       FunctionType& /* function */,
+                       MatType& /* coordinates */)
+  {
+    if (saving.valid())
+      saving.get();
+
+    // The name is that of the last epoch, whose parameters the network
+    // holds, not that of the skipped epoch.
+    if (pending)
+    {
+      Save(network, ModelName(lastEpoch, lastObjective));
+      pending = false;
+    }
+  }
+
+  //! Get the number of epochs not saved because a save was still running.
+  size_t SkippedSaves() const { return skippedSaves; }
+
  private:
+  //! Get the name of the model of the given epoch, without the extension.
+  std::string ModelName(const size_t epoch, const double objective) const
+  {
+    std::string objectiveString = std::to_string(objective);
+    std::replace(objectiveString.begin(), objectiveString.end(), '.', '_');
+    return modelPrefix + "_" + std::to_string(epoch) + "_" + objectiveString;
+  }
+
+  /**
+   * Saves the given network through a temporary file, and removes the
+   * oldest models beyond the number of models kept.
+   *
+   * @param model Network to save.
+   * @param modelName Name of the file without the extension.
+   */
+  void Save(AnnType& model, const std::string& modelName)
+  {
+    const std::string path = filePath + modelName + ".bin";
+    const std::string temporaryPath = filePath + modelName + ".tmp.bin";
+    if (!mlpack::data::Save(temporaryPath, modelPrefix, model) ||
+        std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+      std::remove(temporaryPath.c_str());
+      if (!silent)
+        output << ("Model could not be saved as " + modelName + "\n")
+            << std::flush;
+      return;
+    }
+
+    saved.push_back(path);
+    while (keep > 0 && saved.size() > keep)
+    {
+      std::remove(saved.front().c_str());
+      saved.pop_front();
+    }
+
+    if (!silent)
+      output << ("Model saved as " + modelName + "\n") << std::flush;
+  }
+
   // Reference to the model which will be used for evaluated using the metric.
   AnnType& network;
 
@@ -96,6 +206,35 @@ class PeriodicSave
 
   // The output stream that all data is to be sent to; example: std::cout.
   std::ostream& output;
+
+  // Locally held boolean to determine whether the model is saved on a
+  // background thread.
+  bool asynchronous;
+
+  // Locally held number of latest models kept.
+  size_t keep;
+
+  // Locally held number of epochs that weren't saved.
+  size_t skippedSaves;
+
+  // Locally held boolean to determine whether a skipped save wasn't followed
+  // by a later save.
+  bool pending;
+
+  // Locally held last epoch so far.
+  size_t lastEpoch;
+
+  // Locally held objective of the last epoch so far.
+  double lastObjective;
+
+  // Locally held paths of the saved models, oldest first.
+  std::deque<std::string> saved;
+
+  // Locally held copy of the network saved in the background.
+  NetworkSnapshot<AnnType> snapshot;
+
+  // Locally held save running in the background.
+  std::future<void> saving;
 };
 
 } // namespace ens
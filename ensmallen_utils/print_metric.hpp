@@ -14,13 +14,26 @@
 #define ENSMALLEN_CALLBACKS_PRINT_METRIC_HPP
 
 #include <ensmallen.hpp>
+#include "network_snapshot.hpp"
+#include <chrono>
 #include <functional>
+#include <future>
 
 namespace ens {
 
 /**
  * Prints metric on training / validation set.
  *
+ * The dataset is held by reference, so it must outlive the callback. The
+ * network predicts it in batches of the given size, or a random subset of
+ * the given number of points drawn every epoch. In asynchronous mode the
+ * metric is evaluated on a background thread with a copy of the layers of
+ * the network, whose parameters and batch normalization statistics are set
+ * to those of the network at the end of the epoch, so the next epoch starts
+ * right away; the metric is printed once it is
+ * computed. If the evaluation of an earlier epoch is still running, the
+ * epoch isn't evaluated, so training never waits for it.
+ *
  * @tparam ANNType Type of model which will be used for evaluating metric.
  * @tparam MetricType Metric class which must have static `Evaluate` function
  *    that will be called at the end of the epoch.
@@ -44,52 +57,140 @@ class PrintMetric
    * @param trainData Boolean to determine whether dataset corresponds to
    *     training data or validation data.
    * @param output Outputstream where output will be directed.
+   * @param batchSize Number of points predicted at once.
+   * @param samples Number of random points the metric is evaluated on every
+   *     epoch; all points are used if 0.
+   * @param asynchronous Boolean to determine whether the metric is evaluated
+   *     on a background thread.
    */
   PrintMetric(AnnType &network,
               const InputType &features,
               const OutputType &responses,
               const std::string metricName = "metric",
               const bool trainData = false,
-              std::ostream &output = arma::get_cout_stream()) :
+              std::ostream &output = arma::get_cout_stream(),
+              const size_t batchSize = 128,
+              const size_t samples = 0,
+              const bool asynchronous = false) :
               network(network),
               features(features),
               responses(responses),
               metricName(metricName),
               trainData(trainData),
-              output(output)
+              output(output),
+              batchSize(batchSize),
+              samples(samples),
+              asynchronous(asynchronous),
+              skippedEpochs(0)
   {
      // Nothing to do here.
   }
 
+  //! Wait for the evaluation running in the background, if any.
+  ~PrintMetric()
+  {
+    if (evaluation.valid())
+      evaluation.wait();
+  }
+
   template<typename OptimizerType, typename FunctionType, typename MatType>
   bool EndEpoch(OptimizerType& /* optimizer */,
                 FunctionType& /* function */,
                 const MatType& /* coordinates */,
-                const size_t /* epoch */,
+                const size_t epoch,
                 const double /* objective */)
+  {
+    // Points are drawn on the training thread, whose generator is seeded.
+    arma::uvec indices;
+    if (samples > 0 && samples < features.n_cols)
+      indices = arma::randperm(features.n_cols, samples);
+
+    if (!asynchronous)
+    {
+      Evaluate(network, indices, "");
+      return false;
+    }
+
+    if (evaluation.valid())
+    {
+      if (evaluation.wait_for(std::chrono::seconds(0)) !=
+          std::future_status::ready)
+      {
+        skippedEpochs++;
+        return false;
+      }
+
+      // Errors of the background thread are raised here.
+      evaluation.get();
+    }
+
+    snapshot.Update(network);
+
+    const std::string label = " (epoch " + std::to_string(epoch) + ")";
+    evaluation = std::async(std::launch::async, [this, indices, label]()
+    {
+      Evaluate(snapshot.Network(), indices, label);
+    });
+    return false;
+  }
+
+  template<typename OptimizerType, typename FunctionType, typename MatType>
+  void EndOptimization(OptimizerType& /* optimizer */,
+                       FunctionType& /* function */,
+                       MatType& /* coordinates */)
+  {
+    if (evaluation.valid())
+      evaluation.get();
+  }
+
+  //! Get the number of epochs not evaluated because an evaluation was still
+  //! running.
+  size_t SkippedEpochs() const { return skippedEpochs; }
+
+ private:
+  /**
+   * Evaluates the metric with the given network and prints it.
+   *
+   * @param model Network that predicts the dataset.
+   * @param indices Points to evaluate the metric on; all if empty.
+   * @param label Text printed after the name of the metric.
+   */
+  void Evaluate(AnnType& model,
+                const arma::uvec& indices,
+                const std::string& label)
   {
     OutputType predictions;
-    network.Predict(features, predictions);
-    const double localObjective = MetricType::Evaluate(predictions, responses);
+    double localObjective;
+    if (indices.is_empty())
+    {
+      model.Predict(features, predictions, batchSize);
+      localObjective = MetricType::Evaluate(predictions, responses);
+    }
+    else
+    {
+      model.Predict(InputType(features.cols(indices)), predictions,
+          batchSize);
+      localObjective = MetricType::Evaluate(predictions,
+          OutputType(responses.cols(indices)));
+    }
+
     if (!std::isnan(localObjective))
     {
       std::string outputString = (trainData == true) ? "Train " : "Validation ";
-      outputString = outputString + metricName + " : " +
-          std::to_string(localObjective);
-      output << outputString << std::endl;
+      outputString = outputString + metricName + label + " : " +
+          std::to_string(localObjective) + "\n";
+      output << outputString << std::flush;
     }
-    return false;
   }
 
- private:
   // Reference to the model which will be used for evaluated using the metric.
   AnnType& network;
 
   // Dataset which will be used for evaluating the metric.
-  InputType features;
+  const InputType& features;
 
   // Dataset labels / predictions that will be used for evaluating the dataset.
-  OutputType responses;
+  const OutputType& responses;
 
   // Locally held string that depicts the name of the metric.
   std::string metricName;
@@ -100,6 +201,25 @@ class PrintMetric
 
   // The output stream that all data is to be sent to; example: std::cout.
   std::ostream& output;
+
+  // Locally held number of points predicted at once.
+  size_t batchSize;
+
+  // Locally held number of random points evaluated every epoch.
+  size_t samples;
+
+  // Locally held boolean to determine whether the metric is evaluated on a
+  // background thread.
+  bool asynchronous;
+
+  // Locally held number of epochs that weren't evaluated.
+  size_t skippedEpochs;
+
+  // Locally held copy of the network evaluated in the background.
+  NetworkSnapshot<AnnType> snapshot;
+
+  // Locally held evaluation running in the background.
+  std::future<void> evaluation;
 };
 
 } // namespace ens
@@ -0,0 +1,116 @@
+/**
+ * @file profile_training.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of ProfileTraining callback.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+
+#ifndef ENSMALLEN_CALLBACKS_PROFILE_TRAINING_HPP
+#define ENSMALLEN_CALLBACKS_PROFILE_TRAINING_HPP
+
+#include <ensmallen.hpp>
+
+namespace ens {
+
+/**
+ * Profiles the layers of the model being trained with a profiler attached to
+ * it, e.g. mlpack::models::Profiler. The profiler is enabled once the warmup
+ * epochs are over; at the end of the optimization the time of every layer is
+ * printed and the trace is written.
+ *
+ * @tparam ProfilerType Type of profiler attached to the model.
+ */
+template<typename ProfilerType>
+class ProfileTraining
+{
+ public:
+  /**
+   * Constructor for ProfileTraining class.
+   *
+   * @param profiler Profiler attached to the model being trained.
+   * @param tracePath Path the trace is written to; no trace is written if
+   *    empty.
+   * @param warmupEpochs Number of epochs that aren't profiled.
+   * @param silent Boolean to determine whether or not to print the time of
+   *    every layer.
+   * @param output Outputstream where output will be directed.
+   */
+  ProfileTraining(ProfilerType& profiler,
+                  const std::string tracePath = "",
+                  const size_t warmupEpochs = 0,
+                  const bool silent = false,
+                  std::ostream& output = arma::get_cout_stream()) :
+                  profiler(profiler),
+                  tracePath(tracePath),
+                  warmupEpochs(warmupEpochs),
+                  silent(silent),
+                  output(output)
+  {
+    // Nothing to do here.
+  }
+
+  template<typename OptimizerType, typename FunctionType, typename MatType>
+  void BeginOptimization(OptimizerType& /* optimizer */,
+                         FunctionType& /* function */,
+                         MatType& /* coordinates */)
+  {
+    profiler.Reset();
+    if (warmupEpochs == 0)
+      profiler.Enable();
+  }
+
+  template<typename OptimizerType, typename FunctionType, typename MatType>
+  bool EndEpoch(OptimizerType& /* optimizer */,
+                FunctionType& /* function */,
+                const MatType& /* coordinates */,
+                const size_t epoch,
+                const double /* objective */)
+  {
+    if (epoch == warmupEpochs)
+    {
+      profiler.Reset();
+      profiler.Enable();
+    }
+
+    return false;
+  }
+
+  template<typename OptimizerType, typename FunctionType, typename MatType>
+  void EndOptimization(OptimizerType& /* optimizer */,
+                       FunctionType& /* function */,
+                       MatType& /* coordinates */)
+  {
+    profiler.Disable();
+    if (!silent)
+      profiler.Print(output);
+
+    if (!tracePath.empty() && profiler.WriteTrace(tracePath) && !silent)
+      output << "Trace written to " << tracePath << std::endl;
+  }
+
+ private:
+  // Reference to the profiler attached to the model.
+  ProfilerType& profiler;
+
+  // Locally held path the trace is written to.
+  std::string tracePath;
+
+  // Locally held number of epochs that aren't profiled.
+  size_t warmupEpochs;
+
+  // Locally held boolean to determine whether to print the time of every
+  // layer.
+  bool silent;
+
+  // The output stream that all data is to be sent to; example: std::cout.
+  std::ostream& output;
+};
+
+} // namespace ens
+
+#endif
@@ -0,0 +1,295 @@
+/**
+ * @file training_telemetry.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of TrainingTelemetry, which reports the speed of training.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+
+#ifndef ENSMALLEN_CALLBACKS_TRAINING_TELEMETRY_HPP
+#define ENSMALLEN_CALLBACKS_TRAINING_TELEMETRY_HPP
+
+#include <ensmallen.hpp>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sys/resource.h>
+#endif
+
+namespace ens {
+
+/**
+ * Records the wall time of every step of the optimizer and periodically
+ * reports the number of steps, the mean and the 50th, 95th and 99th
+ * percentiles of their time, the points trained on per second, the fraction
+ * of the time spent computing the objective and its gradient and the peak
+ * resident memory of the process. The rest of the time of a step is spent
+ * preparing the batch, updating the parameters and in other callbacks, so a
+ * stalling data pipeline shows up as a falling gradient fraction and a high
+ * 99th percentile.
+ *
+ * Reports are printed as a line of text or as a JSON object per line, every
+ * given number of steps or at the end of every epoch, and for the whole
+ * optimization at its end, with the number of the last finished epoch. The
+ * number of points per step is the batch size of the optimizer, if it has
+ * one.
+ */
+class TrainingTelemetry
+{
+ public:
+  /**
+   * Constructor for TrainingTelemetry class.
+   *
+   * @param output Outputstream where output will be directed.
+   * @param period Number of steps between reports; reports are printed at
+   *    the end of every epoch if 0.
+   * @param json Boolean to determine whether reports are printed as JSON
+   *    lines.
+   */
+  TrainingTelemetry(std::ostream& output = arma::get_cout_stream(),
+                    const size_t period = 0,
+                    const bool json = false) :
+                    output(output),
+                    period(period),
+                    json(json),
+                    batchSize(0),
+                    epoch(0),
+                    totalGradientTime(0.0),
+                    windowGradientTime(0.0)
+  {
+    // Nothing to do here.
+  }
+
+  template<typename OptimizerType, typename FunctionType, typename MatType>
+  void BeginOptimization(OptimizerType& optimizer,
+                         FunctionType& /* function */,
+                         MatType& /* coordinates */)
+  {
+    batchSize = BatchSize(optimizer, 0);
+    epoch = 0;
+    totalTimes.clear();
+    windowTimes.clear();
+    totalGradientTime = windowGradientTime = 0.0;
+    stepStart = Clock::now();
+  }
+
+  template<typename OptimizerType, typename FunctionType, typename MatType,
+           typename GradType>
+  bool EvaluateWithGradient(OptimizerType& /* optimizer */,
+                            FunctionType& /* function */,
+                            const MatType& /* coordinates */,
+                            const double /* objective */,
+                            const GradType& /* gradient */)
+  {
+    GradientDone();
+    return false;
+  }
+
+  template<typename OptimizerType, typename FunctionType, typename MatType,
+           typename GradType>
+  bool Gradient(OptimizerType& /* optimizer */,
+                FunctionType& /* function */,
+                const MatType& /* coordinates */,
+                const GradType& /* gradient */)
+  {
+    GradientDone();
+    return false;
+  }
+
+  template<typename OptimizerType, typename FunctionType, typename MatType>
+  bool StepTaken(OptimizerType& /* optimizer */,
+                 FunctionType& /* function */,
+                 MatType& /* coordinates */)
+  {
+    const Clock::time_point now = Clock::now();
+    const double time = Seconds(stepStart, now);
+    totalTimes.push_back(time);
+    windowTimes.push_back(time);
+    stepStart = now;
+
+    if (period > 0 && windowTimes.size() == period)
+      Report("window");
+
+    return false;
+  }
+
+  template<typename OptimizerType, typename FunctionType, typename MatType>
+  bool EndEpoch(OptimizerType& /* optimizer */,
+                FunctionType& /* function */,
+                const MatType& /* coordinates */,
+                const size_t epoch,
+                const double /* objective */)
+  {
+    this->epoch = epoch;
+    if (period == 0 && !windowTimes.empty())
+      Report("epoch");
+
+    return false;
+  }
+
+  template<typename OptimizerType, typename FunctionType, typename MatType>
+  void EndOptimization(OptimizerType& /* optimizer */,
+                       FunctionType& /* function */,
+                       MatType& /* coordinates */)
+  {
+    Print("total", totalTimes, totalGradientTime);
+  }
+
+  //! Get the number of steps taken so far.
+  size_t Steps() const { return totalTimes.size(); }
+
+  //! Get the time of every step so far, in seconds.
+  const std::vector<double>& StepTimes() const { return totalTimes; }
+
+  /**
+   * Get the peak resident memory of the process in bytes, or 0 if it isn't
+   * known on this platform.
+   */
+  static size_t PeakMemory()
+  {
+  #if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+      return 0;
+    #if defined(__APPLE__)
+      return size_t(usage.ru_maxrss);
+    #else
+      return size_t(usage.ru_maxrss) * 1024;
+    #endif
+  #else
+    return 0;
+  #endif
+  }
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  //! Get the batch size of an optimizer that has one.
+  template<typename OptimizerType>
+  static auto BatchSize(const OptimizerType& optimizer, int)
+      -> decltype(size_t(optimizer.BatchSize()))
+  {
+    return optimizer.BatchSize();
+  }
+
+  //! Get 0 for an optimizer without batch size.
+  template<typename OptimizerType>
+  static size_t BatchSize(const OptimizerType& /* optimizer */, long)
+  {
+    return 0;
+  }
+
+  //! Get the seconds between the given times.
+  static double Seconds(const Clock::time_point& begin,
+                        const Clock::time_point& end)
+  {
+    return std::chrono::duration<double>(end - begin).count();
+  }
+
+  //! Records the time spent computing the gradient of the current step.
+  void GradientDone()
+  {
+    const double time = Seconds(stepStart, Clock::now());
+    totalGradientTime += time;
+    windowGradientTime += time;
+  }
+
+  //! Prints a report of the current window and starts the next one.
+  void Report(const std::string& event)
+  {
+    Print(event, windowTimes, windowGradientTime);
+    windowTimes.clear();
+    windowGradientTime = 0.0;
+  }
+
+  //! Get the given percentile of the given times, in milliseconds.
+  static double Percentile(std::vector<double> times, const double percentile)
+  {
+    const size_t index = std::min(times.size() - 1,
+        size_t(percentile / 100.0 * times.size()));
+    std::nth_element(times.begin(), times.begin() + index, times.end());
+    return 1000.0 * times[index];
+  }
+
+  //! Prints a report of the given step times.
+  void Print(const std::string& event,
+             const std::vector<double>& times,
+             const double gradientTime) const
+  {
+    if (times.empty())
+      return;
+
+    double time = 0.0;
+    for (const double step : times)
+      time += step;
+
+    const double mean = 1000.0 * time / times.size();
+    const double samples = (time > 0.0) ?
+        batchSize * times.size() / time : 0.0;
+    const double fraction = (time > 0.0) ? gradientTime / time : 0.0;
+
+    std::ostringstream line;
+    if (json)
+    {
+      line << "{\"event\":\"" << event << "\",\"epoch\":" << epoch
+          << ",\"steps\":" << times.size() << ",\"step_ms_mean\":" << mean
+          << ",\"step_ms_p50\":" << Percentile(times, 50)
+          << ",\"step_ms_p95\":" << Percentile(times, 95)
+          << ",\"step_ms_p99\":" << Percentile(times, 99)
+          << ",\"samples_per_second\":" << samples
+          << ",\"gradient_fraction\":" << fraction
+          << ",\"peak_memory_bytes\":" << PeakMemory() << "}\n";
+    }
+    else
+    {
+      line << "Telemetry (" << event << ", epoch " << epoch << "): "
+          << times.size() << " steps, " << mean << " ms mean, "
+          << Percentile(times, 50) << " / " << Percentile(times, 95) << " / "
+          << Percentile(times, 99) << " ms p50 / p95 / p99, " << samples
+          << " samples/s, " << 100.0 * fraction << "% gradient, peak memory "
+          << PeakMemory() / (1024 * 1024) << " MB\n";
+    }
+
+    output << line.str() << std::flush;
+  }
+
+  // The output stream that all data is to be sent to; example: std::cout.
+  std::ostream& output;
+
+  // Locally held number of steps between reports.
+  size_t period;
+
+  // Locally held boolean to determine whether reports are JSON lines.
+  bool json;
+
+  // Locally held number of points of a step, 0 if unknown.
+  size_t batchSize;
+
+  // Locally held number of the last finished epoch.
+  size_t epoch;
+
+  // Locally held time of every step, in seconds.
+  std::vector<double> totalTimes;
+
+  // Locally held time of every step of the current report, in seconds.
+  std::vector<double> windowTimes;
+
+  // Locally held time spent computing gradients, in seconds.
+  double totalGradientTime;
+
+  // Locally held time spent computing gradients in the current report, in
+  // seconds.
+  double windowGradientTime;
+
+  // Locally held start of the current step.
+  Clock::time_point stepStart;
+};
+
+} // namespace ens
+
+#endif
@@ -28,6 +28,7 @@
 
 #define MLPACK_ENABLE_ANN_SERIALIZATION
 #include <mlpack.hpp>
+#include <models/common/model_summary.hpp>
 
 namespace mlpack {
 namespace models {
@@ -86,6 +87,18 @@ class AlexNetType : public MultiLayer<MatType>
     return alexNet;
   }
 
+  /**
+   * Get the output shape, parameters, multiply-accumulates and activation
+   * memory of every layer of the network for inputs of the given dimensions,
+   * without passing any input through it; see ModelSummary.
+   *
+   * @param inputDimensions Dimensions of a single input, e.g. {224, 224, 3}.
+   */
+  ModelSummary Summary(const std::vector<size_t>& inputDimensions)
+  {
+    return ModelSummary(*this, inputDimensions);
+  }
+
   //! Serialize the AlexNetType.
   template<typename Archive>
   void serialize(Archive& ar, const uint32_t /* version */);
@@ -0,0 +1,247 @@
+/**
+ * @file batch_norm_folding.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of BatchNormFolding, which folds batch normalization into the
+ * weights of the preceding convolutions for inference.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_COMMON_BATCH_NORM_FOLDING_HPP
+#define MODELS_MODELS_COMMON_BATCH_NORM_FOLDING_HPP
+
+#include <mlpack.hpp>
+#include <models/layers/layer_types.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * At inference time batch normalization is a fixed affine map of every
+ * channel, y = gamma * (x - mean) / sqrt(variance + epsilon) + beta. When it
+ * directly follows a convolution, the map can be folded into the weights
+ * and the bias of the convolution, which saves one pass over every
+ * activation of the block.
+ *
+ * BatchNormFolding copies the weights of a trained network into a network of
+ * the same architecture built without the batch normalization layers that
+ * follow convolutions, where those convolutions use a bias. Layers of both
+ * networks are matched in order; a convolution followed by batch
+ * normalization in the trained network is folded into the next convolution
+ * of the folded network, all other layers are copied. The models build the
+ * folded network themselves, e.g. VGGType::GetInferenceModel().
+ *
+ * @code
+ * models::VGG16BN vgg;
+ * FFN<>* model = vgg.GetModel();
+ * model->Train(trainX, trainY, optimizer);
+ *
+ * // Same predictions, without batch normalization layers.
+ * FFN<>* inference = vgg.GetInferenceModel(*model);
+ * inference->Predict(testX, predictions);
+ * @endcode
+ */
+class BatchNormFolding
+{
+ public:
+  /**
+   * Copies the weights of a trained network into the folded network. The
+   * weights of the folded network are allocated for the input dimensions of
+   * the trained network.
+   *
+   * @param trained Trained network.
+   * @param folded Network with the same architecture, without batch
+   *               normalization after convolutions.
+   */
+  template<
+    typename OutputLayerType,
+    typename InitializationRuleType,
+    typename MatType
+  >
+  static void Fold(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& trained,
+      FFN<OutputLayerType, InitializationRuleType, MatType>& folded)
+  {
+    folded.InputDimensions() = trained.InputDimensions();
+    folded.Reset();
+    Fold(trained.Network(), folded.Network());
+  }
+
+  /**
+   * Copies the weights of trained layers into folded layers. The weights of
+   * both must already be allocated.
+   *
+   * @param trained Trained layers.
+   * @param folded Layers of the same architecture, without batch
+   *               normalization after convolutions.
+   */
+  template<typename MatType>
+  static void Fold(const std::vector<Layer<MatType>*>& trained,
+                   const std::vector<Layer<MatType>*>& folded)
+  {
+    std::vector<Layer<MatType>*> source, target;
+    Flatten(trained, source);
+    Flatten(folded, target);
+
+    size_t t = 0;
+    for (size_t i = 0; i < source.size(); i++)
+    {
+      if (source[i]->WeightSize() == 0 && !IsBatchNorm(source[i]))
+        continue;
+
+      while (t < target.size() && target[t]->WeightSize() == 0 &&
+          !IsBatchNorm(target[t]))
+        t++;
+
+      if (t == target.size())
+      {
+        mlpack::Log::Fatal << "Folded network has fewer layers with weights "
+            << "than the trained network." << std::endl;
+      }
+
+      // Batch normalization is folded if it directly follows a convolution
+      // and the folded network doesn't keep it.
+      const bool keepsNorm = (t + 1 < target.size() &&
+          IsBatchNorm(target[t + 1]));
+      if (IsConvolution(source[i]) && i + 1 < source.size() &&
+          IsBatchNorm(source[i + 1]) && !keepsNorm)
+      {
+        FoldConvolution(*source[i],
+            *dynamic_cast<BatchNormType<MatType>*>(source[i + 1]),
+            *target[t]);
+        i++;
+      }
+      else
+      {
+        Copy(*source[i], *target[t]);
+      }
+
+      t++;
+    }
+
+    for (; t < target.size(); t++)
+    {
+      if (target[t]->WeightSize() > 0)
+      {
+        mlpack::Log::Fatal << "Folded network has more layers with weights "
+            << "than the trained network." << std::endl;
+      }
+    }
+  }
+
+ private:
+  //! Appends all layers that aren't containers, in the order of the forward
+  //! pass.
+  template<typename MatType>
+  static void Flatten(const std::vector<Layer<MatType>*>& layers,
+                      std::vector<Layer<MatType>*>& leaves)
+  {
+    for (Layer<MatType>* layer : layers)
+    {
+      MultiLayer<MatType>* container =
+          dynamic_cast<MultiLayer<MatType>*>(layer);
+      if (container != nullptr)
+        Flatten(container->Network(), leaves);
+      else
+        leaves.push_back(layer);
+    }
+  }
+
+  //! Returns true if the layer is a convolution.
+  template<typename MatType>
+  static bool IsConvolution(Layer<MatType>* layer)
+  {
+    return dynamic_cast<DefaultConvolutionType<MatType>*>(layer) != nullptr;
+  }
+
+  //! Returns true if the layer is batch normalization.
+  template<typename MatType>
+  static bool IsBatchNorm(Layer<MatType>* layer)
+  {
+    return dynamic_cast<BatchNormType<MatType>*>(layer) != nullptr;
+  }
+
+  /**
+   * Copies the weights of a layer, and the running statistics of batch
+   * normalization.
+   *
+   * @param source Trained layer.
+   * @param target Layer of the folded network.
+   */
+  template<typename MatType>
+  static void Copy(Layer<MatType>& source, Layer<MatType>& target)
+  {
+    if (source.WeightSize() != target.WeightSize())
+    {
+      mlpack::Log::Fatal << "Layer with " << source.WeightSize() << " weights "
+          << "doesn't match the folded layer with " << target.WeightSize()
+          << " weights." << std::endl;
+    }
+
+    if (source.WeightSize() > 0)
+      target.Parameters() = source.Parameters();
+
+    BatchNormType<MatType>* sourceNorm =
+        dynamic_cast<BatchNormType<MatType>*>(&source);
+    BatchNormType<MatType>* targetNorm =
+        dynamic_cast<BatchNormType<MatType>*>(&target);
+    if (sourceNorm != nullptr && targetNorm != nullptr)
+    {
+      targetNorm->TrainingMean() = sourceNorm->TrainingMean();
+      targetNorm->TrainingVariance() = sourceNorm->TrainingVariance();
+    }
+  }
+
+  /**
+   * Folds batch normalization into the weights of a convolution. Weights of
+   * the convolution are stored output map by output map, followed by the
+   * bias of every output map, if the convolution uses a bias.
+   *
+   * @param convolution Trained convolution, with or without bias.
+   * @param norm Trained batch normalization following the convolution.
+   * @param target Convolution of the folded network, with bias.
+   */
+  template<typename MatType>
+  static void FoldConvolution(Layer<MatType>& convolution,
+                              BatchNormType<MatType>& norm,
+                              Layer<MatType>& target)
+  {
+    typedef typename MatType::elem_type ElemType;
+
+    const size_t maps = norm.TrainingMean().n_elem;
+    const size_t weights = target.WeightSize() - maps;
+    const bool bias = (convolution.WeightSize() == weights + maps);
+    if (target.WeightSize() < maps || weights % maps != 0 ||
+        (!bias && convolution.WeightSize() != weights))
+    {
+      mlpack::Log::Fatal << "Convolution with " << convolution.WeightSize()
+          << " weights followed by batch normalization of " << maps
+          << " maps doesn't match the folded convolution with "
+          << target.WeightSize() << " weights." << std::endl;
+    }
+
+    const MatType& input = convolution.Parameters();
+    const MatType& normParameters = norm.Parameters();
+    MatType& output = target.Parameters();
+    const size_t kernelSize = weights / maps;
+    for (size_t map = 0; map < maps; map++)
+    {
+      const double scale = normParameters(map) /
+          std::sqrt(norm.TrainingVariance()(map) + norm.Epsilon());
+      for (size_t k = map * kernelSize; k < (map + 1) * kernelSize; k++)
+        output(k) = ElemType(scale * input(k));
+
+      const double mapBias = bias ? input(weights + map) : 0.0;
+      output(weights + map) = ElemType((mapBias - norm.TrainingMean()(map)) *
+          scale + normParameters(maps + map));
+    }
+  }
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * @file batch_norm_statistics.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of BatchNormStatistics, which copies the running statistics of
+ * batch normalization between networks of the same architecture.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_COMMON_BATCH_NORM_STATISTICS_HPP
+#define MODELS_MODELS_COMMON_BATCH_NORM_STATISTICS_HPP
+
+#include <mlpack.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * The running mean and variance of batch normalization are learned while
+ * training but aren't part of the parameters of a network, so copying the
+ * parameters of a network into another one, e.g. one trained on copies of
+ * its layers, leaves the statistics of the target behind. BatchNormStatistics
+ * copies them; batch normalization layers of both networks are matched in the
+ * order of the forward pass, looking into containers such as the models.
+ *
+ * @code
+ * // Copy everything a trained network learned into a copy of its layers.
+ * copy.Parameters() = trained.Parameters();
+ * BatchNormStatistics::Copy(trained.Network(), copy.Network());
+ * @endcode
+ */
+class BatchNormStatistics
+{
+ public:
+  /**
+   * Copies the running statistics of all batch normalization layers.
+   *
+   * @param source Layers the statistics are copied from.
+   * @param target Layers of the same architecture the statistics are copied
+   *     to.
+   */
+  template<typename MatType>
+  static void Copy(const std::vector<Layer<MatType>*>& source,
+                   const std::vector<Layer<MatType>*>& target)
+  {
+    std::vector<BatchNormType<MatType>*> sourceNorms, targetNorms;
+    Find(source, sourceNorms);
+    Find(target, targetNorms);
+    if (sourceNorms.size() != targetNorms.size())
+    {
+      mlpack::Log::Fatal << "BatchNormStatistics::Copy(): "
+          << sourceNorms.size() << " batch normalization layers can't be "
+          << "copied into " << targetNorms.size() << " layers." << std::endl;
+    }
+
+    for (size_t i = 0; i < sourceNorms.size(); i++)
+    {
+      targetNorms[i]->TrainingMean() = sourceNorms[i]->TrainingMean();
+      targetNorms[i]->TrainingVariance() = sourceNorms[i]->TrainingVariance();
+    }
+  }
+
+  /**
+   * Appends all batch normalization layers of the given layers, in the order
+   * of the forward pass.
+   *
+   * @param layers Layers to look into.
+   * @param norms Batch normalization layers found.
+   */
+  template<typename MatType>
+  static void Find(const std::vector<Layer<MatType>*>& layers,
+                   std::vector<BatchNormType<MatType>*>& norms)
+  {
+    for (Layer<MatType>* layer : layers)
+    {
+      MultiLayer<MatType>* container =
+          dynamic_cast<MultiLayer<MatType>*>(layer);
+      BatchNormType<MatType>* norm =
+          dynamic_cast<BatchNormType<MatType>*>(layer);
+      if (container != nullptr)
+        Find(container->Network(), norms);
+      else if (norm != nullptr)
+        norms.push_back(norm);
+    }
+  }
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,116 @@
+/**
+ * @file batched_evaluation.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of BatchedEvaluation, which evaluates the loss of a network on
+ * a dataset in batches, with the batches evaluated in parallel.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_COMMON_BATCHED_EVALUATION_HPP
+#define MODELS_MODELS_COMMON_BATCHED_EVALUATION_HPP
+
+#include <mlpack.hpp>
+#include <models/common/data_parallel.hpp>
+#include <memory>
+#include <thread>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Batched evaluation of the loss of a network. Every batch is an alias of
+ * columns of the dataset, so no batch is copied. A network can only evaluate
+ * one batch at a time, so batches are evaluated in parallel (if OpenMP is
+ * available) by replicas of the network, which share its weights; the first
+ * replica is the network itself.
+ *
+ * The loss of the dataset is the sum of the losses of its batches, so with
+ * losses that sum over their inputs, e.g. the default losses of mlpack, it
+ * doesn't depend on the batch size, and a last batch smaller than the others
+ * counts by its size.
+ *
+ * @code
+ * FFN<MeanSquaredError>* model = resnet.GetModel<MeanSquaredError>();
+ * const double loss = BatchedEvaluation::Evaluate(*model, testX, testY, 64);
+ * @endcode
+ */
+class BatchedEvaluation
+{
+ public:
+  /**
+   * Evaluates the loss of the network on the given dataset.
+   *
+   * @param network Network to evaluate, with allocated weights.
+   * @param predictors Input variables, one input per column.
+   * @param responses Outputs of the input variables.
+   * @param batchSize Number of inputs evaluated at once.
+   * @param replicas Maximum number of replicas evaluating batches at once.
+   * @return Sum of the losses of all batches.
+   */
+  template<
+    typename OutputLayerType,
+    typename InitializationRuleType,
+    typename MatType
+  >
+  static double Evaluate(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& network,
+      const MatType& predictors,
+      const MatType& responses,
+      const size_t batchSize = 32,
+      const size_t replicas = std::thread::hardware_concurrency())
+  {
+    typedef FFN<OutputLayerType, InitializationRuleType, MatType> NetworkType;
+
+    if (batchSize == 0 || predictors.n_cols != responses.n_cols)
+    {
+      mlpack::Log::Fatal << "BatchedEvaluation::Evaluate(): expected a "
+          << "positive batch size and as many responses as predictors, but "
+          << "the batch size is " << batchSize << " with " << predictors.n_cols
+          << " predictors and " << responses.n_cols << " responses."
+          << std::endl;
+    }
+
+    const size_t batches = (predictors.n_cols + batchSize - 1) / batchSize;
+    const size_t numReplicas = std::max<size_t>(1, std::min(replicas,
+        batches));
+
+    std::vector<std::unique_ptr<NetworkType>> copies;
+    for (size_t i = 1; i < numReplicas; i++)
+    {
+      copies.emplace_back(new NetworkType(network));
+      DataParallel<OutputLayerType, InitializationRuleType, MatType>::
+          ShareParameters(*copies.back(), network.Parameters());
+    }
+
+    // Replica r evaluates batches r, r + numReplicas, and so on.
+    std::vector<double> losses(numReplicas, 0.0);
+
+    #pragma omp parallel for num_threads(numReplicas) schedule(static)
+    for (size_t r = 0; r < numReplicas; r++)
+    {
+      NetworkType& replica = (r == 0) ? network : *copies[r - 1];
+      for (size_t b = r; b < batches; b += numReplicas)
+      {
+        const size_t first = b * batchSize;
+        const size_t size = std::min(batchSize,
+            size_t(predictors.n_cols) - first);
+        const MatType inputs(const_cast<MatType&>(predictors).colptr(first),
+            predictors.n_rows, size, false, true);
+        const MatType targets(const_cast<MatType&>(responses).colptr(first),
+            responses.n_rows, size, false, true);
+        losses[r] += replica.Evaluate(inputs, targets);
+      }
+    }
+
+    return arma::accu(arma::vec(losses));
+  }
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,330 @@
+/**
+ * @file data_parallel.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of DataParallel, which trains a network with replicas that
+ * compute the gradients of parts of every batch on their own threads.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_COMMON_DATA_PARALLEL_HPP
+#define MODELS_MODELS_COMMON_DATA_PARALLEL_HPP
+
+#include <mlpack.hpp>
+#include <memory>
+#include <thread>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Data-parallel training on a single machine. Multithreaded BLAS only
+ * parallelizes every matrix multiplication on its own, which scales poorly
+ * for the small convolutions of deep models. DataParallel instead keeps
+ * replicas of the network, whose weights all alias the parameters being
+ * optimized, and splits every batch into one shard per replica. Replicas
+ * compute the loss and the gradient of their shard in parallel (if OpenMP is
+ * available), and the gradients are then summed in parallel as well: every
+ * thread sums one slice of the parameters over all replicas, so no locks
+ * are taken. The sum is the gradient of the whole batch, so the optimizer
+ * takes the same steps as for FFN::Train().
+ *
+ * DataParallel is a separable function for ensmallen optimizers, and Train()
+ * takes the same arguments as FFN::Train(), including callbacks, e.g. with
+ * the features and labels of a DataLoader. BLAS should run single-threaded,
+ * e.g. with OPENBLAS_NUM_THREADS=1.
+ *
+ * @code
+ * FFN<>* model = resnet.GetModel();
+ * DataParallel<> parallel(*model, 16);
+ * ens::Adam optimizer(1e-3, 256);
+ * parallel.Train(dataloader.TrainFeatures(), dataloader.TrainLabels(),
+ *     optimizer, ens::PrintLoss(), ens::ProgressBar());
+ * @endcode
+ *
+ * @tparam OutputLayerType The output layer type of the network.
+ * @tparam InitializationRuleType Rule used to initialize the weights.
+ * @tparam MatType Matrix representation to accept as input and use for
+ *    computation.
+ */
+template<
+  typename OutputLayerType = NegativeLogLikelihood,
+  typename InitializationRuleType = RandomInitialization,
+  typename MatType = arma::mat
+>
+class DataParallel
+{
+ public:
+  //! Type of the network being trained.
+  typedef FFN<OutputLayerType, InitializationRuleType, MatType> NetworkType;
+
+  /**
+   * Create the DataParallel object for the given network. The replicas are
+   * created by Train().
+   *
+   * @param network Network to train; its input dimensions must be set.
+   * @param replicas Number of replicas, one per thread.
+   */
+  DataParallel(NetworkType& network,
+               const size_t replicas = std::thread::hardware_concurrency()) :
+      network(network),
+      numReplicas(std::max<size_t>(replicas, 1)),
+      predictors(nullptr),
+      responses(nullptr),
+      aliased(nullptr)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Trains the network on the given data with the given optimizer; see
+   * FFN::Train().
+   *
+   * @param predictors Input training variables.
+   * @param responses Outputs results from input training variables.
+   * @param optimizer Instantiated ensmallen optimizer.
+   * @param callbacks Callback functions for the ensmallen optimizer.
+   * @return The final objective of the trained model.
+   */
+  template<typename OptimizerType, typename... CallbackTypes>
+  double Train(const MatType& predictors,
+               const MatType& responses,
+               OptimizerType& optimizer,
+               CallbackTypes&&... callbacks)
+  {
+    this->predictors = &predictors;
+    this->responses = &responses;
+    order = arma::regspace<arma::uvec>(0, predictors.n_cols - 1);
+
+    if (network.Parameters().is_empty())
+      network.Reset();
+
+    // Replicas hold their own layers, and the weights of the network.
+    network.SetNetworkMode(true);
+    replicas.clear();
+    for (size_t i = 1; i < numReplicas; i++)
+    {
+      replicas.emplace_back(new NetworkType(network));
+      replicas.back()->SetNetworkMode(true);
+    }
+    aliased = nullptr;
+
+    const double objective = optimizer.Optimize(*this, network.Parameters(),
+        callbacks...);
+
+    replicas.clear();
+    this->predictors = nullptr;
+    this->responses = nullptr;
+    return objective;
+  }
+
+  /**
+   * Evaluates the loss of the given batch, with the shards of the batch
+   * evaluated in parallel.
+   *
+   * @param parameters Weights of the network.
+   * @param begin Index of the first input of the batch.
+   * @param batchSize Number of inputs of the batch.
+   */
+  double Evaluate(const MatType& parameters,
+                  const size_t begin,
+                  const size_t batchSize)
+  {
+    Alias(parameters);
+    std::vector<double> losses(numReplicas, 0.0);
+
+    #pragma omp parallel for num_threads(numReplicas) schedule(static)
+    for (size_t i = 0; i < numReplicas; i++)
+    {
+      MatType inputs, targets;
+      if (Shard(i, begin, batchSize, inputs, targets))
+        losses[i] = Replica(i).Evaluate(inputs, targets);
+    }
+
+    return arma::accu(arma::vec(losses));
+  }
+
+  /**
+   * Evaluates the loss and the gradient of the given batch. Every replica
+   * computes the gradient of its shard, and the gradients are summed.
+   *
+   * @param parameters Weights of the network.
+   * @param begin Index of the first input of the batch.
+   * @param gradient Resulting gradient of the batch.
+   * @param batchSize Number of inputs of the batch.
+   */
+  double EvaluateWithGradient(const MatType& parameters,
+                              const size_t begin,
+                              MatType& gradient,
+                              const size_t batchSize)
+  {
+    Alias(parameters);
+    gradients.resize(numReplicas);
+    std::vector<double> losses(numReplicas, 0.0);
+    std::vector<char> computed(numReplicas, 0);
+
+    #pragma omp parallel for num_threads(numReplicas) schedule(static)
+    for (size_t i = 0; i < numReplicas; i++)
+    {
+      MatType inputs, targets, outputs;
+      if (!Shard(i, begin, batchSize, inputs, targets))
+        continue;
+
+      gradients[i].set_size(parameters.n_rows, parameters.n_cols);
+      Replica(i).Forward(inputs, outputs);
+      losses[i] = Replica(i).Backward(inputs, targets, gradients[i]);
+      computed[i] = 1;
+    }
+
+    // Every thread sums one slice of the gradients of all replicas.
+    gradient.zeros(parameters.n_rows, parameters.n_cols);
+    const size_t slice = (gradient.n_elem + numReplicas - 1) / numReplicas;
+
+    #pragma omp parallel for num_threads(numReplicas) schedule(static)
+    for (size_t s = 0; s < numReplicas; s++)
+    {
+      const size_t first = s * slice;
+      const size_t last = std::min(first + slice, size_t(gradient.n_elem));
+      for (size_t i = 0; i < numReplicas; i++)
+      {
+        if (!computed[i])
+          continue;
+
+        const typename MatType::elem_type* values = gradients[i].memptr();
+        typename MatType::elem_type* sum = gradient.memptr();
+        for (size_t j = first; j < last; j++)
+          sum[j] += values[j];
+      }
+    }
+
+    return arma::accu(arma::vec(losses));
+  }
+
+  /**
+   * Computes the gradient of the given batch; see EvaluateWithGradient().
+   *
+   * @param parameters Weights of the network.
+   * @param begin Index of the first input of the batch.
+   * @param gradient Resulting gradient of the batch.
+   * @param batchSize Number of inputs of the batch.
+   */
+  void Gradient(const MatType& parameters,
+                const size_t begin,
+                MatType& gradient,
+                const size_t batchSize)
+  {
+    EvaluateWithGradient(parameters, begin, gradient, batchSize);
+  }
+
+  //! Get the number of inputs being trained on.
+  size_t NumFunctions() const { return order.n_elem; }
+
+  //! Shuffle the order of the inputs.
+  void Shuffle() { order = arma::shuffle(order); }
+
+  //! Get the number of replicas.
+  size_t Replicas() const { return numReplicas; }
+
+  /**
+   * Makes the weights of the given network alias the given parameters, e.g.
+   * those of the network it is a copy of.
+   *
+   * @param replica Network whose weights are replaced.
+   * @param parameters Parameters of the same size, which must outlive the
+   *     network.
+   */
+  static void ShareParameters(NetworkType& replica, const MatType& parameters)
+  {
+    // The shapes of the layers are computed like in the first pass.
+    std::vector<size_t> dimensions = replica.InputDimensions();
+    MatType& weights = replica.Parameters();
+    weights.~MatType();
+    new (&weights) MatType(const_cast<MatType&>(parameters).memptr(),
+        parameters.n_rows, parameters.n_cols, false, true);
+
+    size_t offset = 0;
+    for (Layer<MatType>* layer : replica.Network())
+    {
+      layer->InputDimensions() = dimensions;
+      layer->ComputeOutputDimensions();
+      dimensions = layer->OutputDimensions();
+      layer->SetWeights(MatType(weights.memptr() + offset,
+          layer->WeightSize(), 1, false, true));
+      offset += layer->WeightSize();
+    }
+  }
+
+ private:
+  //! Get the given replica; replica 0 is the network itself.
+  NetworkType& Replica(const size_t i)
+  {
+    return (i == 0) ? network : *replicas[i - 1];
+  }
+
+  /**
+   * Gathers the inputs of the given shard of a batch.
+   *
+   * @return false if the shard is empty.
+   */
+  bool Shard(const size_t i,
+             const size_t begin,
+             const size_t batchSize,
+             MatType& inputs,
+             MatType& targets) const
+  {
+    const size_t shardSize = (batchSize + numReplicas - 1) / numReplicas;
+    const size_t first = std::min(i * shardSize, batchSize);
+    const size_t last = std::min(first + shardSize, batchSize);
+    if (first == last)
+      return false;
+
+    const arma::uvec indices = order.subvec(begin + first, begin + last - 1);
+    inputs = predictors->cols(indices);
+    targets = responses->cols(indices);
+    return true;
+  }
+
+  //! Make the weights of all replicas alias the given parameters.
+  void Alias(const MatType& parameters)
+  {
+    if (aliased == parameters.memptr())
+      return;
+
+    for (std::unique_ptr<NetworkType>& replica : replicas)
+      ShareParameters(*replica, parameters);
+
+    aliased = parameters.memptr();
+  }
+
+  //! Locally stored network being trained, also the first replica.
+  NetworkType& network;
+
+  //! Locally stored number of replicas.
+  size_t numReplicas;
+
+  //! Locally stored replicas other than the network, only while training.
+  std::vector<std::unique_ptr<NetworkType>> replicas;
+
+  //! Locally stored gradient of the shard of every replica.
+  std::vector<MatType> gradients;
+
+  //! Locally stored input training variables, only while training.
+  const MatType* predictors;
+
+  //! Locally stored outputs of the training variables, only while training.
+  const MatType* responses;
+
+  //! Locally stored order of the inputs.
+  arma::uvec order;
+
+  //! Locally stored parameters the replicas alias.
+  const typename MatType::elem_type* aliased;
+}; // DataParallel class.
+
+} // namespace models
+} // namespace mlpack
+
+#endif
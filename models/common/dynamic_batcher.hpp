@@ -0,0 +1,277 @@
+/**
+ * @file dynamic_batcher.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of DynamicBatcher, which serves predictions of single inputs
+ * requested from many threads by running the network on batches of them.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_COMMON_DYNAMIC_BATCHER_HPP
+#define MODELS_MODELS_COMMON_DYNAMIC_BATCHER_HPP
+
+#include <mlpack.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Inference front-end for serving. Predicting single inputs makes every
+ * matrix multiplication of the network a matrix-vector product, and a
+ * network can't predict from several threads at once, since its layers keep
+ * the outputs of the last pass. DynamicBatcher owns a network and a thread
+ * that is the only one running it. Predict() may be called from any number
+ * of threads; it queues the input and returns a future of its prediction.
+ * The thread collects queued inputs until the batch is full or the oldest
+ * input has waited for the maximum wait time, predicts the whole batch in a
+ * single pass, and fulfills the futures of its inputs.
+ *
+ * A larger batch gives better throughput; the maximum wait time bounds the
+ * latency added to a request when there are few requests.
+ *
+ * @code
+ * ResNet50 resnet(1000);
+ * FFN<>* model = resnet.GetInferenceModel(trained);
+ * DynamicBatcher batcher(model, 32, std::chrono::milliseconds(5));
+ *
+ * // In every request thread.
+ * arma::mat prediction = batcher.Predict(image).get();
+ * @endcode
+ *
+ * @tparam MatType Matrix representation to accept as input and use for
+ *    computation.
+ */
+template<typename MatType = arma::mat>
+class DynamicBatcherType
+{
+ public:
+  /**
+   * Create the DynamicBatcherType object, which takes ownership of the given
+   * network and starts the thread running it. The input dimensions of the
+   * network must be set, and its weights allocated.
+   *
+   * @param network Network to predict with, deleted with the batcher.
+   * @param maxBatchSize Maximum number of inputs predicted at once.
+   * @param maxWait Maximum time an input waits for more inputs to arrive.
+   */
+  template<typename OutputLayerType, typename InitializationRuleType>
+  DynamicBatcherType(
+      FFN<OutputLayerType, InitializationRuleType, MatType>* network,
+      const size_t maxBatchSize = 32,
+      const std::chrono::microseconds maxWait =
+          std::chrono::microseconds(2000)) :
+      maxBatchSize(std::max<size_t>(maxBatchSize, 1)),
+      maxWait(maxWait),
+      inputSize(1),
+      stopping(false),
+      batches(0),
+      requests(0)
+  {
+    for (size_t dimension : network->InputDimensions())
+      inputSize *= dimension;
+
+    network->SetNetworkMode(false);
+    owner = std::shared_ptr<void>(network, [](void* pointer)
+    {
+      delete static_cast<FFN<OutputLayerType, InitializationRuleType,
+          MatType>*>(pointer);
+    });
+    predict = [network](const MatType& inputs, MatType& outputs)
+    {
+      network->Predict(inputs, outputs, inputs.n_cols);
+    };
+
+    worker = std::thread(&DynamicBatcherType::Run, this);
+  }
+
+  //! Predict the queued inputs, then stop the thread and delete the network.
+  ~DynamicBatcherType()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+
+    available.notify_one();
+    worker.join();
+  }
+
+  //! DynamicBatchers can't be copied, they own a thread.
+  DynamicBatcherType(const DynamicBatcherType&) = delete;
+  //! DynamicBatchers can't be copied, they own a thread.
+  DynamicBatcherType& operator=(const DynamicBatcherType&) = delete;
+
+  /**
+   * Queues a single input. This is safe to call from several threads at
+   * once.
+   *
+   * @param input Input of the network, a single column.
+   * @return Future of the prediction of the input, a single column. If the
+   *     network fails, the future holds its exception.
+   */
+  std::future<MatType> Predict(const MatType& input)
+  {
+    if (input.n_rows != inputSize || input.n_cols != 1)
+    {
+      mlpack::Log::Fatal << "DynamicBatcher::Predict(): expected an input of "
+          << inputSize << " rows and 1 column, but the input has "
+          << input.n_rows << " rows and " << input.n_cols << " columns."
+          << std::endl;
+    }
+
+    Request request;
+    request.input = input;
+    request.arrival = std::chrono::steady_clock::now();
+    std::future<MatType> prediction = request.promise.get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      queue.push_back(std::move(request));
+    }
+
+    available.notify_one();
+    return prediction;
+  }
+
+  //! Get the maximum number of inputs predicted at once.
+  size_t MaxBatchSize() const { return maxBatchSize; }
+
+  //! Get the number of batches predicted so far.
+  size_t Batches() const { return batches; }
+
+  //! Get the number of inputs predicted so far.
+  size_t Requests() const { return requests; }
+
+  //! Get the average number of inputs of a batch so far.
+  double AverageBatchSize() const
+  {
+    const size_t total = batches;
+    return (total == 0) ? 0.0 : double(requests) / total;
+  }
+
+ private:
+  //! A queued input.
+  struct Request
+  {
+    //! Input of the network.
+    MatType input;
+    //! Time the input was queued.
+    std::chrono::steady_clock::time_point arrival;
+    //! Promise of the prediction of the input.
+    std::promise<MatType> promise;
+  };
+
+  //! Predicts batches until the batcher is destroyed.
+  void Run()
+  {
+    MatType inputs, outputs;
+    std::vector<Request> batch;
+    while (true)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        available.wait(lock, [this]() { return stopping || !queue.empty(); });
+        if (queue.empty())
+          return;
+
+        // Wait for a full batch as long as the oldest input may wait.
+        const std::chrono::steady_clock::time_point deadline =
+            queue.front().arrival + maxWait;
+        available.wait_until(lock, deadline, [this]()
+        {
+          return stopping || queue.size() >= maxBatchSize;
+        });
+
+        const size_t size = std::min(queue.size(), maxBatchSize);
+        for (size_t i = 0; i < size; i++)
+        {
+          batch.push_back(std::move(queue.front()));
+          queue.pop_front();
+        }
+      }
+
+      inputs.set_size(inputSize, batch.size());
+      for (size_t i = 0; i < batch.size(); i++)
+        inputs.col(i) = batch[i].input;
+
+      // Counts are updated first, so they include the batch once its
+      // predictions are available.
+      requests += batch.size();
+      batches++;
+
+      std::exception_ptr error;
+      try
+      {
+        predict(inputs, outputs);
+      }
+      catch (...)
+      {
+        error = std::current_exception();
+      }
+
+      for (size_t i = 0; i < batch.size(); i++)
+      {
+        if (error)
+          batch[i].promise.set_exception(error);
+        else
+          batch[i].promise.set_value(MatType(outputs.col(i)));
+      }
+      batch.clear();
+    }
+  }
+
+  //! Locally stored maximum number of inputs predicted at once.
+  size_t maxBatchSize;
+
+  //! Locally stored maximum time an input waits for more inputs.
+  std::chrono::microseconds maxWait;
+
+  //! Locally stored number of rows of an input.
+  size_t inputSize;
+
+  //! Locally stored owner of the network.
+  std::shared_ptr<void> owner;
+
+  //! Locally stored prediction of a batch with the network.
+  std::function<void(const MatType&, MatType&)> predict;
+
+  //! Locally stored queued inputs.
+  std::deque<Request> queue;
+
+  //! Locally stored lock of the queue.
+  std::mutex mutex;
+
+  //! Locally stored signal of queued inputs.
+  std::condition_variable available;
+
+  //! Locally stored if the batcher is being destroyed.
+  bool stopping;
+
+  //! Locally stored number of batches predicted so far.
+  std::atomic<size_t> batches;
+
+  //! Locally stored number of inputs predicted so far.
+  std::atomic<size_t> requests;
+
+  //! Locally stored thread running the network.
+  std::thread worker;
+}; // DynamicBatcherType class.
+
+// Standard DynamicBatcher.
+typedef DynamicBatcherType<arma::mat> DynamicBatcher;
+
+} // namespace models
+} // namespace mlpack
+
+#endif
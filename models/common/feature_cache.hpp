@@ -0,0 +1,197 @@
+/**
+ * @file feature_cache.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of FeatureCache class, which computes the features of a frozen
+ * backbone once and caches them for training heads on top of it.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_COMMON_FEATURE_CACHE_HPP
+#define MODELS_MODELS_COMMON_FEATURE_CACHE_HPP
+
+#include <mlpack.hpp>
+#include <dataloader/dataset_cache.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Feature extraction for transfer learning. When a head is trained on top of
+ * a frozen backbone, e.g. a model built with includeTop = false, the output
+ * of the backbone for a sample never changes, yet training runs the whole
+ * backbone for every sample in every epoch. FeatureCache runs the backbone
+ * once over a dataset, in large batches, averages every output map over its
+ * width and height, and stores the pooled features with the labels in a
+ * DatasetCache file. Later runs map the file and train the head on the
+ * features directly.
+ *
+ * @code
+ * FFN<> backbone;
+ * backbone.InputDimensions() = std::vector<size_t>({224, 224, 3});
+ * backbone.Add<ResNet50>(1000, false);
+ * WeightFile weights;
+ * weights.Load(cache.Fetch("resnet50"), backbone);
+ *
+ * FeatureCache features;
+ * arma::mat trainX, trainY;
+ * features.Load("./../data/cache/resnet50_train.bin", backbone,
+ *     dataloader.TrainFeatures(), dataloader.TrainLabels(), trainX, trainY);
+ *
+ * FFN<> head;
+ * head.Add<Linear>(numClasses);
+ * head.Add<LogSoftMax>();
+ * head.Train(trainX, trainY, optimizer);
+ * @endcode
+ *
+ * The cache file holds no information about the backbone or the dataset, so
+ * its path should identify both, e.g. with DatasetCache::Fingerprint().
+ */
+class FeatureCache
+{
+ public:
+  //! Create an empty FeatureCache object.
+  FeatureCache()
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Computes the features of the given inputs. The backbone is set to
+   * testing mode and runs over batchSize inputs at once; the output of every
+   * batch is pooled before the next batch runs, so the output of the
+   * backbone is never held for the whole dataset.
+   *
+   * @param backbone Trained backbone without classifier layers.
+   * @param inputs Inputs of the backbone, one input per column.
+   * @param features Resulting features, one column per input.
+   * @param batchSize Number of inputs passed through the backbone at once.
+   * @param pool Whether every output map is averaged over its width and
+   *     height. Otherwise the output of the backbone is stored as is.
+   */
+  template<
+    typename OutputLayerType,
+    typename InitializationRuleType,
+    typename MatType
+  >
+  static void Extract(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& backbone,
+      const MatType& inputs,
+      MatType& features,
+      const size_t batchSize = 256,
+      const bool pool = true)
+  {
+    typedef typename MatType::elem_type ElemType;
+
+    backbone.SetNetworkMode(false);
+
+    MatType output;
+    for (size_t i = 0; i < inputs.n_cols; i += batchSize)
+    {
+      const size_t cols = std::min(batchSize, inputs.n_cols - i);
+      const MatType batch(const_cast<MatType&>(inputs).colptr(i),
+          inputs.n_rows, cols, false, true);
+      backbone.Predict(batch, output, cols);
+
+      // The shape of the output is known after the first pass.
+      size_t area = 1;
+      if (pool)
+      {
+        const std::vector<size_t>& dimensions =
+            backbone.Network().back()->OutputDimensions();
+        area = (dimensions.size() >= 3) ? dimensions[0] * dimensions[1] : 1;
+      }
+
+      const size_t maps = output.n_rows / area;
+      if (i == 0)
+        features.set_size(maps, inputs.n_cols);
+
+      #pragma omp parallel for schedule(static)
+      for (size_t col = 0; col < cols; col++)
+      {
+        const ElemType* values = output.colptr(col);
+        ElemType* pooled = features.colptr(i + col);
+        for (size_t map = 0; map < maps; map++)
+        {
+          ElemType sum = 0;
+          for (size_t j = 0; j < area; j++)
+            sum += values[map * area + j];
+          pooled[map] = sum / ElemType(area);
+        }
+      }
+    }
+
+    mlpack::Log::Info << "Extracted " << features.n_rows << " features of "
+        << inputs.n_cols << " inputs." << std::endl;
+  }
+
+  /**
+   * Maps the features and labels of the given cache file if it exists, and
+   * otherwise extracts the features of the inputs and writes them to the
+   * cache file first. Features alias the mapped file, so they are only valid
+   * while this FeatureCache object is alive.
+   *
+   * @param path Path of the cache file.
+   * @param backbone Trained backbone without classifier layers.
+   * @param inputs Inputs of the backbone, one input per column.
+   * @param labels Labels of the inputs.
+   * @param features Resulting features, one column per input.
+   * @param featureLabels Resulting labels of the features.
+   * @param batchSize Number of inputs passed through the backbone at once.
+   * @param pool Whether every output map is averaged over its width and
+   *     height.
+   * @return true if the features were loaded from the cache file.
+   */
+  template<
+    typename OutputLayerType,
+    typename InitializationRuleType,
+    typename MatType,
+    typename LabelsType
+  >
+  bool Load(const std::string& path,
+            FFN<OutputLayerType, InitializationRuleType, MatType>& backbone,
+            const MatType& inputs,
+            const LabelsType& labels,
+            MatType& features,
+            LabelsType& featureLabels,
+            const size_t batchSize = 256,
+            const bool pool = true)
+  {
+    if (cache.Load(path, features, featureLabels))
+    {
+      if (features.n_cols == inputs.n_cols)
+        return true;
+
+      mlpack::Log::Warn << "Feature cache " << path << " holds "
+          << features.n_cols << " samples, but the dataset has "
+          << inputs.n_cols << "; extracting the features again." << std::endl;
+    }
+
+    MatType extracted;
+    Extract(backbone, inputs, extracted, batchSize, pool);
+    DatasetCache::Save(path, extracted, labels);
+
+    // Map the written file, so that the features of all runs share memory
+    // the same way.
+    if (cache.Load(path, features, featureLabels))
+      return false;
+
+    // Features may still alias the mapping of a stale cache file.
+    features.~MatType();
+    new (&features) MatType(std::move(extracted));
+    featureLabels = labels;
+    return false;
+  }
+
+ private:
+  //! Locally stored mapping of the cache file.
+  DatasetCache cache;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
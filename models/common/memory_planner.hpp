@@ -0,0 +1,371 @@
+/**
+ * @file memory_planner.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of MemoryPlanner, which runs inference with the outputs of all
+ * layers of a network stored in a few reused buffers.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_COMMON_MEMORY_PLANNER_HPP
+#define MODELS_MODELS_COMMON_MEMORY_PLANNER_HPP
+
+#include <mlpack.hpp>
+#include <models/layers/channel_concat.hpp>
+#include <models/layers/residual.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Memory planner for inference. FFN::Predict() keeps the output of every
+ * layer of the network in a matrix of its own, so the memory of a pass is
+ * the sum of all activations, which is large for deep models such as
+ * ResNet152 or VGG19. For inference an output is only needed until the
+ * layer that consumes it has run.
+ *
+ * The planner walks the layers of the network once, through the containers
+ * built by the models, and assigns every output to one of a few buffers of
+ * an arena: a buffer is reused as soon as the tensor in it is consumed. A
+ * chain of layers alternates between two buffers; a residual block keeps
+ * its input alive while its branches run, and its sum is computed in place.
+ * Predict() then runs the planned steps with the outputs aliased into the
+ * arena, which is allocated once for the batch size.
+ *
+ * MultiLayer and the models built on it are planned layer by layer, and so
+ * is Residual. Other containers, like AddMerge, Concat and ChannelConcat,
+ * run as a single step with their own buffers.
+ *
+ * @code
+ * FFN<>* model = resnet.GetModel();
+ * model->Train(trainX, trainY, optimizer);
+ *
+ * MemoryPlanner planner(*model);
+ * planner.Predict(testX, predictions);
+ * @endcode
+ *
+ * The planner holds pointers to the layers of the network and its plan
+ * only stays valid as long as the layers of the network don't change.
+ *
+ * @tparam MatType Matrix representation to accept as input and use for
+ *    computation.
+ */
+template<typename MatType = arma::mat>
+class MemoryPlannerType
+{
+ public:
+  /**
+   * Plans the outputs of the layers of the given network. The network is set
+   * to testing mode, and its weights must be allocated, i.e. it must have
+   * been trained, loaded or reset.
+   *
+   * @param network Network to run inference with.
+   */
+  template<typename OutputLayerType, typename InitializationRuleType>
+  MemoryPlannerType(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& network) :
+      inputSize(1),
+      outputSize(1),
+      batchSize(0)
+  {
+    if (network.Network().empty())
+    {
+      mlpack::Log::Fatal << "MemoryPlanner: the network has no layers."
+          << std::endl;
+    }
+
+    network.SetNetworkMode(false);
+
+    std::vector<size_t> dimensions = network.InputDimensions();
+    for (size_t dimension : dimensions)
+      inputSize *= dimension;
+
+    const std::vector<Layer<MatType>*>& layers = network.Network();
+    for (Layer<MatType>* layer : layers)
+    {
+      layer->InputDimensions() = dimensions;
+      layer->ComputeOutputDimensions();
+      dimensions = layer->OutputDimensions();
+    }
+
+    outputSize = Size(dimensions);
+    PlanSequence(layers, Input, Output);
+  }
+
+  /**
+   * Predicts the responses to the given predictors.
+   *
+   * @param predictors Input variables, one input per column.
+   * @param results Resulting responses, one response per column.
+   * @param batchSize Number of inputs passed through the network at once.
+   */
+  void Predict(const MatType& predictors,
+               MatType& results,
+               const size_t batchSize = 128)
+  {
+    if (predictors.n_rows != inputSize)
+    {
+      mlpack::Log::Fatal << "MemoryPlanner::Predict(): expected inputs of "
+          << inputSize << " rows, but the predictors have "
+          << predictors.n_rows << " rows." << std::endl;
+    }
+
+    // The arena only grows, and keeps its memory between calls.
+    if (batchSize > this->batchSize)
+    {
+      arena.set_size(ArenaSize() * batchSize, 1);
+      this->batchSize = batchSize;
+    }
+
+    results.set_size(outputSize, predictors.n_cols);
+    for (size_t i = 0; i < predictors.n_cols; i += batchSize)
+    {
+      const size_t cols = std::min(batchSize, predictors.n_cols - i);
+      const MatType input(const_cast<MatType&>(predictors).colptr(i),
+          predictors.n_rows, cols, false, true);
+      MatType output(results.colptr(i), results.n_rows, cols, false, true);
+
+      for (const Step& step : steps)
+      {
+        MatType stepInput = Alias(step.input, step.inputSize, cols, input,
+            output);
+        MatType stepOutput = Alias(step.output, step.outputSize, cols, input,
+            output);
+        if (step.residual != nullptr)
+          step.residual->Merge(stepInput, stepOutput);
+        else
+          step.layer->Forward(stepInput, stepOutput);
+      }
+    }
+  }
+
+  //! Get the number of buffers of the arena.
+  size_t Buffers() const { return bufferSizes.size(); }
+
+  //! Get the number of elements of the arena per input.
+  size_t ArenaSize() const
+  {
+    size_t size = 0;
+    for (size_t bufferSize : bufferSizes)
+      size += bufferSize;
+    return size;
+  }
+
+ private:
+  //! Identifiers of the buffers that aren't part of the arena.
+  enum
+  {
+    Input = 0,
+    Output = 1,
+    FirstBuffer = 2
+  };
+
+  //! A layer to run, or the sum of a residual block.
+  struct Step
+  {
+    //! Layer to run.
+    Layer<MatType>* layer;
+    //! Residual block whose sum is computed, or nullptr.
+    const ResidualType<MatType>* residual;
+    //! Buffer of the input.
+    size_t input;
+    //! Number of rows of the input.
+    size_t inputSize;
+    //! Buffer of the output.
+    size_t output;
+    //! Number of rows of the output.
+    size_t outputSize;
+  };
+
+  //! Get the number of elements of a tensor of the given dimensions.
+  static size_t Size(const std::vector<size_t>& dimensions)
+  {
+    size_t size = 1;
+    for (size_t dimension : dimensions)
+      size *= dimension;
+    return size;
+  }
+
+  //! Returns true if the layer runs its layers one after another.
+  static bool IsSequential(Layer<MatType>* layer)
+  {
+    MultiLayer<MatType>* container = dynamic_cast<MultiLayer<MatType>*>(layer);
+    return container != nullptr && !container->Network().empty() &&
+        dynamic_cast<ResidualType<MatType>*>(layer) == nullptr &&
+        dynamic_cast<AddMergeType<MatType>*>(layer) == nullptr &&
+        dynamic_cast<ConcatType<MatType>*>(layer) == nullptr &&
+        dynamic_cast<ChannelConcatType<MatType>*>(layer) == nullptr;
+  }
+
+  /**
+   * Plans the given layers run one after another.
+   *
+   * @param layers Layers to plan.
+   * @param input Buffer holding the input of the first layer.
+   * @param output Buffer to hold the output of the last layer.
+   */
+  void PlanSequence(const std::vector<Layer<MatType>*>& layers,
+                    const size_t input,
+                    const size_t output)
+  {
+    size_t current = input;
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+      const size_t next = (i + 1 == layers.size()) ? output :
+          Acquire(Size(layers[i]->OutputDimensions()));
+      PlanLayer(layers[i], current, next);
+
+      // The input of the sequence belongs to the caller.
+      if (current != input)
+        Release(current);
+      current = next;
+    }
+  }
+
+  /**
+   * Plans a single layer, through the layers it holds if possible.
+   *
+   * @param layer Layer to plan.
+   * @param input Buffer holding the input of the layer.
+   * @param output Buffer to hold the output of the layer.
+   */
+  void PlanLayer(Layer<MatType>* layer,
+                 const size_t input,
+                 const size_t output)
+  {
+    if (IsSequential(layer))
+    {
+      PlanSequence(dynamic_cast<MultiLayer<MatType>*>(layer)->Network(),
+          input, output);
+      return;
+    }
+
+    const size_t layerInputSize = Size(layer->InputDimensions());
+    const size_t layerOutputSize = Size(layer->OutputDimensions());
+    ResidualType<MatType>* residual =
+        dynamic_cast<ResidualType<MatType>*>(layer);
+    if (residual == nullptr)
+    {
+      steps.push_back({ layer, nullptr, input, layerInputSize, output,
+          layerOutputSize });
+      return;
+    }
+
+    // The main branch computes into the output of the block, while the input
+    // stays alive for the shortcut.
+    const std::vector<Layer<MatType>*>& branches = residual->Network();
+    PlanLayer(branches[0], input, output);
+    size_t shortcut = input;
+    if (branches.size() > 1)
+    {
+      shortcut = Acquire(layerOutputSize);
+      PlanLayer(branches[1], input, shortcut);
+    }
+
+    steps.push_back({ layer, residual, shortcut, layerOutputSize, output,
+        layerOutputSize });
+    if (shortcut != input)
+      Release(shortcut);
+  }
+
+  /**
+   * Get a free buffer of the arena for a tensor of the given size, growing
+   * a free buffer or adding one if needed.
+   *
+   * @param size Number of elements of the tensor per input.
+   * @return Buffer now holding the tensor.
+   */
+  size_t Acquire(const size_t size)
+  {
+    // Prefer the smallest free buffer that is large enough, then the largest
+    // free one.
+    size_t best = bufferSizes.size();
+    for (size_t i = 0; i < bufferSizes.size(); i++)
+    {
+      if (!available[i])
+        continue;
+
+      if (best == bufferSizes.size())
+      {
+        best = i;
+        continue;
+      }
+
+      const bool fits = (bufferSizes[i] >= size);
+      const bool bestFits = (bufferSizes[best] >= size);
+      if ((fits && (!bestFits || bufferSizes[i] < bufferSizes[best])) ||
+          (!fits && !bestFits && bufferSizes[i] > bufferSizes[best]))
+        best = i;
+    }
+
+    if (best == bufferSizes.size())
+    {
+      bufferSizes.push_back(0);
+      available.push_back(true);
+    }
+
+    bufferSizes[best] = std::max(bufferSizes[best], size);
+    available[best] = false;
+    return best + FirstBuffer;
+  }
+
+  //! Mark the given buffer of the arena as free.
+  void Release(const size_t buffer) { available[buffer - FirstBuffer] = true; }
+
+  //! Get the matrix of the given buffer, with the given number of rows.
+  MatType Alias(const size_t buffer,
+                const size_t rows,
+                const size_t cols,
+                const MatType& input,
+                MatType& output)
+  {
+    if (buffer == Input)
+    {
+      return MatType(const_cast<MatType&>(input).memptr(), rows, cols, false,
+          true);
+    }
+    else if (buffer == Output)
+    {
+      return MatType(output.memptr(), rows, cols, false, true);
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < buffer - FirstBuffer; i++)
+      offset += bufferSizes[i];
+
+    return MatType(arena.memptr() + offset * batchSize, rows, cols, false,
+        true);
+  }
+
+  //! Locally stored planned steps, in the order they are run.
+  std::vector<Step> steps;
+
+  //! Locally stored number of elements of every buffer per input.
+  std::vector<size_t> bufferSizes;
+
+  //! Locally stored whether every buffer is free, only while planning.
+  std::vector<bool> available;
+
+  //! Locally stored number of rows of the input of the network.
+  size_t inputSize;
+
+  //! Locally stored number of rows of the output of the network.
+  size_t outputSize;
+
+  //! Locally stored number of inputs the arena has room for.
+  size_t batchSize;
+
+  //! Locally stored arena of all buffers.
+  MatType arena;
+}; // MemoryPlannerType class.
+
+// Standard MemoryPlanner.
+typedef MemoryPlannerType<arma::mat> MemoryPlanner;
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,355 @@
+/**
+ * @file mixed_precision.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of MixedPrecision, which trains a network computing in single
+ * precision with master weights in double precision and loss scaling.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_COMMON_MIXED_PRECISION_HPP
+#define MODELS_MODELS_COMMON_MIXED_PRECISION_HPP
+
+#include <mlpack.hpp>
+#include "batch_norm_statistics.hpp"
+#include <memory>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Output layer that multiplies the loss of the given output layer, and so
+ * all gradients of the network, by a scale.
+ *
+ * @tparam OutputLayerType The output layer type being scaled.
+ */
+template<typename OutputLayerType>
+class LossScaling
+{
+ public:
+  //! Create the LossScaling object with a scale of 1.
+  LossScaling() : scale(1.0)
+  {
+    // Nothing to do here.
+  }
+
+  //! Get the scaled loss of the given predictions.
+  template<typename MatType>
+  typename MatType::elem_type Forward(const MatType& prediction,
+                                      const MatType& target)
+  {
+    return typename MatType::elem_type(scale) *
+        outputLayer.Forward(prediction, target);
+  }
+
+  //! Get the scaled gradient of the loss of the given predictions.
+  template<typename MatType>
+  void Backward(const MatType& prediction,
+                const MatType& target,
+                MatType& loss)
+  {
+    outputLayer.Backward(prediction, target, loss);
+    loss *= typename MatType::elem_type(scale);
+  }
+
+  //! Get the scale of the loss.
+  double Scale() const { return scale; }
+  //! Modify the scale of the loss.
+  double& Scale() { return scale; }
+
+  //! Get the output layer being scaled.
+  const OutputLayerType& OutputLayer() const { return outputLayer; }
+  //! Modify the output layer being scaled.
+  OutputLayerType& OutputLayer() { return outputLayer; }
+
+  //! Serialize the layer.
+  template<typename Archive>
+  void serialize(Archive& ar, const uint32_t /* version */)
+  {
+    ar(CEREAL_NVP(outputLayer));
+    ar(CEREAL_NVP(scale));
+  }
+
+ private:
+  //! Locally stored output layer being scaled.
+  OutputLayerType outputLayer;
+
+  //! Locally stored scale of the loss.
+  double scale;
+}; // class LossScaling
+
+/**
+ * Mixed-precision training. The forward and backward passes of the network
+ * run in single precision, which halves the memory and bandwidth of the
+ * activations held for the backward pass, while the optimizer updates master
+ * weights in double precision, so small updates aren't lost to rounding and
+ * the state of the optimizer, e.g. the moments of Adam, keeps full precision.
+ * Before every batch the master weights are rounded into the network.
+ *
+ * Small gradients underflow in single precision, so the loss is multiplied
+ * by a scale before the backward pass and the gradients are divided by it
+ * in double precision. The scale is dynamic: when a gradient overflows, the
+ * scale is halved and the gradient of the batch is computed again, so the
+ * optimizer never steps with an overflowed gradient, and after the given
+ * number of steps without overflow the scale is doubled. A batch computed
+ * again updates the running statistics of batch normalization twice.
+ *
+ * The network is trained on copies of its layers; its weights are set to the
+ * trained master weights, and its batch normalization statistics to those of
+ * the copies, by Train().
+ *
+ * @code
+ * VGGType<arma::fmat, 19> vgg(1000);
+ * FFN<CrossEntropyError, RandomInitialization, arma::fmat>* model =
+ *     vgg.GetModel();
+ * MixedPrecision<CrossEntropyError> mixed(*model);
+ * ens::Adam optimizer(1e-4, 32);
+ * mixed.Train(trainX, trainY, optimizer, ens::PrintLoss());
+ * @endcode
+ *
+ * @tparam OutputLayerType The output layer type of the network.
+ * @tparam InitializationRuleType Rule used to initialize the weights.
+ * @tparam MatType Matrix representation the network computes with.
+ * @tparam MasterMatType Matrix representation of the master weights.
+ */
+template<
+  typename OutputLayerType = NegativeLogLikelihood,
+  typename InitializationRuleType = RandomInitialization,
+  typename MatType = arma::fmat,
+  typename MasterMatType = arma::mat
+>
+class MixedPrecision
+{
+ public:
+  //! Type of the network being trained.
+  typedef FFN<OutputLayerType, InitializationRuleType, MatType> NetworkType;
+
+  //! Type of the network computing the scaled loss.
+  typedef FFN<LossScaling<OutputLayerType>, InitializationRuleType, MatType>
+      ScaledNetworkType;
+
+  /**
+   * Create the MixedPrecision object for the given network.
+   *
+   * @param network Network to train; its input dimensions must be set.
+   * @param lossScale Initial scale of the loss.
+   * @param growthInterval Number of steps without overflow after which the
+   *     scale is doubled.
+   */
+  MixedPrecision(NetworkType& network,
+                 const double lossScale = 65536.0,
+                 const size_t growthInterval = 2000) :
+      network(network),
+      lossScale(lossScale),
+      growthInterval(growthInterval),
+      steps(0),
+      overflows(0),
+      predictors(nullptr),
+      responses(nullptr)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Trains the network on the given data with the given optimizer, which
+   * updates the master weights; see FFN::Train().
+   *
+   * @param predictors Input training variables.
+   * @param responses Outputs results from input training variables.
+   * @param optimizer Instantiated ensmallen optimizer.
+   * @param callbacks Callback functions for the ensmallen optimizer.
+   * @return The final objective of the trained model.
+   */
+  template<typename OptimizerType, typename... CallbackTypes>
+  double Train(const MatType& predictors,
+               const MatType& responses,
+               OptimizerType& optimizer,
+               CallbackTypes&&... callbacks)
+  {
+    this->predictors = &predictors;
+    this->responses = &responses;
+    order = arma::regspace<arma::uvec>(0, predictors.n_cols - 1);
+
+    if (network.Parameters().is_empty())
+      network.Reset();
+
+    scaled.reset(new ScaledNetworkType());
+    for (Layer<MatType>* layer : network.Network())
+      scaled->Add(layer->Clone());
+    scaled->InputDimensions() = network.InputDimensions();
+    scaled->Reset();
+    BatchNormStatistics::Copy(network.Network(), scaled->Network());
+    scaled->SetNetworkMode(true);
+
+    MasterMatType master =
+        arma::conv_to<MasterMatType>::from(network.Parameters());
+    const double objective = optimizer.Optimize(*this, master, callbacks...);
+
+    // The layers of the network alias its parameters, so they are copied in
+    // place.
+    Round(master, network.Parameters());
+    BatchNormStatistics::Copy(scaled->Network(), network.Network());
+    scaled.reset();
+    this->predictors = nullptr;
+    this->responses = nullptr;
+    return objective;
+  }
+
+  /**
+   * Evaluates the loss of the given batch.
+   *
+   * @param parameters Master weights of the network.
+   * @param begin Index of the first input of the batch.
+   * @param batchSize Number of inputs of the batch.
+   */
+  double Evaluate(const MasterMatType& parameters,
+                  const size_t begin,
+                  const size_t batchSize)
+  {
+    MatType inputs, targets;
+    Batch(begin, batchSize, inputs, targets);
+    Round(parameters, scaled->Parameters());
+
+    scaled->OutputLayer().Scale() = 1.0;
+    return scaled->Evaluate(inputs, targets);
+  }
+
+  /**
+   * Evaluates the loss and the gradient of the given batch with the scaled
+   * loss. While the gradient overflows, the scale is halved and the gradient
+   * computed again.
+   *
+   * @param parameters Master weights of the network.
+   * @param begin Index of the first input of the batch.
+   * @param gradient Resulting gradient of the master weights.
+   * @param batchSize Number of inputs of the batch.
+   */
+  double EvaluateWithGradient(const MasterMatType& parameters,
+                              const size_t begin,
+                              MasterMatType& gradient,
+                              const size_t batchSize)
+  {
+    MatType inputs, targets, outputs;
+    Batch(begin, batchSize, inputs, targets);
+    Round(parameters, scaled->Parameters());
+
+    double loss;
+    while (true)
+    {
+      scaled->OutputLayer().Scale() = lossScale;
+      scaled->Forward(inputs, outputs);
+      loss = scaled->Backward(inputs, targets, scaledGradient);
+      if (std::isfinite(loss) && scaledGradient.is_finite())
+        break;
+
+      if (lossScale <= 1.0)
+      {
+        mlpack::Log::Fatal << "MixedPrecision::EvaluateWithGradient(): the "
+            << "gradient isn't finite without loss scaling." << std::endl;
+      }
+
+      lossScale = std::max(lossScale / 2.0, 1.0);
+      steps = 0;
+      overflows++;
+    }
+
+    if (++steps == growthInterval)
+    {
+      lossScale *= 2.0;
+      steps = 0;
+    }
+
+    gradient = arma::conv_to<MasterMatType>::from(scaledGradient) /
+        scaled->OutputLayer().Scale();
+    return loss / scaled->OutputLayer().Scale();
+  }
+
+  /**
+   * Computes the gradient of the given batch; see EvaluateWithGradient().
+   *
+   * @param parameters Master weights of the network.
+   * @param begin Index of the first input of the batch.
+   * @param gradient Resulting gradient of the master weights.
+   * @param batchSize Number of inputs of the batch.
+   */
+  void Gradient(const MasterMatType& parameters,
+                const size_t begin,
+                MasterMatType& gradient,
+                const size_t batchSize)
+  {
+    EvaluateWithGradient(parameters, begin, gradient, batchSize);
+  }
+
+  //! Get the number of inputs being trained on.
+  size_t NumFunctions() const { return order.n_elem; }
+
+  //! Shuffle the order of the inputs.
+  void Shuffle() { order = arma::shuffle(order); }
+
+  //! Get the scale of the loss.
+  double LossScale() const { return lossScale; }
+  //! Modify the scale of the loss.
+  double& LossScale() { return lossScale; }
+
+  //! Get the number of times a gradient overflowed and was computed again.
+  size_t Overflows() const { return overflows; }
+
+ private:
+  //! Gathers the inputs of the given batch.
+  void Batch(const size_t begin,
+             const size_t batchSize,
+             MatType& inputs,
+             MatType& targets) const
+  {
+    const arma::uvec indices = order.subvec(begin, begin + batchSize - 1);
+    inputs = predictors->cols(indices);
+    targets = responses->cols(indices);
+  }
+
+  //! Rounds the master weights into the given weights, in place.
+  static void Round(const MasterMatType& master, MatType& weights)
+  {
+    typename MatType::elem_type* values = weights.memptr();
+    for (size_t i = 0; i < master.n_elem; i++)
+      values[i] = typename MatType::elem_type(master[i]);
+  }
+
+  //! Locally stored network being trained.
+  NetworkType& network;
+
+  //! Locally stored copy of the network computing the scaled loss, only
+  //! while training.
+  std::unique_ptr<ScaledNetworkType> scaled;
+
+  //! Locally stored gradient of the scaled loss.
+  MatType scaledGradient;
+
+  //! Locally stored scale of the loss.
+  double lossScale;
+
+  //! Locally stored number of steps after which the scale is doubled.
+  size_t growthInterval;
+
+  //! Locally stored number of steps since the scale last changed.
+  size_t steps;
+
+  //! Locally stored number of overflowed gradients.
+  size_t overflows;
+
+  //! Locally stored input training variables, only while training.
+  const MatType* predictors;
+
+  //! Locally stored outputs of the training variables, only while training.
+  const MatType* responses;
+
+  //! Locally stored order of the inputs.
+  arma::uvec order;
+}; // MixedPrecision class.
+
+} // namespace models
+} // namespace mlpack
+
+#endif
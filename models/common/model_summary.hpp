@@ -0,0 +1,316 @@
+/**
+ * @file model_summary.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of ModelSummary, which reports the shape, parameters, cost and
+ * activation memory of every layer of a network.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_COMMON_MODEL_SUMMARY_HPP
+#define MODELS_MODELS_COMMON_MODEL_SUMMARY_HPP
+
+#include <mlpack.hpp>
+#include <models/layers/depthwise_convolution.hpp>
+#include <models/layers/fused_convolution.hpp>
+#include <models/layers/layer_types.hpp>
+#include <boost/core/demangle.hpp>
+#include <iomanip>
+#include <typeinfo>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Static cost report of a network. The layers of the network are walked
+ * once, through all containers, with the output dimensions of every layer
+ * computed for inputs of the given dimensions; nothing is allocated and no
+ * input is passed through the network. For every layer the summary holds its
+ * output shape, its number of parameters, the multiply-accumulates of a
+ * single input and the number of elements of its output. Totals are scaled
+ * by the batch size, e.g. to pick the largest batch that fits in memory
+ * before a model is deployed.
+ *
+ * Multiply-accumulates are counted for convolutions, linear layers and batch
+ * normalization, which dominate the cost of the models; activations, pooling
+ * and merges are counted as free. Activation memory is the memory of the
+ * outputs of all layers, which FFN holds for training; MemoryPlanner needs
+ * less for inference.
+ *
+ * @code
+ * ResNet50 resnet(1000);
+ * ModelSummary summary = resnet.Summary({224, 224, 3});
+ * summary.Print(std::cout, 32);
+ * const size_t batchSize = summary.MaxBatchSize(8UL << 30);
+ * @endcode
+ */
+class ModelSummary
+{
+ public:
+  //! Cost of a single layer.
+  struct LayerSummary
+  {
+    //! Name of the layer type, e.g. "Convolution".
+    std::string name;
+    //! Number of containers the layer is nested in.
+    size_t depth;
+    //! Dimensions of the output of a single input.
+    std::vector<size_t> outputDimensions;
+    //! Number of parameters.
+    size_t parameters;
+    //! Multiply-accumulates of a single input.
+    size_t macs;
+    //! Number of elements of the output of a single input.
+    size_t activations;
+  };
+
+  /**
+   * Summarizes the given layer, usually a model, for inputs of the given
+   * dimensions.
+   *
+   * @param model Layer to summarize.
+   * @param inputDimensions Dimensions of a single input, e.g. {224, 224, 3}.
+   */
+  template<typename MatType>
+  ModelSummary(Layer<MatType>& model,
+               const std::vector<size_t>& inputDimensions) :
+      elemSize(sizeof(typename MatType::elem_type))
+  {
+    model.InputDimensions() = inputDimensions;
+    model.ComputeOutputDimensions();
+    Add(&model, 0);
+  }
+
+  /**
+   * Summarizes the layers of the given network, for inputs of its input
+   * dimensions.
+   *
+   * @param network Network to summarize.
+   */
+  template<
+    typename OutputLayerType,
+    typename InitializationRuleType,
+    typename MatType
+  >
+  ModelSummary(FFN<OutputLayerType, InitializationRuleType, MatType>& network) :
+      elemSize(sizeof(typename MatType::elem_type))
+  {
+    std::vector<size_t> dimensions = network.InputDimensions();
+    for (Layer<MatType>* layer : network.Network())
+    {
+      layer->InputDimensions() = dimensions;
+      layer->ComputeOutputDimensions();
+      dimensions = layer->OutputDimensions();
+      Add(layer, 0);
+    }
+  }
+
+  //! Get the cost of every layer, in the order of the forward pass.
+  const std::vector<LayerSummary>& Layers() const { return layers; }
+
+  //! Get the number of parameters of the network.
+  size_t Parameters() const
+  {
+    size_t parameters = 0;
+    for (const LayerSummary& layer : layers)
+      parameters += layer.parameters;
+    return parameters;
+  }
+
+  //! Get the multiply-accumulates of a batch of the given size.
+  size_t MACs(const size_t batchSize = 1) const
+  {
+    size_t macs = 0;
+    for (const LayerSummary& layer : layers)
+      macs += layer.macs;
+    return macs * batchSize;
+  }
+
+  //! Get the memory of the parameters in bytes.
+  size_t ParameterBytes() const { return Parameters() * elemSize; }
+
+  //! Get the memory of the outputs of all layers for a batch of the given
+  //! size, in bytes.
+  size_t ActivationBytes(const size_t batchSize = 1) const
+  {
+    size_t activations = 0;
+    for (const LayerSummary& layer : layers)
+      activations += layer.activations;
+    return activations * batchSize * elemSize;
+  }
+
+  //! Get the memory of the parameters and the outputs of all layers for a
+  //! batch of the given size, in bytes.
+  size_t MemoryBytes(const size_t batchSize = 1) const
+  {
+    return ParameterBytes() + ActivationBytes(batchSize);
+  }
+
+  /**
+   * Get the largest batch size whose parameters and outputs fit in the given
+   * memory.
+   *
+   * @param memoryBytes Available memory in bytes.
+   * @return Largest batch size, 0 if even a single input doesn't fit.
+   */
+  size_t MaxBatchSize(const size_t memoryBytes) const
+  {
+    const size_t perInput = ActivationBytes(1);
+    if (memoryBytes < ParameterBytes() || perInput == 0)
+      return 0;
+
+    return (memoryBytes - ParameterBytes()) / perInput;
+  }
+
+  //! Get the name of the type of the given layer, without namespaces,
+  //! template arguments and the "Type" suffix.
+  template<typename MatType>
+  static std::string LayerName(Layer<MatType>* layer)
+  {
+    std::string name = boost::core::demangle(typeid(*layer).name());
+    name = name.substr(0, name.find('<'));
+    const size_t scope = name.rfind("::");
+    if (scope != std::string::npos)
+      name = name.substr(scope + 2);
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, "Type") == 0)
+      name.resize(name.size() - 4);
+    return name;
+  }
+
+  /**
+   * Prints a table with the cost of every layer, followed by the totals for
+   * a batch of the given size.
+   *
+   * @param stream Stream to print to.
+   * @param batchSize Number of inputs of a batch.
+   */
+  void Print(std::ostream& stream, const size_t batchSize = 1) const
+  {
+    stream << std::left << std::setw(36) << "Layer" << std::setw(20)
+        << "Output shape" << std::right << std::setw(14) << "Parameters"
+        << std::setw(16) << "MACs" << std::setw(18) << "Activation bytes"
+        << std::endl;
+    for (const LayerSummary& layer : layers)
+    {
+      std::ostringstream shape;
+      for (size_t i = 0; i < layer.outputDimensions.size(); i++)
+        shape << (i == 0 ? "" : "x") << layer.outputDimensions[i];
+
+      stream << std::left << std::setw(36) << (std::string(2 * layer.depth,
+          ' ') + layer.name) << std::setw(20) << shape.str() << std::right
+          << std::setw(14) << layer.parameters << std::setw(16)
+          << layer.macs * batchSize << std::setw(18)
+          << layer.activations * batchSize * elemSize << std::endl;
+    }
+
+    stream << "Batch size: " << batchSize << std::endl
+        << "Parameters: " << Parameters() << " (" << ParameterBytes()
+        << " bytes)" << std::endl
+        << "Multiply-accumulates: " << MACs(batchSize) << std::endl
+        << "Activation memory: " << ActivationBytes(batchSize) << " bytes"
+        << std::endl;
+  }
+
+ private:
+  /**
+   * Adds the given layer, or the layers it holds if it is a container.
+   *
+   * @param layer Layer with computed output dimensions.
+   * @param depth Number of containers the layer is nested in, including the
+   *     top level one.
+   */
+  template<typename MatType>
+  void Add(Layer<MatType>* layer, const size_t depth)
+  {
+    // Top level containers, like the models themselves, only hold layers.
+    // Nested containers are listed before their layers.
+    MultiLayer<MatType>* container = dynamic_cast<MultiLayer<MatType>*>(layer);
+    if (container != nullptr && !container->Network().empty())
+    {
+      if (depth > 0)
+      {
+        layers.push_back({ LayerName(layer), depth - 1,
+            layer->OutputDimensions(), 0, 0, 0 });
+      }
+
+      for (Layer<MatType>* child : container->Network())
+        Add(child, depth + 1);
+      return;
+    }
+
+    layers.push_back({ LayerName(layer), (depth > 0) ? depth - 1 : 0,
+        layer->OutputDimensions(), layer->WeightSize(), MACs(layer),
+        Size(layer->OutputDimensions(), 0) });
+  }
+
+  //! Get the multiply-accumulates of a single input of the given layer.
+  template<typename MatType>
+  static size_t MACs(Layer<MatType>* layer)
+  {
+    const std::vector<size_t>& input = layer->InputDimensions();
+    const std::vector<size_t>& output = layer->OutputDimensions();
+    const size_t weights = layer->WeightSize();
+    const size_t area = (output.size() >= 2) ? output[0] * output[1] : 1;
+    const size_t maps = Size(output, 2);
+
+    // Every weight of a kernel is multiplied once for every output position.
+    if (DefaultConvolutionType<MatType>* convolution =
+        dynamic_cast<DefaultConvolutionType<MatType>*>(layer))
+    {
+      return convolution->KernelWidth() * convolution->KernelHeight() *
+          Size(input, 2) * maps * area;
+    }
+    else if (DefaultGroupedConvolutionType<MatType>* convolution =
+        dynamic_cast<DefaultGroupedConvolutionType<MatType>*>(layer))
+    {
+      return convolution->KernelWidth() * convolution->KernelHeight() *
+          Size(input, 2) / convolution->Groups() * maps * area;
+    }
+    else if (DepthwiseConvolutionType<MatType>* convolution =
+        dynamic_cast<DepthwiseConvolutionType<MatType>*>(layer))
+    {
+      return convolution->KernelWidth() * convolution->KernelHeight() *
+          maps * area;
+    }
+    else if (dynamic_cast<FusedConvolutionType<MatType>*>(layer) != nullptr)
+    {
+      return (weights - maps) * area;
+    }
+    else if (dynamic_cast<LinearType<MatType>*>(layer) != nullptr)
+    {
+      return weights - Size(output, 0);
+    }
+    else if (dynamic_cast<BatchNormType<MatType>*>(layer) != nullptr)
+    {
+      // A scale and a shift of every element for inference.
+      return Size(output, 0);
+    }
+
+    // Other layers with weights are assumed to use every weight once.
+    return weights;
+  }
+
+  //! Get the product of the given dimensions from the given one on.
+  static size_t Size(const std::vector<size_t>& dimensions,
+                     const size_t first)
+  {
+    size_t size = 1;
+    for (size_t i = first; i < dimensions.size(); i++)
+      size *= dimensions[i];
+    return size;
+  }
+
+  //! Locally stored cost of every layer.
+  std::vector<LayerSummary> layers;
+
+  //! Locally stored size of a single element in bytes.
+  size_t elemSize;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
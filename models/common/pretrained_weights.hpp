@@ -0,0 +1,281 @@
+/**
+ * @file pretrained_weights.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of PretrainedWeights, which loads and saves the weights of the
+ * models built on MultiLayer, and of PublishedWeights, which fetches the
+ * published weights of the models.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_COMMON_PRETRAINED_WEIGHTS_HPP
+#define MODELS_MODELS_COMMON_PRETRAINED_WEIGHTS_HPP
+
+#include <mlpack.hpp>
+#include <utils/utils.hpp>
+#include <utils/weight_cache.hpp>
+#include "batch_norm_statistics.hpp"
+#include <sstream>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * The weight files published for the models, listed in a manifest built into
+ * the code with the URL, size and CRC-32 checksum of every file. Every model
+ * fetches its pre-trained weights through the same WeightCache, so they are
+ * downloaded once into the shared cache folder and verified before they are
+ * loaded. Weights exported with SaveModel() and published elsewhere can be
+ * added to the cache with Register() before the model is built.
+ *
+ * @code
+ * PublishedWeights::Cache().Register("resnet18.bin",
+ *     "/models/resnet18.bin", size, crc32);
+ * ResNet18 resnet(1000, true, true);
+ * @endcode
+ */
+class PublishedWeights
+{
+ public:
+  //! Get the cache of the published weights, holding the built-in manifest.
+  static WeightCache& Cache()
+  {
+    static WeightCache cache = BuiltinCache();
+    return cache;
+  }
+
+  /**
+   * Returns the path of the given published weight file in the cache,
+   * downloading and verifying it first if needed.
+   *
+   * @param name Name of the file in the manifest.
+   * @param model Name of the model, for errors.
+   */
+  static std::string Fetch(const std::string& name, const std::string& model)
+  {
+    Require(name, model);
+    const std::string path = Cache().Fetch(name, false);
+    if (path.empty())
+    {
+      mlpack::Log::Fatal << "Unable to fetch the pre-trained weights " << name
+          << " of " << model << " into " << Cache().CacheFolder() << "."
+          << std::endl;
+    }
+
+    return path;
+  }
+
+  //! Returns true if the given weight file is published in the weight
+  //! format of this release.
+  static bool Available(const std::string& name)
+  {
+    return Cache().Contains(name);
+  }
+
+  /**
+   * Fails with Log::Fatal if the given weight file isn't published in the
+   * weight format of this release, so models reject unavailable weights
+   * before their layers are built.
+   *
+   * @param name Name of the file in the manifest.
+   * @param model Name of the model, for errors.
+   */
+  static void Require(const std::string& name, const std::string& model)
+  {
+    if (!Available(name))
+    {
+      mlpack::Log::Fatal << "The pre-trained weights " << name << " of "
+          << model << " aren't available in the weight format of this "
+          << "release. Export them with SaveModel() and add them with "
+          << "PublishedWeights::Cache().Register()." << std::endl;
+    }
+  }
+
+  /**
+   * Get the built-in manifest, in the format of WeightCache::LoadManifest():
+   * the name, URL, size and CRC-32 checksum of every published file. The
+   * archives published for earlier releases hold whole mlpack 3 networks,
+   * which PretrainedWeights can't read, so they aren't listed; files are
+   * listed once they are exported with SaveModel() and published.
+   */
+  static const char* Manifest()
+  {
+    return
+        "# name url size crc32 [server]\n";
+  }
+
+ private:
+  //! Creates the cache with the built-in manifest.
+  static WeightCache BuiltinCache()
+  {
+    WeightCache cache;
+    std::stringstream manifest(Manifest());
+    cache.LoadManifest(manifest, "built-in weight manifest");
+    return cache;
+  }
+};
+
+/**
+ * The weights of a model and the running statistics of its batch
+ * normalization layers, held by the model. A model is a layer, whose weights
+ * are only allocated once the network holding it is reset, so weights loaded
+ * before are kept and copied into the model by Set(), which the model calls
+ * when the network gives it its weights.
+ *
+ * The weights are stored as a single column in Armadillo's binary format:
+ * the weights of the model in the order of FFN::Parameters(), followed by
+ * the running mean and variance of every batch normalization layer.
+ *
+ * @tparam MatType Matrix representation of the model.
+ */
+template<typename MatType = arma::mat>
+class PretrainedWeights
+{
+ public:
+  //! Create the PretrainedWeights object without loaded weights.
+  PretrainedWeights()
+  {
+    // Nothing to do here.
+  }
+
+  //! Copy the loaded weights, but not the weights of the model, which belong
+  //! to the network of the copied model.
+  PretrainedWeights(const PretrainedWeights& other) : loaded(other.loaded)
+  {
+    // Nothing to do here.
+  }
+
+  //! Copy the loaded weights of the given object.
+  PretrainedWeights& operator=(const PretrainedWeights& other)
+  {
+    if (this != &other)
+    {
+      loaded = other.loaded;
+      weights.reset();
+    }
+
+    return *this;
+  }
+
+  /**
+   * Keeps the given weights of the model and copies loaded weights into
+   * them, if any.
+   *
+   * @param model Model the weights belong to.
+   * @param weightsIn Weights of the model, allocated by its network.
+   */
+  void Set(MultiLayer<MatType>& model, const MatType& weightsIn)
+  {
+    MakeAlias(weights, weightsIn, weightsIn.n_elem, 1);
+    if (!loaded.is_empty())
+      Copy(model);
+  }
+
+  /**
+   * Loads the weights of the given model from the given path. If the model
+   * has no weights yet, they are copied once its network allocates them.
+   *
+   * @param path Path of the weights.
+   * @param model Model the weights are loaded into.
+   * @return false if the weights couldn't be read.
+   */
+  bool Load(const std::string& path, MultiLayer<MatType>& model)
+  {
+    if (!Utils::PathExists(path, true) ||
+        !data::Load(path, loaded, false, false))
+    {
+      loaded.reset();
+      return false;
+    }
+
+    if (!weights.is_empty())
+      Copy(model);
+    return true;
+  }
+
+  /**
+   * Saves the weights of the given model to the given path.
+   *
+   * @param path Path of the weights.
+   * @param model Model whose weights are saved.
+   * @return false if the model has no weights or the file couldn't be
+   *     written.
+   */
+  bool Save(const std::string& path, MultiLayer<MatType>& model) const
+  {
+    if (weights.is_empty())
+    {
+      mlpack::Log::Warn << "PretrainedWeights::Save(): the model has no "
+          << "weights yet; reset the network holding it first." << std::endl;
+      return false;
+    }
+
+    std::vector<BatchNormType<MatType>*> norms;
+    BatchNormStatistics::Find(model.Network(), norms);
+    MatType stored = weights;
+    for (BatchNormType<MatType>* norm : norms)
+    {
+      stored = arma::join_cols(stored,
+          arma::vectorise(norm->TrainingMean()),
+          arma::vectorise(norm->TrainingVariance()));
+    }
+
+    return data::Save(path, stored, false, false);
+  }
+
+ private:
+  //! Copies the loaded weights into the model and forgets them.
+  void Copy(MultiLayer<MatType>& model)
+  {
+    std::vector<BatchNormType<MatType>*> norms;
+    BatchNormStatistics::Find(model.Network(), norms);
+    size_t size = weights.n_elem;
+    for (BatchNormType<MatType>* norm : norms)
+      size += 2 * Maps(*norm);
+
+    if (loaded.n_elem != size)
+    {
+      mlpack::Log::Fatal << "PretrainedWeights: " << loaded.n_elem
+          << " loaded weights don't match the " << size << " weights and "
+          << "statistics of the model." << std::endl;
+    }
+
+    // The weights alias the parameters of the network, so they are copied in
+    // place.
+    weights = loaded.rows(0, weights.n_elem - 1);
+    size_t offset = weights.n_elem;
+    for (BatchNormType<MatType>* norm : norms)
+    {
+      const size_t maps = Maps(*norm);
+      norm->TrainingMean() = loaded.rows(offset, offset + maps - 1);
+      norm->TrainingVariance() = loaded.rows(offset + maps,
+          offset + 2 * maps - 1);
+      offset += 2 * maps;
+    }
+
+    loaded.reset();
+  }
+
+  //! Get the number of maps normalized by the given layer.
+  static size_t Maps(BatchNormType<MatType>& norm)
+  {
+    size_t maps = 1;
+    for (size_t i = 2; i < norm.OutputDimensions().size(); i++)
+      maps *= norm.OutputDimensions()[i];
+    return maps;
+  }
+
+  //! Locally stored weights loaded before the model had weights.
+  MatType loaded;
+
+  //! Locally stored alias of the weights of the model.
+  MatType weights;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,522 @@
+/**
+ * @file profiler.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of Profiler, which measures the time each layer of a network
+ * takes in the forward and the backward pass.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_COMMON_PROFILER_HPP
+#define MODELS_MODELS_COMMON_PROFILER_HPP
+
+#include <mlpack.hpp>
+#include <models/common/model_summary.hpp>
+#include <models/layers/channel_concat.hpp>
+#include <chrono>
+#include <iomanip>
+
+namespace mlpack {
+namespace models {
+
+template<typename MatType>
+class ProfilerType;
+
+/**
+ * Layer that runs another layer and reports the time of every call to a
+ * Profiler. It is inserted by ProfilerType::Attach() and removed by
+ * ProfilerType::Detach(); it isn't meant to be created or serialized
+ * otherwise.
+ *
+ * @tparam MatType Matrix representation to accept as input and use for
+ *    computation.
+ */
+template<typename MatType = arma::mat>
+class ProfiledLayerType : public Layer<MatType>
+{
+ public:
+  /**
+   * Create the ProfiledLayerType object, which takes ownership of the given
+   * layer.
+   *
+   * @param layer Layer to profile.
+   * @param profiler Profiler the calls are reported to.
+   * @param id Index of the layer in the records of the profiler.
+   */
+  ProfiledLayerType(Layer<MatType>* layer,
+                    ProfilerType<MatType>* profiler,
+                    const size_t id) :
+      layer(layer),
+      profiler(profiler),
+      id(id)
+  {
+    // Layers of a network that has run already keep their shape.
+    if (!layer->InputDimensions().empty())
+    {
+      this->inputDimensions = layer->InputDimensions();
+      this->outputDimensions = layer->OutputDimensions();
+    }
+  }
+
+  //! Delete the profiled layer, unless it was released.
+  ~ProfiledLayerType() { delete layer; }
+
+  //! Create a copy of the layer, reporting to the same profiler.
+  ProfiledLayerType* Clone() const
+  {
+    return new ProfiledLayerType(layer->Clone(), profiler, id);
+  }
+
+  //! Runs the forward pass of the profiled layer.
+  void Forward(const MatType& input, MatType& output)
+  {
+    if (!profiler->Enabled())
+    {
+      layer->Forward(input, output);
+      return;
+    }
+
+    const std::chrono::steady_clock::time_point start = Now();
+    layer->Forward(input, output);
+    profiler->Report(id, ProfilerType<MatType>::Forward, start, Now(),
+        output.n_elem * sizeof(typename MatType::elem_type));
+  }
+
+  //! Runs the backward pass of the profiled layer.
+  void Backward(const MatType& input,
+                const MatType& output,
+                const MatType& gy,
+                MatType& g)
+  {
+    if (!profiler->Enabled())
+    {
+      layer->Backward(input, output, gy, g);
+      return;
+    }
+
+    const std::chrono::steady_clock::time_point start = Now();
+    layer->Backward(input, output, gy, g);
+    profiler->Report(id, ProfilerType<MatType>::Backward, start, Now(),
+        g.n_elem * sizeof(typename MatType::elem_type));
+  }
+
+  //! Computes the gradient of the weights of the profiled layer.
+  void Gradient(const MatType& input,
+                const MatType& error,
+                MatType& gradient)
+  {
+    if (!profiler->Enabled())
+    {
+      layer->Gradient(input, error, gradient);
+      return;
+    }
+
+    const std::chrono::steady_clock::time_point start = Now();
+    layer->Gradient(input, error, gradient);
+    profiler->Report(id, ProfilerType<MatType>::Gradient, start, Now(),
+        gradient.n_elem * sizeof(typename MatType::elem_type));
+  }
+
+  //! Set the weights of the profiled layer.
+  void SetWeights(const MatType& weightsIn) { layer->SetWeights(weightsIn); }
+
+  //! Get the number of weights of the profiled layer.
+  size_t WeightSize() const { return layer->WeightSize(); }
+
+  //! Initialize the weights of the profiled layer.
+  void CustomInitialize(MatType& weights, const size_t elements)
+  {
+    layer->CustomInitialize(weights, elements);
+  }
+
+  //! Get the regularization loss of the profiled layer.
+  double Loss() const { return layer->Loss(); }
+
+  //! Set whether the profiled layer is training.
+  void Training(const bool training)
+  {
+    this->training = training;
+    layer->Training(training);
+  }
+
+  //! Compute the output dimensions of the profiled layer.
+  void ComputeOutputDimensions()
+  {
+    layer->InputDimensions() = this->inputDimensions;
+    layer->ComputeOutputDimensions();
+    this->outputDimensions = layer->OutputDimensions();
+  }
+
+  //! Get the profiled layer.
+  Layer<MatType>* Profiled() const { return layer; }
+
+  //! Give up ownership of the profiled layer and return it.
+  Layer<MatType>* Release()
+  {
+    Layer<MatType>* released = layer;
+    layer = nullptr;
+    return released;
+  }
+
+ private:
+  //! Get the current time.
+  static std::chrono::steady_clock::time_point Now()
+  {
+    return std::chrono::steady_clock::now();
+  }
+
+  //! Locally stored profiled layer.
+  Layer<MatType>* layer;
+
+  //! Locally stored profiler the calls are reported to.
+  ProfilerType<MatType>* profiler;
+
+  //! Locally stored index of the layer in the records of the profiler.
+  size_t id;
+}; // ProfiledLayerType class.
+
+/**
+ * Runtime profiler of the layers of a network. Attach() replaces every layer
+ * of the network, down to the layers inside the containers the models are
+ * built of, with a ProfiledLayer that measures the wall time of its forward
+ * pass, backward pass and gradient, and the bytes of the matrix each of
+ * them produces. Calls are aggregated per layer, and optionally kept as
+ * events that WriteTrace() exports in the Chrome trace format, to be viewed
+ * in chrome://tracing or Perfetto.
+ *
+ * Nothing is measured while the profiler is disabled, and the layers cost a
+ * single check per call; the ens::ProfileTraining callback enables the
+ * profiler for a training run. Convolutions inside a ChannelConcat are
+ * profiled as one layer.
+ *
+ * @code
+ * FFN<>* model = resnet.GetModel();
+ * Profiler profiler;
+ * profiler.Attach(*model);
+ * model->Train(trainX, trainY, optimizer,
+ *     ens::ProfileTraining<Profiler>(profiler, "resnet.trace.json"));
+ * profiler.Detach();
+ * @endcode
+ *
+ * A network with a profiler attached must not be serialized, and the
+ * profiler must be detached or destroyed before the network is.
+ *
+ * @tparam MatType Matrix representation to accept as input and use for
+ *    computation.
+ */
+template<typename MatType = arma::mat>
+class ProfilerType
+{
+ public:
+  //! Kinds of calls that are measured.
+  enum Phase
+  {
+    Forward = 0,
+    Backward = 1,
+    Gradient = 2
+  };
+
+  //! Measurements of a single kind of call of a layer.
+  struct Timing
+  {
+    //! Number of calls.
+    size_t calls;
+    //! Total time in seconds.
+    double seconds;
+    //! Total bytes of the produced matrices.
+    size_t bytes;
+  };
+
+  //! Measurements of a single layer.
+  struct Record
+  {
+    //! Position of the layer in the network and name of its type, e.g.
+    //! "2.0.1 Convolution".
+    std::string name;
+    //! Measurements of every phase.
+    Timing timings[3];
+  };
+
+  /**
+   * Create a disabled ProfilerType object.
+   *
+   * @param trace Whether every call is kept as an event for WriteTrace().
+   * @param maxEvents Maximum number of kept events, later calls are only
+   *     aggregated.
+   */
+  ProfilerType(const bool trace = true, const size_t maxEvents = 1000000) :
+      enabled(false),
+      trace(trace),
+      maxEvents(maxEvents),
+      origin(std::chrono::steady_clock::now())
+  {
+    // Nothing to do here.
+  }
+
+  //! Detach the profiler from its network.
+  ~ProfilerType() { Detach(); }
+
+  //! Profilers can't be copied, their layers report to them.
+  ProfilerType(const ProfilerType&) = delete;
+  //! Profilers can't be copied, their layers report to them.
+  ProfilerType& operator=(const ProfilerType&) = delete;
+
+  /**
+   * Profiles every layer of the given network. The network must have no
+   * profiler attached.
+   *
+   * @param network Network to profile.
+   */
+  template<typename OutputLayerType, typename InitializationRuleType>
+  void Attach(FFN<OutputLayerType, InitializationRuleType, MatType>& network)
+  {
+    Attach(network.Network(), "");
+  }
+
+  //! Restores the original layers of the network.
+  void Detach()
+  {
+    for (Slot& slot : slots)
+    {
+      ProfiledLayerType<MatType>* profiled =
+          static_cast<ProfiledLayerType<MatType>*>((*slot.layers)[slot.index]);
+      (*slot.layers)[slot.index] = profiled->Release();
+      delete profiled;
+    }
+
+    slots.clear();
+  }
+
+  //! Start measuring.
+  void Enable() { enabled = true; }
+  //! Stop measuring.
+  void Disable() { enabled = false; }
+  //! Get whether calls are measured.
+  bool Enabled() const { return enabled; }
+
+  //! Discard all measurements and events.
+  void Reset()
+  {
+    for (Record& record : records)
+      for (Timing& timing : record.timings)
+        timing = Timing({ 0, 0.0, 0 });
+    events.clear();
+    origin = std::chrono::steady_clock::now();
+  }
+
+  //! Get the measurements of every layer, in the order of the network.
+  const std::vector<Record>& Records() const { return records; }
+
+  /**
+   * Records a call of a layer; called by ProfiledLayer.
+   *
+   * @param id Index of the layer.
+   * @param phase Kind of the call.
+   * @param start Time the call started.
+   * @param end Time the call ended.
+   * @param bytes Bytes of the produced matrix.
+   */
+  void Report(const size_t id,
+              const Phase phase,
+              const std::chrono::steady_clock::time_point start,
+              const std::chrono::steady_clock::time_point end,
+              const size_t bytes)
+  {
+    Timing& timing = records[id].timings[phase];
+    timing.calls++;
+    timing.seconds += std::chrono::duration<double>(end - start).count();
+    timing.bytes += bytes;
+
+    if (trace && events.size() < maxEvents)
+    {
+      events.push_back({ id, phase, Microseconds(start),
+          std::chrono::duration<double, std::micro>(end - start).count() });
+    }
+  }
+
+  /**
+   * Prints the measurements of every layer, sorted by total time.
+   *
+   * @param stream Stream to print to.
+   */
+  void Print(std::ostream& stream) const
+  {
+    double total = 0;
+    std::vector<double> seconds(records.size(), 0.0);
+    for (size_t i = 0; i < records.size(); i++)
+    {
+      for (const Timing& timing : records[i].timings)
+        seconds[i] += timing.seconds;
+      total += seconds[i];
+    }
+
+    const arma::uvec order = arma::stable_sort_index(arma::vec(seconds),
+        "descend");
+    stream << std::left << std::setw(36) << "Layer" << std::right
+        << std::setw(8) << "Calls" << std::setw(14) << "Forward ms"
+        << std::setw(14) << "Backward ms" << std::setw(14) << "Gradient ms"
+        << std::setw(10) << "Share" << std::setw(18) << "MB per call"
+        << std::endl;
+    for (size_t i = 0; i < order.n_elem; i++)
+    {
+      const Record& record = records[order[i]];
+      const Timing& forward = record.timings[Forward];
+      size_t calls = 0, bytes = 0;
+      for (const Timing& timing : record.timings)
+      {
+        calls += timing.calls;
+        bytes += timing.bytes;
+      }
+
+      stream << std::left << std::setw(36) << record.name << std::right
+          << std::setw(8) << forward.calls << std::fixed
+          << std::setprecision(3) << std::setw(14) << 1e3 * forward.seconds
+          << std::setw(14) << 1e3 * record.timings[Backward].seconds
+          << std::setw(14) << 1e3 * record.timings[Gradient].seconds
+          << std::setw(9) << std::setprecision(1) << ((total > 0) ?
+          100.0 * seconds[order[i]] / total : 0.0) << "%" << std::setw(18)
+          << std::setprecision(3) << ((calls > 0) ? bytes / 1e6 / calls : 0.0)
+          << std::endl;
+    }
+
+    stream << "Total: " << std::fixed << std::setprecision(3) << 1e3 * total
+        << " ms in " << records.size() << " layers." << std::endl;
+  }
+
+  /**
+   * Writes the kept events in the Chrome trace format. Every layer is a
+   * thread of the trace, so its calls line up.
+   *
+   * @param path Path of the trace file.
+   * @return true if the trace was written.
+   */
+  bool WriteTrace(const std::string& path) const
+  {
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+      mlpack::Log::Warn << "Unable to write trace " << path << "."
+          << std::endl;
+      return false;
+    }
+
+    const char* phases[] = { "Forward", "Backward", "Gradient" };
+    file << "{\"traceEvents\":[";
+    for (size_t i = 0; i < records.size(); i++)
+    {
+      file << (i == 0 ? "" : ",") << "{\"name\":\"thread_name\",\"ph\":\"M\","
+          << "\"pid\":0,\"tid\":" << i << ",\"args\":{\"name\":\""
+          << records[i].name << "\"}}";
+    }
+
+    file << std::fixed << std::setprecision(3);
+    for (const Event& event : events)
+    {
+      file << ",{\"name\":\"" << phases[event.phase] << "\",\"cat\":\""
+          << records[event.id].name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+          << event.id << ",\"ts\":" << event.start << ",\"dur\":"
+          << event.duration << "}";
+    }
+    file << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+
+    return bool(file);
+  }
+
+ private:
+  //! A call kept for the trace.
+  struct Event
+  {
+    //! Index of the layer.
+    size_t id;
+    //! Kind of the call.
+    Phase phase;
+    //! Start of the call in microseconds since the origin.
+    double start;
+    //! Duration of the call in microseconds.
+    double duration;
+  };
+
+  //! A replaced layer of the network.
+  struct Slot
+  {
+    //! Layers of the container the layer belongs to.
+    std::vector<Layer<MatType>*>* layers;
+    //! Position of the layer in the container.
+    size_t index;
+  };
+
+  /**
+   * Replaces the given layers with profiled layers, or their layers if they
+   * are containers.
+   *
+   * @param layers Layers of a container.
+   * @param prefix Position of the container in the network.
+   */
+  void Attach(const std::vector<Layer<MatType>*>& layers,
+              const std::string& prefix)
+  {
+    // The layers of containers are only exposed as constant, but the
+    // containers themselves aren't.
+    std::vector<Layer<MatType>*>& mutableLayers =
+        const_cast<std::vector<Layer<MatType>*>&>(layers);
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+      const std::string position = prefix + std::to_string(i);
+      MultiLayer<MatType>* container =
+          dynamic_cast<MultiLayer<MatType>*>(layers[i]);
+
+      // ChannelConcat calls the convolutions it holds directly.
+      if (container != nullptr && !container->Network().empty() &&
+          dynamic_cast<ChannelConcatType<MatType>*>(layers[i]) == nullptr)
+      {
+        Attach(container->Network(), position + ".");
+        continue;
+      }
+
+      records.push_back({ position + " " + ModelSummary::LayerName(layers[i]),
+          {} });
+      mutableLayers[i] = new ProfiledLayerType<MatType>(layers[i], this,
+          records.size() - 1);
+      slots.push_back({ &mutableLayers, i });
+    }
+  }
+
+  //! Get the microseconds of the given time since the origin.
+  double Microseconds(const std::chrono::steady_clock::time_point time) const
+  {
+    return std::chrono::duration<double, std::micro>(time - origin).count();
+  }
+
+  //! Locally stored if calls are measured.
+  bool enabled;
+
+  //! Locally stored if calls are kept as events.
+  bool trace;
+
+  //! Locally stored maximum number of kept events.
+  size_t maxEvents;
+
+  //! Locally stored time events are relative to.
+  std::chrono::steady_clock::time_point origin;
+
+  //! Locally stored measurements of every layer.
+  std::vector<Record> records;
+
+  //! Locally stored events of the trace.
+  std::vector<Event> events;
+
+  //! Locally stored replaced layers, in the order they were replaced.
+  std::vector<Slot> slots;
+}; // ProfilerType class.
+
+// Standard ProfiledLayer and Profiler.
+typedef ProfiledLayerType<arma::mat> ProfiledLayer;
+typedef ProfilerType<arma::mat> Profiler;
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * @file quantization.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of Quantization, which quantizes the fused convolutions of a
+ * network to 8-bit integers after training.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_COMMON_QUANTIZATION_HPP
+#define MODELS_MODELS_COMMON_QUANTIZATION_HPP
+
+#include <mlpack.hpp>
+#include <models/layers/fused_convolution.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Post-training quantization of the convolutions of a network. Every
+ * FusedConvolution of the network records the range of its inputs while
+ * calibration data is passed through the network, then its kernels are
+ * quantized to 8-bit integers with one scale per output map and its inputs
+ * with the recorded range. All other layers keep computing in floating
+ * point.
+ *
+ * Calibration data should be a few hundred representative inputs, e.g.
+ * images of the training set; inputs beyond the recorded range are clamped
+ * at inference time.
+ *
+ * The models return networks built of fused convolutions from
+ * GetInferenceModel(), and quantized networks from GetQuantizedModel().
+ *
+ * @code
+ * models::ResNet18 resnet;
+ * FFN<>* model = resnet.GetModel();
+ * model->Train(trainX, trainY, optimizer);
+ *
+ * FFN<>* inference = resnet.GetInferenceModel(*model);
+ * Quantization::Quantize(*inference, trainX.cols(0, 255));
+ * inference->Predict(testX, predictions);
+ * @endcode
+ */
+class Quantization
+{
+ public:
+  /**
+   * Calibrates and quantizes every fused convolution of the network.
+   *
+   * @param network Network with fused convolutions and allocated weights.
+   * @param calibrationData Inputs passed through the network to record the
+   *                        ranges of the inputs of every convolution.
+   * @param batchSize Number of inputs passed through the network at once.
+   * @return Number of quantized convolutions.
+   */
+  template<
+    typename OutputLayerType,
+    typename InitializationRuleType,
+    typename MatType
+  >
+  static size_t Quantize(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& network,
+      const MatType& calibrationData,
+      const size_t batchSize = 32)
+  {
+    std::vector<FusedConvolutionType<MatType>*> convolutions;
+    FusedConvolutions(network.Network(), convolutions);
+    if (convolutions.empty())
+    {
+      mlpack::Log::Warn << "Quantization::Quantize(): network has no fused "
+          << "convolutions, nothing is quantized." << std::endl;
+      return 0;
+    }
+
+    for (FusedConvolutionType<MatType>* convolution : convolutions)
+      convolution->Calibrate();
+
+    MatType output;
+    network.Predict(calibrationData, output, batchSize);
+
+    for (FusedConvolutionType<MatType>* convolution : convolutions)
+      convolution->Quantize();
+
+    return convolutions.size();
+  }
+
+ private:
+  //! Appends all fused convolutions of the layers, including those of
+  //! containers, in the order of the forward pass.
+  template<typename MatType>
+  static void FusedConvolutions(
+      const std::vector<Layer<MatType>*>& layers,
+      std::vector<FusedConvolutionType<MatType>*>& convolutions)
+  {
+    for (Layer<MatType>* layer : layers)
+    {
+      MultiLayer<MatType>* container =
+          dynamic_cast<MultiLayer<MatType>*>(layer);
+      FusedConvolutionType<MatType>* convolution =
+          dynamic_cast<FusedConvolutionType<MatType>*>(layer);
+      if (container != nullptr)
+        FusedConvolutions(container->Network(), convolutions);
+      else if (convolution != nullptr)
+        convolutions.push_back(convolution);
+    }
+  }
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
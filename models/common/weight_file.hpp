@@ -0,0 +1,311 @@
+/**
+ * @file weight_file.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of WeightFile class, which stores the weights of a network in a
+ * flat binary file that can be memory-mapped and shared between processes.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_COMMON_WEIGHT_FILE_HPP
+#define MODELS_MODELS_COMMON_WEIGHT_FILE_HPP
+
+#include <mlpack.hpp>
+#include <utils/mapped_file.hpp>
+#include <cstring>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * WeightFile writes the weights of a network to a single binary file and
+ * maps them back into memory. Loading the network with data::Load()
+ * deserializes the whole layer graph and copies every weight into memory of
+ * its own; here the network is built by the model constructor as usual, and
+ * its parameters, and so the weights of all its layers, alias the mapped
+ * file. Nothing is read up front, and since the mapping is copy-on-write,
+ * all processes that load the same file share its pages through the page
+ * cache until a weight is modified, e.g. by training.
+ *
+ * The file starts with a 64 byte header, followed by the parameters of the
+ * network in the order of FFN::Parameters(), so the weights are aligned to
+ * 64 bytes in the mapping. The running means and variances of batch
+ * normalization layers aren't weights; they follow the weights, and are
+ * copied when the file is loaded. Weights loaded from a file are only valid
+ * while the WeightFile object that loaded them is alive.
+ *
+ * @code
+ * FFN<> model;
+ * model.InputDimensions() = std::vector<size_t>({224, 224, 3});
+ * model.Add<ResNet50>();
+ * model.Train(trainX, trainY, optimizer);
+ * WeightFile::Save("resnet50.weights", model);
+ *
+ * // In every worker process.
+ * FFN<> inference;
+ * inference.InputDimensions() = std::vector<size_t>({224, 224, 3});
+ * inference.Add<ResNet50>();
+ *
+ * WeightFile weights;
+ * weights.Load("resnet50.weights", inference);
+ * inference.Predict(testX, predictions);
+ * @endcode
+ */
+class WeightFile
+{
+ public:
+  //! Create an empty WeightFile object.
+  WeightFile()
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Writes the parameters of the given network to the given path. The file
+   * is written under a temporary name and renamed once complete, so a weight
+   * file is never partially written.
+   *
+   * @param path Path of the weight file.
+   * @param network Network with allocated weights.
+   * @return true if the weight file was written.
+   */
+  template<
+    typename OutputLayerType,
+    typename InitializationRuleType,
+    typename MatType
+  >
+  static bool Save(
+      const std::string& path,
+      FFN<OutputLayerType, InitializationRuleType, MatType>& network)
+  {
+    typedef typename MatType::elem_type ElemType;
+
+    const MatType& parameters = network.Parameters();
+    if (parameters.n_elem == 0)
+    {
+      mlpack::Log::Warn << "WeightFile::Save(): the network has no weights "
+          << "to write to " << path << "." << std::endl;
+      return false;
+    }
+
+    const boost::filesystem::path folder =
+        boost::filesystem::path(path).parent_path();
+    if (!folder.empty())
+    {
+      boost::system::error_code error;
+      boost::filesystem::create_directories(folder, error);
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(Header));
+    std::memcpy(header.magic, Magic(), sizeof(header.magic));
+    header.elemSize = sizeof(ElemType);
+    header.weights = parameters.n_elem;
+    header.layers = network.Network().size();
+
+    std::vector<BatchNormType<MatType>*> norms;
+    BatchNorms(network.Network(), norms);
+    for (BatchNormType<MatType>* norm : norms)
+      header.statistics += 2 * norm->TrainingMean().n_elem;
+
+    const std::string temporaryPath = path + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::out | std::ios::binary |
+        std::ios::trunc);
+    if (!file.is_open())
+    {
+      mlpack::Log::Warn << "Unable to write weight file " << path << "."
+          << std::endl;
+      return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    file.write(reinterpret_cast<const char*>(parameters.memptr()),
+        parameters.n_elem * sizeof(ElemType));
+    for (BatchNormType<MatType>* norm : norms)
+    {
+      file.write(reinterpret_cast<const char*>(norm->TrainingMean().memptr()),
+          norm->TrainingMean().n_elem * sizeof(ElemType));
+      file.write(reinterpret_cast<const char*>(
+          norm->TrainingVariance().memptr()),
+          norm->TrainingVariance().n_elem * sizeof(ElemType));
+    }
+    file.close();
+
+    if (!file)
+    {
+      std::remove(temporaryPath.c_str());
+      mlpack::Log::Warn << "Unable to write weight file " << path << "."
+          << std::endl;
+      return false;
+    }
+
+    boost::system::error_code error;
+    boost::filesystem::rename(temporaryPath, path, error);
+    if (error)
+    {
+      std::remove(temporaryPath.c_str());
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Maps the weight file and makes the parameters of the given network, and
+   * the weights of all its layers, alias the mapped memory. The network must
+   * hold the same layers as the network the file was written from, and its
+   * input dimensions must be set.
+   *
+   * @param path Path of the weight file.
+   * @param network Network whose weights will alias the file.
+   * @return false if the weight file doesn't exist or doesn't match the
+   *     network.
+   */
+  template<
+    typename OutputLayerType,
+    typename InitializationRuleType,
+    typename MatType
+  >
+  bool Load(const std::string& path,
+            FFN<OutputLayerType, InitializationRuleType, MatType>& network)
+  {
+    typedef typename MatType::elem_type ElemType;
+
+    if (!boost::filesystem::exists(path) || !file.Open(path))
+      return false;
+
+    if (file.Size() < sizeof(Header))
+    {
+      file.Close();
+      return false;
+    }
+
+    // The shapes of the layers follow from the input dimensions, like in
+    // the first pass of the network.
+    const std::vector<Layer<MatType>*>& layers = network.Network();
+    std::vector<size_t> dimensions = network.InputDimensions();
+    size_t weights = 0;
+    for (Layer<MatType>* layer : layers)
+    {
+      layer->InputDimensions() = dimensions;
+      layer->ComputeOutputDimensions();
+      dimensions = layer->OutputDimensions();
+      weights += layer->WeightSize();
+    }
+
+    std::vector<BatchNormType<MatType>*> norms;
+    BatchNorms(layers, norms);
+    size_t statistics = 0;
+    for (BatchNormType<MatType>* norm : norms)
+      statistics += 2 * Size(norm->OutputDimensions(), 2);
+
+    Header header;
+    std::memcpy(&header, file.Data(), sizeof(Header));
+    if (std::memcmp(header.magic, Magic(), sizeof(header.magic)) != 0 ||
+        header.elemSize != sizeof(ElemType) ||
+        header.weights != weights ||
+        header.layers != layers.size() ||
+        header.statistics != statistics ||
+        file.Size() != sizeof(Header) + (weights + statistics) *
+            sizeof(ElemType))
+    {
+      mlpack::Log::Warn << "Weight file " << path << " doesn't match the "
+          << "network: expected " << weights << " weights of "
+          << sizeof(ElemType) << " bytes." << std::endl;
+      file.Close();
+      return false;
+    }
+
+    ElemType* memory = reinterpret_cast<ElemType*>(file.Data() +
+        sizeof(Header));
+    MatType& parameters = network.Parameters();
+    parameters.~MatType();
+    new (&parameters) MatType(memory, weights, 1, false, true);
+
+    // Layers that were already given memory by the network are moved to
+    // the mapping as well.
+    size_t offset = 0;
+    for (Layer<MatType>* layer : layers)
+    {
+      const size_t layerWeights = layer->WeightSize();
+      layer->SetWeights(MatType(memory + offset, layerWeights, 1, false,
+          true));
+      offset += layerWeights;
+    }
+
+    for (BatchNormType<MatType>* norm : norms)
+    {
+      const size_t maps = Size(norm->OutputDimensions(), 2);
+      norm->TrainingMean() = MatType(memory + offset, maps, 1);
+      norm->TrainingVariance() = MatType(memory + offset + maps, maps, 1);
+      offset += 2 * maps;
+    }
+
+    mlpack::Log::Info << "Weights mapped from " << path << "." << std::endl;
+    return true;
+  }
+
+  //! Returns true if a weight file is mapped.
+  bool IsOpen() const { return file.IsOpen(); }
+
+ private:
+  //! Appends all batch normalization layers, in the order of the forward
+  //! pass.
+  template<typename MatType>
+  static void BatchNorms(const std::vector<Layer<MatType>*>& layers,
+                         std::vector<BatchNormType<MatType>*>& norms)
+  {
+    for (Layer<MatType>* layer : layers)
+    {
+      MultiLayer<MatType>* container =
+          dynamic_cast<MultiLayer<MatType>*>(layer);
+      BatchNormType<MatType>* norm =
+          dynamic_cast<BatchNormType<MatType>*>(layer);
+      if (container != nullptr)
+        BatchNorms(container->Network(), norms);
+      else if (norm != nullptr)
+        norms.push_back(norm);
+    }
+  }
+
+  //! Get the product of the given dimensions from the given one on.
+  static size_t Size(const std::vector<size_t>& dimensions,
+                     const size_t first)
+  {
+    size_t size = 1;
+    for (size_t i = first; i < dimensions.size(); i++)
+      size *= dimensions[i];
+    return size;
+  }
+
+  //! Header stored at the beginning of the weight file.
+  struct Header
+  {
+    //! Identifies the file as a weight file.
+    char magic[8];
+    //! Size of a single weight in bytes.
+    uint64_t elemSize;
+    //! Number of weights.
+    uint64_t weights;
+    //! Number of top level layers of the network.
+    uint64_t layers;
+    //! Number of running means and variances of batch normalization.
+    uint64_t statistics;
+    //! Reserved to keep the weights aligned to 64 bytes.
+    uint64_t reserved[3];
+  };
+
+  //! Get the identifier of weight files.
+  static const char* Magic() { return "MLPKWTS1"; }
+
+  //! Locally stored mapping of the weight file.
+  MappedFile file;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -39,6 +39,13 @@
 
 #define MLPACK_ENABLE_ANN_SERIALIZATION
 #include <mlpack.hpp>
+#include <models/common/batch_norm_folding.hpp>
+#include <models/common/model_summary.hpp>
+#include <models/common/pretrained_weights.hpp>
+#include <models/common/quantization.hpp>
+#include <models/layers/fused_convolution.hpp>
+#include <models/layers/layer_types.hpp>
+#include <models/layers/residual.hpp>
 
 namespace mlpack {
 namespace models {
@@ -46,158 +53,191 @@ namespace models {
 /**
  * Definition of a DarkNet CNN.
  * 
- * @tparam OutputLayerType The output layer type used to evaluate the network.
- * @tparam InitializationRuleType Rule used to initialize the weight matrix.
- * @tparam DaknetVer Version of DarkNet.
+ * @tparam MatType Matrix representation to accept as input and use for
+ *    computation, e.g. arma::fmat for single precision.
+ * @tparam DarkNetVersion Version of DarkNet (Valid Configuration - 19, 53).
  */
 template<
-  typename OutputLayerType = CrossEntropyError<>,
-  typename InitializationRuleType = RandomInitialization,
+  typename MatType = arma::mat,
   size_t DarkNetVersion = 19
 >
-class DarkNet
+class DarkNetType : public MultiLayer<MatType>
 {
  public:
-  //! Create the DarkNet model.
-  DarkNet();
-
   /**
-   * DarkNet constructor intializes input shape and number of classes.
+   * DarkNetType constructor intializes number of classes and weights.
    *
-   * @param inputChannels Number of input channels of the input image.
-   * @param inputWidth Width of the input image.
-   * @param inputHeight Height of the input image.
-   * @param numClasses Optional number of classes to classify images into,
-   *     only to be specified if includeTop is  true.
-   * @param weights One of 'none', 'imagenet'(pre-training on ImageNet) or path to weights.
-   * @param includeTop Must be set to true if weights are set.
+   * @param numClasses Number of classes to classify images into,
+   *     only to be specified if includeTop is true.
+   * @param weights One of 'none', 'imagenet'(pre-training on ImageNet,
+   *     fetched through PublishedWeights) or path to weights, which are
+   *     copied into the model once the network holding it is reset; see
+   *     LoadModel().
+   * @param includeTop Must be set to true if classifier layers are set, and
+   *     if weights are set.
+   * @param fused Whether every convolution, its batch normalization and its
+   *     LeakyReLU are computed by a single FusedConvolution layer, which is
+   *     faster for inference. Use GetInferenceModel() to get the weights of
+   *     a trained network.
    */
-  DarkNet(const size_t inputChannel,
-          const size_t inputWidth,
-          const size_t inputHeight,
-          const size_t numClasses = 1000,
-          const std::string& weights = "none",
-          const bool includeTop = true);
+  DarkNetType(const size_t numClasses = 1000,
+              const std::string& weights = "none",
+              const bool includeTop = true,
+              const bool fused = false);
+
+  //! Copy the given DarkNetType.
+  DarkNetType(const DarkNetType& other);
+  //! Take ownership of the layers of the given DarkNetType.
+  DarkNetType(DarkNetType&& other);
+  //! Copy the given DarkNetType.
+  DarkNetType& operator=(const DarkNetType& other);
+  //! Take ownership of the given DarkNetType.
+  DarkNetType& operator=(DarkNetType&& other);
+
+  //! Virtual destructor: delete all held layers.
+  virtual ~DarkNetType()
+  { /* Nothing to do here. */ }
+
+  //! Create a copy of the DarkNetType (this is safe for polymorphic use).
+  DarkNetType* Clone() const { return new DarkNetType(*this); }
 
   /**
-   * DarkNet constructor intializes input shape and number of classes.
-   *
-   * @param inputShape A three-valued tuple indicating input shape.
-   *     First value is number of channels (channels-first).
-   *     Second value is input height. Third value is input width.
-   * @param numClasses Optional number of classes to classify images into,
-   *     only to be specified if includeTop is  true.
-   * @param weights One of 'none', 'imagenet'(pre-training on ImageNet) or path to weights.
+   * Get the FFN object representing the network.
+   * 
+   * NOTE: The caller is responsible for deleting the returned object.
+   * 
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
    */
-  DarkNet(const std::tuple<size_t, size_t, size_t> inputShape,
-          const size_t numClasses = 1000,
-          const std::string& weights = "none",
-          const bool includeTop = true);
-
-  //! Get Layers of the model.
-  FFN<OutputLayerType, InitializationRuleType>& GetModel()
+  template<
+    typename OutputLayerType = CrossEntropyError,
+    typename InitializationRuleType = RandomInitialization
+  >
+  FFN<OutputLayerType, InitializationRuleType, MatType>* GetModel()
   {
+    FFN<OutputLayerType, InitializationRuleType, MatType>* darkNet =
+        new FFN<OutputLayerType, InitializationRuleType, MatType>();
+    darkNet->Add(this);
     return darkNet;
   }
 
-  //! Load weights into the model.
-  void LoadModel(const std::string& filePath);
-
-  //! Save weights for the model.
-  void SaveModel(const std::string& filePath);
+  /**
+   * Get the output shape, parameters, multiply-accumulates and activation
+   * memory of every layer of the network for inputs of the given dimensions,
+   * without passing any input through it; see ModelSummary.
+   *
+   * @param inputDimensions Dimensions of a single input, e.g. {224, 224, 3}.
+   */
+  ModelSummary Summary(const std::vector<size_t>& inputDimensions)
+  {
+    return ModelSummary(*this, inputDimensions);
+  }
 
- private:
   /**
-   * Adds Convolution Block.
+   * Get an FFN object for inference with the weights of the given trained
+   * network, which holds this DarkNetType. Batch normalization layers are
+   * folded into the convolutions before them, and LeakyReLU layers that
+   * follow a convolution are applied by it, so the returned network is a
+   * fused DarkNetType.
    *
-   * @tparam SequentialType Layer type in which convolution block will
-   *     be added.
+   * NOTE: The caller is responsible for deleting the returned object.
    *
-   * @param inSize Number of input maps.
-   * @param outSize Number of output maps.
-   * @param kernelWidth Width of the filter/kernel.
-   * @param kernelHeight Height of the filter/kernel.
-   * @param strideWidth Stride of filter application in the x direction.
-   * @param strideHeight Stride of filter application in the y direction.
-   * @param padW Padding width of the input.
-   * @param padH Padding height of the input.
-   * @param batchNorm Boolean to determine whether a batch normalization
-   *     layer is added.
-   * @param negativeSlope Negative slope hyper-parameter for LeakyReLU.
-   * @param baseLayer Layer in which Convolution block will be added, if
-   *                  NULL added to darkNet FFN.
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
+   *
+   * @param trained Trained network returned by GetModel().
    */
-  template<typename SequentialType = Sequential<>>
-  void ConvolutionBlock(const size_t inSize,
-                        const size_t outSize,
-                        const size_t kernelWidth,
-                        const size_t kernelHeight,
-                        const size_t strideWidth = 1,
-                        const size_t strideHeight = 1,
-                        const size_t padW = 0,
-                        const size_t padH = 0,
-                        const bool batchNorm = true,
-                        const double negativeSlope = 1e-1,
-                        SequentialType* baseLayer = NULL)
+  template<typename OutputLayerType, typename InitializationRuleType>
+  FFN<OutputLayerType, InitializationRuleType, MatType>* GetInferenceModel(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& trained) const
   {
-    Sequential<>* bottleNeck = new Sequential<>();
-    bottleNeck->Add(new Convolution<>(inSize, outSize, kernelWidth,
-        kernelHeight, strideWidth, strideHeight, padW, padH, inputWidth,
-        inputHeight));
+    FFN<OutputLayerType, InitializationRuleType, MatType>* darkNet =
+        new FFN<OutputLayerType, InitializationRuleType, MatType>();
+    darkNet->Add(new DarkNetType(numClasses, "none", includeTop, true));
+    BatchNormFolding::Fold(trained, *darkNet);
+    return darkNet;
+  }
 
-    // Update inputWidth and input Height.
-    mlpack::Log::Info << "Conv Layer.  ";
-    mlpack::Log::Info << "(" << inputWidth << ", " << inputHeight <<
-        ", " << inSize << ") ----> ";
+  /**
+   * Get an FFN object for inference with the weights of the given trained
+   * network, whose convolutions compute with 8-bit integers. The network of
+   * GetInferenceModel() is quantized with the ranges of the inputs of
+   * every convolution recorded on the calibration data.
+   *
+   * NOTE: The caller is responsible for deleting the returned object.
+   *
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
+   *
+   * @param trained Trained network returned by GetModel().
+   * @param calibrationData Representative inputs, one input per column.
+   */
+  template<typename OutputLayerType, typename InitializationRuleType>
+  FFN<OutputLayerType, InitializationRuleType, MatType>* GetQuantizedModel(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& trained,
+      const MatType& calibrationData) const
+  {
+    FFN<OutputLayerType, InitializationRuleType, MatType>* darkNet =
+        GetInferenceModel(trained);
+    Quantization::Quantize(*darkNet, calibrationData);
+    return darkNet;
+  }
 
-    inputWidth = ConvOutSize(inputWidth, kernelWidth, strideWidth, padW);
-    inputHeight = ConvOutSize(inputHeight, kernelHeight, strideHeight, padH);
-    mlpack::Log::Info << "(" << inputWidth << ", " << inputHeight <<
-        ", " << outSize << ")" << std::endl;
+  /**
+   * Set the weights of the layers of the network to the given weights, and
+   * copy weights loaded by LoadModel() into them.
+   *
+   * @param weightsIn Weights of the network, allocated by the FFN.
+   */
+  void SetWeights(const MatType& weightsIn)
+  {
+    MultiLayer<MatType>::SetWeights(weightsIn);
+    preTrainedWeights.Set(*this, weightsIn);
+  }
 
-    if (batchNorm)
-      bottleNeck->Add(new BatchNorm<>(outSize, 1e-5, false));
+  /**
+   * Load the weights and batch normalization statistics of the model, as
+   * saved by SaveModel(). If the network holding the model isn't reset yet,
+   * they are copied into the model once it is.
+   *
+   * @param filePath Path of the weights.
+   */
+  void LoadModel(const std::string& filePath);
 
-    bottleNeck->Add(new LeakyReLU<>(negativeSlope));
+  /**
+   * Save the weights and batch normalization statistics of the model, which
+   * must be held by a reset network.
+   *
+   * @param filePath Path of the weights.
+   */
+  void SaveModel(const std::string& filePath);
 
-    if (baseLayer != NULL)
-      baseLayer->Add(bottleNeck);
-    else
-      darkNet.Add(bottleNeck);
-  }
+  //! Serialize the DarkNetType.
+  template<typename Archive>
+  void serialize(Archive& ar, const uint32_t /* version */);
 
+ private:
   /**
-   * Adds Pooling Block.
+   * Adds a convolution followed by batch normalization and LeakyReLU. If the
+   * network is fused, a single FusedConvolution is added instead.
    *
-   * @param factor The factor by which input dimensions will be divided.
-   * @param type One of "max" or "mean". Determines whether add mean pooling
-   *     layer or max pooling layer.
+   * @param block Block the layers are added to.
+   * @param maps Number of output maps.
+   * @param kernelSize Width and height of the kernel.
+   * @param stride Stride in both directions.
+   * @param padding Padding in both directions.
+   * @param negativeSlope Negative slope hyper-parameter for LeakyReLU.
    */
-  void PoolingBlock(const size_t factor = 2,
-                    const std::string type = "max")
-  {
-    if (type == "max")
-    {
-      darkNet.Add(new AdaptiveMaxPooling<>(
-          std::ceil(inputWidth * 1.0 / factor),
-          std::ceil(inputHeight * 1.0 / factor)));
-    }
-    else
-    {
-      darkNet.Add(new AdaptiveMeanPooling<>(std::ceil(inputWidth * 1.0 /
-          factor), std::ceil(inputHeight * 1.0 / factor)));
-    }
+  void ConvolutionBlock(MultiLayer<MatType>* block,
+                        const size_t maps,
+                        const size_t kernelSize,
+                        const size_t stride = 1,
+                        const size_t padding = 0,
+                        const double negativeSlope = 1e-1);
 
-    mlpack::Log::Info << "Pooling Layer.  ";
-    mlpack::Log::Info << "(" << inputWidth << ", " << inputHeight <<
-        ") ----> ";
-
-    // Update inputWidth and inputHeight.
-    inputWidth = std::ceil(inputWidth * 1.0 / factor);
-    inputHeight = std::ceil(inputHeight * 1.0 / factor);
-    mlpack::Log::Info << "(" << inputWidth << ", " << inputHeight <<
-        ")" << std::endl;
-  }
+  //! Adds max pooling that halves the width and height of the input.
+  void PoolingBlock() { this->template Add<MaxPoolingType<MatType>>(
+      2, 2, 2, 2, false); }
 
   /**
    * Adds bottleneck block for DarkNet 19.
@@ -210,96 +250,46 @@ class DarkNet
    * ConvolutionLayer(inputChannel, inputChannel * 2, stride)
    *
    * @param inputChannel Input channel in the convolution block.
-   * @param kernelWidth Width of the filter/kernel.
-   * @param kernelHeight Height of the filter/kernel.
-   * @param padWidth Padding in convolutional layer.
-   * @param padHeight Padding in convolutional layer.
    */
-  void DarkNet19SequentialBlock(const size_t inputChannel,
-                                const size_t kernelWidth,
-                                const size_t kernelHeight,
-                                const size_t padWidth,
-                                const size_t padHeight)
-  {
-    ConvolutionBlock(inputChannel, inputChannel * 2,
-        kernelWidth, kernelHeight, 1, 1, padWidth, padHeight, true);
-    ConvolutionBlock(inputChannel * 2, inputChannel,
-        1, 1, 1, 1, 0, 0, true);
-    ConvolutionBlock(inputChannel, inputChannel * 2,
-        kernelWidth, kernelHeight, 1, 1, padWidth, padHeight, true);
-  }
+  void DarkNet19SequentialBlock(const size_t inputChannel);
 
   /**
    * Adds residual bottleneck block for DarkNet 53.
    *
    * @param inputChannel Input channel in the bottle-neck.
-   * @param kernelWidth Width of the filter/kernel.
-   * @param kernelHeight Height of the filter/kernel.
-   * @param padWidth Padding in convolutional layer.
-   * @param padHeight Padding in convolutional layer.
    */
-  void DarkNet53ResidualBlock(const size_t inputChannel,
-                              const size_t kernelWidth = 3,
-                              const size_t kernelHeight = 3,
-                              const size_t padWidth = 1,
-                              const size_t padHeight = 1)
-  {
-    mlpack::Log::Info << "Residual Block Begin." << std::endl;
-    Residual<>* residualBlock = new Residual<>();
-    ConvolutionBlock(inputChannel, inputChannel / 2,
-        1, 1, 1, 1, 0, 0, true, 1e-2, residualBlock);
-    ConvolutionBlock(inputChannel / 2, inputChannel, kernelWidth,
-        kernelHeight, 1, 1, padWidth, padHeight, true, 1e-2, residualBlock);
-    darkNet.Add(residualBlock);
-    mlpack::Log::Info << "Residual Block end." << std::endl;
-  }
-
-  /**
-   * Return the convolution output size.
-   *
-   * @param size The size of the input (row or column).
-   * @param k The size of the filter (width or height).
-   * @param s The stride size (x or y direction).
-   * @param padding The size of the padding (width or height) on one side.
-   * @return The convolution output size.
-   */
-  size_t ConvOutSize(const size_t size,
-                     const size_t k,
-                     const size_t s,
-                     const size_t padding)
-  {
-    return std::floor(size + 2 * padding - k) / s + 1;
-  }
+  void DarkNet53ResidualBlock(const size_t inputChannel);
 
-  //! Locally stored DarkNet Model.
-  FFN<OutputLayerType, InitializationRuleType> darkNet;
-
-  //! Locally stored width of the image.
-  size_t inputWidth;
-
-  //! Locally stored height of the image.
-  size_t inputHeight;
-
-  //! Locally stored number of channels in the image.
-  size_t inputChannel;
+  //! Generate the layers of the DarkNet.
+  void MakeModel();
 
   //! Locally stored number of output classes.
   size_t numClasses;
 
-  //! Locally stored type of pre-trained weights.
-  std::string weights;
-}; // DarkNet class.
+  //! Locally stored if classifier layers are included or not.
+  bool includeTop;
 
-// Convenience typedefs for different DarkNet models.
-typedef DarkNet<CrossEntropyError<>, RandomInitialization, 19>
-    DarkNet19;
+  //! Locally stored if convolutions and activations are fused.
+  bool fused;
 
-typedef DarkNet<CrossEntropyError<>, RandomInitialization, 53>
-    DarkNet53;
+  //! Locally stored pre-trained weights, until they are copied into the
+  //! model.
+  PretrainedWeights<MatType> preTrainedWeights;
+}; // DarkNetType class.
+
+// Convenience typedefs for different DarkNet models.
+typedef DarkNetType<arma::mat, 19> DarkNet19;
+typedef DarkNetType<arma::mat, 53> DarkNet53;
 
 } // namespace models
 } // namespace mlpack
 
+CEREAL_REGISTER_TYPE(mlpack::models::DarkNetType<arma::mat, 19>);
+CEREAL_REGISTER_TYPE(mlpack::models::DarkNetType<arma::mat, 53>);
+CEREAL_TEMPLATE_CLASS_VERSION(
+    (template<typename MatType, size_t DarkNetVersion>),
+    (mlpack::models::DarkNetType<MatType, DarkNetVersion>), (1));
+
 # include "darknet_impl.hpp"
 
 #endif
@@ -17,114 +17,204 @@
 namespace mlpack {
 namespace models {
 
-template<
-     typename OutputLayerType,
-     typename InitializationRuleType,
-     size_t DarkNetVersion
->
-DarkNet<OutputLayerType, InitializationRuleType, DarkNetVersion>::DarkNet() :
-    inputWidth(0),
-    inputHeight(0),
-    inputChannel(0),
-    numClasses(0),
-    weights("none")
+template<typename MatType, size_t DarkNetVersion>
+DarkNetType<MatType, DarkNetVersion>::DarkNetType(
+    const size_t numClasses,
+    const std::string& weights,
+    const bool includeTop,
+    const bool fused) :
+    MultiLayer<MatType>(),
+    numClasses(numClasses),
+    includeTop(includeTop),
+    fused(fused)
+{
+  // Unavailable weights are rejected before the layers are built.
+  const std::string name = "darknet" + std::to_string(DarkNetVersion) +
+      "_imagenet.bin";
+  if (weights == "imagenet")
+    PublishedWeights::Require(name, "DarkNet");
+
+  MakeModel();
+
+  if (weights == "imagenet")
+  {
+    LoadModel(PublishedWeights::Fetch(name, "DarkNet"));
+  }
+  else if (weights != "none")
+  {
+    LoadModel(weights);
+  }
+}
+
+template<typename MatType, size_t DarkNetVersion>
+DarkNetType<MatType, DarkNetVersion>::DarkNetType(const DarkNetType& other) :
+    MultiLayer<MatType>(other),
+    numClasses(other.numClasses),
+    includeTop(other.includeTop),
+    fused(other.fused),
+    preTrainedWeights(other.preTrainedWeights)
 {
   // Nothing to do here.
 }
 
-template<
-     typename OutputLayerType,
-     typename InitializationRuleType,
-     size_t DarkNetVersion
->
-DarkNet<OutputLayerType, InitializationRuleType, DarkNetVersion>::DarkNet(
-  const size_t inputChannel,
-  const size_t inputWidth,
-  const size_t inputHeight,
-  const size_t numClasses,
-  const std::string& weights,
-  const bool includeTop) :
-  DarkNet<OutputLayerType, InitializationRuleType, DarkNetVersion>(
-    std::tuple<size_t, size_t, size_t>(
-      inputChannel,
-      inputWidth,
-      inputHeight),
-      numClasses,
-      weights,
-      includeTop)
+template<typename MatType, size_t DarkNetVersion>
+DarkNetType<MatType, DarkNetVersion>::DarkNetType(DarkNetType&& other) :
+    MultiLayer<MatType>(std::move(other)),
+    numClasses(std::move(other.numClasses)),
+    includeTop(std::move(other.includeTop)),
+    fused(std::move(other.fused)),
+    preTrainedWeights(other.preTrainedWeights)
 {
   // Nothing to do here.
 }
 
-template<
-     typename OutputLayerType,
-     typename InitializationRuleType,
-     size_t DarkNetVersion
->
-DarkNet<OutputLayerType, InitializationRuleType, DarkNetVersion>::DarkNet(
-    const std::tuple<size_t, size_t, size_t> inputShape,
-    const size_t numClasses,
-    const std::string& weights,
-    const bool includeTop) :
-    inputWidth(std::get<1>(inputShape)),
-    inputHeight(std::get<2>(inputShape)),
-    inputChannel(std::get<0>(inputShape)),
-    numClasses(numClasses),
-    weights(weights)
+template<typename MatType, size_t DarkNetVersion>
+DarkNetType<MatType, DarkNetVersion>&
+DarkNetType<MatType, DarkNetVersion>::operator=(const DarkNetType& other)
 {
-  mlpack::Log::Assert(DarkNetVersion == 19 || DarkNetVersion == 53,
-      "Incorrect DarkNet version. Possible values are 19 and 53. \
-      Trying to find version : " + std::to_string(DarkNetVersion) + ".");
+  if (this != &other)
+  {
+    MultiLayer<MatType>::operator=(other);
+    numClasses = other.numClasses;
+    includeTop = other.includeTop;
+    fused = other.fused;
+    preTrainedWeights = other.preTrainedWeights;
+  }
 
-  if (weights == "imagenet")
+  return *this;
+}
+
+template<typename MatType, size_t DarkNetVersion>
+DarkNetType<MatType, DarkNetVersion>&
+DarkNetType<MatType, DarkNetVersion>::operator=(DarkNetType&& other)
+{
+  if (this != &other)
   {
-    // Download weights here.
-    LoadModel("./../weights/darknet/darknet" + std::to_string(DarkNetVersion) +
-        "_imagenet.bin");
-    return;
+    MultiLayer<MatType>::operator=(std::move(other));
+    numClasses = std::move(other.numClasses);
+    includeTop = std::move(other.includeTop);
+    fused = std::move(other.fused);
+    preTrainedWeights = other.preTrainedWeights;
   }
-  else if (weights != "none")
+
+  return *this;
+}
+
+template<typename MatType, size_t DarkNetVersion>
+void DarkNetType<MatType, DarkNetVersion>::LoadModel(
+    const std::string& filePath)
+{
+  if (!preTrainedWeights.Load(filePath, *this))
   {
-    LoadModel(weights);
+    mlpack::Log::Fatal << "Unable to load the weights of DarkNet from "
+        << filePath << "." << std::endl;
+  }
+
+  Log::Info << "Loaded model" << std::endl;
+}
+
+template<typename MatType, size_t DarkNetVersion>
+void DarkNetType<MatType, DarkNetVersion>::SaveModel(
+    const std::string& filePath)
+{
+  Log::Info << "Saving model." << std::endl;
+  if (preTrainedWeights.Save(filePath, *this))
+    Log::Info << "Model saved in " << filePath << "." << std::endl;
+}
+
+template<typename MatType, size_t DarkNetVersion>
+template<typename Archive>
+void DarkNetType<MatType, DarkNetVersion>::serialize(
+    Archive& ar, const uint32_t version)
+{
+  ar(cereal::base_class<MultiLayer<MatType>>(this));
+
+  ar(CEREAL_NVP(numClasses));
+  ar(CEREAL_NVP(includeTop));
+
+  // Version 0 was saved before the model could be fused.
+  if (version >= 1)
+    ar(CEREAL_NVP(fused));
+}
+
+template<typename MatType, size_t DarkNetVersion>
+void DarkNetType<MatType, DarkNetVersion>::ConvolutionBlock(
+    MultiLayer<MatType>* block,
+    const size_t maps,
+    const size_t kernelSize,
+    const size_t stride,
+    const size_t padding,
+    const double negativeSlope)
+{
+  if (fused)
+  {
+    block->template Add<FusedConvolutionType<MatType>>(maps, kernelSize,
+        kernelSize, stride, stride, padding, padding,
+        FusedActivation::LeakyReLU, negativeSlope);
     return;
   }
 
+  block->template Add<DefaultConvolutionType<MatType>>(maps, kernelSize,
+      kernelSize, stride, stride, padding, padding);
+  block->template Add<BatchNormType<MatType>>(2, 2, 1e-5, false);
+  block->template Add<LeakyReLUType<MatType>>(negativeSlope);
+}
+
+template<typename MatType, size_t DarkNetVersion>
+void DarkNetType<MatType, DarkNetVersion>::DarkNet19SequentialBlock(
+    const size_t inputChannel)
+{
+  ConvolutionBlock(this, inputChannel * 2, 3, 1, 1);
+  ConvolutionBlock(this, inputChannel, 1);
+  ConvolutionBlock(this, inputChannel * 2, 3, 1, 1);
+}
+
+template<typename MatType, size_t DarkNetVersion>
+void DarkNetType<MatType, DarkNetVersion>::DarkNet53ResidualBlock(
+    const size_t inputChannel)
+{
+  MultiLayer<MatType>* block = new MultiLayer<MatType>();
+  ConvolutionBlock(block, inputChannel / 2, 1, 1, 0, 1e-2);
+  ConvolutionBlock(block, inputChannel, 3, 1, 1, 1e-2);
+
+  ResidualType<MatType>* residualBlock = new ResidualType<MatType>();
+  residualBlock->Add(block);
+  this->Add(residualBlock);
+}
+
+template<typename MatType, size_t DarkNetVersion>
+void DarkNetType<MatType, DarkNetVersion>::MakeModel()
+{
   if (DarkNetVersion == 19)
   {
-    darkNet.Add(new IdentityLayer<>());
-
     // Convolution and activation function in a block.
-    ConvolutionBlock(inputChannel, 32, 3, 3, 1, 1, 1, 1, true);
+    ConvolutionBlock(this, 32, 3, 1, 1);
     PoolingBlock();
-    ConvolutionBlock(32, 64, 3, 3, 1, 1, 1, 1, true);
+    ConvolutionBlock(this, 64, 3, 1, 1);
     PoolingBlock();
-    DarkNet19SequentialBlock(64, 3, 3, 1, 1);
+    DarkNet19SequentialBlock(64);
     PoolingBlock();
-    DarkNet19SequentialBlock(128, 3, 3, 1, 1);
+    DarkNet19SequentialBlock(128);
     PoolingBlock();
-    DarkNet19SequentialBlock(256, 3, 3, 1, 1);
-    ConvolutionBlock(512, 256, 1, 1, 1, 1, 1, 1, true);
-    ConvolutionBlock(256, 512, 3, 3, 1, 1, 1, 1, true);
+    DarkNet19SequentialBlock(256);
+    ConvolutionBlock(this, 256, 1, 1, 1);
+    ConvolutionBlock(this, 512, 3, 1, 1);
     PoolingBlock();
-    DarkNet19SequentialBlock(512, 3, 3, 1, 1);
-    ConvolutionBlock(1024, 512, 1, 1, 1, 1, 1, 1, true);
-    ConvolutionBlock(512, 1024, 3, 3, 1, 1, 1, 1, true);
+    DarkNet19SequentialBlock(512);
+    ConvolutionBlock(this, 512, 1, 1, 1);
+    ConvolutionBlock(this, 1024, 3, 1, 1);
 
     if (includeTop)
     {
-      darkNet.Add(new Convolution<>(1024, numClasses, 1, 1,
-          1, 1, 0, 0, inputWidth, inputHeight));
-      darkNet.Add(new AdaptiveMeanPooling<>(1, 1));
-      darkNet.Add(new LogSoftMax<>());
+      this->template Add<DefaultConvolutionType<MatType>>(numClasses, 1, 1);
+      this->template Add<AdaptiveMeanPoolingType<MatType>>(1, 1);
+      this->template Add<LogSoftMaxType<MatType>>();
     }
-
-    darkNet.ResetParameters();
   }
   else if (DarkNetVersion == 53)
   {
-    darkNet.Add(new IdentityLayer<>());
-    ConvolutionBlock(inputChannel, 32, 3, 3, 1, 1, 1, 1, true, 1e-2);
-    ConvolutionBlock(32, 64, 3, 3, 2, 2, 1, 1, true, 1e-2);
+    ConvolutionBlock(this, 32, 3, 1, 1, 1e-2);
+    ConvolutionBlock(this, 64, 3, 2, 1, 1e-2);
 
     // Let's automate this a bit.
     size_t curChannels = 64;
@@ -138,47 +228,23 @@ DarkNet<OutputLayerType, InitializationRuleType, DarkNetVersion>::DarkNet(
 
       if (blockCount != 4)
       {
-          ConvolutionBlock(curChannels, curChannels * 2, 3, 3,
-              2, 2, 1, 1, true, 1e-2);
-          curChannels = curChannels * 2;
+        ConvolutionBlock(this, curChannels * 2, 3, 2, 1, 1e-2);
+        curChannels = curChannels * 2;
       }
     }
 
     if (includeTop)
     {
-      darkNet.Add(new AdaptiveMeanPooling<>(1, 1));
-      darkNet.Add(new Linear<>(curChannels, numClasses));
+      this->template Add<AdaptiveMeanPoolingType<MatType>>(1, 1);
+      this->template Add<LinearType<MatType>>(numClasses);
     }
-
-    darkNet.ResetParameters();
   }
-}
-
-template<
-     typename OutputLayerType,
-     typename InitializationRuleType,
-     size_t DarkNetVersion
->
-void DarkNet<
-    OutputLayerType, InitializationRuleType, DarkNetVersion
->::LoadModel(const std::string& filePath)
-{
-  data::Load(filePath, "DarkNet", darkNet);
-  Log::Info << "Loaded model" << std::endl;
-}
-
-template<
-     typename OutputLayerType,
-     typename InitializationRuleType,
-     size_t DarkNetVersion
->
-void DarkNet<
-    OutputLayerType, InitializationRuleType, DarkNetVersion
->::SaveModel(const std::string& filePath)
-{
-  Log::Info<< "Saving model." << std::endl;
-  data::Save(filePath, "DarkNet", darkNet);
-  Log::Info << "Model saved in " << filePath << "." << std::endl;
+  else
+  {
+    mlpack::Log::Fatal << "Incorrect DarkNet version. Possible values are 19 "
+        << "and 53. Trying to find version: " << DarkNetVersion << "."
+        << std::endl;
+  }
 }
 
 } // namespace models
@@ -0,0 +1,193 @@
+/**
+ * @file channel_concat.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of ChannelConcat, which concatenates the output maps of
+ * convolutions of the same input without copying them.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_LAYERS_CHANNEL_CONCAT_HPP
+#define MODELS_MODELS_LAYERS_CHANNEL_CONCAT_HPP
+
+#include <mlpack.hpp>
+#include <models/layers/fused_convolution.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * ChannelConcat applies several FusedConvolution layers to the same input
+ * and concatenates their output maps, like Concat along the maps. Concat
+ * computes the output of every branch into a buffer of its own and copies
+ * it into the concatenated output, and copies the gradient of the output
+ * back into branch buffers in the backward pass. Here every convolution
+ * writes its maps directly into its rows of the output of the layer, and
+ * reads the gradient of its maps from the same rows.
+ *
+ * All convolutions must produce outputs of the same width and height.
+ *
+ * @code
+ * // Expand layers of a SqueezeNet Fire module: 64 1x1 and 64 3x3 maps.
+ * models::ChannelConcat* expand = new models::ChannelConcat();
+ * expand->Add<models::FusedConvolution>(64, 1, 1, 1, 1, 0, 0,
+ *     models::FusedActivation::ReLU);
+ * expand->Add<models::FusedConvolution>(64, 3, 3, 1, 1, 1, 1,
+ *     models::FusedActivation::ReLU);
+ * model.Add(expand);
+ * @endcode
+ *
+ * @tparam MatType Matrix representation to accept as input and use for
+ *    computation.
+ */
+template<typename MatType = arma::mat>
+class ChannelConcatType : public MultiLayer<MatType>
+{
+ public:
+  //! Create an empty ChannelConcatType; add convolutions with Add().
+  ChannelConcatType() : MultiLayer<MatType>()
+  {
+    // Nothing to do here.
+  }
+
+  //! Create a copy of the layer (this is safe for polymorphic use).
+  ChannelConcatType* Clone() const { return new ChannelConcatType(*this); }
+
+  /**
+   * Computes every convolution into its rows of the output.
+   *
+   * @param input Input images, one image per column.
+   * @param output Resulting concatenated output maps.
+   */
+  void Forward(const MatType& input, MatType& output)
+  {
+    size_t offset = 0;
+    for (size_t i = 0; i < this->network.size(); i++)
+    {
+      FusedConvolutionType<MatType>& branch = Branch(i);
+      branch.Forward(input, output, offset);
+      offset += OutputSize(branch);
+    }
+  }
+
+  /**
+   * Computes the gradient of the input, the sum of the gradients of all
+   * convolutions.
+   *
+   * @param input Input images passed to Forward().
+   * @param output Output of Forward().
+   * @param gy Gradient of the output.
+   * @param g Resulting gradient of the input.
+   */
+  void Backward(const MatType& /* input */,
+                const MatType& output,
+                const MatType& gy,
+                MatType& g)
+  {
+    g.zeros();
+    size_t offset = 0;
+    for (size_t i = 0; i < this->network.size(); i++)
+    {
+      FusedConvolutionType<MatType>& branch = Branch(i);
+      branch.Backward(output, gy, offset, g);
+      offset += OutputSize(branch);
+    }
+  }
+
+  /**
+   * Computes the gradient of the weights of every convolution.
+   *
+   * @param input Input images passed to Forward().
+   * @param error Gradient of the output.
+   * @param gradient Resulting gradient of the weights.
+   */
+  void Gradient(const MatType& input,
+                const MatType& error,
+                MatType& gradient)
+  {
+    size_t offset = 0;
+    for (size_t i = 0; i < this->network.size(); i++)
+    {
+      FusedConvolutionType<MatType>& branch = Branch(i);
+      MatType branchGradient(gradient.memptr() + offset, branch.WeightSize(),
+          1, false, true);
+      branch.Gradient(input, error, branchGradient);
+      offset += branch.WeightSize();
+    }
+  }
+
+  //! Compute the output dimensions of the layer from its input dimensions.
+  void ComputeOutputDimensions()
+  {
+    if (this->network.empty())
+    {
+      mlpack::Log::Fatal << "ChannelConcat: no convolutions were added."
+          << std::endl;
+    }
+
+    size_t maps = 0;
+    for (size_t i = 0; i < this->network.size(); i++)
+    {
+      FusedConvolutionType<MatType>& branch = Branch(i);
+      branch.InputDimensions() = this->inputDimensions;
+      branch.ComputeOutputDimensions();
+      const std::vector<size_t>& dimensions = branch.OutputDimensions();
+      if (i > 0 && (dimensions[0] != this->outputDimensions[0] ||
+          dimensions[1] != this->outputDimensions[1]))
+      {
+        mlpack::Log::Fatal << "ChannelConcat: convolution " << i << " has an "
+            << "output of shape {" << dimensions[0] << ", " << dimensions[1]
+            << "}, but convolution 0 has an output of shape {"
+            << this->outputDimensions[0] << ", " << this->outputDimensions[1]
+            << "}." << std::endl;
+      }
+
+      this->outputDimensions = { dimensions[0], dimensions[1], 0 };
+      maps += branch.Maps();
+    }
+
+    this->outputDimensions[2] = maps;
+  }
+
+  //! Serialize the layer.
+  template<typename Archive>
+  void serialize(Archive& ar, const uint32_t /* version */)
+  {
+    ar(cereal::base_class<MultiLayer<MatType>>(this));
+  }
+
+ private:
+  //! Get the convolution of the given branch.
+  FusedConvolutionType<MatType>& Branch(const size_t i)
+  {
+    FusedConvolutionType<MatType>* branch =
+        dynamic_cast<FusedConvolutionType<MatType>*>(this->network[i]);
+    if (branch == nullptr)
+    {
+      mlpack::Log::Fatal << "ChannelConcat: layer " << i << " is not a "
+          << "FusedConvolution." << std::endl;
+    }
+
+    return *branch;
+  }
+
+  //! Get the number of output rows of the given convolution.
+  static size_t OutputSize(FusedConvolutionType<MatType>& branch)
+  {
+    return branch.OutputDimensions()[0] * branch.OutputDimensions()[1] *
+        branch.Maps();
+  }
+}; // ChannelConcatType class.
+
+// Standard ChannelConcat layer.
+typedef ChannelConcatType<arma::mat> ChannelConcat;
+
+} // namespace models
+} // namespace mlpack
+
+CEREAL_REGISTER_TYPE(mlpack::models::ChannelConcatType<arma::mat>);
+
+#endif
@@ -0,0 +1,206 @@
+/**
+ * @file checkpoint.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of Checkpoint, a container that doesn't keep the outputs of its
+ * layers for training but computes them again for the backward pass.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_LAYERS_CHECKPOINT_HPP
+#define MODELS_MODELS_LAYERS_CHECKPOINT_HPP
+
+#include <mlpack.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Checkpoint holds layers like MultiLayer, but while training it only keeps
+ * the input passed to it, which its parent holds anyway. MultiLayer keeps
+ * the output and the gradient of every layer it holds from the forward pass
+ * to the gradient; Checkpoint computes its forward pass with just two
+ * buffers, which are freed once the output is computed. Backward() computes
+ * the forward pass again, keeping the outputs of the layers, and they and
+ * the gradients of the outputs are freed once Gradient() is done.
+ *
+ * This trades an additional forward pass of the held layers for the memory
+ * of their outputs and gradients, so only the outputs of a single
+ * checkpointed block are held at any time. Buffers layers keep themselves,
+ * e.g. of batch normalization, are unaffected. The held layers must compute
+ * the same outputs when their forward pass is repeated; batch normalization
+ * updates its running statistics in both passes.
+ *
+ * When not training, Checkpoint computes like MultiLayer.
+ *
+ * @code
+ * // Main branch of a ResNet block whose outputs aren't kept.
+ * MultiLayer<>* block = new models::Checkpoint();
+ * block->Add<Convolution>(64, 3, 3, 1, 1, 1, 1);
+ * block->Add<BatchNorm>();
+ * block->Add<ReLU>();
+ * block->Add<Convolution>(64, 3, 3, 1, 1, 1, 1);
+ * block->Add<BatchNorm>();
+ * @endcode
+ *
+ * @tparam MatType Matrix representation to accept as input and use for
+ *    computation.
+ */
+template<typename MatType = arma::mat>
+class CheckpointType : public MultiLayer<MatType>
+{
+ public:
+  //! Create an empty CheckpointType; add layers with Add().
+  CheckpointType() : MultiLayer<MatType>()
+  {
+    // Nothing to do here.
+  }
+
+  //! Create a copy of the layer (this is safe for polymorphic use).
+  CheckpointType* Clone() const { return new CheckpointType(*this); }
+
+  /**
+   * Computes the output of the held layers. While training, only the output
+   * of the last layer is kept.
+   *
+   * @param input Input of the layers, one input per column.
+   * @param output Resulting output of the last layer.
+   */
+  void Forward(const MatType& input, MatType& output)
+  {
+    if (!this->training)
+    {
+      MultiLayer<MatType>::Forward(input, output);
+      return;
+    }
+
+    // Layers alternate between two buffers.
+    const MatType* current = &input;
+    for (size_t i = 0; i < this->network.size(); i++)
+    {
+      MatType& next = (i + 1 == this->network.size()) ? output :
+          buffers[i % 2];
+      next.set_size(OutputSize(i), input.n_cols);
+      this->network[i]->Forward(*current, next);
+      current = &next;
+    }
+
+    buffers[0].reset();
+    buffers[1].reset();
+  }
+
+  /**
+   * Computes the outputs of the held layers again, then the gradient of the
+   * input through all of them.
+   *
+   * @param input Input of the layers passed to Forward().
+   * @param output Output of Forward().
+   * @param gy Gradient of the output.
+   * @param g Resulting gradient of the input.
+   */
+  void Backward(const MatType& input,
+                const MatType& output,
+                const MatType& gy,
+                MatType& g)
+  {
+    const size_t layers = this->network.size();
+    outputs.resize(layers - 1);
+    for (size_t i = 0; i + 1 < layers; i++)
+    {
+      outputs[i].set_size(OutputSize(i), input.n_cols);
+      this->network[i]->Forward(LayerInput(i, input), outputs[i]);
+    }
+
+    // deltas[i] is the gradient of the output of layer i.
+    deltas.resize(layers - 1);
+    for (size_t i = layers; i-- > 0;)
+    {
+      const MatType& delta = (i + 1 == layers) ? gy : deltas[i];
+      MatType& result = (i == 0) ? g : deltas[i - 1];
+      if (i > 0)
+        result.set_size(outputs[i - 1].n_rows, outputs[i - 1].n_cols);
+
+      this->network[i]->Backward(LayerInput(i, input),
+          (i + 1 == layers) ? output : outputs[i], delta, result);
+    }
+  }
+
+  /**
+   * Computes the gradient of the weights of the held layers, then frees the
+   * outputs and gradients kept by Backward().
+   *
+   * @param input Input of the layers passed to Forward().
+   * @param error Gradient of the output.
+   * @param gradient Resulting gradient of the weights.
+   */
+  void Gradient(const MatType& input,
+                const MatType& error,
+                MatType& gradient)
+  {
+    const size_t layers = this->network.size();
+    size_t offset = 0;
+    for (size_t i = 0; i < layers; i++)
+    {
+      const size_t weights = this->network[i]->WeightSize();
+      if (weights > 0)
+      {
+        MatType layerGradient(gradient.memptr() + offset, weights, 1, false,
+            true);
+        this->network[i]->Gradient(LayerInput(i, input),
+            (i + 1 == layers) ? error : deltas[i], layerGradient);
+      }
+
+      offset += weights;
+    }
+
+    outputs.clear();
+    deltas.clear();
+  }
+
+  //! Serialize the layer.
+  template<typename Archive>
+  void serialize(Archive& ar, const uint32_t /* version */)
+  {
+    ar(cereal::base_class<MultiLayer<MatType>>(this));
+  }
+
+ private:
+  //! Get the input of the given layer, with the outputs of Backward().
+  const MatType& LayerInput(const size_t i, const MatType& input) const
+  {
+    return (i == 0) ? input : outputs[i - 1];
+  }
+
+  //! Get the number of rows of the output of the given layer.
+  size_t OutputSize(const size_t i) const
+  {
+    size_t size = 1;
+    for (size_t dimension : this->network[i]->OutputDimensions())
+      size *= dimension;
+    return size;
+  }
+
+  //! Locally stored buffers of the forward pass while training.
+  MatType buffers[2];
+
+  //! Locally stored outputs of all layers but the last, from Backward() to
+  //! Gradient().
+  std::vector<MatType> outputs;
+
+  //! Locally stored gradients of the outputs of all layers but the last,
+  //! from Backward() to Gradient().
+  std::vector<MatType> deltas;
+}; // CheckpointType class.
+
+// Standard Checkpoint layer.
+typedef CheckpointType<arma::mat> Checkpoint;
+
+} // namespace models
+} // namespace mlpack
+
+CEREAL_REGISTER_TYPE(mlpack::models::CheckpointType<arma::mat>);
+
+#endif
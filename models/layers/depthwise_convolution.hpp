@@ -0,0 +1,456 @@
+/**
+ * @file depthwise_convolution.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of DepthwiseConvolution, a direct convolution of every input map
+ * with its own kernels.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_LAYERS_DEPTHWISE_CONVOLUTION_HPP
+#define MODELS_MODELS_LAYERS_DEPTHWISE_CONVOLUTION_HPP
+
+#include <mlpack.hpp>
+#include <algorithm>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * DepthwiseConvolution convolves every input map with its own kernels; it
+ * computes the same result as a GroupedConvolution with as many groups as
+ * input maps. A grouped convolution solves one small unrolled matrix product
+ * per group, which for the depthwise step of separable convolutions, e.g.
+ * 728 groups of one map in the middle flow of Xception, spends most of its
+ * time on unrolling. This layer instead accumulates every kernel position
+ * directly over the rows of the output: with stride one the inner loop runs
+ * over contiguous memory and is vectorized. Maps and images of a batch are
+ * processed in parallel (if OpenMP is available).
+ *
+ * Weights are stored exactly like the weights of GroupedConvolution with
+ * groups equal to the number of input maps: one kernel per output map,
+ * followed by the bias of every output map if a bias is used. Output map m
+ * convolves input map m / (maps / inMaps).
+ *
+ * @code
+ * // Same result as GroupedConvolution(128, 3, 3, 128, 1, 1, 1, 1) for an
+ * // input with 128 maps.
+ * model.Add<models::DepthwiseConvolution>(128, 3, 3, 1, 1, 1, 1);
+ * @endcode
+ *
+ * @tparam MatType Matrix representation to accept as input and use for
+ *    computation.
+ */
+template<typename MatType = arma::mat>
+class DepthwiseConvolutionType : public Layer<MatType>
+{
+ public:
+  typedef typename MatType::elem_type ElemType;
+
+  //! Create an empty DepthwiseConvolutionType object, used for
+  //! serialization.
+  DepthwiseConvolutionType() :
+      maps(0),
+      kernelWidth(0),
+      kernelHeight(0),
+      strideWidth(1),
+      strideHeight(1),
+      padWidth(0),
+      padHeight(0),
+      useBias(true),
+      inMaps(0)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Create the DepthwiseConvolutionType object.
+   *
+   * @param maps Number of output maps, a multiple of the number of input
+   *     maps.
+   * @param kernelWidth Width of the filter/kernel.
+   * @param kernelHeight Height of the filter/kernel.
+   * @param strideWidth Stride of filter application in the x direction.
+   * @param strideHeight Stride of filter application in the y direction.
+   * @param padWidth Padding width of the input, on both sides.
+   * @param padHeight Padding height of the input, on both sides.
+   * @param useBias Whether a bias is added to every output map.
+   */
+  DepthwiseConvolutionType(const size_t maps,
+                           const size_t kernelWidth,
+                           const size_t kernelHeight,
+                           const size_t strideWidth = 1,
+                           const size_t strideHeight = 1,
+                           const size_t padWidth = 0,
+                           const size_t padHeight = 0,
+                           const bool useBias = true) :
+      maps(maps),
+      kernelWidth(kernelWidth),
+      kernelHeight(kernelHeight),
+      strideWidth(strideWidth),
+      strideHeight(strideHeight),
+      padWidth(padWidth),
+      padHeight(padHeight),
+      useBias(useBias),
+      inMaps(0)
+  {
+    // Nothing to do here.
+  }
+
+  //! Create a copy of the layer (this is safe for polymorphic use).
+  DepthwiseConvolutionType* Clone() const
+  {
+    return new DepthwiseConvolutionType(*this);
+  }
+
+  //! Set the weights of the layer to alias the given memory.
+  void SetWeights(const MatType& weightsIn)
+  {
+    MakeAlias(weights, weightsIn, WeightSize(), 1);
+    MakeAlias(weight, weightsIn, kernelWidth * kernelHeight, maps);
+    if (useBias)
+      MakeAlias(bias, weightsIn, maps, 1, kernelWidth * kernelHeight * maps);
+  }
+
+  /**
+   * Computes the convolution and adds the bias.
+   *
+   * @param input Input images, one image per column.
+   * @param output Resulting output activations.
+   */
+  void Forward(const MatType& input, MatType& output)
+  {
+    const size_t inputSize = InputWidth() * InputHeight();
+    const size_t outputSize = OutputWidth() * OutputHeight();
+    const size_t multiplier = maps / inMaps;
+
+    #pragma omp parallel for collapse(2) schedule(static)
+    for (size_t i = 0; i < input.n_cols; i++)
+    {
+      for (size_t map = 0; map < maps; map++)
+      {
+        ElemType* result = output.colptr(i) + map * outputSize;
+        std::fill(result, result + outputSize,
+            useBias ? bias(map) : ElemType(0));
+        Accumulate(input.colptr(i) + (map / multiplier) * inputSize,
+            weight.colptr(map), result);
+      }
+    }
+  }
+
+  /**
+   * Computes the gradient of the input.
+   *
+   * @param input Input images passed to Forward().
+   * @param output Output of Forward().
+   * @param gy Gradient of the output.
+   * @param g Resulting gradient of the input.
+   */
+  void Backward(const MatType& /* input */,
+                const MatType& /* output */,
+                const MatType& gy,
+                MatType& g)
+  {
+    const size_t inputSize = InputWidth() * InputHeight();
+    const size_t outputSize = OutputWidth() * OutputHeight();
+    const size_t multiplier = maps / inMaps;
+
+    // Every input map only receives the gradient of its own output maps, so
+    // input maps are independent.
+    #pragma omp parallel for collapse(2) schedule(static)
+    for (size_t i = 0; i < gy.n_cols; i++)
+    {
+      for (size_t c = 0; c < inMaps; c++)
+      {
+        ElemType* result = g.colptr(i) + c * inputSize;
+        std::fill(result, result + inputSize, ElemType(0));
+        for (size_t map = c * multiplier; map < (c + 1) * multiplier; map++)
+        {
+          Scatter(gy.colptr(i) + map * outputSize, weight.colptr(map),
+              result);
+        }
+      }
+    }
+  }
+
+  /**
+   * Computes the gradient of the weights.
+   *
+   * @param input Input images passed to Forward().
+   * @param error Gradient of the output.
+   * @param gradient Resulting gradient of the weights.
+   */
+  void Gradient(const MatType& input,
+                const MatType& error,
+                MatType& gradient)
+  {
+    const size_t inputSize = InputWidth() * InputHeight();
+    const size_t outputSize = OutputWidth() * OutputHeight();
+    const size_t kernelSize = kernelWidth * kernelHeight;
+    const size_t multiplier = maps / inMaps;
+
+    // Kernels of different maps are independent; images of the batch are
+    // summed in order.
+    #pragma omp parallel for schedule(static)
+    for (size_t map = 0; map < maps; map++)
+    {
+      ElemType* kernelGradient = gradient.memptr() + map * kernelSize;
+      std::fill(kernelGradient, kernelGradient + kernelSize, ElemType(0));
+      ElemType biasGradient = 0;
+      for (size_t i = 0; i < input.n_cols; i++)
+      {
+        const ElemType* delta = error.colptr(i) + map * outputSize;
+        Correlate(input.colptr(i) + (map / multiplier) * inputSize, delta,
+            kernelGradient);
+        for (size_t p = 0; p < outputSize; p++)
+          biasGradient += delta[p];
+      }
+
+      if (useBias)
+        gradient[kernelSize * maps + map] = biasGradient;
+    }
+  }
+
+  //! Get the number of weights of the layer.
+  size_t WeightSize() const
+  {
+    return (kernelWidth * kernelHeight + (useBias ? 1 : 0)) * maps;
+  }
+
+  //! Compute the output dimensions of the layer from its input dimensions.
+  void ComputeOutputDimensions()
+  {
+    inMaps = (this->inputDimensions.size() > 2) ?
+        this->inputDimensions[2] : 1;
+    for (size_t i = 3; i < this->inputDimensions.size(); i++)
+      inMaps *= this->inputDimensions[i];
+
+    if (maps % inMaps != 0)
+    {
+      mlpack::Log::Fatal << "DepthwiseConvolution: number of output maps ("
+          << maps << ") must be a multiple of the number of input maps ("
+          << inMaps << ")." << std::endl;
+    }
+
+    if (this->inputDimensions[0] + 2 * padWidth < kernelWidth ||
+        this->inputDimensions[1] + 2 * padHeight < kernelHeight)
+    {
+      mlpack::Log::Fatal << "Input of shape {" << this->inputDimensions[0]
+          << ", " << this->inputDimensions[1] << "} is smaller than the "
+          << "kernel of shape {" << kernelWidth << ", " << kernelHeight
+          << "}." << std::endl;
+    }
+
+    this->outputDimensions = { (this->inputDimensions[0] + 2 * padWidth -
+        kernelWidth) / strideWidth + 1, (this->inputDimensions[1] +
+        2 * padHeight - kernelHeight) / strideHeight + 1, maps };
+  }
+
+  //! Get the parameters.
+  const MatType& Parameters() const { return weights; }
+  //! Modify the parameters.
+  MatType& Parameters() { return weights; }
+
+  //! Get the number of output maps.
+  size_t Maps() const { return maps; }
+
+  //! Get the width of the kernel.
+  size_t KernelWidth() const { return kernelWidth; }
+
+  //! Get the height of the kernel.
+  size_t KernelHeight() const { return kernelHeight; }
+
+  //! Serialize the layer.
+  template<typename Archive>
+  void serialize(Archive& ar, const uint32_t /* version */)
+  {
+    ar(cereal::base_class<Layer<MatType>>(this));
+
+    ar(CEREAL_NVP(maps));
+    ar(CEREAL_NVP(kernelWidth));
+    ar(CEREAL_NVP(kernelHeight));
+    ar(CEREAL_NVP(strideWidth));
+    ar(CEREAL_NVP(strideHeight));
+    ar(CEREAL_NVP(padWidth));
+    ar(CEREAL_NVP(padHeight));
+    ar(CEREAL_NVP(useBias));
+    ar(CEREAL_NVP(inMaps));
+  }
+
+ private:
+  //! Get the width of the input.
+  size_t InputWidth() const { return this->inputDimensions[0]; }
+  //! Get the height of the input.
+  size_t InputHeight() const { return this->inputDimensions[1]; }
+  //! Get the width of the output.
+  size_t OutputWidth() const { return this->outputDimensions[0]; }
+  //! Get the height of the output.
+  size_t OutputHeight() const { return this->outputDimensions[1]; }
+
+  /**
+   * Computes the range [begin, end) of output positions whose kernel
+   * position k falls inside the input, for one direction.
+   */
+  static void ValidRange(const size_t k,
+                         const size_t stride,
+                         const size_t padding,
+                         const size_t inputSize,
+                         const size_t outputSize,
+                         size_t& begin,
+                         size_t& end)
+  {
+    // Output position p reads input position p * stride + k - padding.
+    begin = (k >= padding) ? 0 : (padding - k + stride - 1) / stride;
+    end = (inputSize + padding > k) ?
+        std::min(outputSize, (inputSize + padding - k - 1) / stride + 1) : 0;
+    begin = std::min(begin, end);
+  }
+
+  //! Adds the convolution of an input map with a kernel to an output map.
+  void Accumulate(const ElemType* plane,
+                  const ElemType* kernel,
+                  ElemType* result) const
+  {
+    const size_t width = InputWidth();
+    const size_t outputWidth = OutputWidth();
+    for (size_t ky = 0; ky < kernelHeight; ky++)
+    {
+      size_t y0, y1;
+      ValidRange(ky, strideHeight, padHeight, InputHeight(), OutputHeight(),
+          y0, y1);
+      for (size_t kx = 0; kx < kernelWidth; kx++)
+      {
+        size_t x0, x1;
+        ValidRange(kx, strideWidth, padWidth, width, outputWidth, x0, x1);
+        const ElemType w = kernel[kx + kernelWidth * ky];
+        for (size_t y = y0; y < y1; y++)
+        {
+          const ElemType* source = plane + (y * strideHeight + ky -
+              padHeight) * width;
+          ElemType* row = result + y * outputWidth;
+          if (strideWidth == 1)
+          {
+            for (size_t x = x0; x < x1; x++)
+              row[x] += w * source[x + kx - padWidth];
+          }
+          else
+          {
+            for (size_t x = x0; x < x1; x++)
+              row[x] += w * source[x * strideWidth + kx - padWidth];
+          }
+        }
+      }
+    }
+  }
+
+  //! Adds the gradient of an output map, spread by a kernel, to the
+  //! gradient of its input map.
+  void Scatter(const ElemType* delta,
+               const ElemType* kernel,
+               ElemType* result) const
+  {
+    const size_t width = InputWidth();
+    const size_t outputWidth = OutputWidth();
+    for (size_t ky = 0; ky < kernelHeight; ky++)
+    {
+      size_t y0, y1;
+      ValidRange(ky, strideHeight, padHeight, InputHeight(), OutputHeight(),
+          y0, y1);
+      for (size_t kx = 0; kx < kernelWidth; kx++)
+      {
+        size_t x0, x1;
+        ValidRange(kx, strideWidth, padWidth, width, outputWidth, x0, x1);
+        const ElemType w = kernel[kx + kernelWidth * ky];
+        for (size_t y = y0; y < y1; y++)
+        {
+          ElemType* target = result + (y * strideHeight + ky - padHeight) *
+              width;
+          const ElemType* row = delta + y * outputWidth;
+          for (size_t x = x0; x < x1; x++)
+            target[x * strideWidth + kx - padWidth] += w * row[x];
+        }
+      }
+    }
+  }
+
+  //! Adds the correlation of an input map with the gradient of an output
+  //! map to the gradient of the kernel.
+  void Correlate(const ElemType* plane,
+                 const ElemType* delta,
+                 ElemType* kernelGradient) const
+  {
+    const size_t width = InputWidth();
+    const size_t outputWidth = OutputWidth();
+    for (size_t ky = 0; ky < kernelHeight; ky++)
+    {
+      size_t y0, y1;
+      ValidRange(ky, strideHeight, padHeight, InputHeight(), OutputHeight(),
+          y0, y1);
+      for (size_t kx = 0; kx < kernelWidth; kx++)
+      {
+        size_t x0, x1;
+        ValidRange(kx, strideWidth, padWidth, width, outputWidth, x0, x1);
+        ElemType sum = 0;
+        for (size_t y = y0; y < y1; y++)
+        {
+          const ElemType* source = plane + (y * strideHeight + ky -
+              padHeight) * width;
+          const ElemType* row = delta + y * outputWidth;
+          for (size_t x = x0; x < x1; x++)
+            sum += row[x] * source[x * strideWidth + kx - padWidth];
+        }
+
+        kernelGradient[kx + kernelWidth * ky] += sum;
+      }
+    }
+  }
+
+  //! Locally stored number of output maps.
+  size_t maps;
+
+  //! Locally stored width of the kernel.
+  size_t kernelWidth;
+
+  //! Locally stored height of the kernel.
+  size_t kernelHeight;
+
+  //! Locally stored stride in the x direction.
+  size_t strideWidth;
+
+  //! Locally stored stride in the y direction.
+  size_t strideHeight;
+
+  //! Locally stored padding width.
+  size_t padWidth;
+
+  //! Locally stored padding height.
+  size_t padHeight;
+
+  //! Locally stored if a bias is added.
+  bool useBias;
+
+  //! Locally stored number of input maps.
+  size_t inMaps;
+
+  //! Locally stored weights and biases.
+  MatType weights;
+
+  //! Locally stored kernels, one output map per column.
+  MatType weight;
+
+  //! Locally stored bias of every output map.
+  MatType bias;
+}; // DepthwiseConvolutionType class.
+
+// Standard DepthwiseConvolution layer.
+typedef DepthwiseConvolutionType<arma::mat> DepthwiseConvolution;
+
+} // namespace models
+} // namespace mlpack
+
+CEREAL_REGISTER_TYPE(mlpack::models::DepthwiseConvolutionType<arma::mat>);
+
+#endif
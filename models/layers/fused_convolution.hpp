@@ -0,0 +1,729 @@
+/**
+ * @file fused_convolution.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of FusedConvolution, a convolution that adds the bias and applies
+ * the activation while its output is still in cache.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_LAYERS_FUSED_CONVOLUTION_HPP
+#define MODELS_MODELS_LAYERS_FUSED_CONVOLUTION_HPP
+
+#include <mlpack.hpp>
+#include <models/layers/winograd.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace mlpack {
+namespace models {
+
+//! Activations that can be applied by FusedConvolution.
+enum class FusedActivation
+{
+  //! No activation, only the bias is added.
+  Identity,
+  //! max(x, 0).
+  ReLU,
+  //! min(max(x, 0), 6).
+  ReLU6,
+  //! x for positive x, alpha * x otherwise.
+  LeakyReLU
+};
+
+/**
+ * FusedConvolution computes a convolution with bias followed by an
+ * activation in a single pass. Every image is unrolled into a matrix of
+ * patches, so the convolution is one matrix multiplication, and the bias and
+ * the activation are applied to every output map right after it, instead of
+ * in separate layers that each read and write the whole output again.
+ * Images of a batch are processed in parallel (if OpenMP is available).
+ *
+ * For inference, 3x3 convolutions of stride 1, e.g. most convolutions of VGG
+ * and DarkNet, are computed with Winograd's F(2x2, 3x3) algorithm instead,
+ * which takes 2.25 times fewer multiplications (see WinogradConvolution).
+ * The kernels are transformed on the first pass after the weights were set;
+ * the layer keeps using the unrolled convolution while it is trained. Weights
+ * modified through Parameters() after a pass must be set with SetWeights()
+ * again.
+ *
+ * Weights are stored exactly like the weights of mlpack's Convolution with
+ * bias: the kernels of every output map, followed by the bias of every
+ * output map. Weights of a trained convolution can therefore be copied, and
+ * batch normalization can be folded into the layer with BatchNormFolding.
+ * The models emit fused layers for inference, e.g.
+ * VGGType::GetInferenceModel().
+ *
+ * For faster inference the layer can be quantized to 8-bit integers after
+ * training. Calibrate() records the range of the inputs seen by Forward()
+ * from then on; Quantize() stores the kernels of every output map as 8-bit
+ * integers with their own scale and computes the convolution over 8-bit
+ * inputs with 32-bit sums afterwards. Quantization::Quantize() does both for
+ * every fused convolution of a network.
+ *
+ * @code
+ * // Same result as Convolution(64, 3, 3, 1, 1, 1, 1) followed by ReLU.
+ * model.Add<models::FusedConvolution>(64, 3, 3, 1, 1, 1, 1,
+ *     models::FusedActivation::ReLU);
+ * @endcode
+ *
+ * @tparam MatType Matrix representation to accept as input and use for
+ *    computation.
+ */
+template<typename MatType = arma::mat>
+class FusedConvolutionType : public Layer<MatType>
+{
+ public:
+  typedef typename MatType::elem_type ElemType;
+
+  //! Create an empty FusedConvolutionType object, used for serialization.
+  FusedConvolutionType() :
+      maps(0),
+      kernelWidth(0),
+      kernelHeight(0),
+      strideWidth(1),
+      strideHeight(1),
+      padWidth(0),
+      padHeight(0),
+      activation(FusedActivation::Identity),
+      alpha(0.1),
+      inMaps(0),
+      calibrating(false),
+      quantized(false),
+      inputRange(0),
+      inputScale(1),
+      useWinograd(true)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Create the FusedConvolutionType object.
+   *
+   * @param maps Number of output maps.
+   * @param kernelWidth Width of the filter/kernel.
+   * @param kernelHeight Height of the filter/kernel.
+   * @param strideWidth Stride of filter application in the x direction.
+   * @param strideHeight Stride of filter application in the y direction.
+   * @param padWidth Padding width of the input, on both sides.
+   * @param padHeight Padding height of the input, on both sides.
+   * @param activation Activation applied to the output.
+   * @param alpha Slope of negative values, only used by LeakyReLU.
+   */
+  FusedConvolutionType(const size_t maps,
+                       const size_t kernelWidth,
+                       const size_t kernelHeight,
+                       const size_t strideWidth = 1,
+                       const size_t strideHeight = 1,
+                       const size_t padWidth = 0,
+                       const size_t padHeight = 0,
+                       const FusedActivation activation =
+                           FusedActivation::Identity,
+                       const double alpha = 0.1) :
+      maps(maps),
+      kernelWidth(kernelWidth),
+      kernelHeight(kernelHeight),
+      strideWidth(strideWidth),
+      strideHeight(strideHeight),
+      padWidth(padWidth),
+      padHeight(padHeight),
+      activation(activation),
+      alpha(alpha),
+      inMaps(0),
+      calibrating(false),
+      quantized(false),
+      inputRange(0),
+      inputScale(1),
+      useWinograd(true)
+  {
+    // Nothing to do here.
+  }
+
+  //! Create a copy of the layer (this is safe for polymorphic use).
+  FusedConvolutionType* Clone() const
+  {
+    return new FusedConvolutionType(*this);
+  }
+
+  //! Set the weights of the layer to alias the given memory.
+  void SetWeights(const MatType& weightsIn)
+  {
+    MakeAlias(weights, weightsIn, WeightSize(), 1);
+    MakeAlias(weight, weightsIn, KernelSize(), maps);
+    MakeAlias(bias, weightsIn, maps, 1, KernelSize() * maps);
+    winograd.Reset();
+  }
+
+  /**
+   * Computes the convolution, adds the bias and applies the activation.
+   *
+   * @param input Input images, one image per column.
+   * @param output Resulting output activations.
+   */
+  void Forward(const MatType& input, MatType& output)
+  {
+    Forward(input, output, 0);
+  }
+
+  /**
+   * Computes the convolution into rows of a larger output, e.g. the slice of
+   * a concatenation of several convolutions (see ChannelConcat). The output
+   * of image i is written to output.col(i) from the given row on.
+   *
+   * @param input Input images, one image per column.
+   * @param output Output holding the result of the layer.
+   * @param offset First row of the result of the layer.
+   */
+  void Forward(const MatType& input, MatType& output, const size_t offset)
+  {
+    if (quantized)
+    {
+      ForwardQuantized(input, output, offset);
+      return;
+    }
+
+    if (calibrating && input.n_elem > 0)
+      inputRange = std::max(inputRange, (double) arma::abs(input).max());
+
+    const size_t outputSize = OutputWidth() * OutputHeight();
+
+    // Kernels transformed for inference are outdated once the weights are
+    // trained.
+    const bool transform = UsesWinograd();
+    if (!transform)
+      winograd.Reset();
+    else if (!winograd.Transformed())
+      winograd.Transform(weight, inMaps);
+
+    #pragma omp parallel
+    {
+      MatType columns, inputTiles, outputTiles;
+      if (!transform)
+        columns.set_size(outputSize, KernelSize());
+
+      #pragma omp for schedule(static)
+      for (size_t i = 0; i < input.n_cols; i++)
+      {
+        // Output maps of the image are the columns of the product.
+        MatType result(output.colptr(i) + offset, outputSize, maps, false,
+            true);
+        if (transform)
+        {
+          winograd.Forward(input.colptr(i), this->inputDimensions[0],
+              this->inputDimensions[1], padWidth, padHeight, result.memptr(),
+              inputTiles, outputTiles);
+        }
+        else
+        {
+          Unroll(input.colptr(i), columns.memptr());
+          result = columns * weight;
+        }
+
+        for (size_t map = 0; map < maps; map++)
+        {
+          ElemType* values = result.colptr(map);
+          const ElemType mapBias = bias(map);
+          for (size_t p = 0; p < outputSize; p++)
+            values[p] = Activate(values[p] + mapBias);
+        }
+      }
+    }
+  }
+
+  /**
+   * Computes the gradient of the input. The derivative of the activation is
+   * taken from the output.
+   *
+   * @param input Input images passed to Forward().
+   * @param output Output of Forward().
+   * @param gy Gradient of the output.
+   * @param g Resulting gradient of the input.
+   */
+  void Backward(const MatType& /* input */,
+                const MatType& output,
+                const MatType& gy,
+                MatType& g)
+  {
+    g.zeros();
+    Backward(output, gy, 0, g);
+  }
+
+  /**
+   * Adds the gradient of the input to g, for a layer whose output and
+   * gradient are rows of larger matrices; see Forward() with an offset.
+   *
+   * @param output Output holding the result of the layer.
+   * @param gy Gradient of the output, with the same rows as output.
+   * @param offset First row of the result of the layer.
+   * @param g Gradient of the input the gradient of the layer is added to.
+   */
+  void Backward(const MatType& output,
+                const MatType& gy,
+                const size_t offset,
+                MatType& g)
+  {
+    const size_t outputSize = OutputWidth() * OutputHeight();
+    delta.set_size(outputSize * maps, gy.n_cols);
+    for (size_t i = 0; i < gy.n_cols; i++)
+    {
+      const ElemType* gradient = gy.colptr(i) + offset;
+      const ElemType* values = output.colptr(i) + offset;
+      ElemType* error = delta.colptr(i);
+      for (size_t j = 0; j < delta.n_rows; j++)
+        error[j] = gradient[j] * Derivative(values[j]);
+    }
+
+    #pragma omp parallel
+    {
+      MatType columns(outputSize, KernelSize());
+
+      #pragma omp for schedule(static)
+      for (size_t i = 0; i < delta.n_cols; i++)
+      {
+        const MatType error(delta.colptr(i), outputSize, maps, false,
+            true);
+        columns = error * weight.t();
+        Roll(columns, g.colptr(i));
+      }
+    }
+  }
+
+  /**
+   * Computes the gradient of the weights from the error of the last call of
+   * Backward().
+   *
+   * @param input Input images passed to Forward().
+   * @param error Gradient of the output.
+   * @param gradient Resulting gradient of the weights.
+   */
+  void Gradient(const MatType& input,
+                const MatType& /* error */,
+                MatType& gradient)
+  {
+    const size_t outputSize = OutputWidth() * OutputHeight();
+    MatType weightGradient(gradient.memptr(), KernelSize(), maps, false,
+        true);
+    MatType biasGradient(gradient.memptr() + KernelSize() * maps, maps, 1,
+        false, true);
+    weightGradient.zeros();
+    biasGradient.zeros();
+
+    MatType columns(outputSize, KernelSize());
+    for (size_t i = 0; i < input.n_cols; i++)
+    {
+      const MatType error(delta.colptr(i), outputSize, maps, false, true);
+      Unroll(input.colptr(i), columns.memptr());
+      weightGradient += columns.t() * error;
+      biasGradient += arma::sum(error, 0).t();
+    }
+  }
+
+  /**
+   * Starts recording the range of the inputs of Forward(), which is used by
+   * Quantize(). A quantized layer computes in floating point again until
+   * Quantize() is called.
+   */
+  void Calibrate()
+  {
+    calibrating = true;
+    quantized = false;
+    inputRange = 0;
+  }
+
+  /**
+   * Quantizes the layer with the range of the inputs recorded since
+   * Calibrate(). Kernels of every output map are scaled to [-127, 127] on
+   * their own; inputs share a single scale. The floating point weights are
+   * kept, so the layer can be calibrated and quantized again.
+   */
+  void Quantize()
+  {
+    if (!calibrating || inputRange <= 0)
+    {
+      mlpack::Log::Fatal << "FusedConvolution::Quantize(): no inputs were "
+          << "recorded; call Calibrate() and pass calibration data through "
+          << "the network first." << std::endl;
+    }
+
+    inputScale = inputRange / 127.0;
+    const size_t kernelSize = KernelSize();
+    quantizedWeight.resize(kernelSize * maps);
+    weightScales.resize(maps);
+    for (size_t map = 0; map < maps; map++)
+    {
+      const ElemType* kernel = weight.colptr(map);
+      double range = 0;
+      for (size_t k = 0; k < kernelSize; k++)
+        range = std::max(range, (double) std::abs(kernel[k]));
+
+      weightScales[map] = (range > 0) ? range / 127.0 : 1.0;
+      for (size_t k = 0; k < kernelSize; k++)
+      {
+        quantizedWeight[map * kernelSize + k] = QuantizeValue(kernel[k],
+            weightScales[map]);
+      }
+    }
+
+    calibrating = false;
+    quantized = true;
+  }
+
+  //! Get whether the layer computes with 8-bit integers.
+  bool Quantized() const { return quantized; }
+
+  //! Get whether eligible convolutions use Winograd's algorithm for
+  //! inference.
+  bool Winograd() const { return useWinograd; }
+  //! Modify whether eligible convolutions use Winograd's algorithm for
+  //! inference.
+  bool& Winograd() { return useWinograd; }
+
+  //! Get the number of weights of the layer.
+  size_t WeightSize() const { return (KernelSize() + 1) * maps; }
+
+  //! Compute the output dimensions of the layer from its input dimensions.
+  void ComputeOutputDimensions()
+  {
+    inMaps = (this->inputDimensions.size() > 2) ?
+        this->inputDimensions[2] : 1;
+    if (this->inputDimensions[0] + 2 * padWidth < kernelWidth ||
+        this->inputDimensions[1] + 2 * padHeight < kernelHeight)
+    {
+      mlpack::Log::Fatal << "Input of shape {" << this->inputDimensions[0]
+          << ", " << this->inputDimensions[1] << "} is smaller than the "
+          << "kernel of shape {" << kernelWidth << ", " << kernelHeight
+          << "}." << std::endl;
+    }
+
+    // Higher dimensions are processed like additional input maps.
+    for (size_t i = 3; i < this->inputDimensions.size(); i++)
+      inMaps *= this->inputDimensions[i];
+
+    this->outputDimensions = { (this->inputDimensions[0] + 2 * padWidth -
+        kernelWidth) / strideWidth + 1, (this->inputDimensions[1] +
+        2 * padHeight - kernelHeight) / strideHeight + 1, maps };
+  }
+
+  //! Get the parameters.
+  const MatType& Parameters() const { return weights; }
+  //! Modify the parameters.
+  MatType& Parameters() { return weights; }
+
+  //! Get the number of output maps.
+  size_t Maps() const { return maps; }
+
+  //! Get the activation applied to the output.
+  FusedActivation Activation() const { return activation; }
+  //! Modify the activation applied to the output.
+  FusedActivation& Activation() { return activation; }
+
+  //! Get the slope of negative values of LeakyReLU.
+  double Alpha() const { return alpha; }
+  //! Modify the slope of negative values of LeakyReLU.
+  double& Alpha() { return alpha; }
+
+  //! Serialize the layer.
+  template<typename Archive>
+  void serialize(Archive& ar, const uint32_t /* version */)
+  {
+    ar(cereal::base_class<Layer<MatType>>(this));
+
+    ar(CEREAL_NVP(maps));
+    ar(CEREAL_NVP(kernelWidth));
+    ar(CEREAL_NVP(kernelHeight));
+    ar(CEREAL_NVP(strideWidth));
+    ar(CEREAL_NVP(strideHeight));
+    ar(CEREAL_NVP(padWidth));
+    ar(CEREAL_NVP(padHeight));
+    ar(CEREAL_NVP(activation));
+    ar(CEREAL_NVP(alpha));
+    ar(CEREAL_NVP(inMaps));
+    ar(CEREAL_NVP(quantized));
+    if (quantized)
+    {
+      ar(CEREAL_NVP(inputRange));
+      ar(CEREAL_NVP(inputScale));
+      ar(CEREAL_NVP(quantizedWeight));
+      ar(CEREAL_NVP(weightScales));
+    }
+  }
+
+ private:
+  //! Get the number of weights of a single output map.
+  size_t KernelSize() const { return kernelWidth * kernelHeight * inMaps; }
+
+  //! Returns true if Forward() computes with Winograd's algorithm.
+  bool UsesWinograd() const
+  {
+    return useWinograd && !this->training &&
+        WinogradConvolution<MatType>::Supports(kernelWidth, kernelHeight,
+        strideWidth, strideHeight);
+  }
+
+  //! Get the width of an output map.
+  size_t OutputWidth() const { return this->outputDimensions[0]; }
+
+  //! Get the height of an output map.
+  size_t OutputHeight() const { return this->outputDimensions[1]; }
+
+  /**
+   * Computes the convolution over 8-bit inputs and kernels. Every image is
+   * quantized once and unrolled into 8-bit patches, the sums of every output
+   * map are accumulated in 32-bit integers and scaled back before the bias
+   * and the activation are applied.
+   */
+  void ForwardQuantized(const MatType& input,
+                        MatType& output,
+                        const size_t offset) const
+  {
+    const size_t outputSize = OutputWidth() * OutputHeight();
+    const size_t imageSize = this->inputDimensions[0] *
+        this->inputDimensions[1] * inMaps;
+    const size_t kernelSize = KernelSize();
+
+    #pragma omp parallel
+    {
+      std::vector<int8_t> image(imageSize);
+      std::vector<int8_t> columns(outputSize * kernelSize);
+      std::vector<int32_t> sums(outputSize);
+
+      #pragma omp for schedule(static)
+      for (size_t i = 0; i < input.n_cols; i++)
+      {
+        const ElemType* values = input.colptr(i);
+        for (size_t j = 0; j < imageSize; j++)
+          image[j] = QuantizeValue(values[j], inputScale);
+
+        Unroll(image.data(), columns.data());
+
+        for (size_t map = 0; map < maps; map++)
+        {
+          // Patches are stored column by column, so the inner loop runs over
+          // contiguous memory.
+          std::fill(sums.begin(), sums.end(), 0);
+          const int8_t* kernel = quantizedWeight.data() + map * kernelSize;
+          for (size_t k = 0; k < kernelSize; k++)
+          {
+            const int32_t w = kernel[k];
+            const int8_t* column = columns.data() + k * outputSize;
+            for (size_t p = 0; p < outputSize; p++)
+              sums[p] += w * column[p];
+          }
+
+          const double scale = inputScale * weightScales[map];
+          const ElemType mapBias = bias(map);
+          ElemType* result = output.colptr(i) + offset + map * outputSize;
+          for (size_t p = 0; p < outputSize; p++)
+            result[p] = Activate(ElemType(sums[p] * scale) + mapBias);
+        }
+      }
+    }
+  }
+
+  //! Rounds a value to an 8-bit integer of the given scale, values out of
+  //! range are clamped.
+  static int8_t QuantizeValue(const double value, const double scale)
+  {
+    return int8_t(std::min(std::max(std::round(value / scale), -127.0),
+        127.0));
+  }
+
+  /**
+   * Unrolls an image into patches, stored column by column. Element p of
+   * column kx + kernelWidth * (ky + kernelHeight * c) holds the kernel
+   * position (kx, ky) of input map c for output position p. Positions in the
+   * padding are zero.
+   */
+  template<typename InputType, typename OutputType>
+  void Unroll(const InputType* image, OutputType* columns) const
+  {
+    const size_t width = this->inputDimensions[0];
+    const size_t height = this->inputDimensions[1];
+    const size_t outputWidth = OutputWidth();
+    const size_t outputHeight = OutputHeight();
+    for (size_t c = 0; c < inMaps; c++)
+    {
+      const InputType* plane = image + c * width * height;
+      for (size_t ky = 0; ky < kernelHeight; ky++)
+      {
+        for (size_t kx = 0; kx < kernelWidth; kx++)
+        {
+          OutputType* column = columns + (kx + kernelWidth *
+              (ky + kernelHeight * c)) * outputWidth * outputHeight;
+          for (size_t y = 0; y < outputHeight; y++)
+          {
+            // Signed positions, the padding comes before the image.
+            const ptrdiff_t sourceY = ptrdiff_t(y * strideHeight + ky) -
+                ptrdiff_t(padHeight);
+            OutputType* row = column + y * outputWidth;
+            if (sourceY < 0 || sourceY >= ptrdiff_t(height))
+            {
+              std::fill(row, row + outputWidth, OutputType(0));
+              continue;
+            }
+
+            const InputType* source = plane + sourceY * width;
+            for (size_t x = 0; x < outputWidth; x++)
+            {
+              const ptrdiff_t sourceX = ptrdiff_t(x * strideWidth + kx) -
+                  ptrdiff_t(padWidth);
+              row[x] = (sourceX < 0 || sourceX >= ptrdiff_t(width)) ?
+                  OutputType(0) : OutputType(source[sourceX]);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  //! Adds patches back to the positions of the image they were unrolled
+  //! from, the inverse of Unroll().
+  void Roll(const MatType& columns, ElemType* image) const
+  {
+    const size_t width = this->inputDimensions[0];
+    const size_t height = this->inputDimensions[1];
+    const size_t outputWidth = OutputWidth();
+    const size_t outputHeight = OutputHeight();
+    for (size_t c = 0; c < inMaps; c++)
+    {
+      ElemType* plane = image + c * width * height;
+      for (size_t ky = 0; ky < kernelHeight; ky++)
+      {
+        for (size_t kx = 0; kx < kernelWidth; kx++)
+        {
+          const ElemType* column = columns.colptr(kx + kernelWidth *
+              (ky + kernelHeight * c));
+          for (size_t y = 0; y < outputHeight; y++)
+          {
+            const ptrdiff_t sourceY = ptrdiff_t(y * strideHeight + ky) -
+                ptrdiff_t(padHeight);
+            if (sourceY < 0 || sourceY >= ptrdiff_t(height))
+              continue;
+
+            const ElemType* row = column + y * outputWidth;
+            ElemType* source = plane + sourceY * width;
+            for (size_t x = 0; x < outputWidth; x++)
+            {
+              const ptrdiff_t sourceX = ptrdiff_t(x * strideWidth + kx) -
+                  ptrdiff_t(padWidth);
+              if (sourceX >= 0 && sourceX < ptrdiff_t(width))
+                source[sourceX] += row[x];
+            }
+          }
+        }
+      }
+    }
+  }
+
+  //! Applies the activation to a value.
+  ElemType Activate(const ElemType x) const
+  {
+    switch (activation)
+    {
+      case FusedActivation::ReLU:
+        return std::max(x, ElemType(0));
+      case FusedActivation::ReLU6:
+        return std::min(std::max(x, ElemType(0)), ElemType(6));
+      case FusedActivation::LeakyReLU:
+        return (x > 0) ? x : ElemType(alpha * x);
+      default:
+        return x;
+    }
+  }
+
+  //! Computes the derivative of the activation from its output.
+  ElemType Derivative(const ElemType y) const
+  {
+    switch (activation)
+    {
+      case FusedActivation::ReLU:
+        return (y > 0) ? ElemType(1) : ElemType(0);
+      case FusedActivation::ReLU6:
+        return (y > 0 && y < 6) ? ElemType(1) : ElemType(0);
+      case FusedActivation::LeakyReLU:
+        return (y > 0) ? ElemType(1) : ElemType(alpha);
+      default:
+        return ElemType(1);
+    }
+  }
+
+  //! Locally stored number of output maps.
+  size_t maps;
+
+  //! Locally stored width of the kernel.
+  size_t kernelWidth;
+
+  //! Locally stored height of the kernel.
+  size_t kernelHeight;
+
+  //! Locally stored stride in the x direction.
+  size_t strideWidth;
+
+  //! Locally stored stride in the y direction.
+  size_t strideHeight;
+
+  //! Locally stored padding width.
+  size_t padWidth;
+
+  //! Locally stored padding height.
+  size_t padHeight;
+
+  //! Locally stored activation.
+  FusedActivation activation;
+
+  //! Locally stored slope of negative values of LeakyReLU.
+  double alpha;
+
+  //! Locally stored number of input maps.
+  size_t inMaps;
+
+  //! Locally stored weights and biases.
+  MatType weights;
+
+  //! Locally stored kernels, one output map per column.
+  MatType weight;
+
+  //! Locally stored bias of every output map.
+  MatType bias;
+
+  //! Locally stored gradient of the output before the activation.
+  MatType delta;
+
+  //! Locally stored if the range of the inputs is recorded.
+  bool calibrating;
+
+  //! Locally stored if the layer computes with 8-bit integers.
+  bool quantized;
+
+  //! Locally stored largest absolute value of the recorded inputs.
+  double inputRange;
+
+  //! Locally stored scale of the quantized inputs.
+  double inputScale;
+
+  //! Locally stored quantized kernels, output map by output map.
+  std::vector<int8_t> quantizedWeight;
+
+  //! Locally stored scale of the quantized kernel of every output map.
+  std::vector<double> weightScales;
+
+  //! Locally stored if eligible convolutions use Winograd's algorithm.
+  bool useWinograd;
+
+  //! Locally stored Winograd convolution with the transformed kernels.
+  WinogradConvolution<MatType> winograd;
+}; // FusedConvolutionType class.
+
+// Standard FusedConvolution layer.
+typedef FusedConvolutionType<arma::mat> FusedConvolution;
+
+} // namespace models
+} // namespace mlpack
+
+CEREAL_REGISTER_TYPE(mlpack::models::FusedConvolutionType<arma::mat>);
+
+#endif
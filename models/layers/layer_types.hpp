@@ -0,0 +1,48 @@
+/**
+ * @file layer_types.hpp
+ * @author Kartik Dutt
+ *
+ * Convenience templates for mlpack layers whose matrix type is not their only
+ * template parameter.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_LAYERS_LAYER_TYPES_HPP
+#define MODELS_MODELS_LAYERS_LAYER_TYPES_HPP
+
+#include <mlpack.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Convolution with the default convolution rules for the given matrix type,
+ * e.g. DefaultConvolutionType<arma::fmat> for single precision.
+ * DefaultConvolutionType<arma::mat> is mlpack's Convolution.
+ */
+template<typename MatType = arma::mat>
+using DefaultConvolutionType = ConvolutionType<
+    NaiveConvolution<ValidConvolution>,
+    NaiveConvolution<FullConvolution>,
+    NaiveConvolution<ValidConvolution>,
+    MatType>;
+
+/**
+ * Grouped convolution with the default convolution rules for the given
+ * matrix type. DefaultGroupedConvolutionType<arma::mat> is mlpack's
+ * GroupedConvolution.
+ */
+template<typename MatType = arma::mat>
+using DefaultGroupedConvolutionType = GroupedConvolutionType<
+    NaiveConvolution<ValidConvolution>,
+    NaiveConvolution<FullConvolution>,
+    NaiveConvolution<ValidConvolution>,
+    MatType>;
+
+} // namespace models
+} // namespace mlpack
+
+#endif
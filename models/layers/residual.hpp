@@ -0,0 +1,314 @@
+/**
+ * @file residual.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of Residual, which adds the shortcut of a residual block into the
+ * output of its main branch and applies the activation in the same pass.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_LAYERS_RESIDUAL_HPP
+#define MODELS_MODELS_LAYERS_RESIDUAL_HPP
+
+#include <mlpack.hpp>
+#include <models/layers/fused_convolution.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Residual computes activation(main(x) + shortcut(x)), where the shortcut is
+ * either a layer, e.g. a strided 1x1 convolution, or the identity. It
+ * replaces AddMerge followed by an activation layer: AddMerge computes every
+ * branch into a buffer of its own, adds them into a new output, and the
+ * activation layer writes yet another output.
+ *
+ * When the network isn't training, the main branch computes directly into
+ * the output of the layer, and the shortcut (or the input itself) is added
+ * and the activation applied in a single pass over it. While training, the
+ * output of the main branch is kept for its backward pass, so only the
+ * activation layer is saved.
+ *
+ * The first layer added is the main branch, the second one, if any, the
+ * shortcut. Weights are stored branch by branch, like those of AddMerge.
+ *
+ * @code
+ * // Basic ResNet block with an identity shortcut.
+ * MultiLayer<>* block = new MultiLayer<>();
+ * block->Add<Convolution>(64, 3, 3, 1, 1, 1, 1);
+ * block->Add<BatchNorm>();
+ * block->Add<ReLU>();
+ * block->Add<Convolution>(64, 3, 3, 1, 1, 1, 1);
+ * block->Add<BatchNorm>();
+ *
+ * models::Residual* residual =
+ *     new models::Residual(models::FusedActivation::ReLU);
+ * residual->Add(block);
+ * model.Add(residual);
+ * @endcode
+ *
+ * @tparam MatType Matrix representation to accept as input and use for
+ *    computation.
+ */
+template<typename MatType = arma::mat>
+class ResidualType : public MultiLayer<MatType>
+{
+ public:
+  typedef typename MatType::elem_type ElemType;
+
+  /**
+   * Create an empty ResidualType; add the main branch and the shortcut with
+   * Add().
+   *
+   * @param activation Activation applied to the sum.
+   * @param alpha Slope of negative values, only used by LeakyReLU.
+   */
+  ResidualType(const FusedActivation activation = FusedActivation::Identity,
+               const double alpha = 0.1) :
+      MultiLayer<MatType>(),
+      activation(activation),
+      alpha(alpha)
+  {
+    // Nothing to do here.
+  }
+
+  //! Create a copy of the layer (this is safe for polymorphic use).
+  ResidualType* Clone() const { return new ResidualType(*this); }
+
+  /**
+   * Computes the main branch and the shortcut, adds them and applies the
+   * activation.
+   *
+   * @param input Input of the block, one input per column.
+   * @param output Resulting output of the block.
+   */
+  void Forward(const MatType& input, MatType& output)
+  {
+    if (!this->training)
+    {
+      // The output of the main branch isn't needed afterwards: accumulate
+      // into it.
+      this->network[0]->Forward(input, output);
+      if (this->network.size() > 1)
+      {
+        shortcutOutput.set_size(output.n_rows, output.n_cols);
+        this->network[1]->Forward(input, shortcutOutput);
+        Merge(shortcutOutput, output);
+      }
+      else
+      {
+        Merge(input, output);
+      }
+
+      return;
+    }
+
+    mainOutput.set_size(output.n_rows, output.n_cols);
+    this->network[0]->Forward(input, mainOutput);
+
+    const MatType* shortcut = &input;
+    if (this->network.size() > 1)
+    {
+      shortcutOutput.set_size(output.n_rows, output.n_cols);
+      this->network[1]->Forward(input, shortcutOutput);
+      shortcut = &shortcutOutput;
+    }
+
+    const ElemType* main = mainOutput.memptr();
+    const ElemType* values = shortcut->memptr();
+    ElemType* result = output.memptr();
+    for (size_t i = 0; i < output.n_elem; i++)
+      result[i] = Activate(main[i] + values[i]);
+  }
+
+  /**
+   * Adds the shortcut into the output of the main branch and applies the
+   * activation, in place.
+   *
+   * @param shortcut Output of the shortcut, or the input of the block for
+   *     an identity shortcut.
+   * @param output Output of the main branch, overwritten with the output of
+   *     the block.
+   */
+  void Merge(const MatType& shortcut, MatType& output) const
+  {
+    const ElemType* values = shortcut.memptr();
+    ElemType* result = output.memptr();
+    for (size_t i = 0; i < output.n_elem; i++)
+      result[i] = Activate(result[i] + values[i]);
+  }
+
+  /**
+   * Computes the gradient of the input, the sum of the gradients through
+   * the main branch and the shortcut.
+   *
+   * @param input Input of the block passed to Forward().
+   * @param output Output of Forward().
+   * @param gy Gradient of the output.
+   * @param g Resulting gradient of the input.
+   */
+  void Backward(const MatType& input,
+                const MatType& output,
+                const MatType& gy,
+                MatType& g)
+  {
+    delta.set_size(gy.n_rows, gy.n_cols);
+    for (size_t i = 0; i < gy.n_elem; i++)
+      delta[i] = gy[i] * Derivative(output[i]);
+
+    this->network[0]->Backward(input, mainOutput, delta, g);
+    if (this->network.size() > 1)
+    {
+      shortcutDelta.set_size(g.n_rows, g.n_cols);
+      this->network[1]->Backward(input, shortcutOutput, delta,
+          shortcutDelta);
+      g += shortcutDelta;
+    }
+    else
+    {
+      g += delta;
+    }
+  }
+
+  /**
+   * Computes the gradient of the weights of both branches.
+   *
+   * @param input Input of the block passed to Forward().
+   * @param error Gradient of the output.
+   * @param gradient Resulting gradient of the weights.
+   */
+  void Gradient(const MatType& input,
+                const MatType& /* error */,
+                MatType& gradient)
+  {
+    size_t offset = 0;
+    for (size_t i = 0; i < this->network.size(); i++)
+    {
+      const size_t weights = this->network[i]->WeightSize();
+      if (weights > 0)
+      {
+        MatType branchGradient(gradient.memptr() + offset, weights, 1, false,
+            true);
+        this->network[i]->Gradient(input, delta, branchGradient);
+      }
+
+      offset += weights;
+    }
+  }
+
+  //! Compute the output dimensions of the layer from its input dimensions.
+  void ComputeOutputDimensions()
+  {
+    if (this->network.empty() || this->network.size() > 2)
+    {
+      mlpack::Log::Fatal << "Residual: expected a main branch and at most one "
+          << "shortcut, but " << this->network.size() << " layers were added."
+          << std::endl;
+    }
+
+    for (size_t i = 0; i < this->network.size(); i++)
+    {
+      this->network[i]->InputDimensions() = this->inputDimensions;
+      this->network[i]->ComputeOutputDimensions();
+    }
+
+    this->outputDimensions = this->network[0]->OutputDimensions();
+    const std::vector<size_t>& shortcutDimensions =
+        (this->network.size() > 1) ? this->network[1]->OutputDimensions() :
+        this->inputDimensions;
+    if (Size(shortcutDimensions) != Size(this->outputDimensions))
+    {
+      mlpack::Log::Fatal << "Residual: output of the main branch has "
+          << Size(this->outputDimensions) << " elements, but the shortcut "
+          << "has " << Size(shortcutDimensions) << "." << std::endl;
+    }
+  }
+
+  //! Get the activation applied to the sum.
+  FusedActivation Activation() const { return activation; }
+  //! Modify the activation applied to the sum.
+  FusedActivation& Activation() { return activation; }
+
+  //! Serialize the layer.
+  template<typename Archive>
+  void serialize(Archive& ar, const uint32_t /* version */)
+  {
+    ar(cereal::base_class<MultiLayer<MatType>>(this));
+
+    ar(CEREAL_NVP(activation));
+    ar(CEREAL_NVP(alpha));
+  }
+
+ private:
+  //! Get the number of elements of a tensor of the given dimensions.
+  static size_t Size(const std::vector<size_t>& dimensions)
+  {
+    size_t size = 1;
+    for (size_t dimension : dimensions)
+      size *= dimension;
+    return size;
+  }
+
+  //! Applies the activation to a value.
+  ElemType Activate(const ElemType x) const
+  {
+    switch (activation)
+    {
+      case FusedActivation::ReLU:
+        return std::max(x, ElemType(0));
+      case FusedActivation::ReLU6:
+        return std::min(std::max(x, ElemType(0)), ElemType(6));
+      case FusedActivation::LeakyReLU:
+        return (x > 0) ? x : ElemType(alpha * x);
+      default:
+        return x;
+    }
+  }
+
+  //! Computes the derivative of the activation from its output.
+  ElemType Derivative(const ElemType y) const
+  {
+    switch (activation)
+    {
+      case FusedActivation::ReLU:
+        return (y > 0) ? ElemType(1) : ElemType(0);
+      case FusedActivation::ReLU6:
+        return (y > 0 && y < 6) ? ElemType(1) : ElemType(0);
+      case FusedActivation::LeakyReLU:
+        return (y > 0) ? ElemType(1) : ElemType(alpha);
+      default:
+        return ElemType(1);
+    }
+  }
+
+  //! Locally stored activation.
+  FusedActivation activation;
+
+  //! Locally stored slope of negative values of LeakyReLU.
+  double alpha;
+
+  //! Locally stored output of the main branch, only while training.
+  MatType mainOutput;
+
+  //! Locally stored output of the shortcut.
+  MatType shortcutOutput;
+
+  //! Locally stored gradient of the sum.
+  MatType delta;
+
+  //! Locally stored gradient of the input through the shortcut.
+  MatType shortcutDelta;
+}; // ResidualType class.
+
+// Standard Residual layer.
+typedef ResidualType<arma::mat> Residual;
+
+} // namespace models
+} // namespace mlpack
+
+CEREAL_REGISTER_TYPE(mlpack::models::ResidualType<arma::mat>);
+
+#endif
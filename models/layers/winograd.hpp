@@ -0,0 +1,268 @@
+/**
+ * @file winograd.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of WinogradConvolution, which computes 3x3 convolutions of stride
+ * 1 with Winograd's minimal filtering algorithm F(2x2, 3x3).
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_LAYERS_WINOGRAD_HPP
+#define MODELS_MODELS_LAYERS_WINOGRAD_HPP
+
+#include <mlpack.hpp>
+#include <algorithm>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Winograd convolution F(2x2, 3x3). The output is split into tiles of 2x2
+ * positions, each computed from a 4x4 tile of the input. Input tiles and
+ * kernels are transformed so that a tile of the output takes 16
+ * multiplications per input map instead of 36; for a tile position all input
+ * maps and output maps are then a single matrix multiplication, so a block
+ * of tiles takes 16 of them. The transformed kernels only depend on the
+ * weights and are computed once by Transform().
+ *
+ * The engine is used by FusedConvolution for its 3x3 convolutions of stride 1
+ * while it isn't trained; see FusedConvolutionType::Winograd().
+ *
+ * @tparam MatType Matrix representation to accept as input and use for
+ *    computation.
+ */
+template<typename MatType = arma::mat>
+class WinogradConvolution
+{
+ public:
+  typedef typename MatType::elem_type ElemType;
+
+  //! Create a WinogradConvolution object without transformed kernels.
+  WinogradConvolution() : inMaps(0), maps(0), transformed(false)
+  {
+    // Nothing to do here.
+  }
+
+  //! Returns true if a convolution of the given shape can be computed.
+  static bool Supports(const size_t kernelWidth,
+                       const size_t kernelHeight,
+                       const size_t strideWidth,
+                       const size_t strideHeight)
+  {
+    return kernelWidth == 3 && kernelHeight == 3 && strideWidth == 1 &&
+        strideHeight == 1;
+  }
+
+  /**
+   * Transforms the given kernels. Kernels are stored like the kernels of
+   * FusedConvolution, i.e. position (kx, ky) of input map c of the kernel of
+   * an output map is row kx + 3 * (ky + 3 * c) of its column.
+   *
+   * @param weight Kernels, one output map per column.
+   * @param inMaps Number of input maps.
+   */
+  void Transform(const MatType& weight, const size_t inMaps)
+  {
+    this->inMaps = inMaps;
+    maps = weight.n_cols;
+
+    // Position i + 4 * j of the transformed kernels is the matrix of columns
+    // (i + 4 * j) * maps to (i + 4 * j + 1) * maps - 1.
+    kernels.set_size(inMaps, 16 * maps);
+    for (size_t map = 0; map < maps; map++)
+    {
+      for (size_t c = 0; c < inMaps; c++)
+      {
+        const ElemType* g = weight.colptr(map) + 9 * c;
+        ElemType rows[12], u[16];
+
+        // G g along x for every row of the kernel, then along y.
+        for (size_t ky = 0; ky < 3; ky++)
+        {
+          const ElemType* row = g + 3 * ky;
+          rows[4 * ky] = row[0];
+          rows[4 * ky + 1] = (row[0] + row[1] + row[2]) / 2;
+          rows[4 * ky + 2] = (row[0] - row[1] + row[2]) / 2;
+          rows[4 * ky + 3] = row[2];
+        }
+
+        for (size_t i = 0; i < 4; i++)
+        {
+          u[i] = rows[i];
+          u[i + 4] = (rows[i] + rows[i + 4] + rows[i + 8]) / 2;
+          u[i + 8] = (rows[i] - rows[i + 4] + rows[i + 8]) / 2;
+          u[i + 12] = rows[i + 8];
+        }
+
+        for (size_t p = 0; p < 16; p++)
+          kernels(c, p * maps + map) = u[p];
+      }
+    }
+
+    transformed = true;
+  }
+
+  //! Discard the transformed kernels, e.g. after the weights changed.
+  void Reset() { transformed = false; }
+
+  //! Get whether the kernels are transformed.
+  bool Transformed() const { return transformed; }
+
+  /**
+   * Computes the convolution of a single image. Output maps are stored one
+   * after another, like the output of FusedConvolution; the bias isn't
+   * added. The given matrices are the workspace of the calling thread and
+   * hold the transformed tiles of a block.
+   *
+   * @param image Input maps of the image, one after another.
+   * @param width Width of the input maps.
+   * @param height Height of the input maps.
+   * @param padWidth Padding width of the input, on both sides.
+   * @param padHeight Padding height of the input, on both sides.
+   * @param output Resulting output maps.
+   * @param inputTiles Workspace for the transformed input tiles.
+   * @param outputTiles Workspace for the transformed output tiles.
+   */
+  void Forward(const ElemType* image,
+               const size_t width,
+               const size_t height,
+               const size_t padWidth,
+               const size_t padHeight,
+               ElemType* output,
+               MatType& inputTiles,
+               MatType& outputTiles) const
+  {
+    const size_t outputWidth = width + 2 * padWidth - 2;
+    const size_t outputHeight = height + 2 * padHeight - 2;
+    const size_t outputSize = outputWidth * outputHeight;
+    const size_t tilesX = (outputWidth + 1) / 2;
+    const size_t tiles = tilesX * ((outputHeight + 1) / 2);
+
+    // Blocks of tiles keep the workspace small for large images, and the
+    // multiplications large enough to be efficient.
+    const size_t blockSize = 64;
+    inputTiles.set_size(std::min(blockSize, tiles) * inMaps, 16);
+    outputTiles.set_size(std::min(blockSize, tiles) * maps, 16);
+
+    for (size_t first = 0; first < tiles; first += blockSize)
+    {
+      const size_t count = std::min(blockSize, tiles - first);
+
+      // Column p of the workspace holds position p of all tiles of the
+      // block, a count x inMaps matrix.
+      for (size_t c = 0; c < inMaps; c++)
+      {
+        const ElemType* plane = image + c * width * height;
+        for (size_t t = 0; t < count; t++)
+        {
+          const ptrdiff_t x0 = ptrdiff_t(2 * ((first + t) % tilesX)) -
+              ptrdiff_t(padWidth);
+          const ptrdiff_t y0 = ptrdiff_t(2 * ((first + t) / tilesX)) -
+              ptrdiff_t(padHeight);
+
+          // Positions in the padding and beyond the image are zero.
+          ElemType d[16];
+          for (size_t j = 0; j < 4; j++)
+          {
+            const ptrdiff_t y = y0 + ptrdiff_t(j);
+            for (size_t i = 0; i < 4; i++)
+            {
+              const ptrdiff_t x = x0 + ptrdiff_t(i);
+              d[i + 4 * j] = (x < 0 || x >= ptrdiff_t(width) || y < 0 ||
+                  y >= ptrdiff_t(height)) ? ElemType(0) :
+                  plane[x + y * ptrdiff_t(width)];
+            }
+          }
+
+          // B^T d along x for every row of the tile, then along y.
+          ElemType rows[16];
+          for (size_t j = 0; j < 4; j++)
+          {
+            const ElemType* row = d + 4 * j;
+            rows[4 * j] = row[0] - row[2];
+            rows[4 * j + 1] = row[1] + row[2];
+            rows[4 * j + 2] = row[2] - row[1];
+            rows[4 * j + 3] = row[1] - row[3];
+          }
+
+          const size_t index = c * count + t;
+          for (size_t i = 0; i < 4; i++)
+          {
+            inputTiles(index, i) = rows[i] - rows[i + 8];
+            inputTiles(index, i + 4) = rows[i + 4] + rows[i + 8];
+            inputTiles(index, i + 8) = rows[i + 8] - rows[i + 4];
+            inputTiles(index, i + 12) = rows[i + 4] - rows[i + 12];
+          }
+        }
+      }
+
+      for (size_t p = 0; p < 16; p++)
+      {
+        const MatType v(inputTiles.colptr(p), count, inMaps, false, true);
+        const MatType u(const_cast<ElemType*>(kernels.colptr(p * maps)),
+            inMaps, maps, false, true);
+        MatType m(outputTiles.colptr(p), count, maps, false, true);
+        m = v * u;
+      }
+
+      for (size_t map = 0; map < maps; map++)
+      {
+        ElemType* result = output + map * outputSize;
+        for (size_t t = 0; t < count; t++)
+        {
+          const size_t index = map * count + t;
+          ElemType m[16];
+          for (size_t p = 0; p < 16; p++)
+            m[p] = outputTiles(index, p);
+
+          // A^T m along x for every row of the tile, then along y.
+          ElemType rows[8];
+          for (size_t j = 0; j < 4; j++)
+          {
+            const ElemType* row = m + 4 * j;
+            rows[2 * j] = row[0] + row[1] + row[2];
+            rows[2 * j + 1] = row[1] - row[2] - row[3];
+          }
+
+          const size_t x0 = 2 * ((first + t) % tilesX);
+          const size_t y0 = 2 * ((first + t) / tilesX);
+          for (size_t i = 0; i < 2; i++)
+          {
+            // Tiles at the border of an output of odd size are cropped.
+            if (x0 + i >= outputWidth)
+              continue;
+
+            result[x0 + i + y0 * outputWidth] = rows[i] + rows[i + 2] +
+                rows[i + 4];
+            if (y0 + 1 < outputHeight)
+            {
+              result[x0 + i + (y0 + 1) * outputWidth] = rows[i + 2] -
+                  rows[i + 4] - rows[i + 6];
+            }
+          }
+        }
+      }
+    }
+  }
+
+ private:
+  //! Locally stored number of input maps.
+  size_t inMaps;
+
+  //! Locally stored number of output maps.
+  size_t maps;
+
+  //! Locally stored if the kernels are transformed.
+  bool transformed;
+
+  //! Locally stored transformed kernels, see Transform().
+  MatType kernels;
+}; // WinogradConvolution class.
+
+} // namespace models
+} // namespace mlpack
+
+#endif
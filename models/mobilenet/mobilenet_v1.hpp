@@ -27,8 +27,13 @@
 
 #define MLPACK_ENABLE_ANN_SERIALIZATION
 #include <mlpack.hpp>
-
-#include "./../../utils/utils.hpp"
+#include <models/common/batch_norm_folding.hpp>
+#include <models/common/model_summary.hpp>
+#include <models/common/pretrained_weights.hpp>
+#include <models/common/quantization.hpp>
+#include <models/layers/depthwise_convolution.hpp>
+#include <models/layers/fused_convolution.hpp>
+#include <models/layers/layer_types.hpp>
 
 namespace mlpack {
 namespace models {
@@ -36,311 +41,264 @@ namespace models {
 /**
  * Definition of a MobileNet V1 CNN.
  * 
- * @tparam OutputLayerType The output layer type used to evaluate the network.
- * @tparam InitializationRuleType Rule used to initialize the weight matrix.
+ * @tparam MatType Matrix representation to accept as input and use for
+ *    computation, e.g. arma::fmat for single precision.
  */
 template<
-  typename OutputLayerType = CrossEntropyError<>,
-  typename InitializationRuleType = RandomInitialization
+  typename MatType = arma::mat
 >
-class MobileNetV1
+class MobileNetV1Type : public MultiLayer<MatType>
 {
  public:
-  //! Create the MobileNet model.
-  MobileNetV1();
-
   /**
-   * MobileNetV1 constructor initializes input shape and number of classes.
+   * MobileNetV1Type constructor initializes number of classes and weights.
    *
-   * @param inputChannels Number of input channels of the input image.
-   * @param inputWidth Width of the input image.
-   * @param inputHeight Height of the input image.
-   * @param includeTop Must be set to true if preTrained is set to true.
-   * @param preTrained True for pre-trained weights of ImageNet,
-   *    default is false.
    * @param numClasses Optional number of classes to classify images into,
    *     only to be specified if includeTop is true, default is 1000.
+   * @param alpha Controls the number of output channels of the pointwise
+   *     convolutions.
+   * @param depthMultiplier Controls the number of output channels of the
+   *     depthwise convolutions.
+   * @param includeTop Must be set to true if classifier layers are set, and
+   *     if preTrained is set to true.
+   * @param preTrained True for pre-trained weights of ImageNet, which are
+   *     chosen by alpha and the width of the input images, fetched through
+   *     PublishedWeights and copied into the model once the network holding
+   *     it is reset; see LoadModel().
+   * @param fused Whether every pointwise convolution, its batch normalization
+   *     and its ReLU6 are computed by a single FusedConvolution layer, which
+   *     is faster for inference. Use GetInferenceModel() to get the weights
+   *     of a trained network.
    */
-  MobileNetV1(const size_t inputChannel,
-              const size_t inputWidth,
-              const size_t inputHeight,
-              const float alpha = 1.0,
-              const size_t depthMultiplier = 1.0,
-              const bool includeTop = true,
-              const bool preTrained = false,
-              const size_t numClasses = 1000);
+  MobileNetV1Type(const size_t numClasses = 1000,
+                  const float alpha = 1.0,
+                  const size_t depthMultiplier = 1,
+                  const bool includeTop = true,
+                  const bool preTrained = false,
+                  const bool fused = false);
+
+  //! Copy the given MobileNetV1Type.
+  MobileNetV1Type(const MobileNetV1Type& other);
+  //! Take ownership of the layers of the given MobileNetV1Type.
+  MobileNetV1Type(MobileNetV1Type&& other);
+  //! Copy the given MobileNetV1Type.
+  MobileNetV1Type& operator=(const MobileNetV1Type& other);
+  //! Take ownership of the given MobileNetV1Type.
+  MobileNetV1Type& operator=(MobileNetV1Type&& other);
+
+  //! Virtual destructor: delete all held layers.
+  virtual ~MobileNetV1Type()
+  { /* Nothing to do here. */ }
+
+  //! Create a copy of the MobileNetV1Type (this is safe for polymorphic use).
+  MobileNetV1Type* Clone() const { return new MobileNetV1Type(*this); }
+
+  //! Compute the output dimensions; inputs must be at least 32x32.
+  void ComputeOutputDimensions();
 
   /**
-   * MobileNetV1 constructor initializes input shape and number of classes.
-   *
-   * @param inputShape A three-valued tuple indicating input shape.
-   *     First value is number of channels (channels-first).
-   *     Second value is input height. Third value is input width.
-   * @param preTrained True for pre-trained weights of ImageNet,
-   *    default is false.
-   * @param numClasses Optional number of classes to classify images into,
-   *     only to be specified if includeTop is  true.
+   * Get the FFN object representing the network.
+   * 
+   * NOTE: The caller is responsible for deleting the returned object.
+   * 
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
    */
-  MobileNetV1(std::tuple<size_t, size_t, size_t> inputShape,
-              const float alpha = 1.0,
-              const size_t depthMultiplier = 1.0,
-              const bool includeTop = true,
-              const bool preTrained = false,
-              const size_t numClasses = 1000);
-
-  //! Get Layers of the model.
-  FFN<OutputLayerType, InitializationRuleType>& GetModel() { return mobileNet; }
-
-  //! Load weights into the model and assumes the internal matrix to be
-  //!  named "MobileNetV1".
-  void LoadModel(const std::string& filePath);
-
-  //! Save weights for the model and assumes the internal matrix to be
-  //!  named "MobileNetV1".
+  template<
+    typename OutputLayerType = CrossEntropyError,
+    typename InitializationRuleType = RandomInitialization
+  >
+  FFN<OutputLayerType, InitializationRuleType, MatType>* GetModel()
+  {
+    FFN<OutputLayerType, InitializationRuleType, MatType>* mobileNet =
+        new FFN<OutputLayerType, InitializationRuleType, MatType>();
+    mobileNet->Add(this);
+    return mobileNet;
+  }
 
-  void SaveModel(const std::string& filepath);
+  /**
+   * Get the output shape, parameters, multiply-accumulates and activation
+   * memory of every layer of the network for inputs of the given dimensions,
+   * without passing any input through it; see ModelSummary.
+   *
+   * @param inputDimensions Dimensions of a single input, e.g. {224, 224, 3}.
+   */
+  ModelSummary Summary(const std::vector<size_t>& inputDimensions)
+  {
+    return ModelSummary(*this, inputDimensions);
+  }
 
- private:
   /**
-   * Adds a ReLU6 Layer.
+   * Get an FFN object for inference with the weights of the given trained
+   * network, which holds this MobileNetV1Type. Batch normalization layers
+   * are folded into the pointwise convolutions before them, and ReLU6
+   * layers that follow a pointwise convolution are applied by it, so the
+   * returned network is a fused MobileNetV1Type. Depthwise convolutions keep
+   * their batch normalization.
    *
-   * @param baseLayer Sequential layer type in which ReLU6 layer will be added
-   *     if it's not NULL otherwise added to mobileNet.
+   * NOTE: The caller is responsible for deleting the returned object.
+   *
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
+   *
+   * @param trained Trained network returned by GetModel().
    */
-  void ReLU6Layer(Sequential<>* baseLayer = NULL)
+  template<typename OutputLayerType, typename InitializationRuleType>
+  FFN<OutputLayerType, InitializationRuleType, MatType>* GetInferenceModel(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& trained) const
   {
-    if (baseLayer != NULL)
-    {
-      baseLayer->Add(new ReLU6<>);
-      mlpack::Log::Info << "RelU6" << std::endl;
-      return;
-    }
-
-    mobileNet.Add(new ReLU6<>);
-    mlpack::Log::Info << "RelU6" << std::endl;
+    FFN<OutputLayerType, InitializationRuleType, MatType>* mobileNet =
+        new FFN<OutputLayerType, InitializationRuleType, MatType>();
+    mobileNet->Add(new MobileNetV1Type(numClasses, alpha, depthMultiplier,
+        includeTop, false, true));
+    BatchNormFolding::Fold(trained, *mobileNet);
+    return mobileNet;
   }
 
   /**
-   * Adds a Convolution Block.
+   * Get an FFN object for inference with the weights of the given trained
+   * network, whose pointwise convolutions compute with 8-bit integers. The
+   * network of GetInferenceModel() is quantized with the ranges of the
+   * inputs of every pointwise convolution recorded on the calibration data.
    *
-   * @param inSize Number of input maps.
-   * @param outSize Number of output maps.
-   * @param strideWidth Stride of filter application in the x direction.
-   * @param strideHeight Stride of filter application in the y direction.
-   * @param kernelWidth Width of the filter/kernel.
-   * @param kernelHeight Height of the filter/kernel.
-   * @param padL Left padding width of the input.
-   * @param padR Right padding height of the input.
-   * @param padT Top padding width of the input.
-   * @param padB Bottom padding height of the input.
-   * @param paddingType Type of padding used.
+   * NOTE: The caller is responsible for deleting the returned object.
    *
-   * @tparam SequentialType Layer type in which convolution block will
-   *    be added if it's not NULL otherwise added to mobileNet.
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
+   *
+   * @param trained Trained network returned by GetModel().
+   * @param calibrationData Representative inputs, one input per column.
    */
-  template<typename SequentialType = Sequential<>>
-  void ConvolutionBlock(const size_t inSize,
-                        const size_t outSize,
-                        const size_t kernelWidth = 1,
-                        const size_t kernelHeight = 1,
-                        const size_t strideWidth = 1,
-                        const size_t strideHeight = 1,
-                        const size_t padL = 0,
-                        const size_t padR = 0,
-                        const size_t padT = 0,
-                        const size_t padB = 0,
-                        const std::string paddingType = "None",
-                        SequentialType* baseLayer = NULL)
+  template<typename OutputLayerType, typename InitializationRuleType>
+  FFN<OutputLayerType, InitializationRuleType, MatType>* GetQuantizedModel(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& trained,
+      const MatType& calibrationData) const
   {
-    Sequential<>* sequentialBlock = new Sequential<>();
-    sequentialBlock->Add(new Convolution<>(inSize, outSize, kernelWidth,
-        kernelHeight, strideWidth, strideHeight, std::make_tuple(padL, padR),
-        std::make_tuple(padT, padB), inputWidth, inputHeight, paddingType));
-
-    mlpack::Log::Info << "Convolution: " << "(" << inSize << ", " << inputWidth
-        << ", " << inputHeight << ")" << " ---> (";
-
-    if (paddingType != "same")
-    {
-      // Updating input dimesntions.
-      inputWidth = ConvOutSize(inputWidth, kernelWidth, strideWidth, padR);
-      inputHeight = ConvOutSize(inputHeight, kernelHeight, strideHeight, padB);
-    }
-
-    mlpack::Log::Info << outSize << ", " << inputWidth << ", " << inputHeight
-        << ")" << std::endl;
-
-    if (baseLayer != NULL)
-    {
-      baseLayer->Add(sequentialBlock);
-      return;
-    }
-
-    mobileNet.Add(sequentialBlock);
+    FFN<OutputLayerType, InitializationRuleType, MatType>* mobileNet =
+        GetInferenceModel(trained);
+    Quantization::Quantize(*mobileNet, calibrationData);
+    return mobileNet;
   }
 
+  /**
+   * Set the weights of the layers of the network to the given weights, and
+   * copy weights loaded by LoadModel() into them.
+   *
+   * @param weightsIn Weights of the network, allocated by the FFN.
+   */
+  void SetWeights(const MatType& weightsIn)
+  {
+    MultiLayer<MatType>::SetWeights(weightsIn);
+    preTrainedWeights.Set(*this, weightsIn);
+  }
+
+  /**
+   * Load the weights and batch normalization statistics of the model, as
+   * saved by SaveModel(). If the network holding the model isn't reset yet,
+   * they are copied into the model once it is.
+   *
+   * @param filePath Path of the weights.
+   */
+  void LoadModel(const std::string& filePath);
+
+  /**
+   * Save the weights and batch normalization statistics of the model, which
+   * must be held by a reset network.
+   *
+   * @param filePath Path of the weights.
+   */
+  void SaveModel(const std::string& filePath);
+
+  //! Serialize the MobileNetV1Type.
+  template<typename Archive>
+  void serialize(Archive& ar, const uint32_t /* version */);
+
+ private:
+  /**
+   * Adds a convolution followed by batch normalization and ReLU6. If the
+   * network is fused, a single FusedConvolution is added instead.
+   *
+   * @param block Block the layers are added to.
+   * @param maps Number of output maps.
+   * @param kernelSize Width and height of the kernel.
+   * @param stride Stride in both directions.
+   */
+  void ConvolutionBlock(MultiLayer<MatType>* block,
+                        const size_t maps,
+                        const size_t kernelSize = 1,
+                        const size_t stride = 1);
+
   /**
    * Adds DepthWiseConvBlock block.
-   * 
-   * @return pointwiseOutSize Returns pointwise output channel size.
    *
    * It's represented as:
-   * 
+   *
    * @code
-   * sequentialBlock - Sequential
+   * sequentialBlock - MultiLayer
    * {
-   *   Padding(0, 1, 0, 1, inputWidth, inputHeight)
-   *   SeparableConvolution(inSize, depthMultipliedOutSize, 3, 3, stride,
-   *       stride, 0, 0, inputWidth, inputHeight, inSize, paddingType)
-   *   BatchNorm(depthMultipliedOutSize, 1e-3, true)
-   *   Convolution(depthMultipliedOutSize, pointwiseOutSize, 1, 1, 1, 1, 0,
-   *       0, inputWidth, inputHeight, "same")
-   *   BatchNorm(pointwiseOutSize, 1e-3, true)
+   *   Padding(0, 1, 0, 1)  (only if stride != 1)
+   *   DepthwiseConvolution(depthMultipliedOutSize, 3, 3, stride, stride)
+   *   BatchNorm(1e-3, true)
+   *   ReLU6
+   *   Convolution(pointwiseOutSize, 1, 1)
+   *   BatchNorm(1e-3, true)
+   *   ReLU6
    * }
    * @endcode
-   * 
+   *
    * @param inSize Number of input channels.
    * @param outSize Number of output channels.
-   * @param alpha Controls the number of output channels in pointwise
-   *     convolution: outSize * depthMultiplier.
-   * @param depthMultiplier Controls the number of output channels in depthwise
-   *     convolution: inSize * depthMultiplier.
    * @param stride The stride width and height.
+   * @return pointwiseOutSize Returns pointwise output channel size.
    */
   size_t DepthWiseConvBlock(const size_t inSize,
                             const size_t outSize,
-                            const float alpha,
-                            const size_t depthMultiplier,
-                            const size_t stride = 1)
-{
-    paddingType = "same";
-    size_t pointwiseOutSize = size_t(outSize * alpha);
-    size_t depthMultipliedOutSize = size_t(inSize * depthMultiplier);
-    Sequential<>* sequentialBlock = new Sequential<>();
-
-    if (stride != 1)
-    {
-      sequentialBlock->Add(new Padding<>(0, 1, 0, 1, inputWidth,
-          inputHeight));
-      mlpack::Log::Info << "Padding: " << "(" << inSize << ", " << inputWidth
-          << ", " << inputWidth << " ---> (";
-      inputWidth += 1;
-      inputHeight += 1;
-      mlpack::Log::Info << inSize << ", " << inputWidth << ", " << inputHeight
-          << ")" << std::endl;
-      paddingType = "valid";
-    }
-
-    sequentialBlock->Add(new SeparableConvolution<>(inSize,
-        depthMultipliedOutSize, 3, 3, stride, stride, 0, 0, inputWidth,
-        inputHeight, inSize, paddingType));
-    mlpack::Log::Info << "Separable convolution: " << "(" << inSize << ", " <<
-        inputWidth << ", " << inputHeight << ")" << " ---> (";
-
-    if (paddingType == "valid")
-    {
-      inputWidth = ConvOutSize(inputWidth, 3, stride, 0);
-      inputHeight = ConvOutSize(inputHeight, 3, stride, 0);
-    }
-
-    mlpack::Log::Info << depthMultipliedOutSize << ", " << inputWidth << ", "
-        << inputHeight << ")" << std::endl;
-
-    sequentialBlock->Add(new BatchNorm<>(depthMultipliedOutSize, 1e-3,
-        true));
-    mlpack::Log::Info << "BatchNorm: " << "(" << depthMultipliedOutSize << ")"
-        << " ---> (" << depthMultipliedOutSize << ")" << std::endl;
-    ReLU6Layer(sequentialBlock);
-    ConvolutionBlock(depthMultipliedOutSize, pointwiseOutSize, 1, 1, 1, 1, 0,
-        0, 0, 0, "same", sequentialBlock);
-    sequentialBlock->Add(new BatchNorm<>(pointwiseOutSize, 1e-3, true));
-    mlpack::Log::Info << "BatchNorm: " << "(" << pointwiseOutSize << ")"
-        << " ---> (" << pointwiseOutSize << ")" << std::endl;
-    ReLU6Layer(sequentialBlock);
-    mobileNet.Add(sequentialBlock);
-
-    return pointwiseOutSize;
-}
-
-  /**
-   * Return the convolution output size.
-   *
-   * @param size The size of the input (row or column).
-   * @param k The size of the filter (width or height).
-   * @param s The stride size (x or y direction).
-   * @param padding The size of the padding (width or height) on one side.
-   * @return The convolution output size.
-   */
-  size_t ConvOutSize(const size_t size,
-                     const size_t k,
-                     const size_t s,
-                     const size_t padding)
-  {
-    return std::floor((size - k + 2 * padding) / s) + 1;
-  }
+                            const size_t stride = 1);
 
-  //! Locally stored DarkNet Model.
-  FFN<OutputLayerType, InitializationRuleType> mobileNet;
+  //! Generate the layers of the MobileNetV1.
+  void MakeModel();
 
-  //! Locally stored number of channels in the image.
-  size_t inputChannel;
+  //! Fetch the pre-trained weights for inputs of the given width and load
+  //! them.
+  void LoadPreTrained(const size_t inputWidth, const size_t inputHeight);
 
-  //! Locally stored width of the image.
-  size_t inputWidth;
+  //! Get the name of the pre-trained weights for inputs of the given width.
+  std::string PreTrainedName(const size_t inputWidth) const;
 
-  //! Locally stored height of the image.
-  size_t inputHeight;
+  //! Locally stored number of output classes.
+  size_t numClasses;
 
   //! Locally stored alpha for mobileNet block creation.
   float alpha;
 
   //! Locally stored Depth multiplier for mobileNet block creation.
-  float depthMultiplier;
+  size_t depthMultiplier;
 
-  //! Locally stored number of output classes.
-  size_t numClasses;
+  //! Locally stored if classifier layers are included or not.
+  bool includeTop;
 
-  //! Locally stored block string from which to build the model.
-  std::string paddingType;
-
-  //! Locally stored output channels to use when building blocks.
-  size_t outSize;
-
-  //! Locally stored map to construct mobileNetV1 blocks.
-  std::map<size_t, size_t> mobileNetConfig = {
-                                                {128, 2},
-                                                {256, 2},
-                                                {512, 6},
-                                                {1024, 2},
-                                              };
-
-  //! Locally stored map to convert alpha value to string.
-  std::map<double, std::string> alphaToString = {
-                                                  {0.25, "0.25"},
-                                                  {0.5, "0.5"},
-                                                  {0.75, "0.75"},
-                                                  {1.0, "1"}
-                                                };
-
-  //! Locally stored map to convert image size to string.
-  std::map<size_t, std::string> imageSizeToString = {
-                                                      {128, "128"},
-                                                      {160, "160"},
-                                                      {192, "192"},
-                                                      {224, "224"}
-                                                    };
-
-  //! Locally stored path string for pre-trained model.
-  std::string preTrainedPath;
-}; // MobileNetV1 class
+  //! Locally stored if convolutions and activations are fused.
+  bool fused;
+
+  //! Locally stored if pre-trained weights are loaded once the input
+  //! dimensions are known.
+  bool preTrained;
+
+  //! Locally stored pre-trained weights, until they are copied into the
+  //! model.
+  PretrainedWeights<MatType> preTrainedWeights;
+}; // MobileNetV1Type class
 
 // convenience typedef.
-typedef MobileNetV1<CrossEntropyError<>, RandomInitialization>
-    MobilenetV1;
+typedef MobileNetV1Type<arma::mat> MobileNetV1;
 
 } // namespace models
 } // namespace mlpack
 
+CEREAL_REGISTER_TYPE(mlpack::models::MobileNetV1Type<arma::mat>);
+CEREAL_TEMPLATE_CLASS_VERSION((template<typename MatType>),
+    (mlpack::models::MobileNetV1Type<MatType>), (1));
+
 #include "mobilenet_v1_impl.hpp"
 
 #endif
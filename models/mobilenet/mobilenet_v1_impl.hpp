@@ -17,167 +17,291 @@
 namespace mlpack {
 namespace models {
 
-template<typename OutputLayerType, typename InitializationRuleType>
-MobileNetV1<OutputLayerType, InitializationRuleType>::MobileNetV1() :
-    inputChannel(0),
-    inputWidth(0),
-    inputHeight(0),
-    numClasses(0),
-    alpha(1.0),
-    depthMultiplier(0)
-{
-  // Nothing to do here.
-}
-
-template<typename OutputLayerType, typename InitializationRuleType>
-MobileNetV1<OutputLayerType, InitializationRuleType>::MobileNetV1(
-    const size_t inputChannel,
-    const size_t inputWidth,
-    const size_t inputHeight,
+template<typename MatType>
+MobileNetV1Type<MatType>::MobileNetV1Type(
+    const size_t numClasses,
     const float alpha,
     const size_t depthMultiplier,
     const bool includeTop,
     const bool preTrained,
-    const size_t numClasses) :
-    MobileNetV1<OutputLayerType, InitializationRuleType>(
-        std::tuple<size_t, size_t, size_t>(
-        inputChannel,
-        inputWidth,
-        inputHeight),
-        alpha,
-        depthMultiplier,
-        includeTop,
-        preTrained,
-        numClasses)
+    const bool fused) :
+    MultiLayer<MatType>(),
+    numClasses(numClasses),
+    alpha(alpha),
+    depthMultiplier(depthMultiplier),
+    includeTop(includeTop),
+    fused(fused),
+    preTrained(preTrained)
+{
+  // The weights are chosen by the width of the input once it's known, so
+  // weights that aren't available for any width are rejected up front.
+  if (preTrained)
+  {
+    bool available = false;
+    for (const size_t width : { 128, 160, 192, 224 })
+    {
+      available = available ||
+          PublishedWeights::Available(PreTrainedName(width));
+    }
+
+    if (!available)
+      PublishedWeights::Require(PreTrainedName(224), "MobileNetV1");
+  }
+
+  MakeModel();
+}
+
+template<typename MatType>
+MobileNetV1Type<MatType>::MobileNetV1Type(const MobileNetV1Type& other) :
+    MultiLayer<MatType>(other),
+    numClasses(other.numClasses),
+    alpha(other.alpha),
+    depthMultiplier(other.depthMultiplier),
+    includeTop(other.includeTop),
+    fused(other.fused),
+    preTrained(other.preTrained),
+    preTrainedWeights(other.preTrainedWeights)
 {
   // Nothing to do here.
 }
 
-template<typename OutputLayerType, typename InitializationRuleType>
-MobileNetV1<OutputLayerType, InitializationRuleType>::MobileNetV1(
-    std::tuple<size_t, size_t, size_t> inputShape,
-    const float alpha,
-    const size_t depthMultiplier,
-    const bool includeTop,
-    const bool preTrained,
-    const size_t numClasses) :
-    inputChannel(std::get<0>(inputShape)),
-    inputWidth(std::get<1>(inputShape)),
-    inputHeight(std::get<2>(inputShape)),
-    alpha(alpha),
-    depthMultiplier(depthMultiplier),
-    numClasses(numClasses)
+template<typename MatType>
+MobileNetV1Type<MatType>::MobileNetV1Type(MobileNetV1Type&& other) :
+    MultiLayer<MatType>(std::move(other)),
+    numClasses(std::move(other.numClasses)),
+    alpha(std::move(other.alpha)),
+    depthMultiplier(std::move(other.depthMultiplier)),
+    includeTop(std::move(other.includeTop)),
+    fused(std::move(other.fused)),
+    preTrained(std::move(other.preTrained)),
+    preTrainedWeights(other.preTrainedWeights)
 {
-  if (inputWidth < 32 || inputHeight < 32)
+  // Nothing to do here.
+}
+
+template<typename MatType>
+MobileNetV1Type<MatType>&
+MobileNetV1Type<MatType>::operator=(const MobileNetV1Type& other)
+{
+  if (this != &other)
+  {
+    MultiLayer<MatType>::operator=(other);
+    numClasses = other.numClasses;
+    alpha = other.alpha;
+    depthMultiplier = other.depthMultiplier;
+    includeTop = other.includeTop;
+    fused = other.fused;
+    preTrained = other.preTrained;
+    preTrainedWeights = other.preTrainedWeights;
+  }
+
+  return *this;
+}
+
+template<typename MatType>
+MobileNetV1Type<MatType>&
+MobileNetV1Type<MatType>::operator=(MobileNetV1Type&& other)
+{
+  if (this != &other)
+  {
+    MultiLayer<MatType>::operator=(std::move(other));
+    numClasses = std::move(other.numClasses);
+    alpha = std::move(other.alpha);
+    depthMultiplier = std::move(other.depthMultiplier);
+    includeTop = std::move(other.includeTop);
+    fused = std::move(other.fused);
+    preTrained = std::move(other.preTrained);
+    preTrainedWeights = other.preTrainedWeights;
+  }
+
+  return *this;
+}
+
+template<typename MatType>
+void MobileNetV1Type<MatType>::ComputeOutputDimensions()
+{
+  if (this->inputDimensions.size() < 2 || this->inputDimensions[0] < 32 ||
+      this->inputDimensions[1] < 32)
   {
     mlpack::Log::Fatal << "input width and input height cannot be smaller than"
-        " 32.\nGiven input width and height: (" << inputWidth << ", "
-        << inputHeight << ")" << std::endl;
+        " 32." << std::endl;
   }
 
+  // The pre-trained weights depend on the input size, so they are loaded
+  // before the network allocates the weights of the model.
   if (preTrained)
   {
-    if (numClasses != 1000)
-    {
-      mlpack::Log::Fatal << "Number of classes should be 1000 when pre-trained"
-          " is true." << std::endl;
-    }
+    LoadPreTrained(this->inputDimensions[0], this->inputDimensions[1]);
+    preTrained = false;
+  }
 
-    if (inputWidth != inputHeight)
-    {
-      mlpack::Log::Fatal << "When pre-trained is true image height should be"
-          " equal to image width." << std::endl;
-    }
+  MultiLayer<MatType>::ComputeOutputDimensions();
+}
 
-    std::map<size_t, std::string>::iterator imageSizeString =
-        imageSizeToString.find(inputWidth);
-    if (imageSizeString == imageSizeToString.end())
-    {
-      mlpack::Log::Fatal << "Image size can only be one of the following when"
-          " pre-trained is true: (128, 160, 192, 224)" << std::endl;
-    }
+template<typename MatType>
+void MobileNetV1Type<MatType>::LoadModel(const std::string& filePath)
+{
+  if (!preTrainedWeights.Load(filePath, *this))
+  {
+    mlpack::Log::Fatal << "Unable to load the weights of MobileNetV1 from "
+        << filePath << "." << std::endl;
+  }
 
-    std::map<double, std::string>::iterator alphaString =
-        alphaToString.find(alpha);
-    if (alphaString == alphaToString.end())
-    {
-      mlpack::Log::Fatal << "Alpha can only be one of the following when"
-          " pre-trained is true: (0.25, 0.5, 0.75, 1.0)" << std::endl;
-    }
+  Log::Info << "Loaded model" << std::endl;
+}
 
-    std::string home = getenv("HOME");
-    preTrainedPath = home + "/.cache/mlpack/models/weights/mobilenetv1/"
-        "mobilenetv1_" + alphaString->second + "_" + imageSizeString->second +
-        ".bin";
-    if (Utils::PathExists(preTrainedPath, true) == false)
-    {
-      std::cout << "mobilenetv1_" + alphaString->second + "_" +
-          imageSizeString->second + ".bin to " + preTrainedPath << std::endl;
-      Utils::DownloadFile("mobilenetv1_" + alphaString->second + "_" +
-          imageSizeString->second + ".bin", preTrainedPath, "", false, false,
-          "http://models.mlpack.org/mobilenetv1/");
-    }
+template<typename MatType>
+void MobileNetV1Type<MatType>::SaveModel(const std::string& filePath)
+{
+  Log::Info << "Saving model." << std::endl;
+  if (preTrainedWeights.Save(filePath, *this))
+    Log::Info << "Model saved in " << filePath << "." << std::endl;
+}
 
-    LoadModel(preTrainedPath);
-    return;
+template<typename MatType>
+void MobileNetV1Type<MatType>::LoadPreTrained(const size_t inputWidth,
+                                              const size_t inputHeight)
+{
+  if (inputWidth != inputHeight)
+  {
+    mlpack::Log::Fatal << "When pre-trained is true image height should be"
+        " equal to image width." << std::endl;
   }
 
-  outSize = size_t(32 * alpha);
-  ConvolutionBlock(inputChannel, outSize, 3, 3, 2, 2, 0, 1, 0, 1);
-  mobileNet.Add(new BatchNorm<>(outSize, 1e-3, true));
-  mlpack::Log::Info << "BatchNorm: " << "(" << outSize << ")"
-        << " ---> (" << outSize << ")" << std::endl;
-  ReLU6Layer();
-  outSize = DepthWiseConvBlock(outSize, 64, alpha, depthMultiplier);
+  LoadModel(PublishedWeights::Fetch(PreTrainedName(inputWidth),
+      "MobileNetV1"));
+}
 
-  for (const auto& blockConfig : mobileNetConfig)
+template<typename MatType>
+std::string MobileNetV1Type<MatType>::PreTrainedName(
+    const size_t inputWidth) const
+{
+  if (numClasses != 1000)
   {
-    outSize = DepthWiseConvBlock(outSize, blockConfig.first, alpha,
-        depthMultiplier, 2);
+    mlpack::Log::Fatal << "Number of classes should be 1000 when pre-trained"
+        " is true." << std::endl;
+  }
 
-    for (size_t numBlock = 1; numBlock < blockConfig.second; ++numBlock)
-    {
-      outSize = DepthWiseConvBlock(outSize, blockConfig.first, alpha,
-          depthMultiplier);
-    }
+  const std::map<size_t, std::string> imageSizeToString = {
+      {128, "128"}, {160, "160"}, {192, "192"}, {224, "224"} };
+  const std::map<double, std::string> alphaToString = {
+      {0.25, "0.25"}, {0.5, "0.5"}, {0.75, "0.75"}, {1.0, "1"} };
+
+  std::map<size_t, std::string>::const_iterator imageSizeString =
+      imageSizeToString.find(inputWidth);
+  if (imageSizeString == imageSizeToString.end())
+  {
+    mlpack::Log::Fatal << "Image size can only be one of the following when"
+        " pre-trained is true: (128, 160, 192, 224)" << std::endl;
   }
 
-  mobileNet.Add(new AdaptiveMeanPooling<>(1, 1));
-  mlpack::Log::Info << "Adaptive mean pooling: (" << size_t(1024 * alpha)
-      << ", " << inputWidth << ", " << inputHeight << ") ---> ("
-      << size_t(1024 * alpha) << ", 1, 1)" << std::endl;
+  std::map<double, std::string>::const_iterator alphaString =
+      alphaToString.find(alpha);
+  if (alphaString == alphaToString.end())
+  {
+    mlpack::Log::Fatal << "Alpha can only be one of the following when"
+        " pre-trained is true: (0.25, 0.5, 0.75, 1.0)" << std::endl;
+  }
 
-  if (includeTop)
+  return "mobilenetv1_" + alphaString->second + "_" +
+      imageSizeString->second + ".bin";
+}
+
+template<typename MatType>
+template<typename Archive>
+void MobileNetV1Type<MatType>::serialize(
+    Archive& ar, const uint32_t version)
+{
+  ar(cereal::base_class<MultiLayer<MatType>>(this));
+
+  ar(CEREAL_NVP(numClasses));
+  ar(CEREAL_NVP(alpha));
+  ar(CEREAL_NVP(depthMultiplier));
+  ar(CEREAL_NVP(includeTop));
+
+  // Version 0 was saved before the model could be fused.
+  if (version >= 1)
+    ar(CEREAL_NVP(fused));
+}
+
+template<typename MatType>
+void MobileNetV1Type<MatType>::ConvolutionBlock(
+    MultiLayer<MatType>* block,
+    const size_t maps,
+    const size_t kernelSize,
+    const size_t stride)
+{
+  if (fused)
   {
-    mobileNet.Add(new Dropout<>(1e-3));
-    mlpack::Log::Info << "Dropout" << std::endl;
-    mobileNet.Add(new Convolution<>(size_t(1024 * alpha), numClasses, 1,
-        1, 1, 1, 0, 0, 1, 1, "same"));
-    mlpack::Log::Info << "Convolution: (" << size_t(1024 * alpha)
-        << ", 1, 1) ---> (" << numClasses << " , 1, 1)" << std::endl;
-    mobileNet.Add(new Softmax<>);
-    mlpack::Log::Info << "Softmax" << std::endl;
+    block->template Add<FusedConvolutionType<MatType>>(maps, kernelSize,
+        kernelSize, stride, stride, 0, 0, FusedActivation::ReLU6);
+    return;
   }
 
-  // Reset parameters for a new network.
-  mobileNet.ResetParameters();
+  block->template Add<DefaultConvolutionType<MatType>>(maps, kernelSize,
+      kernelSize, stride, stride, 0, 0);
+  block->template Add<BatchNormType<MatType>>(2, 2, 1e-3, true);
+  block->template Add<ReLU6Type<MatType>>();
 }
 
-template<typename OutputLayerType, typename InitializationRuleType>
-void MobileNetV1<OutputLayerType, InitializationRuleType>::LoadModel(
-    const std::string& filePath)
+template<typename MatType>
+size_t MobileNetV1Type<MatType>::DepthWiseConvBlock(
+    const size_t inSize,
+    const size_t outSize,
+    const size_t stride)
 {
-  data::Load(filePath, "mobilenet_v1", mobileNet);
-  Log::Info << "Loaded model" << std::endl;
+  size_t pointwiseOutSize = size_t(outSize * alpha);
+  size_t depthMultipliedOutSize = size_t(inSize * depthMultiplier);
+  MultiLayer<MatType>* sequentialBlock = new MultiLayer<MatType>();
+
+  // Strided blocks pad the right and the bottom only; all others keep the
+  // size of the input.
+  const size_t padding = (stride != 1) ? 0 : 1;
+  if (stride != 1)
+    sequentialBlock->template Add<PaddingType<MatType>>(0, 1, 0, 1);
+
+  sequentialBlock->template Add<DepthwiseConvolutionType<MatType>>(
+      depthMultipliedOutSize, 3, 3, stride, stride, padding, padding);
+  sequentialBlock->template Add<BatchNormType<MatType>>(2, 2, 1e-3, true);
+  sequentialBlock->template Add<ReLU6Type<MatType>>();
+  ConvolutionBlock(sequentialBlock, pointwiseOutSize);
+  this->Add(sequentialBlock);
+
+  return pointwiseOutSize;
 }
 
-template<typename OutputLayerType, typename InitializationRuleType>
-void MobileNetV1<OutputLayerType, InitializationRuleType>::SaveModel(
-    const std::string& filePath)
+template<typename MatType>
+void MobileNetV1Type<MatType>::MakeModel()
 {
-  Log::Info<< "Saving model." << std::endl;
-  data::Save(filePath, "mobilenet_v1", mobileNet);
-  Log::Info << "Model saved in " << filePath << "." << std::endl;
+  // Number of blocks of every width after the first block.
+  std::map<size_t, size_t> const mobileNetConfig = {
+    {128, 2},
+    {256, 2},
+    {512, 6},
+    {1024, 2},
+  };
+
+  size_t outSize = size_t(32 * alpha);
+  this->template Add<PaddingType<MatType>>(0, 1, 0, 1);
+  ConvolutionBlock(this, outSize, 3, 2);
+  outSize = DepthWiseConvBlock(outSize, 64);
+
+  for (const auto& blockConfig : mobileNetConfig)
+  {
+    outSize = DepthWiseConvBlock(outSize, blockConfig.first, 2);
+
+    for (size_t numBlock = 1; numBlock < blockConfig.second; ++numBlock)
+      outSize = DepthWiseConvBlock(outSize, blockConfig.first);
+  }
+
+  this->template Add<AdaptiveMeanPoolingType<MatType>>(1, 1);
+
+  if (includeTop)
+  {
+    this->template Add<DropoutType<MatType>>(1e-3);
+    this->template Add<DefaultConvolutionType<MatType>>(numClasses, 1, 1);
+    this->template Add<SoftmaxType<MatType>>();
+  }
 }
 
 } // namespace models
@@ -1,9 +1,9 @@
 /**
  * @file resnet.hpp
  * @author Aakash Kaushik
- * 
+ *
  * Definition of ResNet models.
- * 
+ *
  * For more information, kindly refer to the following paper.
  *
  * @code
@@ -14,7 +14,7 @@
  *  url = {https://arxiv.org/pdf/1512.03385.pdf}
  * }
  * @endcode
- * 
+ *
  * mlpack is free software; you may redistribute it and/or modify it under the
  * terms of the 3-clause BSD license.  You should have received a copy of the
  * 3-clause BSD license along with mlpack.  If not, see
@@ -25,414 +25,283 @@
 
 #define MLPACK_ENABLE_ANN_SERIALIZATION
 #include <mlpack.hpp>
-
-#include "./../../utils/utils.hpp"
+#include <models/common/batch_norm_folding.hpp>
+#include <models/common/model_summary.hpp>
+#include <models/common/pretrained_weights.hpp>
+#include <models/common/quantization.hpp>
+#include <models/layers/checkpoint.hpp>
+#include <models/layers/fused_convolution.hpp>
+#include <models/layers/layer_types.hpp>
+#include <models/layers/residual.hpp>
 
 namespace mlpack {
 namespace models {
 
 /**
  * Definition of a ResNet CNN.
- * 
- * @tparam OutputLayerType The output layer type used to evaluate the network.
- * @tparam InitializationRuleType Rule used to initialize the weight matrix.
- * @tparam ResNetVersion Version of ResNet.
+ *
+ * ResNet 18 and 34 are built of basic blocks, ResNet 50, 101 and 152 of
+ * bottleneck blocks.
+ *
+ * @tparam MatType Matrix representation to accept as input and use for
+ *    computation, e.g. arma::fmat for single precision.
+ * @tparam ResNetVersion Version of ResNet (Valid Configuration - 18, 34, 50,
+ *    101, 152).
  */
 template<
-  typename OutputLayerType = CrossEntropyError<>,
-  typename InitializationRuleType = RandomInitialization,
+  typename MatType = arma::mat,
   size_t ResNetVersion = 18
 >
-class ResNet
+class ResNetType : public MultiLayer<MatType>
 {
  public:
-  //! Create the ResNet model.
-  ResNet();
-
   /**
-   * ResNet constructor intializes input shape and number of classes.
+   * ResNetType constructor intializes number of classes and weights.
    *
-   * @param inputChannels Number of input channels of the input image.
-   * @param inputWidth Width of the input image.
-   * @param inputHeight Height of the input image.
-   * @param includeTop Must be set to true if preTrained is set to true.
-   * @param preTrained True for pre-trained weights of ImageNet,
-   *    default is false.
-   * @param numClasses Optional number of classes to classify images into,
-   *     only to be specified if includeTop is true, default is 1000.
+   * @param numClasses Number of classes to classify images into,
+   *     only to be specified if includeTop is true.
+   * @param includeTop Must be set to true if classifier layers are set, and
+   *     if preTrained is set to true.
+   * @param preTrained True for pre-trained weights of ImageNet, which are
+   *     fetched through PublishedWeights and copied into the model once the
+   *     network holding it is reset; see LoadModel().
+   * @param fused Whether every convolution, its batch normalization and its
+   *     ReLU are computed by a single FusedConvolution layer, which is faster
+   *     for inference. Use GetInferenceModel() to get the weights of a
+   *     trained network.
+   * @param checkpoint Whether the outputs of the layers of every residual
+   *     block are computed again for the backward pass instead of being
+   *     kept, so training needs much less memory for about a third more
+   *     computation; see Checkpoint.
    */
-  ResNet(const size_t inputChannel,
-         const size_t inputWidth,
-         const size_t inputHeight,
-         const bool includeTop = true,
-         const bool preTrained = false,
-         const size_t numClasses = 1000);
-
-  /**
-   * ResNet constructor intializes input shape and number of classes.
-   *
-   * @param inputShape A three-valued tuple indicating input shape.
-   *     First value is number of channels (channels-first).
-   *     Second value is input height. Third value is input width.
-   * @param preTrained True for pre-trained weights of ImageNet,
-   *    default is false.
-   * @param numClasses Optional number of classes to classify images into,
-   *     only to be specified if includeTop is  true.
-   */
-  ResNet(std::tuple<size_t, size_t, size_t> inputShape,
-         const bool includeTop = true,
-         const bool preTrained = false,
-         const size_t numClasses = 1000);
-
-  //! Get Layers of the model.
-  FFN<OutputLayerType, InitializationRuleType>& GetModel() { return resNet; }
-
-  //! Load weights into the model and assumes the internal matrix to be
-  //  named "ResNet".
-  void LoadModel(const std::string& filePath);
+  ResNetType(const size_t numClasses = 1000,
+             const bool includeTop = true,
+             const bool preTrained = false,
+             const bool fused = false,
+             const bool checkpoint = false);
+
+  //! Copy the given ResNetType.
+  ResNetType(const ResNetType& other);
+  //! Take ownership of the layers of the given ResNetType.
+  ResNetType(ResNetType&& other);
+  //! Copy the given ResNetType.
+  ResNetType& operator=(const ResNetType& other);
+  //! Take ownership of the given ResNetType.
+  ResNetType& operator=(ResNetType&& other);
+
+  //! Virtual destructor: delete all held layers.
+  virtual ~ResNetType()
+  { /* Nothing to do here. */ }
+
+  //! Create a copy of the ResNetType (this is safe for polymorphic use).
+  ResNetType* Clone() const { return new ResNetType(*this); }
 
-  //! Save weights for the model and assumes the internal matrix to be
-  //  named "ResNet".
-  void SaveModel(const std::string& filepath);
-
- private:
   /**
-   * Adds a Convolution Block depending on the configuration.
+   * Get the FFN object representing the network.
    *
-   * @tparam SequentialType Layer type in which convolution block will
-   *     be added.
+   * NOTE: The caller is responsible for deleting the returned object.
    *
-   * @param inSize Number of input maps.
-   * @param outSize Number of output maps.
-   * @param strideWidth Stride of filter application in the x direction.
-   * @param strideHeight Stride of filter application in the y direction.
-   * @param kernelWidth Width of the filter/kernel.
-   * @param kernelHeight Height of the filter/kernel.
-   * @param padW Padding width of the input.
-   * @param padH Padding height of the input.
-   * @param downSample Bool if it's a downsample block or not. Default is false.
-   * @param downSampleInputWidth Input widht for downSample block.
-   * @param downSampleInputHeight Input height for downSample block.
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
    */
-  template<typename SequentialType = Sequential<>>
-  void ConvolutionBlock(SequentialType* baseLayer,
-                        const size_t inSize,
-                        const size_t outSize,
-                        const size_t strideWidth = 1,
-                        const size_t strideHeight = 1,
-                        const size_t kernelWidth = 3,
-                        const size_t kernelHeight = 3,
-                        const size_t padW = 1,
-                        const size_t padH = 1,
-                        const bool downSample = false,
-                        const size_t downSampleInputWidth = 0,
-                        const size_t downSampleInputHeight = 0)
+  template<
+    typename OutputLayerType = CrossEntropyError,
+    typename InitializationRuleType = RandomInitialization
+  >
+  FFN<OutputLayerType, InitializationRuleType, MatType>* GetModel()
   {
-    if (downSample)
-    {
-      mlpack::Log::Info << "DownSample (" << std::endl;
-      inputWidth = downSampleInputWidth;
-      inputHeight = downSampleInputHeight;
-    }
-
-    Sequential<>* tempBaseLayer = new Sequential<>();
-    tempBaseLayer->Add(new Convolution<>(inSize, outSize, kernelWidth,
-        kernelHeight, strideWidth, strideHeight, padW, padH, inputWidth,
-        inputHeight));
-    mlpack::Log::Info << "Convolution: " << "(" << inSize << ", " <<
-        inputWidth << ", " << inputHeight << ")" << " ---> (";
-
-    // Updating input dimensions.
-    inputWidth = ConvOutSize(inputWidth, kernelWidth, strideWidth, padW);
-    inputHeight = ConvOutSize(inputHeight, kernelHeight, strideHeight,
-        padH);
-
-    mlpack::Log::Info << outSize << ", " << inputWidth << ", " <<
-        inputHeight << ")" << std::endl;
-
-    tempBaseLayer->Add(new BatchNorm<>(outSize, 1e-5));
-    mlpack::Log::Info << "BatchNorm: " << "(" << outSize << ")" << " ---> ("
-        << outSize << ")" << std::endl;
-    baseLayer->Add(tempBaseLayer);
-    if (downSample)
-      mlpack::Log::Info << ")" <<std::endl;
+    FFN<OutputLayerType, InitializationRuleType, MatType>* resNet =
+        new FFN<OutputLayerType, InitializationRuleType, MatType>();
+    resNet->Add(this);
+    return resNet;
   }
 
   /**
-   * Adds a ReLU Layer.
+   * Get the output shape, parameters, multiply-accumulates and activation
+   * memory of every layer of the network for inputs of the given dimensions,
+   * without passing any input through it; see ModelSummary.
    *
-   * @param baseLayer Sequential layer type in which ReLU layer will be added.
+   * @param inputDimensions Dimensions of a single input, e.g. {224, 224, 3}.
    */
-  void ReLULayer(Sequential<>* baseLayer)
+  ModelSummary Summary(const std::vector<size_t>& inputDimensions)
   {
-    baseLayer->Add(new ReLULayer<>);
-    mlpack::Log::Info << "Relu" << std::endl;
+    return ModelSummary(*this, inputDimensions);
   }
 
   /**
-   * Adds basicBlock block for ResNet 18 and 34.
+   * Get an FFN object for inference with the weights of the given trained
+   * network, which holds this ResNetType. Batch normalization layers are
+   * folded into the convolutions before them, and ReLU layers that follow a
+   * convolution are applied by it, so the returned network is a fused
+   * ResNetType.
+   *
+   * NOTE: The caller is responsible for deleting the returned object.
    *
-   * It's represented as:
-   * 
-   * @code
-   * resBlock - AddMerge layer
-   * {
-   *   sequentialBlock - sequentialLayer
-   *   {
-   *     ConvolutionBlock(inSize, outSize, strideWidth, strideHeight)
-   *     ReLU
-   *     ConvolutionBlock(inSize, outSize)
-   *   }
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
    *
-   *   sequentialLayer
-   *   {
-   *     if downsample == true
-   *       ConvolutionBlock(inSize, outSize, strideWidth, strideHeight, 1, 1,
-   *           0, 0, true, downSampleInputWidth, downSampleInputHeight);
-   *     else
-   *       IdentityLayer
-   *   }
-   * 
-   *   ReLU
-   * }
-   * @endcode
-   * 
-   * @param inSize Number of input maps.
-   * @param outSize Number of output maps.
-   * @param strideWidth Stride of filter application in the x direction.
-   * @param strideHeight Stride of filter application in the y direction.
-   * @param downSample If there will be a downSample block or not, default
-   *     false.
+   * @param trained Trained network returned by GetModel().
    */
-  void BasicBlock(const size_t inSize,
-                  const size_t outSize,
-                  const size_t strideWidth = 1,
-                  const size_t strideHeight = 1,
-                  const bool downSample = false)
+  template<typename OutputLayerType, typename InitializationRuleType>
+  FFN<OutputLayerType, InitializationRuleType, MatType>* GetInferenceModel(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& trained) const
   {
-    downSampleInputWidth = inputWidth;
-    downSampleInputHeight = inputHeight;
-
-    Sequential<>* basicBlock = new Sequential<>();
-    AddMerge<>* resBlock = new AddMerge<>(true, true);
-    Sequential<>* sequentialBlock = new Sequential<>();
-    ConvolutionBlock(sequentialBlock, inSize, outSize, strideWidth,
-        strideHeight);
-    ReLULayer(sequentialBlock);
-    ConvolutionBlock(sequentialBlock, outSize, outSize);
-
-    resBlock->Add(sequentialBlock);
-
-    if (downSample == true)
-    {
-      ConvolutionBlock(resBlock, inSize, outSize, strideWidth, strideHeight,
-          1, 1, 0, 0, true, downSampleInputWidth, downSampleInputHeight);
-    }
-    else
-    {
-      mlpack::Log::Info << "IdentityLayer" << std::endl;
-      resBlock->Add(new IdentityLayer<>);
-    }
-
-    basicBlock->Add(resBlock);
-    ReLULayer(basicBlock);
-    resNet.Add(basicBlock);
+    FFN<OutputLayerType, InitializationRuleType, MatType>* resNet =
+        new FFN<OutputLayerType, InitializationRuleType, MatType>();
+    resNet->Add(new ResNetType(numClasses, includeTop, false, true));
+    BatchNormFolding::Fold(trained, *resNet);
+    return resNet;
   }
 
   /**
-   * Adds bottleNeck block for ResNet 50, 101 and 152.
+   * Get an FFN object for inference with the weights of the given trained
+   * network, whose convolutions compute with 8-bit integers. The network of
+   * GetInferenceModel() is quantized with the ranges of the inputs of
+   * every convolution recorded on the calibration data.
    *
-   * It's represented as:
-   * 
-   * @code
-   * resBlock - AddMerge layer
-   * {
-   *   sequentialBlock
-   *   {
-   *     ConvolutionBlock(sequentialBlock, inSize, width, 1, 1, 1, 1, 0, 0)
-   *     ReLU
-   *     ConvolutionBlock(width, width, strideWidth, strideHeight)
-   *     ReLU
-   *     ConvolutionBlock(sequentialBlock, width, outSize * bottleNeckExpansion,
-   *         1, 1, 1, 1, 0, 0)
-   *   }
+   * NOTE: The caller is responsible for deleting the returned object.
    *
-   *   sequentialLayer
-   *   {
-   *     if downsample == true
-   *       ConvolutionBlock(inSize, outSize * bottleNeckExpansion, strideWidth,
-   *           strideHeight, 1, 1, 0, 0, true, downSampleInputWidth,
-   *           downSampleInputHeight);
-   *     else
-   *       IdentityLayer
-   *   }
-   * 
-   *   ReLU
-   * }
-   *@endcode
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
    *
-   * @param inSize Number of input maps.
-   * @param outSize Number of output maps.
-   * @param strideWidth Stride of filter application in the x direction.
-   * @param strideHeight Stride of filter application in the y direction.
-   * @param downSample If there will be a downSample block or not, default
-   *     false.
-   * @param baseWidth Parameter for calculating width.
-   * @param groups Parameter for calculating width.
+   * @param trained Trained network returned by GetModel().
+   * @param calibrationData Representative inputs, one input per column.
    */
-  void BottleNeck(const size_t inSize,
-                  const size_t outSize,
-                  const size_t strideWidth = 1,
-                  const size_t strideHeight = 1,
-                  const bool downSample = false,
-                  const size_t baseWidth = 64,
-                  const size_t groups = 1)
+  template<typename OutputLayerType, typename InitializationRuleType>
+  FFN<OutputLayerType, InitializationRuleType, MatType>* GetQuantizedModel(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& trained,
+      const MatType& calibrationData) const
   {
-    downSampleInputWidth = inputWidth;
-    downSampleInputHeight = inputHeight;
-
-    size_t width = int((baseWidth / 64.0) * outSize) * groups;
-    Sequential<>* basicBlock = new Sequential<>();
-    AddMerge<>* resBlock = new AddMerge<>(true, true);
-    Sequential<>* sequentialBlock = new Sequential<>();
-    ConvolutionBlock(sequentialBlock, inSize, width, 1, 1, 1, 1, 0, 0);
-    ReLULayer(sequentialBlock);
-    ConvolutionBlock(sequentialBlock, width, width, strideWidth,
-        strideHeight);
-    ReLULayer(sequentialBlock);
-    ConvolutionBlock(sequentialBlock, width, outSize * bottleNeckExpansion, 1,
-        1, 1, 1, 0, 0);
-    resBlock->Add(sequentialBlock);
-
-    if (downSample == true)
-    {
-      ConvolutionBlock(resBlock, inSize, outSize * bottleNeckExpansion,
-           strideWidth, strideHeight, 1, 1, 0, 0, true, downSampleInputWidth,
-           downSampleInputHeight);
-    }
-    else
-    {
-      mlpack::Log::Info << "IdentityLayer" << std::endl;
-      resBlock->Add(new IdentityLayer<>);
-    }
-
-    basicBlock->Add(resBlock);
-    ReLULayer(basicBlock);
-    resNet.Add(basicBlock);
+    FFN<OutputLayerType, InitializationRuleType, MatType>* resNet =
+        GetInferenceModel(trained);
+    Quantization::Quantize(*resNet, calibrationData);
+    return resNet;
   }
 
   /**
-   * Creates model layers based on the type of layer and parameters supplied.
+   * Set the weights of the layers of the network to the given weights, and
+   * copy weights loaded by LoadModel() into them.
    *
-   * @param block Type of block to use for layer creation.
-   * @param outSize Number of output maps.
-   * @param numBlocks Number of layers to create.
-   * @param stride Single parameter for StrideHeight and strideWidth.
+   * @param weightsIn Weights of the network, allocated by the FFN.
    */
-  void MakeLayer(const std::string& block,
-                 const size_t outSize,
-                 const size_t numBlocks,
-                 const size_t stride = 1)
+  void SetWeights(const MatType& weightsIn)
   {
-    bool downSample = false;
-
-    if (block == "basicblock")
-    {
-      if (stride != 1 || downSampleInSize != outSize * basicBlockExpansion)
-        downSample = true;
-      BasicBlock(downSampleInSize, outSize * basicBlockExpansion, stride,
-          stride, downSample);
-      downSampleInSize = outSize * basicBlockExpansion;
-      for (size_t i = 1; i != numBlocks; ++i)
-        BasicBlock(downSampleInSize, outSize);
-      return;
-    }
-
-    if (stride != 1 || downSampleInSize != outSize * bottleNeckExpansion)
-      downSample = true;
-    BottleNeck(downSampleInSize, outSize, stride, stride, downSample);
-    downSampleInSize = outSize * bottleNeckExpansion;
-    for (size_t i = 1; i != numBlocks; ++i)
-      BottleNeck(downSampleInSize, outSize);
+    MultiLayer<MatType>::SetWeights(weightsIn);
+    preTrainedWeights.Set(*this, weightsIn);
   }
 
   /**
-   * Return the convolution output size.
+   * Load the weights and batch normalization statistics of the model, as
+   * saved by SaveModel(). If the network holding the model isn't reset yet,
+   * they are copied into the model once it is.
    *
-   * @param size The size of the input (row or column).
-   * @param k The size of the filter (width or height).
-   * @param s The stride size (x or y direction).
-   * @param padding The size of the padding (width or height) on one side.
-   * @return The convolution output size.
+   * @param filePath Path of the weights.
    */
-  size_t ConvOutSize(const size_t size,
-                     const size_t k,
-                     const size_t s,
-                     const size_t padding)
-  {
-    return std::floor((size - k + 2 * padding) / s) + 1;
-  }
-
-  //! Locally stored DarkNet Model.
-  FFN<OutputLayerType, InitializationRuleType> resNet;
-
-  //! Locally stored number of channels in the image.
-  size_t inputChannel;
+  void LoadModel(const std::string& filePath);
 
-  //! Locally stored width of the image.
-  size_t inputWidth;
+  /**
+   * Save the weights and batch normalization statistics of the model, which
+   * must be held by a reset network.
+   *
+   * @param filePath Path of the weights.
+   */
+  void SaveModel(const std::string& filePath);
 
-  //! Locally stored height of the image.
-  size_t inputHeight;
+  //! Serialize the ResNetType.
+  template<typename Archive>
+  void serialize(Archive& ar, const uint32_t /* version */);
 
-  //! Locally stored number of output classes.
-  size_t numClasses;
+ private:
+  /**
+   * Adds a convolution followed by batch normalization and the activation.
+   * If the network is fused, a single FusedConvolution is added instead.
+   *
+   * @param block Block the layers are added to.
+   * @param maps Number of output maps.
+   * @param kernelSize Width and height of the kernel.
+   * @param stride Stride in both directions.
+   * @param padding Padding in both directions.
+   * @param activation Either FusedActivation::ReLU or
+   *     FusedActivation::Identity for no activation.
+   */
+  void ConvolutionBlock(MultiLayer<MatType>* block,
+                        const size_t maps,
+                        const size_t kernelSize = 3,
+                        const size_t stride = 1,
+                        const size_t padding = 1,
+                        const FusedActivation activation =
+                            FusedActivation::Identity);
 
-  //! Locally stored width of image for downSample block.
-  size_t downSampleInputWidth;
+  /**
+   * Adds a residual block, whose sum is followed by ReLU. The shortcut is a
+   * 1x1 convolution if the shape of the input changes, and the identity
+   * otherwise.
+   *
+   * @param inMaps Number of input maps.
+   * @param maps Number of output maps of the residual branch.
+   * @param stride Stride of the first convolution of the residual branch.
+   */
+  void ResidualBlock(const size_t inMaps,
+                     const size_t maps,
+                     const size_t stride);
 
-  //! Locally stored height of image for downSample block.
-  size_t downSampleInputHeight;
+  /**
+   * Adds the blocks of one stage of the network.
+   *
+   * @param inMaps Number of input maps, updated to the number of output maps
+   *     of the stage.
+   * @param maps Number of maps of the blocks.
+   * @param numBlocks Number of blocks of the stage.
+   * @param stride Stride of the first block.
+   */
+  void MakeLayer(size_t& inMaps,
+                 const size_t maps,
+                 const size_t numBlocks,
+                 const size_t stride = 1);
 
-  //! Locally stored expansion for BasicBlock.
-  size_t basicBlockExpansion = 1;
+  //! Generate the layers of the ResNet.
+  void MakeModel();
 
-  //! Locally stored expansion for BottleNeck.
-  size_t bottleNeckExpansion = 4;
+  //! Get the number of output maps of a block of the given number of maps.
+  static size_t Expansion() { return (ResNetVersion < 50) ? 1 : 4; }
 
-  //! InSize for ResNet block creation.
-  size_t downSampleInSize = 64;
+  //! Locally stored number of output classes.
+  size_t numClasses;
 
-  //! Locally stored map to constructor different ResNet versions.
-  std::map<size_t, std::map<std::string, std::array<size_t, 4>>> ResNetConfig =
-      {
-        {18, {{"basicblock", {2, 2, 2, 2}}}},
-        {34, {{"basicblock", {3, 4, 6, 3}}}},
-        {50, {{"bottleneck", {3, 4, 6, 3}}}},
-        {101, {{"bottleneck", {3, 4, 23, 3}}}},
-        {152, {{"bottleneck", {3, 8, 36, 3}}}}
-      };
+  //! Locally stored if classifier layers are included or not.
+  bool includeTop;
 
-  //! Locally stored array to constructor different ResNet versions.
-  std::array<size_t , 4> numBlockArray;
+  //! Locally stored if convolutions and activations are fused.
+  bool fused;
 
-  //! Locally stored block string from which to build the model.
-  std::string builderBlock;
+  //! Locally stored if the outputs of the blocks are computed again for the
+  //! backward pass.
+  bool checkpoint;
 
-  //! Locally stored path string for pre-trained model.
-  std::string preTrainedPath;
-}; // ResNet class
+  //! Locally stored pre-trained weights, until they are copied into the
+  //! model.
+  PretrainedWeights<MatType> preTrainedWeights;
+}; // ResNetType class.
 
-// convenience typedefs for different ResNet models.
-typedef ResNet<CrossEntropyError<>, RandomInitialization, 18> ResNet18;
-typedef ResNet<CrossEntropyError<>, RandomInitialization, 34> ResNet34;
-typedef ResNet<CrossEntropyError<>, RandomInitialization, 50> ResNet50;
-typedef ResNet<CrossEntropyError<>, RandomInitialization, 101> ResNet101;
-typedef ResNet<CrossEntropyError<>, RandomInitialization, 152> ResNet152;
+// Convenience typedefs for different ResNet layer.
+typedef ResNetType<arma::mat, 18> ResNet18;
+typedef ResNetType<arma::mat, 34> ResNet34;
+typedef ResNetType<arma::mat, 50> ResNet50;
+typedef ResNetType<arma::mat, 101> ResNet101;
+typedef ResNetType<arma::mat, 152> ResNet152;
 
 } // namespace models
 } // namespace mlpack
 
+CEREAL_REGISTER_TYPE(mlpack::models::ResNetType<arma::mat, 18>);
+CEREAL_REGISTER_TYPE(mlpack::models::ResNetType<arma::mat, 34>);
+CEREAL_REGISTER_TYPE(mlpack::models::ResNetType<arma::mat, 50>);
+CEREAL_REGISTER_TYPE(mlpack::models::ResNetType<arma::mat, 101>);
+CEREAL_REGISTER_TYPE(mlpack::models::ResNetType<arma::mat, 152>);
+CEREAL_TEMPLATE_CLASS_VERSION(
+    (template<typename MatType, size_t ResNetVersion>),
+    (mlpack::models::ResNetType<MatType, ResNetVersion>), (2));
+
 #include "resnet_impl.hpp"
 
 #endif
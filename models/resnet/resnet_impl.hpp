@@ -17,154 +17,233 @@
 namespace mlpack {
 namespace models {
 
-template<typename OutputLayerType, typename InitializationRuleType,
-    size_t ResNetVersion>
-ResNet<OutputLayerType, InitializationRuleType, ResNetVersion>::ResNet() :
-    inputChannel(0),
-    inputWidth(0),
-    inputHeight(0),
-    numClasses(0)
+template<typename MatType, size_t ResNetVersion>
+ResNetType<MatType, ResNetVersion>::ResNetType(
+    const size_t numClasses,
+    const bool includeTop,
+    const bool preTrained,
+    const bool fused,
+    const bool checkpoint) :
+    MultiLayer<MatType>(),
+    numClasses(numClasses),
+    includeTop(includeTop),
+    fused(fused),
+    checkpoint(checkpoint)
+{
+  // Unavailable weights are rejected before the layers are built.
+  const std::string name = "resnet" + std::to_string(ResNetVersion) + ".bin";
+  if (preTrained)
+    PublishedWeights::Require(name, "ResNet");
+
+  MakeModel();
+
+  if (preTrained)
+    LoadModel(PublishedWeights::Fetch(name, "ResNet"));
+}
+
+template<typename MatType, size_t ResNetVersion>
+ResNetType<MatType, ResNetVersion>::ResNetType(const ResNetType& other) :
+    MultiLayer<MatType>(other),
+    numClasses(other.numClasses),
+    includeTop(other.includeTop),
+    fused(other.fused),
+    checkpoint(other.checkpoint),
+    preTrainedWeights(other.preTrainedWeights)
 {
   // Nothing to do here.
 }
 
-template<typename OutputLayerType, typename InitializationRuleType,
-    size_t ResNetVersion>
-ResNet<OutputLayerType, InitializationRuleType, ResNetVersion>::ResNet(
-    const size_t inputChannel,
-    const size_t inputWidth,
-    const size_t inputHeight,
-    const bool includeTop,
-    const bool preTrained,
-    const size_t numClasses) :
-    ResNet<OutputLayerType, InitializationRuleType, ResNetVersion>(
-        std::tuple<size_t, size_t, size_t>(
-        inputChannel,
-        inputWidth,
-        inputHeight),
-        includeTop,
-        preTrained,
-        numClasses)
+template<typename MatType, size_t ResNetVersion>
+ResNetType<MatType, ResNetVersion>::ResNetType(ResNetType&& other) :
+    MultiLayer<MatType>(std::move(other)),
+    numClasses(std::move(other.numClasses)),
+    includeTop(std::move(other.includeTop)),
+    fused(std::move(other.fused)),
+    checkpoint(std::move(other.checkpoint)),
+    preTrainedWeights(other.preTrainedWeights)
 {
   // Nothing to do here.
 }
 
-template<typename OutputLayerType, typename InitializationRuleType,
-    size_t ResNetVersion>
-ResNet<OutputLayerType, InitializationRuleType, ResNetVersion>::ResNet(
-    std::tuple<size_t, size_t, size_t> inputShape,
-    const bool includeTop,
-    const bool preTrained,
-    const size_t numClasses) :
-    inputChannel(std::get<0>(inputShape)),
-    inputWidth(std::get<1>(inputShape)),
-    inputHeight(std::get<2>(inputShape)),
-    numClasses(numClasses)
+template<typename MatType, size_t ResNetVersion>
+ResNetType<MatType, ResNetVersion>&
+ResNetType<MatType, ResNetVersion>::operator=(const ResNetType& other)
 {
-  if (preTrained)
+  if (this != &other)
   {
-    std::string home = getenv("HOME");
-    preTrainedPath = home + "/.cache/mlpack/models/weights/resnet/resnet" +
-        std::to_string(ResNetVersion) + ".bin";
-    if (Utils::PathExists(preTrainedPath, true) == false)
-    {
-      std::cout << "Downloading resnet" + std::to_string(ResNetVersion) +
-          ".bin to " + preTrainedPath << std::endl;
-      Utils::DownloadFile("resnet" + std::to_string(ResNetVersion) + ".bin",
-          preTrainedPath, "", false, false,
-          "http://models.mlpack.org/resnet/");
-    }
-
-    LoadModel(preTrainedPath);
-    return;
+    MultiLayer<MatType>::operator=(other);
+    numClasses = other.numClasses;
+    includeTop = other.includeTop;
+    fused = other.fused;
+    checkpoint = other.checkpoint;
+    preTrainedWeights = other.preTrainedWeights;
   }
 
-  // Config for different versions.
-  std::map<size_t, std::map<std::string, std::array<size_t, 4>>>::iterator
-      configFinder = ResNetConfig.find(ResNetVersion);
-  std::map<std::string, std::array<size_t, 4>> config = configFinder->second;
-  builderBlock = config.begin()->first;
-  numBlockArray = config.begin()->second;
+  return *this;
+}
 
-  if (configFinder == ResNetConfig.end())
+template<typename MatType, size_t ResNetVersion>
+ResNetType<MatType, ResNetVersion>&
+ResNetType<MatType, ResNetVersion>::operator=(ResNetType&& other)
+{
+  if (this != &other)
   {
-    mlpack::Log::Fatal << "Incorrect ResNet version. Possible values are: 18, "
-        "34, 50, 101 and 152" << std::endl;
+    MultiLayer<MatType>::operator=(std::move(other));
+    numClasses = std::move(other.numClasses);
+    includeTop = std::move(other.includeTop);
+    fused = std::move(other.fused);
+    checkpoint = std::move(other.checkpoint);
+    preTrainedWeights = other.preTrainedWeights;
   }
 
-  resNet.Add(new IdentityLayer<>);
-  Sequential<>* seqBlock = new Sequential<>();
-  ConvolutionBlock(seqBlock, 3, 64, 2, 2, 7, 7, 3, 3);
-  ReLULayer(seqBlock);
-  resNet.Add(seqBlock);
+  return *this;
+}
+
+template<typename MatType, size_t ResNetVersion>
+void ResNetType<MatType, ResNetVersion>::LoadModel(const std::string& filePath)
+{
+  if (!preTrainedWeights.Load(filePath, *this))
+  {
+    mlpack::Log::Fatal << "Unable to load the weights of ResNet from "
+        << filePath << "." << std::endl;
+  }
+
+  Log::Info << "Loaded model" << std::endl;
+}
 
-  resNet.Add(new Padding<>(1, 1, 1, 1, inputWidth, inputHeight));
-  mlpack::Log::Info << "Padding: " << "(" << "64, " << inputWidth << ", " <<
-      inputWidth << " ---> (";
+template<typename MatType, size_t ResNetVersion>
+void ResNetType<MatType, ResNetVersion>::SaveModel(const std::string& filePath)
+{
+  Log::Info << "Saving model." << std::endl;
+  if (preTrainedWeights.Save(filePath, *this))
+    Log::Info << "Model saved in " << filePath << "." << std::endl;
+}
 
-  // Updating input dimensions.
-  inputWidth += 2;
-  inputHeight += 2;
+template<typename MatType, size_t ResNetVersion>
+template<typename Archive>
+void ResNetType<MatType, ResNetVersion>::serialize(
+    Archive& ar, const uint32_t version)
+{
+  ar(cereal::base_class<MultiLayer<MatType>>(this));
 
-  mlpack::Log::Info <<"64, "<< inputWidth << ", " << inputHeight << ")" <<
-      std::endl;
+  ar(CEREAL_NVP(numClasses));
+  ar(CEREAL_NVP(includeTop));
 
-  resNet.Add(new MaxPooling<>(3, 3, 2, 2));
-  mlpack::Log::Info << "MaxPool: " << "(" <<"64, " << inputWidth << ", " <<
-      inputHeight << " ---> (";
+  // Version 0 was saved before the model could be fused, and version 1
+  // before it could be checkpointed.
+  if (version >= 1)
+    ar(CEREAL_NVP(fused));
+  if (version >= 2)
+    ar(CEREAL_NVP(checkpoint));
+}
 
-  // Updating input dimensions.
-  inputWidth = ConvOutSize(inputWidth, 3, 2, 0);
-  inputHeight = ConvOutSize(inputHeight, 3, 2, 0);
+template<typename MatType, size_t ResNetVersion>
+void ResNetType<MatType, ResNetVersion>::ConvolutionBlock(
+    MultiLayer<MatType>* block,
+    const size_t maps,
+    const size_t kernelSize,
+    const size_t stride,
+    const size_t padding,
+    const FusedActivation activation)
+{
+  if (fused)
+  {
+    block->template Add<FusedConvolutionType<MatType>>(maps, kernelSize,
+        kernelSize, stride, stride, padding, padding, activation);
+    return;
+  }
 
-  mlpack::Log::Info << "64, " << inputWidth << ", " << inputHeight << ")" <<
-      std::endl;
+  block->template Add<DefaultConvolutionType<MatType>>(maps, kernelSize,
+      kernelSize, stride, stride, padding, padding);
+  block->template Add<BatchNormType<MatType>>(2, 2, 1e-5);
+  if (activation == FusedActivation::ReLU)
+    block->template Add<ReLUType<MatType>>();
+}
 
-  MakeLayer(builderBlock, 64, numBlockArray[0]);
-  MakeLayer(builderBlock, 128, numBlockArray[1], 2);
-  MakeLayer(builderBlock, 256, numBlockArray[2], 2);
-  MakeLayer(builderBlock, 512, numBlockArray[3], 2);
+template<typename MatType, size_t ResNetVersion>
+void ResNetType<MatType, ResNetVersion>::ResidualBlock(
+    const size_t inMaps,
+    const size_t maps,
+    const size_t stride)
+{
+  const size_t outMaps = maps * Expansion();
+  MultiLayer<MatType>* block = checkpoint ? new CheckpointType<MatType>() :
+      new MultiLayer<MatType>();
+  if (ResNetVersion < 50)
+  {
+    ConvolutionBlock(block, maps, 3, stride, 1, FusedActivation::ReLU);
+    ConvolutionBlock(block, maps);
+  }
+  else
+  {
+    ConvolutionBlock(block, maps, 1, 1, 0, FusedActivation::ReLU);
+    ConvolutionBlock(block, maps, 3, stride, 1, FusedActivation::ReLU);
+    ConvolutionBlock(block, outMaps, 1, 1, 0);
+  }
 
-  if (includeTop)
+  // The shortcut is added into the output of the block and the ReLU applied
+  // in the same pass.
+  ResidualType<MatType>* residual =
+      new ResidualType<MatType>(FusedActivation::ReLU);
+  residual->Add(block);
+  if (stride != 1 || inMaps != outMaps)
   {
-    resNet.Add(new AdaptiveMeanPooling<>(1, 1));
-    mlpack::Log::Info << "AdaptiveMeanPooling: " << "(1, 1)" << std::endl;
-
-    if (ResNetVersion == 18 || ResNetVersion == 34)
-    {
-      resNet.Add(new Linear<>(512 * basicBlockExpansion, numClasses));
-      mlpack::Log::Info << "Linear: " << "(" << 512 * basicBlockExpansion <<
-          ") ---> (" << numClasses << ")" <<std::endl;
-    }
-    else if (ResNetVersion == 50 || ResNetVersion == 101 ||
-        ResNetVersion == 152)
-    {
-      resNet.Add(new Linear<>(512 * bottleNeckExpansion, numClasses));
-      mlpack::Log::Info<<"Linear: " << "(" << 512 * bottleNeckExpansion <<
-          ") ---> (" << numClasses << ")" << std::endl;
-    }
+    MultiLayer<MatType>* downSample = new MultiLayer<MatType>();
+    ConvolutionBlock(downSample, outMaps, 1, stride, 0);
+    residual->Add(downSample);
   }
 
-  resNet.ResetParameters();
+  this->Add(residual);
 }
 
-template<typename OutputLayerType, typename InitializationRuleType,
-    size_t ResNetVersion>
-void ResNet<OutputLayerType, InitializationRuleType, ResNetVersion>::
-    LoadModel(const std::string& filePath)
+template<typename MatType, size_t ResNetVersion>
+void ResNetType<MatType, ResNetVersion>::MakeLayer(
+    size_t& inMaps,
+    const size_t maps,
+    const size_t numBlocks,
+    const size_t stride)
 {
-  data::Load(filePath, "ResNet", resNet);
-  Log::Info << "Loaded model" << std::endl;
+  ResidualBlock(inMaps, maps, stride);
+  inMaps = maps * Expansion();
+  for (size_t i = 1; i < numBlocks; i++)
+    ResidualBlock(inMaps, maps, 1);
 }
 
-template<typename OutputLayerType, typename InitializationRuleType,
-    size_t ResNetVersion>
-void ResNet<OutputLayerType, InitializationRuleType, ResNetVersion>::
-    SaveModel(const std::string& filePath)
+template<typename MatType, size_t ResNetVersion>
+void ResNetType<MatType, ResNetVersion>::MakeModel()
 {
-  Log::Info<< "Saving model." << std::endl;
-  data::Save(filePath, "ResNet", resNet);
-  Log::Info << "Model saved in " << filePath << "." << std::endl;
+  // Number of blocks of every stage.
+  std::map<size_t, std::array<size_t, 4>> const construct {
+    { 18, {2, 2, 2, 2} },
+    { 34, {3, 4, 6, 3} },
+    { 50, {3, 4, 6, 3} },
+    { 101, {3, 4, 23, 3} },
+    { 152, {3, 8, 36, 3} }
+  };
+
+  if (construct.count(ResNetVersion) == 0)
+  {
+    mlpack::Log::Fatal << "Incorrect ResNet version. Possible values are: 18, "
+        "34, 50, 101 and 152" << std::endl;
+  }
+
+  const std::array<size_t, 4>& numBlocks = construct.at(ResNetVersion);
+
+  ConvolutionBlock(this, 64, 7, 2, 3, FusedActivation::ReLU);
+  this->template Add<PaddingType<MatType>>(1, 1, 1, 1);
+  this->template Add<MaxPoolingType<MatType>>(3, 3, 2, 2);
+
+  size_t inMaps = 64;
+  MakeLayer(inMaps, 64, numBlocks[0]);
+  MakeLayer(inMaps, 128, numBlocks[1], 2);
+  MakeLayer(inMaps, 256, numBlocks[2], 2);
+  MakeLayer(inMaps, 512, numBlocks[3], 2);
+
+  if (includeTop)
+  {
+    this->template Add<AdaptiveMeanPoolingType<MatType>>(1, 1);
+    this->template Add<LinearType<MatType>>(numClasses);
+  }
 }
 
 } // namespace models
@@ -30,6 +30,10 @@
 
 #define MLPACK_ENABLE_ANN_SERIALIZATION
 #include <mlpack.hpp>
+#include <models/common/batch_norm_folding.hpp>
+#include <models/common/model_summary.hpp>
+#include <models/layers/channel_concat.hpp>
+#include <models/layers/fused_convolution.hpp>
 
 namespace mlpack {
 namespace models {
@@ -58,9 +62,12 @@ class SqueezeNetType : public MultiLayer<MatType>
    * @param numClasses Number of classes to classify images into,
    *     only to be specified if includeTop is true.
    * @param includeTop Must be set to true if classifier layers are set.
+   * @param fused Whether every convolution and its activation are computed
+   *     by a single FusedConvolution layer, which is faster for inference.
    */
   SqueezeNetType(const size_t numClasses = 1000,
-                 const bool includeTop = true);
+                 const bool includeTop = true,
+                 const bool fused = false);
 
   //! Copy the given SqueezeNetType.
   SqueezeNetType(const SqueezeNetType& other);
@@ -98,6 +105,42 @@ class SqueezeNetType : public MultiLayer<MatType>
     return squeezeNet;
   }
 
+  /**
+   * Get the output shape, parameters, multiply-accumulates and activation
+   * memory of every layer of the network for inputs of the given dimensions,
+   * without passing any input through it; see ModelSummary.
+   *
+   * @param inputDimensions Dimensions of a single input, e.g. {224, 224, 3}.
+   */
+  ModelSummary Summary(const std::vector<size_t>& inputDimensions)
+  {
+    return ModelSummary(*this, inputDimensions);
+  }
+
+  /**
+   * Get an FFN object for inference with the weights of the given trained
+   * network, which holds this SqueezeNetType. The returned network is a
+   * fused SqueezeNetType, so every activation is applied by the convolution
+   * before it.
+   *
+   * NOTE: The caller is responsible for deleting the returned object.
+   *
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
+   *
+   * @param trained Trained network returned by GetModel().
+   */
+  template<typename OutputLayerType, typename InitializationRuleType>
+  FFN<OutputLayerType, InitializationRuleType, MatType>* GetInferenceModel(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& trained) const
+  {
+    FFN<OutputLayerType, InitializationRuleType, MatType>* squeezeNet =
+        new FFN<OutputLayerType, InitializationRuleType, MatType>();
+    squeezeNet->Add(new SqueezeNetType(numClasses, includeTop, true));
+    BatchNormFolding::Fold(trained, *squeezeNet);
+    return squeezeNet;
+  }
+
   //! Serialize the SqueezeNetType.
   template<typename Archive>
   void serialize(Archive& ar, const uint32_t /* version */);
@@ -114,6 +157,22 @@ class SqueezeNetType : public MultiLayer<MatType>
             const size_t expand1x1Planes,
             const size_t expand3x3Planes);
 
+  /**
+   * Adds a convolution followed by ReLU, as a single FusedConvolution layer
+   * if the network is fused.
+   *
+   * @param block Block the layers are added to.
+   * @param maps Number of output maps.
+   * @param kernelSize Width and height of the kernel.
+   * @param stride Stride in both directions.
+   * @param padding Padding in both directions.
+   */
+  void ConvolutionReLU(MultiLayer<MatType>* block,
+                       const size_t maps,
+                       const size_t kernelSize,
+                       const size_t stride = 1,
+                       const size_t padding = 0);
+
   //! Generate the layers of the SqueezeNet.
   void MakeModel();
 
@@ -122,6 +181,9 @@ class SqueezeNetType : public MultiLayer<MatType>
 
   //! Locally stored if classifier layers are included or not.
   bool includeTop;
+
+  //! Locally stored if convolutions and activations are fused.
+  bool fused;
 }; // SqueezeNetType class.
 
 // Convenience typedefs for different SqueezeNet layer.
@@ -134,6 +196,9 @@ typedef SqueezeNetType<arma::mat, 1> SqueezeNet1;
 
 CEREAL_REGISTER_TYPE(mlpack::models::SqueezeNetType<arma::mat, 0>);
 CEREAL_REGISTER_TYPE(mlpack::models::SqueezeNetType<arma::mat, 1>);
+CEREAL_TEMPLATE_CLASS_VERSION(
+    (template<typename MatType, size_t SqueezeNetVersion>),
+    (mlpack::models::SqueezeNetType<MatType, SqueezeNetVersion>), (1));
 
 #include "squeezenet_impl.hpp"
 
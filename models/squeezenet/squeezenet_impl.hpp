@@ -20,10 +20,12 @@ namespace models {
 template<typename MatType, size_t SqueezeNetVersion>
 SqueezeNetType<MatType, SqueezeNetVersion>::SqueezeNetType(
     const size_t numClasses,
-    const bool includeTop) :
+    const bool includeTop,
+    const bool fused) :
     MultiLayer<MatType>(),
     numClasses(numClasses),
-    includeTop(includeTop)
+    includeTop(includeTop),
+    fused(fused)
 {
   MakeModel();
 }
@@ -33,7 +35,8 @@ SqueezeNetType<MatType, SqueezeNetVersion>::SqueezeNetType(
     const SqueezeNetType& other) :
     MultiLayer<MatType>(other),
     numClasses(other.numClasses),
-    includeTop(other.includeTop)
+    includeTop(other.includeTop),
+    fused(other.fused)
 {
   // Nothing to do here.
 }
@@ -43,7 +46,8 @@ SqueezeNetType<MatType, SqueezeNetVersion>::SqueezeNetType(
     SqueezeNetType&& other) :
     MultiLayer<MatType>(std::move(other)),
     numClasses(std::move(other.numClasses)),
-    includeTop(std::move(other.includeTop))
+    includeTop(std::move(other.includeTop)),
+    fused(std::move(other.fused))
 {
   // Nothing to do here.
 }
@@ -58,6 +62,7 @@ SqueezeNetType<MatType, SqueezeNetVersion>::operator=(
     MultiLayer<MatType>::operator=(other);
     numClasses = other.numClasses;
     includeTop = other.includeTop;
+    fused = other.fused;
   }
 
   return *this;
@@ -72,6 +77,7 @@ SqueezeNetType<MatType, SqueezeNetVersion>::operator=(SqueezeNetType&& other)
     MultiLayer<MatType>::operator=(std::move(other));
     numClasses = std::move(other.numClasses);
     includeTop = std::move(other.includeTop);
+    fused = std::move(other.fused);
   }
 
   return *this;
@@ -80,12 +86,16 @@ SqueezeNetType<MatType, SqueezeNetVersion>::operator=(SqueezeNetType&& other)
 template<typename MatType, size_t SqueezeNetVersion>
 template<typename Archive>
 void SqueezeNetType<MatType, SqueezeNetVersion>::serialize(
-    Archive& ar, const uint32_t /* version */)
+    Archive& ar, const uint32_t version)
 {
   ar(cereal::base_class<MultiLayer<MatType>>(this));
 
   ar(CEREAL_NVP(numClasses));
   ar(CEREAL_NVP(includeTop));
+
+  // Version 0 was saved before the model could be fused.
+  if (version >= 1)
+    ar(CEREAL_NVP(fused));
 }
 
 template<typename MatType, size_t SqueezeNetVersion>
@@ -94,22 +104,39 @@ void SqueezeNetType<MatType, SqueezeNetVersion>::Fire(
     const size_t expand1x1Planes,
     const size_t expand3x3Planes)
 {
-  this->template Add<Convolution>(squeezePlanes, 1, 1);
-  this->template Add<ReLU>();
-
-  MultiLayer<MatType>* expand1x1 = new MultiLayer<MatType>();
-  expand1x1->template Add<Convolution>(expand1x1Planes, 1, 1);
-  expand1x1->template Add<ReLU>();
-
-  MultiLayer<MatType>* expand3x3 = new MultiLayer<MatType>();
-  expand3x3->template Add<Convolution>(expand3x3Planes, 3, 3, 1, 1, 1, 1);
-  expand3x3->template Add<ReLU>();
-
-  Concat* catLayer = new Concat(2);
-  catLayer->template Add(expand1x1);
-  catLayer->template Add(expand3x3);
+  ConvolutionReLU(this, squeezePlanes, 1);
+
+  // Both expand convolutions write their maps directly into the output of
+  // the module, so it is never copied; they apply the ReLU themselves even
+  // if the network isn't fused.
+  ChannelConcatType<MatType>* expand = new ChannelConcatType<MatType>();
+  expand->template Add<FusedConvolutionType<MatType>>(expand1x1Planes, 1, 1,
+      1, 1, 0, 0, FusedActivation::ReLU);
+  expand->template Add<FusedConvolutionType<MatType>>(expand3x3Planes, 3, 3,
+      1, 1, 1, 1, FusedActivation::ReLU);
+
+  this->Add(expand);
+}
 
-  this->template Add(catLayer);
+template<typename MatType, size_t SqueezeNetVersion>
+void SqueezeNetType<MatType, SqueezeNetVersion>::ConvolutionReLU(
+    MultiLayer<MatType>* block,
+    const size_t maps,
+    const size_t kernelSize,
+    const size_t stride,
+    const size_t padding)
+{
+  if (fused)
+  {
+    block->template Add<FusedConvolutionType<MatType>>(maps, kernelSize,
+        kernelSize, stride, stride, padding, padding, FusedActivation::ReLU);
+  }
+  else
+  {
+    block->template Add<Convolution>(maps, kernelSize, kernelSize, stride,
+        stride, padding, padding);
+    block->template Add<ReLU>();
+  }
 }
 
 template<typename MatType, size_t SqueezeNetVersion>
@@ -117,8 +144,7 @@ void SqueezeNetType<MatType, SqueezeNetVersion>::MakeModel()
 {
   if (SqueezeNetVersion == 0)
   {
-    this->template Add<Convolution>(96, 7, 7, 2, 2);
-    this->template Add<ReLU>();
+    ConvolutionReLU(this, 96, 7, 2);
     this->template Add<MaxPooling>(3, 3, 2, 2, false);
     Fire(16, 64, 64);
     Fire(16, 64, 64);
@@ -133,8 +159,7 @@ void SqueezeNetType<MatType, SqueezeNetVersion>::MakeModel()
   }
   else if (SqueezeNetVersion == 1)
   {
-    this->template Add<Convolution>(64, 3, 3, 2, 2);
-    this->template Add<ReLU>();
+    ConvolutionReLU(this, 64, 3, 2);
     this->template Add<MaxPooling>(3, 3, 2, 2, false);
     Fire(16, 64, 64);
     Fire(16, 64, 64);
@@ -154,8 +179,7 @@ void SqueezeNetType<MatType, SqueezeNetVersion>::MakeModel()
   if (includeTop)
   {
     this->template Add<Dropout>();
-    this->template Add<Convolution>(numClasses, 1, 1);
-    this->template Add<ReLU>();
+    ConvolutionReLU(this, numClasses, 1);
     this->template Add<AdaptiveMeanPooling>(1, 1);
   }
 }
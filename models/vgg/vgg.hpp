@@ -28,6 +28,9 @@
 
 #define MLPACK_ENABLE_ANN_SERIALIZATION
 #include <mlpack.hpp>
+#include <models/common/batch_norm_folding.hpp>
+#include <models/common/model_summary.hpp>
+#include <models/layers/fused_convolution.hpp>
 
 namespace mlpack {
 namespace models {
@@ -60,9 +63,14 @@ class VGGType : public MultiLayer<MatType>
    * @param numClasses Number of classes to classify images into,
    *     only to be specified if includeTop is true.
    * @param includeTop Must be set to true if classifier layers are set.
+   * @param fused Whether every convolution and its ReLU are computed by a
+   *     single FusedConvolution layer, which is faster for inference. Fused
+   *     networks have no batch normalization layers; use
+   *     GetInferenceModel() to fold them into the convolutions.
    */
   VGGType(const size_t numClasses = 1000,
-          const bool includeTop = true);
+          const bool includeTop = true,
+          const bool fused = false);
 
   //! Copy the given VGGType.
   VGGType(const VGGType& other);
@@ -98,6 +106,44 @@ class VGGType : public MultiLayer<MatType>
     return vgg;
   }
 
+  /**
+   * Get the output shape, parameters, multiply-accumulates and activation
+   * memory of every layer of the network for inputs of the given dimensions,
+   * without passing any input through it; see ModelSummary.
+   *
+   * @param inputDimensions Dimensions of a single input, e.g. {224, 224, 3}.
+   */
+  ModelSummary Summary(const std::vector<size_t>& inputDimensions)
+  {
+    return ModelSummary(*this, inputDimensions);
+  }
+
+  /**
+   * Get an FFN object for inference with the weights of the given trained
+   * network, which holds this VGGType. Batch normalization layers are folded
+   * into the convolutions before them, and every ReLU is applied by the
+   * convolution before it, so the returned network is a fused VGGType
+   * without batch normalization.
+   *
+   * NOTE: The caller is responsible for deleting the returned object.
+   *
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
+   *
+   * @param trained Trained network returned by GetModel().
+   */
+  template<typename OutputLayerType, typename InitializationRuleType>
+  FFN<OutputLayerType, InitializationRuleType, MatType>* GetInferenceModel(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& trained) const
+  {
+    FFN<OutputLayerType, InitializationRuleType, MatType>* vgg =
+        new FFN<OutputLayerType, InitializationRuleType, MatType>();
+    vgg->Add(new VGGType<MatType, VGGVersion, false>(numClasses, includeTop,
+        true));
+    BatchNormFolding::Fold(trained, *vgg);
+    return vgg;
+  }
+
   //! Serialize the VGGType.
   template<typename Archive>
   void serialize(Archive& ar, const uint32_t /* version */);
@@ -110,6 +156,9 @@ class VGGType : public MultiLayer<MatType>
 
   //! Locally stored if classifier layers are included or not.
   bool includeTop;
+
+  //! Locally stored if convolutions and activations are fused.
+  bool fused;
 }; // VGGType class.
 
 // Convenience typedefs for different VGG layer.
@@ -136,6 +185,9 @@ CEREAL_REGISTER_TYPE(mlpack::models::VGGType<arma::mat, 11, true>);
 CEREAL_REGISTER_TYPE(mlpack::models::VGGType<arma::mat, 13, true>);
 CEREAL_REGISTER_TYPE(mlpack::models::VGGType<arma::mat, 16, true>);
 CEREAL_REGISTER_TYPE(mlpack::models::VGGType<arma::mat, 19, true>);
+CEREAL_TEMPLATE_CLASS_VERSION(
+    (template<typename MatType, size_t VGGVersion, bool UsesBatchNorm>),
+    (mlpack::models::VGGType<MatType, VGGVersion, UsesBatchNorm>), (1));
 
 
 #include "vgg_impl.hpp"
@@ -20,10 +20,12 @@ namespace models {
 template<typename MatType, size_t VGGVersion, bool UsesBatchNorm>
 VGGType<MatType, VGGVersion, UsesBatchNorm>::VGGType(
     const size_t numClasses,
-    const bool includeTop) :
+    const bool includeTop,
+    const bool fused) :
     MultiLayer<MatType>(),
     numClasses(numClasses),
-    includeTop(includeTop)
+    includeTop(includeTop),
+    fused(fused)
 {
   MakeModel();
 }
@@ -33,7 +35,8 @@ VGGType<MatType, VGGVersion, UsesBatchNorm>::VGGType(
     const VGGType& other) :
     MultiLayer<MatType>(other),
     numClasses(other.numClasses),
-    includeTop(other.includeTop)
+    includeTop(other.includeTop),
+    fused(other.fused)
 {
   // Nothing to do here.
 }
@@ -43,7 +46,8 @@ VGGType<MatType, VGGVersion, UsesBatchNorm>::VGGType(
     VGGType&& other) :
     MultiLayer<MatType>(std::move(other)),
     numClasses(std::move(other.numClasses)),
-    includeTop(std::move(other.includeTop))
+    includeTop(std::move(other.includeTop)),
+    fused(std::move(other.fused))
 {
   // Nothing to do here.
 }
@@ -57,6 +61,7 @@ VGGType<MatType, VGGVersion, UsesBatchNorm>::operator=(const VGGType& other)
     MultiLayer<MatType>::operator=(other);
     numClasses = other.numClasses;
     includeTop = other.includeTop;
+    fused = other.fused;
   }
 
   return *this;
@@ -71,6 +76,7 @@ VGGType<MatType, VGGVersion, UsesBatchNorm>::operator=(VGGType&& other)
     MultiLayer<MatType>::operator=(std::move(other));
     numClasses = std::move(other.numClasses);
     includeTop = std::move(other.includeTop);
+    fused = std::move(other.fused);
   }
 
   return *this;
@@ -79,12 +85,16 @@ VGGType<MatType, VGGVersion, UsesBatchNorm>::operator=(VGGType&& other)
 template<typename MatType, size_t VGGVersion, bool UsesBatchNorm>
 template<typename Archive>
 void VGGType<MatType, VGGVersion, UsesBatchNorm>::serialize(
-    Archive& ar, const uint32_t /* version */)
+    Archive& ar, const uint32_t version)
 {
   ar(cereal::base_class<MultiLayer<MatType>>(this));
 
   ar(CEREAL_NVP(numClasses));
   ar(CEREAL_NVP(includeTop));
+
+  // Version 0 was saved before the model could be fused.
+  if (version >= 1)
+    ar(CEREAL_NVP(fused));
 }
 
 template<typename MatType, size_t VGGVersion, bool UsesBatchNorm>
@@ -109,6 +119,11 @@ void VGGType<MatType, VGGVersion, UsesBatchNorm>::MakeModel()
     {
       this->template Add<MaxPooling>(2, 2, 2, 2);
     }
+    else if (fused)
+    {
+      this->template Add<FusedConvolutionType<MatType>>(layers[i], 3, 3, 1,
+          1, 1, 1, FusedActivation::ReLU);
+    }
     else
     {
       this->template Add<Convolution>(layers[i], 3, 3, 1, 1, 1, 1);
@@ -28,6 +28,12 @@
 
 #define MLPACK_ENABLE_ANN_SERIALIZATION
 #include <mlpack.hpp>
+#include <models/common/batch_norm_folding.hpp>
+#include <models/common/model_summary.hpp>
+#include <models/layers/checkpoint.hpp>
+#include <models/layers/depthwise_convolution.hpp>
+#include <models/layers/fused_convolution.hpp>
+#include <models/layers/residual.hpp>
 
 namespace mlpack {
 namespace models {
@@ -50,9 +56,19 @@ class XceptionType : public MultiLayer<MatType>
    * @param numClasses Number of classes to classify images into,
    *     only to be specified if includeTop is true.
    * @param includeTop Must be set to true if classifier layers are set.
+   * @param fused Whether convolutions are FusedConvolution layers that also
+   *     apply the ReLU after them, which is faster for inference. Fused
+   *     networks have no batch normalization layers; use
+   *     GetInferenceModel() to fold them into the convolutions.
+   * @param checkpoint Whether the outputs of the layers of every block are
+   *     computed again for the backward pass instead of being kept, so
+   *     training needs much less memory for about a third more computation;
+   *     see Checkpoint.
    */
   XceptionType(const size_t numClasses = 1000,
-               const bool includeTop = true);
+               const bool includeTop = true,
+               const bool fused = false,
+               const bool checkpoint = false);
 
   //! Copy the given XceptionType.
   XceptionType(const XceptionType& other);
@@ -90,13 +106,72 @@ class XceptionType : public MultiLayer<MatType>
     return xception;
   }
 
+  /**
+   * Get the output shape, parameters, multiply-accumulates and activation
+   * memory of every layer of the network for inputs of the given dimensions,
+   * without passing any input through it; see ModelSummary.
+   *
+   * @param inputDimensions Dimensions of a single input, e.g. {224, 224, 3}.
+   */
+  ModelSummary Summary(const std::vector<size_t>& inputDimensions)
+  {
+    return ModelSummary(*this, inputDimensions);
+  }
+
+  /**
+   * Get an FFN object for inference with the weights of the given trained
+   * network, which holds this XceptionType. Batch normalization layers are
+   * folded into the convolutions before them, and ReLU layers that follow a
+   * convolution are applied by it, so the returned network is a fused
+   * XceptionType.
+   *
+   * NOTE: The caller is responsible for deleting the returned object.
+   *
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
+   *
+   * @param trained Trained network returned by GetModel().
+   */
+  template<typename OutputLayerType, typename InitializationRuleType>
+  FFN<OutputLayerType, InitializationRuleType, MatType>* GetInferenceModel(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& trained) const
+  {
+    FFN<OutputLayerType, InitializationRuleType, MatType>* xception =
+        new FFN<OutputLayerType, InitializationRuleType, MatType>();
+    xception->Add(new XceptionType(numClasses, includeTop, true));
+    BatchNormFolding::Fold(trained, *xception);
+    return xception;
+  }
+
   //! Serialize the XceptionType.
   template<typename Archive>
   void serialize(Archive& ar, const uint32_t /* version */);
 
  private:
   /**
-   * Adds Separable Convolution to the given block.
+   * Adds a convolution followed by batch normalization to the given block.
+   * If the network is fused, a single FusedConvolution with bias is added
+   * instead.
+   *
+   * @param block Block to add the convolution to.
+   * @param maps Number of output maps.
+   * @param kernelSize Kernel size of the convolution.
+   * @param stride Stride of the convolution.
+   * @param useBias Whether to use bias in the convolution.
+   */
+  void ConvolutionBatchNorm(MultiLayer<MatType>* block,
+                            const size_t maps,
+                            const size_t kernelSize,
+                            const size_t stride = 1,
+                            const bool useBias = false);
+
+  //! Adds ReLU to the given block. If the network is fused and the last
+  //! layer of the block is a FusedConvolution, it applies the ReLU instead.
+  void AddReLU(MultiLayer<MatType>* block);
+
+  /**
+   * Adds Separable Convolution followed by batch normalization to the given
+   * block.
    *
    * @param block Block to add the separable convolution to.
    * @param inMaps Number of input maps.
@@ -140,6 +215,13 @@ class XceptionType : public MultiLayer<MatType>
 
   //! Locally stored if classifier layers are included or not.
   bool includeTop;
+
+  //! Locally stored if convolutions and activations are fused.
+  bool fused;
+
+  //! Locally stored if the outputs of the blocks are computed again for the
+  //! backward pass.
+  bool checkpoint;
 }; // XceptionType class.
 
 // Convenience typedefs for different VGG layer.
@@ -149,6 +231,8 @@ typedef XceptionType<arma::mat> Xception;
 } // namespace mlpack
 
 CEREAL_REGISTER_TYPE(mlpack::models::XceptionType<arma::mat>);
+CEREAL_TEMPLATE_CLASS_VERSION((template<typename MatType>),
+    (mlpack::models::XceptionType<MatType>), (1));
 
 #include "xception_impl.hpp"
 
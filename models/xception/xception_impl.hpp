@@ -20,10 +20,14 @@ namespace models {
 template<typename MatType>
 XceptionType<MatType>::XceptionType(
     const size_t numClasses,
-    const bool includeTop) :
+    const bool includeTop,
+    const bool fused,
+    const bool checkpoint) :
     MultiLayer<MatType>(),
     numClasses(numClasses),
-    includeTop(includeTop)
+    includeTop(includeTop),
+    fused(fused),
+    checkpoint(checkpoint)
 {
   MakeModel();
 }
@@ -33,7 +37,9 @@ XceptionType<MatType>::XceptionType(
     const XceptionType& other) :
     MultiLayer<MatType>(other),
     numClasses(other.numClasses),
-    includeTop(other.includeTop)
+    includeTop(other.includeTop),
+    fused(other.fused),
+    checkpoint(other.checkpoint)
 {
   // Nothing to do here.
 }
@@ -43,7 +49,9 @@ XceptionType<MatType>::XceptionType(
     XceptionType&& other) :
     MultiLayer<MatType>(std::move(other)),
     numClasses(std::move(other.numClasses)),
-    includeTop(std::move(other.includeTop))
+    includeTop(std::move(other.includeTop)),
+    fused(std::move(other.fused)),
+    checkpoint(std::move(other.checkpoint))
 {
   // Nothing to do here.
 }
@@ -57,6 +65,8 @@ XceptionType<MatType>::operator=(const XceptionType& other)
     MultiLayer<MatType>::operator=(other);
     numClasses = other.numClasses;
     includeTop = other.includeTop;
+    fused = other.fused;
+    checkpoint = other.checkpoint;
   }
 
   return *this;
@@ -71,6 +81,8 @@ XceptionType<MatType>::operator=(XceptionType&& other)
     MultiLayer<MatType>::operator=(std::move(other));
     numClasses = std::move(other.numClasses);
     includeTop = std::move(other.includeTop);
+    fused = std::move(other.fused);
+    checkpoint = std::move(other.checkpoint);
   }
 
   return *this;
@@ -79,12 +91,57 @@ XceptionType<MatType>::operator=(XceptionType&& other)
 template<typename MatType>
 template<typename Archive>
 void XceptionType<MatType>::serialize(
-    Archive& ar, const uint32_t /* version */)
+    Archive& ar, const uint32_t version)
 {
   ar(cereal::base_class<MultiLayer<MatType>>(this));
 
   ar(CEREAL_NVP(numClasses));
   ar(CEREAL_NVP(includeTop));
+
+  // Version 0 was saved before the model could be fused or checkpointed.
+  if (version >= 1)
+  {
+    ar(CEREAL_NVP(fused));
+    ar(CEREAL_NVP(checkpoint));
+  }
+}
+
+template<typename MatType>
+void XceptionType<MatType>::ConvolutionBatchNorm(
+    MultiLayer<MatType>* block,
+    const size_t maps,
+    const size_t kernelSize,
+    const size_t stride,
+    const bool useBias)
+{
+  if (fused)
+  {
+    block->template Add<FusedConvolutionType<MatType>>(maps, kernelSize,
+        kernelSize, stride, stride);
+  }
+  else
+  {
+    block->template Add<Convolution>(maps, kernelSize, kernelSize, stride,
+        stride, 0, 0, "none", useBias);
+    block->template Add<BatchNorm>();
+  }
+}
+
+template<typename MatType>
+void XceptionType<MatType>::AddReLU(MultiLayer<MatType>* block)
+{
+  FusedConvolutionType<MatType>* convolution = nullptr;
+  if (fused && !block->Network().empty())
+  {
+    convolution = dynamic_cast<FusedConvolutionType<MatType>*>(
+        block->Network().back());
+  }
+
+  if (convolution != nullptr &&
+      convolution->Activation() == FusedActivation::Identity)
+    convolution->Activation() = FusedActivation::ReLU;
+  else
+    block->template Add<ReLU>();
 }
 
 template<typename MatType>
@@ -97,10 +154,11 @@ void XceptionType<MatType>::SeparableConv(
     const size_t padding,
     const bool useBias)
 {
-  block->template Add<GroupedConvolution>(inMaps, kernelSize, kernelSize,
-      inMaps, stride, stride, padding, padding, "none", useBias);
-  block->template Add<Convolution>(outMaps, 1, 1, 1, 1, 0, 0, "none",
-      useBias);
+  // The depthwise step convolves every map on its own, which is much faster
+  // with a direct kernel than as a grouped convolution.
+  block->template Add<DepthwiseConvolutionType<MatType>>(inMaps, kernelSize,
+      kernelSize, stride, stride, padding, padding, useBias);
+  ConvolutionBatchNorm(block, outMaps, 1, 1, useBias);
 }
 
 template<typename MatType>
@@ -112,43 +170,39 @@ void XceptionType<MatType>::Block(
     const bool startWithRelu,
     const bool growFirst)
 {
-  MultiLayer<MatType>* block = new MultiLayer<MatType>();
+  MultiLayer<MatType>* block = checkpoint ? new CheckpointType<MatType>() :
+      new MultiLayer<MatType>();
   size_t filter = inMaps;
   if (reps < 2)
   {
     if (startWithRelu)
-      block->template Add<ReLU>();
+      AddReLU(block);
     SeparableConv(block, inMaps, outMaps, 3, 1, 1, false);
-    block->template Add<BatchNorm>();
   }
   else
   {
     if (growFirst)
     {
       if (startWithRelu)
-        block->template Add<ReLU>();
+        AddReLU(block);
       SeparableConv(block, inMaps, outMaps, 3, 1, 1, false);
-      block->template Add<BatchNorm>();
       filter = outMaps;
     }
     if (startWithRelu || growFirst)
-      block->template Add<ReLU>();
+      AddReLU(block);
     SeparableConv(block, filter, filter, 3, 1, 1, false);
-    block->template Add<BatchNorm>();
     if (reps > 2)
     {
       for (size_t i = 0; i < reps - 2; i++)
       {
-        block->template Add<ReLU>();
+        AddReLU(block);
         SeparableConv(block, filter, filter, 3, 1, 1, false);
-        block->template Add<BatchNorm>();
       }
     }
     if (!growFirst)
     {
-      block->template Add<ReLU>();
+      AddReLU(block);
       SeparableConv(block, inMaps, outMaps, 3, 1, 1, false);
-      block->template Add<BatchNorm>();
     }
   }
   if (strides != 1)
@@ -156,39 +210,29 @@ void XceptionType<MatType>::Block(
     block->template Add<Padding>(1, 1, 1, 1);
     block->template Add<MaxPooling>(3, 3, strides, strides);
   }
+
+  // The ReLU after the sum starts the next block, whose shortcut takes the
+  // sum itself, so only the addition is done by the residual layer.
+  ResidualType<MatType>* residual = new ResidualType<MatType>();
+  residual->Add(block);
   if (inMaps != outMaps || strides != 1)
   {
     MultiLayer<MatType>* block2 = new MultiLayer<MatType>();
-    block2->template Add<Convolution>(outMaps, 1, 1, strides, strides,
-        0, 0, "none", false);
-    block2->template Add<BatchNorm>();
-
-    AddMerge* merge = new AddMerge();
-    merge->template Add(block);
-    merge->template Add(block2);
-
-    this->template Add(merge);
+    ConvolutionBatchNorm(block2, outMaps, 1, strides);
+    residual->Add(block2);
   }
-  else
-  {
-    AddMerge* merge = new AddMerge();
-    merge->template Add(block);
-    merge->template Add<Identity>();
 
-    this->template Add(merge);
-  }
+  this->Add(residual);
 }
 
 template<typename MatType>
 void XceptionType<MatType>::MakeModel()
 {
-  this->template Add<Convolution>(32, 3, 3, 2, 2, 0, 0, "none", false);
-  this->template Add<BatchNorm>();
-  this->template Add<ReLU>();
+  ConvolutionBatchNorm(this, 32, 3, 2);
+  AddReLU(this);
 
-  this->template Add<Convolution>(64, 3, 3, 1, 1, 0, 0, "none", false);
-  this->template Add<BatchNorm>();
-  this->template Add<ReLU>();
+  ConvolutionBatchNorm(this, 64, 3);
+  AddReLU(this);
 
   Block(64, 128, 2, 2, false, true);
   Block(128, 256, 2, 2);
@@ -207,15 +251,13 @@ void XceptionType<MatType>::MakeModel()
   Block(728, 1024, 2, 2, true, false);
 
   SeparableConv(this, 1024, 1536, 3, 1, 1);
-  this->template Add<BatchNorm>();
-  this->template Add<ReLU>();
+  AddReLU(this);
 
   SeparableConv(this, 1536, 2048, 3, 1, 1);
-  this->template Add<BatchNorm>();
 
   if (includeTop)
   {
-    this->template Add<ReLU>();
+    AddReLU(this);
     this->template Add<AdaptiveMeanPooling>(1, 1);
     this->template Add<Linear>(numClasses);
   }
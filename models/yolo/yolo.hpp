@@ -28,6 +28,13 @@
 
 #define MLPACK_ENABLE_ANN_SERIALIZATION
 #include <mlpack.hpp>
+#include <models/common/batch_norm_folding.hpp>
+#include <models/common/model_summary.hpp>
+#include <models/common/pretrained_weights.hpp>
+#include <models/common/quantization.hpp>
+#include <models/layers/fused_convolution.hpp>
+#include <models/layers/layer_types.hpp>
+#include <models/yolo/yolo_detection.hpp>
 
 namespace mlpack {
 namespace models {
@@ -35,194 +42,244 @@ namespace models {
 /**
  * Definition of a YOLO object detection models.
  * 
- * @tparam OutputLayerType The output layer type used to evaluate the network.
- * @tparam InitializationRuleType Rule used to initialize the weight matrix.
+ * @tparam MatType Matrix representation to accept as input and use for
+ *    computation, e.g. arma::fmat for single precision.
  */
 template<
-  typename OutputLayerType = NegativeLogLikelihood<>,
-  typename InitializationRuleType = RandomInitialization
+  typename MatType = arma::mat
 >
-class YOLO
+class YOLOType : public MultiLayer<MatType>
 {
  public:
-  //! Create the YOLO model.
-  YOLO();
-
   /**
-   * YOLO constructor intializes input shape and number of classes.
+   * YOLOType constructor intializes version, number of classes and boxes.
    *
-   * @param inputChannels Number of input channels of the input image.
-   * @param inputWidth Width of the input image.
-   * @param inputHeight Height of the input image.
    * @param yoloVersion Version of YOLO model.
    * @param numClasses Optional number of classes to classify images into,
-   *     only to be specified if includeTop is  true.
-   * @param numBoxes Number of bounding boxes per image.
-   * @param featureSizeWidth Width of output feature map.
-   * @param featureSizeHeight Height of output feature map.
-   * @param weights One of 'none', 'voc'(pre-training on VOC-2012) or path to weights.
-   * @param includeTop Must be set to true if weights are set.
+   *     only to be specified if includeTop is true.
+   * @param numBoxes Number of bounding boxes per grid cell.
+   * @param featureWidth Width of output feature map.
+   * @param featureHeight Height of output feature map.
+   * @param weights One of 'none', 'voc'(pre-training on VOC-2012, fetched
+   *     through PublishedWeights) or path to weights, which are copied into
+   *     the model once the network holding it is reset; see LoadModel().
+   * @param includeTop Must be set to true if classifier layers are set, and
+   *     if weights are set.
+   * @param fused Whether every convolution, its batch normalization and its
+   *     LeakyReLU are computed by a single FusedConvolution layer, which is
+   *     faster for inference. Use GetInferenceModel() to get the weights of
+   *     a trained network.
    */
-  YOLO(const size_t inputChannel,
-       const size_t inputWidth,
-       const size_t inputHeight,
-       const std::string yoloVersion = "v1-tiny",
-       const size_t numClasses = 20,
-       const size_t numBoxes = 2,
-       const size_t featureSizeWidth = 7,
-       const size_t featureSizeHeight = 7,
-       const std::string& weights = "none",
-       const bool includeTop = true);
+  YOLOType(const std::string& yoloVersion = "v1-tiny",
+           const size_t numClasses = 20,
+           const size_t numBoxes = 2,
+           const size_t featureWidth = 7,
+           const size_t featureHeight = 7,
+           const std::string& weights = "none",
+           const bool includeTop = true,
+           const bool fused = false);
+
+  //! Copy the given YOLOType.
+  YOLOType(const YOLOType& other);
+  //! Take ownership of the layers of the given YOLOType.
+  YOLOType(YOLOType&& other);
+  //! Copy the given YOLOType.
+  YOLOType& operator=(const YOLOType& other);
+  //! Take ownership of the given YOLOType.
+  YOLOType& operator=(YOLOType&& other);
+
+  //! Virtual destructor: delete all held layers.
+  virtual ~YOLOType()
+  { /* Nothing to do here. */ }
+
+  //! Create a copy of the YOLOType (this is safe for polymorphic use).
+  YOLOType* Clone() const { return new YOLOType(*this); }
 
   /**
-   * YOLO constructor intializes input shape and number of classes.
-   *
-   * @param inputShape A three-valued tuple indicating input shape.
-   *     First value is number of Channels (Channels-First).
-   *     Second value is input height. Third value is input width.
-   * @param yoloVersion Version of YOLO model.
-   * @param numClasses Optional number of classes to classify images into,
-   *     only to be specified if includeTop is  true.
-   * @param numBoxes Number of bounding boxes per image.
-   * @param featureShape A twp-valued tuple indicating width and height of output feature
-   *     map.
-   * @param weights One of 'none', 'voc'(pre-training on VOC) or path to weights.
+   * Get the FFN object representing the network.
+   * 
+   * NOTE: The caller is responsible for deleting the returned object.
+   * 
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
    */
-  YOLO(const std::tuple<size_t, size_t, size_t> inputShape,
-       const std::string yoloVersion = "v1-tiny",
-       const size_t numClasses = 1000,
-       const size_t numBoxes = 2,
-       const std::tuple<size_t, size_t> featureShape = {7, 7},
-       const std::string& weights = "none",
-       const bool includeTop = true);
-
-  //! Get Layers of the model.
-  FFN<OutputLayerType, InitializationRuleType>& GetModel() { return yolo; }
-
-  //! Load weights into the model.
-  void LoadModel(const std::string& filePath);
+  template<
+    typename OutputLayerType = NegativeLogLikelihood,
+    typename InitializationRuleType = RandomInitialization
+  >
+  FFN<OutputLayerType, InitializationRuleType, MatType>* GetModel()
+  {
+    FFN<OutputLayerType, InitializationRuleType, MatType>* yolo =
+        new FFN<OutputLayerType, InitializationRuleType, MatType>();
+    yolo->Add(this);
+    return yolo;
+  }
 
-  //! Save weights for the model.
-  void SaveModel(const std::string& filePath);
+  /**
+   * Get the output shape, parameters, multiply-accumulates and activation
+   * memory of every layer of the network for inputs of the given dimensions,
+   * without passing any input through it; see ModelSummary.
+   *
+   * @param inputDimensions Dimensions of a single input, e.g. {224, 224, 3}.
+   */
+  ModelSummary Summary(const std::vector<size_t>& inputDimensions)
+  {
+    return ModelSummary(*this, inputDimensions);
+  }
 
- private:
   /**
-   * Adds Convolution Block.
+   * Get an FFN object for inference with the weights of the given trained
+   * network, which holds this YOLOType. Batch normalization layers are
+   * folded into the convolutions before them, and LeakyReLU layers that
+   * follow a convolution are applied by it, so the returned network is a
+   * fused YOLOType.
    *
-   * @tparam SequentialType Layer type in which convolution block will
-   *     be added.
+   * NOTE: The caller is responsible for deleting the returned object.
    *
-   * @param inSize Number of input maps.
-   * @param outSize Number of output maps.
-   * @param kernelWidth Width of the filter/kernel.
-   * @param kernelHeight Height of the filter/kernel.
-   * @param strideWidth Stride of filter application in the x direction.
-   * @param strideHeight Stride of filter application in the y direction.
-   * @param padW Padding width of the input.
-   * @param padH Padding height of the input.
-   * @param batchNorm Boolean to determine whether a batch normalization
-   *     layer is added.
-   * @param baseLayer Layer in which Convolution block will be added, if
-   *     NULL added to YOLO FFN.
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
+   *
+   * @param trained Trained network returned by GetModel().
    */
-  template<typename SequentialType = Sequential<>>
-  void ConvolutionBlock(const size_t inSize,
-                        const size_t outSize,
-                        const size_t kernelWidth,
-                        const size_t kernelHeight,
-                        const size_t strideWidth = 1,
-                        const size_t strideHeight = 1,
-                        const size_t padW = 0,
-                        const size_t padH = 0,
-                        const bool batchNorm = false,
-                        SequentialType* baseLayer = NULL)
+  template<typename OutputLayerType, typename InitializationRuleType>
+  FFN<OutputLayerType, InitializationRuleType, MatType>* GetInferenceModel(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& trained) const
   {
-    Sequential<>* bottleNeck = new Sequential<>();
-    bottleNeck->Add(new Convolution<>(inSize, outSize, kernelWidth,
-        kernelHeight, strideWidth, strideHeight, padW, padH, inputWidth,
-        inputHeight));
-
-    mlpack::Log::Info << "Conv Layer.  ";
-    mlpack::Log::Info << "(" << inputWidth << ", " << inputHeight <<
-        ", " << inSize << ") ----> ";
-
-    inputWidth = ConvOutSize(inputWidth, kernelWidth, strideWidth, padW);
-    inputHeight = ConvOutSize(inputHeight, kernelHeight, strideHeight, padH);
-    mlpack::Log::Info << "(" << inputWidth << ", " << inputHeight <<
-        ", " << outSize << ")" << std::endl;
-
-    if (batchNorm)
-      bottleNeck->Add(new BatchNorm<>(outSize, 1e-8, false));
-
-    bottleNeck->Add(new LeakyReLU<>(0.01));
+    FFN<OutputLayerType, InitializationRuleType, MatType>* yolo =
+        new FFN<OutputLayerType, InitializationRuleType, MatType>();
+    yolo->Add(new YOLOType(yoloVersion, numClasses, numBoxes, featureWidth,
+        featureHeight, "none", includeTop, true));
+    BatchNormFolding::Fold(trained, *yolo);
+    return yolo;
+  }
 
-    if (baseLayer != NULL)
-      baseLayer->Add(bottleNeck);
-    else
-      yolo.Add(bottleNeck);
+  /**
+   * Get an FFN object for inference with the weights of the given trained
+   * network, whose convolutions compute with 8-bit integers. The network of
+   * GetInferenceModel() is quantized with the ranges of the inputs of
+   * every convolution recorded on the calibration data.
+   *
+   * NOTE: The caller is responsible for deleting the returned object.
+   *
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
+   *
+   * @param trained Trained network returned by GetModel().
+   * @param calibrationData Representative inputs, one input per column.
+   */
+  template<typename OutputLayerType, typename InitializationRuleType>
+  FFN<OutputLayerType, InitializationRuleType, MatType>* GetQuantizedModel(
+      FFN<OutputLayerType, InitializationRuleType, MatType>& trained,
+      const MatType& calibrationData) const
+  {
+    FFN<OutputLayerType, InitializationRuleType, MatType>* yolo =
+        GetInferenceModel(trained);
+    Quantization::Quantize(*yolo, calibrationData);
+    return yolo;
   }
 
   /**
-   * Adds Pooling Block.
+   * Detects objects in the given images with the given trained network,
+   * which holds this YOLOType. The output of the network is decoded into
+   * boxes in pixel coordinates of the input images, boxes below the
+   * confidence threshold are dropped and non-maximum suppression is applied
+   * to the boxes of every class; see YOLODetection::Decode().
+   *
+   * @tparam OutputLayerType The output layer type used to evaluate the network.
+   * @tparam InitializationRuleType Rule used to initialize the weight matrix.
    *
-   * @param factor The factor by which input dimensions will be divided.
-   * @param type One of "max" or "mean". Determines whether add mean pooling
-   *     layer or max pooling layer.
+   * @param network Trained network returned by GetModel() or
+   *     GetInferenceModel().
+   * @param images Input images, one image per column.
+   * @param detections Resulting boxes of every image, sorted by descending
+   *     score.
+   * @param scores Resulting score of every box of the detections.
+   * @param confidenceThreshold Minimum score of a detection.
+   * @param iouThreshold Maximum intersection over union of detections of the
+   *     same class.
    */
-  void PoolingBlock(const size_t factor = 2,
-                    const std::string type = "max")
+  template<typename OutputLayerType, typename InitializationRuleType>
+  void Detect(FFN<OutputLayerType, InitializationRuleType, MatType>& network,
+              const MatType& images,
+              BoxStore& detections,
+              arma::vec& scores,
+              const double confidenceThreshold = 0.5,
+              const double iouThreshold = 0.5) const
   {
-    if (type == "max")
+    if (!includeTop)
     {
-      yolo.Add(new AdaptiveMaxPooling<>(
-          std::ceil(inputWidth * 1.0 / factor),
-          std::ceil(inputHeight * 1.0 / factor)));
-    }
-    else
-    {
-      yolo.Add(new AdaptiveMeanPooling<>(std::ceil(inputWidth * 1.0 /
-          factor), std::ceil(inputHeight * 1.0 / factor)));
+      mlpack::Log::Fatal << "YOLO::Detect(): the model has no detection "
+          << "layers, set includeTop to true." << std::endl;
     }
 
-    mlpack::Log::Info << "Pooling Layer.  ";
-    mlpack::Log::Info << "(" << inputWidth << ", " << inputHeight <<
-        ") ----> ";
-    // Update inputWidth and inputHeight.
-    inputWidth = std::ceil(inputWidth * 1.0 / factor);
-    inputHeight = std::ceil(inputHeight * 1.0 / factor);
-
-    mlpack::Log::Info << "(" << inputWidth << ", " << inputHeight <<
-        ")" << std::endl;
+    const std::vector<size_t>& dimensions = network.InputDimensions();
+    MatType output;
+    network.Predict(images, output);
+    YOLODetection::Decode(output, detections, scores, 1, dimensions[0],
+        dimensions[1], featureWidth, featureHeight, numBoxes, numClasses,
+        true, confidenceThreshold, iouThreshold);
   }
 
+  //! Get the number of classes.
+  size_t NumClasses() const { return numClasses; }
+  //! Get the number of bounding boxes per grid cell.
+  size_t NumBoxes() const { return numBoxes; }
+  //! Get the width of the output feature map.
+  size_t FeatureWidth() const { return featureWidth; }
+  //! Get the height of the output feature map.
+  size_t FeatureHeight() const { return featureHeight; }
+
   /**
-   * Return the convolution output size.
+   * Set the weights of the layers of the network to the given weights, and
+   * copy weights loaded by LoadModel() into them.
    *
-   * @param size The size of the input (row or column).
-   * @param k The size of the filter (width or height).
-   * @param s The stride size (x or y direction).
-   * @param padding The size of the padding (width or height) on one side.
-   * @return The convolution output size.
+   * @param weightsIn Weights of the network, allocated by the FFN.
    */
-  size_t ConvOutSize(const size_t size,
-                     const size_t k,
-                     const size_t s,
-                     const size_t padding)
+  void SetWeights(const MatType& weightsIn)
   {
-    return std::floor(size + 2 * padding - k) / s + 1;
+    MultiLayer<MatType>::SetWeights(weightsIn);
+    preTrainedWeights.Set(*this, weightsIn);
   }
 
-  //! Locally stored YOLO Model.
-  FFN<OutputLayerType, InitializationRuleType> yolo;
+  /**
+   * Load the weights and batch normalization statistics of the model, as
+   * saved by SaveModel(). If the network holding the model isn't reset yet,
+   * they are copied into the model once it is.
+   *
+   * @param filePath Path of the weights.
+   */
+  void LoadModel(const std::string& filePath);
+
+  /**
+   * Save the weights and batch normalization statistics of the model, which
+   * must be held by a reset network.
+   *
+   * @param filePath Path of the weights.
+   */
+  void SaveModel(const std::string& filePath);
+
+  //! Serialize the YOLOType.
+  template<typename Archive>
+  void serialize(Archive& ar, const uint32_t /* version */);
 
-  //! Locally stored number of channels in the image.
-  size_t inputChannel;
+ private:
+  /**
+   * Adds a convolution followed by batch normalization and LeakyReLU. If the
+   * network is fused, a single FusedConvolution is added instead.
+   *
+   * @param maps Number of output maps.
+   */
+  void ConvolutionBlock(const size_t maps);
 
-  //! Locally stored width of the image.
-  size_t inputWidth;
+  //! Adds max pooling that halves the width and height of the input.
+  void PoolingBlock() { this->template Add<MaxPoolingType<MatType>>(
+      2, 2, 2, 2, false); }
 
-  //! Locally stored height of the image.
-  size_t inputHeight;
+  //! Generate the layers of the YOLO.
+  void MakeModel();
+
+  //! Locally stored version of yolo model.
+  std::string yoloVersion;
 
   //! Locally stored number of output classes.
   size_t numClasses;
@@ -236,16 +293,27 @@ class YOLO
   //! Locally stored height of output feature map.
   size_t featureHeight;
 
-  //! Locally stored type of pre-trained weights.
-  std::string weights;
+  //! Locally stored if classifier layers are included or not.
+  bool includeTop;
 
-  //! Locally stored version of yolo model.
-  std::string yoloVersion;
-}; // YOLO class.
+  //! Locally stored if convolutions and activations are fused.
+  bool fused;
+
+  //! Locally stored pre-trained weights, until they are copied into the
+  //! model.
+  PretrainedWeights<MatType> preTrainedWeights;
+}; // YOLOType class.
+
+// Convenience typedef for the YOLO model.
+typedef YOLOType<arma::mat> YOLO;
 
 } // namespace models
 } // namespace mlpack
 
+CEREAL_REGISTER_TYPE(mlpack::models::YOLOType<arma::mat>);
+CEREAL_TEMPLATE_CLASS_VERSION((template<typename MatType>),
+    (mlpack::models::YOLOType<MatType>), (1));
+
 # include "yolo_impl.hpp"
 
 #endif
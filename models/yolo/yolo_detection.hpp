@@ -0,0 +1,269 @@
+/**
+ * @file yolo_detection.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of YOLODetection, which decodes the output of YOLO models into
+ * bounding boxes and filters them with non-maximum suppression.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_MODELS_YOLO_YOLO_DETECTION_HPP
+#define MODELS_MODELS_YOLO_YOLO_DETECTION_HPP
+
+#include <mlpack.hpp>
+#include <dataloader/box_store.hpp>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * Post-processing of the output of YOLO models. Decode() is the inverse of
+ * PreProcessor::YOLOPreProcessor(): every prediction of every grid cell is
+ * decoded into a box in pixel coordinates, boxes whose score is below the
+ * confidence threshold are dropped, and the remaining boxes of every class
+ * go through non-maximum suppression. Images are decoded in parallel (if
+ * OpenMP is available).
+ *
+ * The score of a box is its confidence times the probability of its most
+ * likely class. For version 1 all predictions of a cell share the class
+ * probabilities of the cell; for later versions every box has its own.
+ *
+ * @code
+ * arma::mat output;
+ * model.Predict(images, output);
+ *
+ * BoxStore detections;
+ * arma::vec scores;
+ * YOLODetection::Decode(output, detections, scores);
+ * for (size_t b = detections.Offset(0); b < detections.Offset(1); b++)
+ * {
+ *   std::cout << detections.Classes()(b) << " (" << scores(b) << ") : "
+ *       << detections.Coordinates().col(b).t();
+ * }
+ * @endcode
+ */
+class YOLODetection
+{
+ public:
+  /**
+   * Decodes the output of a YOLO model into the detected boxes of every
+   * image, with the parameters of the encoding of
+   * PreProcessor::YOLOPreProcessor().
+   *
+   * @param output Output of the model, one image per column.
+   * @param detections Resulting boxes of every image, in pixel coordinates,
+   *     with the boxes of an image sorted by descending score.
+   * @param scores Resulting score of every box of the detections.
+   * @param version Version of YOLO the output was encoded for.
+   * @param imageWidth Width of the input images.
+   * @param imageHeight Height of the input images.
+   * @param gridWidth Width of output feature map of YOLO model.
+   * @param gridHeight Height of output feature map of YOLO model.
+   * @param numBoxes Number of bounding boxes per grid.
+   * @param numClasses Number of classes in training set.
+   * @param normalize Boolean to determine whether centres are encoded
+   *     relative to their grid cell.
+   * @param confidenceThreshold Minimum score of a detection.
+   * @param iouThreshold Boxes of the same class that overlap a box of higher
+   *     score by more than this intersection over union are suppressed.
+   */
+  template<typename eT>
+  static void Decode(const arma::Mat<eT>& output,
+                     BoxStore& detections,
+                     arma::vec& scores,
+                     const size_t version = 1,
+                     const size_t imageWidth = 224,
+                     const size_t imageHeight = 224,
+                     const size_t gridWidth = 7,
+                     const size_t gridHeight = 7,
+                     const size_t numBoxes = 2,
+                     const size_t numClasses = 20,
+                     const bool normalize = true,
+                     const double confidenceThreshold = 0.5,
+                     const double iouThreshold = 0.5)
+  {
+    mlpack::Log::Assert(version >= 1 && version <= 3, "Supported YOLO versions \
+        are version 1 to version 3.");
+
+    const size_t numPredictions = (version == 1) ?
+        5 * numBoxes + numClasses : numBoxes * (5 + numClasses);
+    const size_t gridSize = gridWidth * gridHeight;
+    if (output.n_rows != gridSize * numPredictions)
+    {
+      mlpack::Log::Fatal << "YOLODetection::Decode(): expected outputs of "
+          << gridSize * numPredictions << " rows, but the output has "
+          << output.n_rows << " rows." << std::endl;
+    }
+
+    const double cellSizeWidth = 1.0 / gridWidth;
+    const double cellSizeHeight = 1.0 / gridHeight;
+
+    // Every image is decoded into the same format the preprocessor reads,
+    // i.e. class label, x1, y1, x2 and y2 of every box.
+    std::vector<arma::vec> imageBoxes(output.n_cols);
+    std::vector<arma::vec> imageScores(output.n_cols);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t image = 0; image < output.n_cols; image++)
+    {
+      const eT* prediction = output.colptr(image);
+
+      // Candidates are collected in rows for the suppression.
+      arma::mat boxes(4, gridSize * numBoxes);
+      arma::vec boxScores(gridSize * numBoxes);
+      arma::vec classes(gridSize * numBoxes);
+      size_t candidates = 0;
+      for (size_t cell = 0; cell < gridSize; cell++)
+      {
+        // Rows of the grid hold the x coordinate, see the preprocessor.
+        const size_t gridX = cell % gridHeight;
+        const size_t gridY = cell / gridHeight;
+        for (size_t k = 0; k < numBoxes; k++)
+        {
+          const size_t s = (version == 1) ? 5 * k : (5 + numClasses) * k;
+          const size_t classOffset = (version == 1) ? 5 * numBoxes : s + 5;
+          const eT* values = prediction + cell + gridSize * s;
+          const eT* probabilities = prediction + cell + gridSize * classOffset;
+
+          size_t label = 0;
+          for (size_t c = 1; c < numClasses; c++)
+          {
+            if (probabilities[gridSize * c] > probabilities[gridSize * label])
+              label = c;
+          }
+
+          const double score = double(values[4 * gridSize]) *
+              double(probabilities[gridSize * label]);
+          if (score < confidenceThreshold)
+            continue;
+
+          double centreX = values[0];
+          double centreY = values[gridSize];
+          if (normalize)
+          {
+            centreX = (gridX + centreX) * cellSizeWidth;
+            centreY = (gridY + centreY) * cellSizeHeight;
+          }
+
+          const double width = values[2 * gridSize];
+          const double height = values[3 * gridSize];
+          double* box = boxes.colptr(candidates);
+          box[0] = (centreX - width / 2.0) * imageWidth;
+          box[1] = (centreY - height / 2.0) * imageHeight;
+          box[2] = (centreX + width / 2.0) * imageWidth;
+          box[3] = (centreY + height / 2.0) * imageHeight;
+          boxScores[candidates] = score;
+          classes[candidates] = label;
+          candidates++;
+        }
+      }
+
+      if (candidates == 0)
+        continue;
+
+      boxes.resize(4, candidates);
+      boxScores.resize(candidates);
+      classes.resize(candidates);
+
+      const arma::uvec keep = NonMaxSuppression(boxes, boxScores, classes,
+          iouThreshold);
+      imageBoxes[image].set_size(5 * keep.n_elem);
+      imageScores[image] = boxScores.elem(keep);
+      for (size_t i = 0; i < keep.n_elem; i++)
+      {
+        imageBoxes[image][5 * i] = classes[keep[i]];
+        imageBoxes[image].subvec(5 * i + 1, 5 * i + 4) = boxes.col(keep[i]);
+      }
+    }
+
+    size_t totalBoxes = 0;
+    for (size_t image = 0; image < output.n_cols; image++)
+      totalBoxes += imageScores[image].n_elem;
+
+    detections = BoxStore();
+    detections.Reserve(output.n_cols, totalBoxes);
+    scores.set_size(totalBoxes);
+    size_t offset = 0;
+    for (size_t image = 0; image < output.n_cols; image++)
+    {
+      detections.Add(imageBoxes[image]);
+      if (imageScores[image].n_elem > 0)
+      {
+        scores.subvec(offset, offset + imageScores[image].n_elem - 1) =
+            imageScores[image];
+        offset += imageScores[image].n_elem;
+      }
+    }
+  }
+
+  /**
+   * Class-aware non-maximum suppression. Boxes are visited by descending
+   * score; every kept box suppresses the boxes of the same class after it
+   * whose intersection over union with it exceeds the threshold. The
+   * overlaps of a kept box with all remaining boxes are computed at once,
+   * and boxes of different classes are moved apart by an offset per class
+   * so that they never overlap.
+   *
+   * @param boxes Boxes (x1, y1, x2, y2), one box per column.
+   * @param scores Score of every box.
+   * @param classes Class label of every box.
+   * @param iouThreshold Maximum intersection over union of kept boxes of the
+   *     same class.
+   * @return Indices of the kept boxes, by descending score.
+   */
+  static arma::uvec NonMaxSuppression(const arma::mat& boxes,
+                                      const arma::vec& scores,
+                                      const arma::vec& classes,
+                                      const double iouThreshold)
+  {
+    if (boxes.n_cols == 0)
+      return arma::uvec();
+
+    const arma::uvec order = arma::stable_sort_index(scores, "descend");
+    const arma::vec offset = classes.elem(order) *
+        (boxes.max() - boxes.min() + 1.0);
+    const arma::mat sorted = boxes.cols(order);
+    const arma::vec x1 = sorted.row(0).t() + offset;
+    const arma::vec y1 = sorted.row(1).t() + offset;
+    const arma::vec x2 = sorted.row(2).t() + offset;
+    const arma::vec y2 = sorted.row(3).t() + offset;
+    const arma::vec areas = (x2 - x1) % (y2 - y1);
+
+    const double lowest = std::numeric_limits<double>::lowest();
+    const double highest = std::numeric_limits<double>::max();
+    const size_t n = order.n_elem;
+    arma::uvec suppressed(n, arma::fill::zeros);
+    std::vector<arma::uword> keep;
+    for (size_t i = 0; i < n; i++)
+    {
+      if (suppressed[i])
+        continue;
+
+      keep.push_back(order[i]);
+      if (i + 1 == n)
+        break;
+
+      const arma::span rest(i + 1, n - 1);
+      const arma::vec width = arma::clamp(
+          arma::clamp(x2(rest), lowest, x2[i]) -
+          arma::clamp(x1(rest), x1[i], highest), 0.0, highest);
+      const arma::vec height = arma::clamp(
+          arma::clamp(y2(rest), lowest, y2[i]) -
+          arma::clamp(y1(rest), y1[i], highest), 0.0, highest);
+      const arma::vec intersection = width % height;
+      const arma::vec iou = intersection / (areas[i] + areas(rest) -
+          intersection);
+      suppressed(rest) += arma::conv_to<arma::uvec>::from(iou > iouThreshold);
+    }
+
+    return arma::uvec(keep);
+  }
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -17,148 +17,194 @@
 namespace mlpack {
 namespace models {
 
-template<
-    typename OutputLayerType,
-    typename InitializationRuleType
->
-YOLO<OutputLayerType, InitializationRuleType>::YOLO() :
-    inputChannel(0),
-    inputWidth(0),
-    inputHeight(0),
-    numClasses(0),
-    numBoxes(0),
-    featureWidth(0),
-    featureHeight(0),
-    weights("none"),
-    yoloVersion("none")
-{
-  // Nothing to do here.
-}
-
-template<
-    typename OutputLayerType,
-    typename InitializationRuleType
->
-YOLO<OutputLayerType, InitializationRuleType>::YOLO(
-  const size_t inputChannel,
-  const size_t inputWidth,
-  const size_t inputHeight,
-  const std::string yoloVersion,
-  const size_t numClasses,
-  const size_t numBoxes,
-  const size_t featureWidth,
-  const size_t featureHeight,
-  const std::string& weights,
-  const bool includeTop) :
-  YOLO<OutputLayerType, InitializationRuleType>(
-    std::tuple<size_t, size_t, size_t>(
-      inputChannel,
-      inputWidth,
-      inputHeight),
-      yoloVersion,
-      numClasses,
-      numBoxes,
-      std::tuple<size_t, size_t>(featureWidth, featureHeight),
-      weights,
-      includeTop)
-{
-  // Nothing to do here.
-}
-
-template<
-    typename OutputLayerType,
-    typename InitializationRuleType
->
-YOLO<OutputLayerType, InitializationRuleType>::YOLO(
-    const std::tuple<size_t, size_t, size_t> inputShape,
-    const std::string yoloVersion,
+template<typename MatType>
+YOLOType<MatType>::YOLOType(
+    const std::string& yoloVersion,
     const size_t numClasses,
     const size_t numBoxes,
-    const std::tuple<size_t, size_t> featureShape,
+    const size_t featureWidth,
+    const size_t featureHeight,
     const std::string& weights,
-    const bool includeTop) :
-    inputChannel(std::get<0>(inputShape)),
-    inputWidth(std::get<1>(inputShape)),
-    inputHeight(std::get<2>(inputShape)),
+    const bool includeTop,
+    const bool fused) :
+    MultiLayer<MatType>(),
+    yoloVersion(yoloVersion),
     numClasses(numClasses),
     numBoxes(numBoxes),
-    featureWidth(std::get<0>(featureShape)),
-    featureHeight(std::get<1>(featureShape)),
-    weights(weights),
-    yoloVersion(yoloVersion)
+    featureWidth(featureWidth),
+    featureHeight(featureHeight),
+    includeTop(includeTop),
+    fused(fused)
 {
-  std::set<std::string> supportedVersion({"v1-tiny"});
-  mlpack::Log::Assert(supportedVersion.count(yoloVersion),
-      "Unsupported YOLO version. Trying to find :" + yoloVersion);
+  // Unavailable weights are rejected before the layers are built.
+  const std::string name = "yolo" + yoloVersion + "_voc.bin";
+  if (weights == "voc")
+    PublishedWeights::Require(name, "YOLO");
+
+  MakeModel();
 
   if (weights == "voc")
   {
-    // Download weights here.
-    LoadModel("./../weights/YOLO/yolo" + yoloVersion + "_voc.bin");
-    return;
+    LoadModel(PublishedWeights::Fetch(name, "YOLO"));
   }
   else if (weights != "none")
   {
     LoadModel(weights);
-    return;
   }
+}
+
+template<typename MatType>
+YOLOType<MatType>::YOLOType(const YOLOType& other) :
+    MultiLayer<MatType>(other),
+    yoloVersion(other.yoloVersion),
+    numClasses(other.numClasses),
+    numBoxes(other.numBoxes),
+    featureWidth(other.featureWidth),
+    featureHeight(other.featureHeight),
+    includeTop(other.includeTop),
+    fused(other.fused),
+    preTrainedWeights(other.preTrainedWeights)
+{
+  // Nothing to do here.
+}
+
+template<typename MatType>
+YOLOType<MatType>::YOLOType(YOLOType&& other) :
+    MultiLayer<MatType>(std::move(other)),
+    yoloVersion(std::move(other.yoloVersion)),
+    numClasses(std::move(other.numClasses)),
+    numBoxes(std::move(other.numBoxes)),
+    featureWidth(std::move(other.featureWidth)),
+    featureHeight(std::move(other.featureHeight)),
+    includeTop(std::move(other.includeTop)),
+    fused(std::move(other.fused)),
+    preTrainedWeights(other.preTrainedWeights)
+{
+  // Nothing to do here.
+}
 
-  if (yoloVersion == "v1-tiny")
+template<typename MatType>
+YOLOType<MatType>& YOLOType<MatType>::operator=(const YOLOType& other)
+{
+  if (this != &other)
   {
-    yolo.Add(new IdentityLayer<>());
-
-    // Convolution and activation function in a block.
-    ConvolutionBlock(inputChannel, 16, 3, 3, 1, 1, 1, 1, true);
-    PoolingBlock(2);
-
-    size_t numBlocks = 5;
-    size_t outChannels = 16;
-    for (size_t blockId = 0; blockId < numBlocks; blockId++)
-    {
-      ConvolutionBlock(outChannels, outChannels * 2, 3, 3, 1, 1, 1, 1, true);
-      PoolingBlock(2);
-      outChannels *= 2;
-    }
-
-    ConvolutionBlock(outChannels, outChannels * 2, 3, 3, 1, 1, 1, 1, true);
-    outChannels *= 2;
-    ConvolutionBlock(outChannels, 256, 3, 3, 1, 1, 1, 1, true);
-    outChannels = 256;
+    MultiLayer<MatType>::operator=(other);
+    yoloVersion = other.yoloVersion;
+    numClasses = other.numClasses;
+    numBoxes = other.numBoxes;
+    featureWidth = other.featureWidth;
+    featureHeight = other.featureHeight;
+    includeTop = other.includeTop;
+    fused = other.fused;
+    preTrainedWeights = other.preTrainedWeights;
+  }
 
-    if (includeTop)
-    {
-      yolo.Add(new Linear<>(inputWidth * inputHeight * outChannels,
-          featureWidth * featureHeight * (5 * numBoxes + numClasses)));
-      yolo.Add(new SigmoidLayer<>());
-    }
+  return *this;
+}
 
-    yolo.ResetParameters();
+template<typename MatType>
+YOLOType<MatType>& YOLOType<MatType>::operator=(YOLOType&& other)
+{
+  if (this != &other)
+  {
+    MultiLayer<MatType>::operator=(std::move(other));
+    yoloVersion = std::move(other.yoloVersion);
+    numClasses = std::move(other.numClasses);
+    numBoxes = std::move(other.numBoxes);
+    featureWidth = std::move(other.featureWidth);
+    featureHeight = std::move(other.featureHeight);
+    includeTop = std::move(other.includeTop);
+    fused = std::move(other.fused);
+    preTrainedWeights = other.preTrainedWeights;
   }
+
+  return *this;
 }
 
-template<
-    typename OutputLayerType,
-    typename InitializationRuleType
->
-void YOLO<
-    OutputLayerType, InitializationRuleType
->::LoadModel(const std::string& filePath)
+template<typename MatType>
+void YOLOType<MatType>::LoadModel(const std::string& filePath)
 {
-  data::Load(filePath, "yolo" + yoloVersion, yolo);
+  if (!preTrainedWeights.Load(filePath, *this))
+  {
+    mlpack::Log::Fatal << "Unable to load the weights of YOLO from "
+        << filePath << "." << std::endl;
+  }
+
   Log::Info << "Loaded model." << std::endl;
 }
 
-template<
-    typename OutputLayerType,
-    typename InitializationRuleType
->
-void YOLO<
-    OutputLayerType, InitializationRuleType
->::SaveModel(const std::string& filePath)
+template<typename MatType>
+void YOLOType<MatType>::SaveModel(const std::string& filePath)
+{
+  Log::Info << "Saving model." << std::endl;
+  if (preTrainedWeights.Save(filePath, *this))
+    Log::Info << "Model saved in " << filePath << "." << std::endl;
+}
+
+template<typename MatType>
+template<typename Archive>
+void YOLOType<MatType>::serialize(Archive& ar, const uint32_t version)
+{
+  ar(cereal::base_class<MultiLayer<MatType>>(this));
+
+  ar(CEREAL_NVP(yoloVersion));
+  ar(CEREAL_NVP(numClasses));
+  ar(CEREAL_NVP(numBoxes));
+  ar(CEREAL_NVP(featureWidth));
+  ar(CEREAL_NVP(featureHeight));
+  ar(CEREAL_NVP(includeTop));
+
+  // Version 0 was saved before the model could be fused.
+  if (version >= 1)
+    ar(CEREAL_NVP(fused));
+}
+
+template<typename MatType>
+void YOLOType<MatType>::ConvolutionBlock(const size_t maps)
 {
-  Log::Info<< "Saving model." << std::endl;
-  data::Save(filePath, "yolo" + yoloVersion, yolo);
-  Log::Info << "Model saved in " << filePath << "." << std::endl;
+  if (fused)
+  {
+    this->template Add<FusedConvolutionType<MatType>>(maps, 3, 3, 1, 1, 1, 1,
+        FusedActivation::LeakyReLU, 0.01);
+    return;
+  }
+
+  this->template Add<DefaultConvolutionType<MatType>>(maps, 3, 3, 1, 1, 1, 1);
+  this->template Add<BatchNormType<MatType>>(2, 2, 1e-8, false);
+  this->template Add<LeakyReLUType<MatType>>(0.01);
+}
+
+template<typename MatType>
+void YOLOType<MatType>::MakeModel()
+{
+  if (yoloVersion != "v1-tiny")
+  {
+    mlpack::Log::Fatal << "Unsupported YOLO version. Trying to find: "
+        << yoloVersion << std::endl;
+  }
+
+  // Convolution and activation function in a block.
+  ConvolutionBlock(16);
+  PoolingBlock();
+
+  size_t numBlocks = 5;
+  size_t outChannels = 16;
+  for (size_t blockId = 0; blockId < numBlocks; blockId++)
+  {
+    outChannels *= 2;
+    ConvolutionBlock(outChannels);
+    PoolingBlock();
+  }
+
+  ConvolutionBlock(outChannels * 2);
+  ConvolutionBlock(256);
+
+  if (includeTop)
+  {
+    this->template Add<LinearType<MatType>>(
+        featureWidth * featureHeight * (5 * numBoxes + numClasses));
+    this->template Add<SigmoidType<MatType>>();
+  }
 }
 
 } // namespace models
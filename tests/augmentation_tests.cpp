@@ -51,3 +51,126 @@ TEST_CASE("ResizeAugmentationTest", "[AugmentationTest]")
   REQUIRE(input.n_cols == 2);
   REQUIRE(input.n_rows == 8 * 8);
 }
+
+TEST_CASE("ParsedAugmentationTest", "[AugmentationTest]")
+{
+  // Augmentations are parsed once, resize is moved to the front.
+  Augmentation augmentation({"horizontal-flip", "RESIZE = (6, 3)",
+      "resize : 2"}, 0.2);
+  REQUIRE(augmentation.HasResize());
+  REQUIRE(augmentation.ResizeWidth() == 6);
+  REQUIRE(augmentation.ResizeHeight() == 3);
+
+  // Resizes are chained in the given order.
+  arma::mat input(4 * 5, 3, arma::fill::randu);
+  augmentation.Transform(input, 4, 5, 1);
+  REQUIRE(input.n_rows == 2 * 2);
+  REQUIRE(input.n_cols == 3);
+
+  // A single data point is resized with the first resize only.
+  arma::mat sample(4 * 5 * 2, 1, arma::fill::randu);
+  augmentation.ResizeTransform(sample, 4, 5, 2);
+  REQUIRE(sample.n_rows == 6 * 3 * 2);
+
+  // Without a resize nothing is changed.
+  Augmentation noResize;
+  REQUIRE(!noResize.HasResize());
+  noResize.ResizeTransform(sample, 6, 3, 2);
+  REQUIRE(sample.n_rows == 6 * 3 * 2);
+}
+
+TEST_CASE("RandomAugmentationTest", "[AugmentationTest]")
+{
+  // Two 3 x 2 images with two channels each.
+  arma::mat input = arma::reshape(arma::linspace(0, 23, 24), 12, 2);
+
+  // Flips are always applied with a probability of one.
+  Augmentation flip({"horizontal-flip", "vertical-flip"}, 1.0);
+  REQUIRE(flip.HasRandomTransform());
+  REQUIRE(!flip.HasResize());
+  arma::mat flipped = input;
+  flip.RandomTransform(flipped, 3, 2, 2, 0);
+  for (size_t i = 0; i < 2; i++)
+  {
+    for (size_t c = 0; c < 2; c++)
+    {
+      for (size_t y = 0; y < 2; y++)
+      {
+        for (size_t x = 0; x < 3; x++)
+        {
+          REQUIRE(flipped(x + 3 * (y + 2 * c), i) ==
+              input((2 - x) + 3 * ((1 - y) + 2 * c), i));
+        }
+      }
+    }
+  }
+
+  // Nothing is applied with a probability of zero.
+  Augmentation never({"horizontal-flip", "noise = 1"}, 0.0);
+  arma::mat unchanged = input;
+  never.RandomTransform(unchanged, 3, 2, 2, 0);
+  REQUIRE(arma::approx_equal(unchanged, input, "absdiff", 0));
+
+  // The same seed gives the same augmentations.
+  Augmentation random({"random-crop = 1", "brightness = 0.5",
+      "contrast = 0.5", "noise = 0.1"}, 0.5);
+  arma::mat first = input, second = input;
+  random.RandomTransform(first, 3, 2, 2, 42);
+  random.RandomTransform(second, 3, 2, 2, 42);
+  REQUIRE(arma::approx_equal(first, second, "absdiff", 0));
+
+  // Values of integer types are rounded and clamped.
+  arma::Mat<uint8_t> pixels(4, 1);
+  pixels.fill(200);
+  Augmentation brightness({"brightness = 0.5"}, 1.0);
+  for (size_t seed = 0; seed < 10; seed++)
+  {
+    arma::Mat<uint8_t> augmented = pixels;
+    brightness.RandomTransform(augmented, 2, 2, 1, seed);
+    REQUIRE(augmented.min() >= 100);
+    REQUIRE(augmented.max() == augmented.min());
+  }
+}
+
+TEST_CASE("ImageResizeTest", "[AugmentationTest]")
+{
+  // Bilinear interpolation matches mlpack's interpolation layer.
+  arma::mat input(5 * 7 * 2, 3, arma::fill::randu);
+  mlpack::BilinearInterpolation<arma::mat, arma::mat> layer(5, 7, 9, 4, 2);
+  arma::mat expected;
+  layer.Forward(input, expected);
+
+  ImageResize bilinear(5, 7, 2, 9, 4);
+  arma::mat output;
+  bilinear.Resize(input, output);
+  REQUIRE(output.n_rows == bilinear.OutputSize());
+  REQUIRE(arma::approx_equal(output, expected, "absdiff", 1e-10));
+
+  // Area interpolation averages the covered pixels.
+  arma::mat square = arma::linspace(0, 15, 16);
+  ImageResize area(4, 4, 1, 2, 2, ImageResize::Method::Area);
+  area.Resize(square, output);
+  REQUIRE(arma::approx_equal(output, arma::mat({2.5, 4.5, 10.5, 12.5}).t(),
+      "absdiff", 1e-10));
+
+  ImageResize nearest(4, 4, 1, 2, 2, ImageResize::Method::Nearest);
+  nearest.Resize(square, output);
+  REQUIRE(arma::approx_equal(output, arma::mat({0, 2, 8, 10}).t(),
+      "absdiff", 0));
+
+  // Integer images are rounded and stay in range.
+  arma::Mat<uint8_t> pixels = {0, 255, 255, 0};
+  pixels = pixels.t();
+  arma::Mat<uint8_t> resized;
+  ImageResize(2, 2, 1, 3, 3).Resize(pixels, resized);
+  REQUIRE(resized.n_rows == 9);
+  REQUIRE(resized(1) == 170);
+  REQUIRE(resized(4) == 85);
+
+  // The same resize is used by the augmentation.
+  Augmentation augmentation({"resize-area = (2, 2)"}, 0.2);
+  REQUIRE(augmentation.ResizeMethod() == ImageResize::Method::Area);
+  augmentation.ResizeTransform(square, 4, 4, 1);
+  REQUIRE(arma::approx_equal(square, arma::mat({2.5, 4.5, 10.5, 12.5}).t(),
+      "absdiff", 1e-10));
+}
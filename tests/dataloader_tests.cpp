@@ -249,4 +249,829 @@ TEST_CASE("LoadImageDatasetFromDirectoryTest", "[DataLoadersTest]")
 
   REQUIRE(dataloader.ValidLabels().n_cols == 200);
   REQUIRE(dataloader.ValidLabels().n_rows == 1);
+
+  // The sets are split in place, in the order of their indices.
+  DataLoader<> testDataloader;
+  testDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, false);
+  const arma::mat& dataset = testDataloader.TestFeatures();
+  const arma::mat& labels = testDataloader.TestLabels();
+  REQUIRE(arma::accu(dataloader.TrainFeatures() !=
+      dataset.cols(dataloader.TrainIndices())) == 0);
+  REQUIRE(arma::accu(dataloader.TrainLabels() !=
+      labels.cols(dataloader.TrainIndices())) == 0);
+  REQUIRE(arma::accu(dataloader.ValidFeatures() !=
+      dataset.cols(dataloader.ValidIndices())) == 0);
+  REQUIRE(arma::accu(dataloader.ValidLabels() !=
+      labels.cols(dataloader.ValidIndices())) == 0);
+
+  // Copies hold sets of their own.
+  DataLoader<> copiedDataloader;
+  copiedDataloader = dataloader;
+  dataloader = DataLoader<>();
+  REQUIRE(arma::accu(copiedDataloader.TrainFeatures() !=
+      dataset.cols(copiedDataloader.TrainIndices())) == 0);
+  REQUIRE(arma::accu(copiedDataloader.ValidFeatures() !=
+      dataset.cols(copiedDataloader.ValidIndices())) == 0);
+}
+
+/**
+ * Test that copied and moved DataLoaders split their sets in a single store
+ * of their own, also for sets small enough to be copied by a move.
+ */
+TEST_CASE("DataLoaderCopyMoveTest", "[DataLoadersTest]")
+{
+  const std::string path = "./../data/copy_test.csv";
+  std::ofstream csv(path);
+  for (size_t i = 0; i < 8; i++)
+    csv << i << "," << i % 2 << "\n";
+  csv.close();
+
+  DataLoader<> dataloader;
+  dataloader.LoadCSV(path, true, false, 0.25, false, 0, 0, 1, 1);
+  const arma::mat trainFeatures = dataloader.TrainFeatures();
+  const arma::mat validFeatures = dataloader.ValidFeatures();
+
+  // The validation set directly follows the training set in the store.
+  DataLoader<> copiedDataloader(dataloader);
+  DataLoader<> movedDataloader(std::move(copiedDataloader));
+  DataLoader<> assignedDataloader;
+  assignedDataloader = movedDataloader;
+  movedDataloader = std::move(assignedDataloader);
+  dataloader = DataLoader<>();
+
+  const arma::mat& train = movedDataloader.TrainFeatures();
+  const arma::mat& valid = movedDataloader.ValidFeatures();
+  REQUIRE(train.memptr() + train.n_elem == valid.memptr());
+  REQUIRE(arma::accu(train != trainFeatures) == 0);
+  REQUIRE(arma::accu(valid != validFeatures) == 0);
+  REQUIRE(movedDataloader.TrainLabels().n_cols == train.n_cols);
+
+  // Writes to the training set stay in its own DataLoader.
+  DataLoader<> otherDataloader(movedDataloader);
+  movedDataloader.TrainFeatures().fill(-1);
+  REQUIRE(arma::accu(otherDataloader.TrainFeatures() != trainFeatures) == 0);
+
+  Utils::RemoveFile(path);
+}
+
+/**
+ * Test that parallel decoding keeps the column order deterministic.
+ */
+TEST_CASE("LoadImageDatasetFromDirectoryOrderTest", "[DataLoadersTest]")
+{
+  // Download the test dataset.
+  Utils::DownloadFile("/datasets/cifar-test.tar.gz",
+    "./../data/cifar-test.tar.gz", "", false, true,
+    "www.mlpack.org", true);
+  Utils::ExtractFiles("./../data/cifar-test.tar.gz", "./../data/");
+
+  DataLoader<> dataloader, otherDataloader;
+  dataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, false);
+  otherDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, false);
+
+  REQUIRE(dataloader.TestFeatures().n_cols == 1000);
+  REQUIRE(arma::accu(dataloader.TestFeatures() !=
+      otherDataloader.TestFeatures()) == 0);
+  REQUIRE(arma::accu(dataloader.TestLabels() !=
+      otherDataloader.TestLabels()) == 0);
+
+  // Images of the last class occupy the first columns.
+  REQUIRE(dataloader.TestLabels()(0, 0) ==
+      arma::max(dataloader.TestLabels().row(0)));
+  REQUIRE(dataloader.TestLabels()(0, 999) == 0);
+}
+
+/**
+ * Test that decoded images are cached and mapped by later loads.
+ */
+TEST_CASE("LoadImageDatasetFromDirectoryCacheTest", "[DataLoadersTest]")
+{
+  // Download the test dataset.
+  Utils::DownloadFile("/datasets/cifar-test.tar.gz",
+    "./../data/cifar-test.tar.gz", "", false, true,
+    "www.mlpack.org", true);
+  Utils::ExtractFiles("./../data/cifar-test.tar.gz", "./../data/");
+
+  const std::string cacheDirectory = "./../data/cifar-test-cache";
+  boost::filesystem::remove_all(cacheDirectory);
+
+  DataLoader<> dataloader, cachedDataloader;
+  dataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, false, 0.2, false, {"resize : 16"}, 0.2, cacheDirectory);
+
+  // A single cache file is written on the first load.
+  std::vector<boost::filesystem::path> cacheFiles;
+  Utils::ListDir(cacheDirectory, cacheFiles);
+  REQUIRE(cacheFiles.size() == 1);
+
+  cachedDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, false, 0.2, false, {"resize : 16"}, 0.2, cacheDirectory);
+
+  REQUIRE(cachedDataloader.TestFeatures().n_rows == 16 * 16 * 3);
+  REQUIRE(cachedDataloader.TestFeatures().n_cols == 1000);
+  REQUIRE(arma::accu(dataloader.TestFeatures() !=
+      cachedDataloader.TestFeatures()) == 0);
+  REQUIRE(arma::accu(dataloader.TestLabels() !=
+      cachedDataloader.TestLabels()) == 0);
+
+  // A different resize parameter uses a different cache file.
+  cachedDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, false, 0.2, false, {"resize : 8"}, 0.2, cacheDirectory);
+  REQUIRE(cachedDataloader.TestFeatures().n_rows == 8 * 8 * 3);
+
+  cacheFiles.clear();
+  Utils::ListDir(cacheDirectory, cacheFiles);
+  REQUIRE(cacheFiles.size() == 2);
+
+  boost::filesystem::remove_all(cacheDirectory);
+}
+
+/**
+ * Test streaming an image dataset from directory in mini-batches.
+ */
+TEST_CASE("ImageDatasetBatchIteratorTest", "[DataLoadersTest]")
+{
+  // Download the test dataset.
+  Utils::DownloadFile("/datasets/cifar-test.tar.gz",
+    "./../data/cifar-test.tar.gz", "", false, true,
+    "www.mlpack.org", true);
+
+  DataLoader<> dataloader;
+  Utils::ExtractFiles("./../data/cifar-test.tar.gz", "./../data/");
+  dataloader.IndexImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, true);
+
+  // Nothing is decoded while indexing.
+  REQUIRE(dataloader.TrainFeatures().n_elem == 0);
+  REQUIRE(dataloader.TrainIndex().Size() == 800);
+  REQUIRE(dataloader.ValidIndex().Size() == 200);
+
+  BatchIterator<> batches = dataloader.TrainBatches(64);
+  REQUIRE(batches.NumBatches() == 13);
+
+  // Every data point is returned exactly once in an epoch.
+  arma::mat features, labels;
+  size_t totalSamples = 0, totalBatches = 0;
+  while (batches.Next(features, labels))
+  {
+    REQUIRE(features.n_rows == 32 * 32 * 3);
+    REQUIRE(labels.n_rows == 1);
+    REQUIRE(features.n_cols == labels.n_cols);
+    REQUIRE(features.n_cols <= 64);
+    totalSamples += features.n_cols;
+    totalBatches++;
+  }
+
+  REQUIRE(totalSamples == 800);
+  REQUIRE(totalBatches == 13);
+
+  // The last batch holds the remaining data points.
+  REQUIRE(features.n_cols == 800 - 12 * 64);
+
+  // Starting a new epoch allows iterating again.
+  batches.Reset();
+  REQUIRE(batches.HasNext());
+
+  // Resize is applied while decoding a batch.
+  dataloader.IndexImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, true, 0.2, true, {"resize : 16"});
+  dataloader.ValidBatches(50).Next(features, labels);
+  REQUIRE(features.n_rows == 16 * 16 * 3);
+  REQUIRE(features.n_cols == 50);
+}
+
+/**
+ * Test streaming an object detection dataset in mini-batches.
+ */
+TEST_CASE("ObjectDetectionBatchIteratorTest", "[DataLoadersTest]")
+{
+  // Download the test dataset.
+  Utils::DownloadFile("/datasets/PASCAL-VOC-Test.tar.gz",
+    "./../data/PASCAL-VOC-Test.tar.gz", "", false, true,
+    "www.mlpack.org", true);
+
+  DataLoader<arma::mat, arma::field<arma::vec>> dataloader;
+  std::string basePath = "./../data/PASCAL-VOC-Test/";
+
+  // Classes in the dataset.
+  std::vector<std::string> classes = {"background", "aeroplane", "bicycle",
+      "bird", "boat", "bottle", "bus", "car", "cat", "chair", "cow",
+      "diningtable", "dog", "horse", "motorbike", "person", "pottedplant",
+      "sheep", "sofa", "train", "tvmonitor"};
+
+  dataloader.IndexObjectDetectionDataset(basePath + "Annotations/",
+      basePath + "Images/", classes, 0.2, true, {"resize (64, 64)"});
+
+  REQUIRE(dataloader.TrainIndex().Size() == 109);
+  REQUIRE(dataloader.ValidIndex().Size() == 27);
+
+  size_t totalBoundingBoxes = 0;
+  arma::mat features;
+  arma::field<arma::vec> labels;
+  BatchIterator<arma::mat, arma::field<arma::vec>> trainBatches =
+      dataloader.TrainBatches(16);
+  while (trainBatches.Next(features, labels))
+  {
+    REQUIRE(features.n_rows == 64 * 64 * 3);
+    REQUIRE(labels.n_cols == features.n_cols);
+    for (size_t i = 0; i < labels.n_cols; i++)
+    {
+      REQUIRE(labels(0, i).n_elem % 5 == 0);
+      totalBoundingBoxes += labels(0, i).n_elem / 5;
+    }
+  }
+
+  BatchIterator<arma::mat, arma::field<arma::vec>> validBatches =
+      dataloader.ValidBatches(16);
+  while (validBatches.Next(features, labels))
+  {
+    for (size_t i = 0; i < labels.n_cols; i++)
+      totalBoundingBoxes += labels(0, i).n_elem / 5;
+  }
+
+  // There are total 390 objects in the dataset in 136 images.
+  REQUIRE(totalBoundingBoxes == 390);
+}
+
+/**
+ * Simple test for XMLTagExtractor on a VOC style annotation.
+ */
+TEST_CASE("XMLTagExtractorTest", "[DataLoadersTest]")
+{
+  const std::string document = "<?xml version=\"1.0\"?>\n"
+      "<annotation>\n"
+      "  <!-- <filename>comment.jpg</filename> -->\n"
+      "  <filename> image.jpg </filename>\n"
+      "  <size><width>500</width><height>375</height><depth>3</depth></size>\n"
+      "  <segmented/>\n"
+      "  <object><name>dog</name>\n"
+      "    <part><name>head</name></part>\n"
+      "    <bndbox><xmin>48</xmin><ymin>240</ymin><xmax>195.5</xmax>"
+      "<ymax>371</ymax></bndbox></object>\n"
+      "  <object><name>person</name></object>\n"
+      "</annotation>\n";
+
+  XMLTagExtractor xml(document);
+  XMLTagExtractor::Element annotation, element, size;
+  REQUIRE(xml.Child(xml.Root(), "annotation", annotation));
+  REQUIRE(xml.Child(annotation, "filename", element));
+  REQUIRE(xml.Text(element) == "image.jpg");
+  REQUIRE(xml.Child(annotation, "size", size));
+  REQUIRE(xml.Child(size, "height", element));
+  REQUIRE(xml.Integer(element) == 375);
+  REQUIRE(!xml.Child(annotation, "width", element));
+
+  std::vector<std::string> names;
+  xml.ForEachChild(annotation, [&](const char* name, const size_t length,
+      const XMLTagExtractor::Element& object)
+  {
+    if (std::string(name, length) != "object")
+      return;
+
+    XMLTagExtractor::Element className, boundingBox, coordinate;
+    REQUIRE(xml.Child(object, "name", className));
+    names.push_back(xml.Text(className));
+    if (xml.Child(object, "bndbox", boundingBox))
+    {
+      REQUIRE(xml.Child(boundingBox, "xmax", coordinate));
+      REQUIRE(xml.Integer(coordinate) == 195);
+    }
+  });
+
+  REQUIRE(names.size() == 2);
+  REQUIRE(names[0] == "dog");
+  REQUIRE(names[1] == "person");
+}
+
+/**
+ * Simple test for BoxStore.
+ */
+TEST_CASE("BoxStoreTest", "[DataLoadersTest]")
+{
+  arma::vec first = {2, 84, 48, 493, 387};
+  arma::vec second = {8, 341, 217, 487, 375, 19, 237, 110, 320, 176};
+
+  BoxStore boxes;
+  boxes.Add(first);
+  boxes.Add(arma::vec());
+  boxes.Add(second);
+
+  REQUIRE(boxes.NumImages() == 3);
+  REQUIRE(boxes.NumBoxes() == 3);
+  REQUIRE(boxes.NumBoxes(1) == 0);
+  REQUIRE(boxes.Offset(2) == 1);
+  REQUIRE(boxes.Classes()(2) == 19);
+  REQUIRE(boxes.Coordinates()(3, 1) == 375);
+  REQUIRE(arma::approx_equal(boxes.Boxes(2), second, "absdiff", 1e-10));
+
+  const arma::uvec indices = {2, 0};
+  BoxStore subset = boxes.Subset(indices);
+  REQUIRE(subset.NumImages() == 2);
+  REQUIRE(subset.NumBoxes() == 3);
+  REQUIRE(arma::approx_equal(subset.Boxes(0), second, "absdiff", 1e-10));
+  REQUIRE(arma::approx_equal(subset.Boxes(1), first, "absdiff", 1e-10));
+
+  subset.Clear();
+  REQUIRE(subset.NumImages() == 0);
+  REQUIRE(subset.NumBoxes() == 0);
+}
+
+/**
+ * Check that CSV files are parsed the same for any chunk size and that
+ * LoadCSV writes the requested columns into the splits.
+ */
+TEST_CASE("CSVReaderChunkTest", "[DataLoadersTest]")
+{
+  const std::string path = "./../data/csv_reader_test.csv";
+  std::ofstream file(path);
+  for (size_t i = 0; i < 20; i++)
+    file << i << ", " << 0.5 * i << "," << 2 * i << "," << (i % 3) << "\n";
+  file << "\n";
+  file.close();
+
+  for (const size_t chunkSize : {3, 16, 1 << 20})
+  {
+    CSVReader reader(path, chunkSize);
+    size_t rows, cols;
+    REQUIRE(reader.Scan(rows, cols));
+    REQUIRE(rows == 20);
+    REQUIRE(cols == 4);
+
+    arma::mat values(2, rows);
+    reader.Parse(1, 2, [&](const size_t row, const size_t col,
+        const double value)
+    {
+      values(col - 1, row) = value;
+    });
+
+    for (size_t i = 0; i < rows; i++)
+    {
+      REQUIRE(values(0, i) == Approx(0.5 * i));
+      REQUIRE(values(1, i) == Approx(2.0 * i));
+    }
+  }
+
+  DataLoader<> dataloader;
+  dataloader.LoadCSV(path, true, false, 0.25, false, 0, 2, -1, -1);
+  REQUIRE(dataloader.TrainFeatures().n_rows == 3);
+  REQUIRE(dataloader.TrainFeatures().n_cols == 15);
+  REQUIRE(dataloader.ValidFeatures().n_cols == 5);
+  REQUIRE(dataloader.TrainLabels().n_rows == 1);
+
+  // Without shuffling the last points belong to the validation set.
+  REQUIRE(dataloader.TrainFeatures()(2, 14) == Approx(28.0));
+  REQUIRE(dataloader.ValidFeatures()(0, 0) == Approx(15.0));
+  REQUIRE(dataloader.ValidLabels()(0, 4) == Approx(19 % 3));
+
+  Utils::RemoveFile(path);
+}
+
+/**
+ * Check that splits are drawn through index permutations and that loaded
+ * splits can be iterated in shuffled batches without copying the split.
+ */
+TEST_CASE("InMemoryBatchIteratorTest", "[DataLoadersTest]")
+{
+  const std::string path = "./../data/in_memory_batches_test.csv";
+  std::ofstream file(path);
+  for (size_t i = 0; i < 50; i++)
+    file << i << "," << 2 * i << "," << i % 5 << "\n";
+  file.close();
+
+  DataLoader<> dataloader;
+  dataloader.LoadCSV(path, true, true, 0.2, false, 0, 1, -1, -1);
+
+  const DataLoader<>& constDataloader = dataloader;
+  REQUIRE(&constDataloader.TrainFeatures() == &dataloader.TrainFeatures());
+  REQUIRE(&std::get<0>(constDataloader.TrainSet()) ==
+      &dataloader.TrainFeatures());
+
+  // Split indices describe where every data point came from.
+  REQUIRE(dataloader.TrainIndices().n_elem == 40);
+  REQUIRE(dataloader.ValidIndices().n_elem == 10);
+  for (size_t i = 0; i < dataloader.TrainIndices().n_elem; i++)
+  {
+    REQUIRE(dataloader.TrainFeatures()(0, i) ==
+        Approx(dataloader.TrainIndices()(i)));
+  }
+
+  BatchIterator<> batches = dataloader.TrainBatches(16);
+  REQUIRE(batches.NumBatches() == 3);
+  REQUIRE(batches.OutputSize() == 2);
+
+  arma::mat features, labels;
+  double total = 0;
+  size_t points = 0;
+  while (batches.Next(features, labels))
+  {
+    REQUIRE(labels.n_cols == features.n_cols);
+    for (size_t i = 0; i < features.n_cols; i++)
+    {
+      REQUIRE(features(1, i) == Approx(2 * features(0, i)));
+      REQUIRE(labels(0, i) == Approx(size_t(features(0, i)) % 5));
+    }
+
+    total += arma::accu(features.row(0));
+    points += features.n_cols;
+  }
+
+  REQUIRE(points == 40);
+  REQUIRE(total == Approx(arma::accu(dataloader.TrainFeatures().row(0))));
+
+  Utils::RemoveFile(path);
+}
+
+/**
+ * Check that prefetched batches arrive in the order of the epoch, which only
+ * depends on the seed and the epoch number.
+ */
+TEST_CASE("PrefetchIteratorTest", "[DataLoadersTest]")
+{
+  arma::mat dataset = arma::regspace<arma::rowvec>(0, 99);
+  arma::mat labels = 2 * dataset;
+
+  BatchIterator<> batches(dataset, labels, 8, true);
+  PrefetchIterator<> prefetch(batches, 3, 2, 7);
+  REQUIRE(prefetch.NumBatches() == 13);
+  REQUIRE(prefetch.Workers() == 3);
+
+  arma::mat features, batchLabels, expectedFeatures, expectedLabels;
+  for (size_t epoch = 0; epoch < 3; epoch++)
+  {
+    prefetch.Reset();
+    REQUIRE(prefetch.Epoch() == epoch);
+
+    BatchIterator<> expected(dataset, labels, 8, true);
+    expected.Reset(7 + epoch);
+
+    size_t numBatches = 0;
+    while (prefetch.Next(features, batchLabels))
+    {
+      REQUIRE(expected.Next(expectedFeatures, expectedLabels));
+      REQUIRE(arma::approx_equal(features, expectedFeatures, "absdiff", 0));
+      REQUIRE(arma::approx_equal(batchLabels, 2 * features, "absdiff", 0));
+      numBatches++;
+    }
+
+    REQUIRE(numBatches == 13);
+    REQUIRE(!expected.HasNext());
+  }
+
+  // Stop the workers while batches are still being prepared.
+  prefetch.Reset();
+  REQUIRE(prefetch.Next(features, batchLabels));
+  prefetch.Stop();
+  REQUIRE(prefetch.Workers() == 0);
+}
+
+/**
+ * Check that images stored as bytes are converted and scaled when batches
+ * are gathered.
+ */
+TEST_CASE("CompactImageStorageTest", "[DataLoadersTest]")
+{
+  // Download the test dataset.
+  Utils::DownloadFile("/datasets/cifar-test.tar.gz",
+    "./../data/cifar-test.tar.gz", "", false, true,
+    "www.mlpack.org", true);
+  Utils::ExtractFiles("./../data/cifar-test.tar.gz", "./../data/");
+
+  DataLoader<> dataloader;
+  DataLoader<arma::Mat<uint8_t>, arma::mat> compactDataloader;
+  dataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, false);
+  compactDataloader.LoadImageDatasetFromDirectory("./../data/cifar-test/",
+      32, 32, 3, false);
+
+  REQUIRE(compactDataloader.TestFeatures().n_cols == 1000);
+  REQUIRE(arma::approx_equal(dataloader.TestFeatures(),
+      arma::conv_to<arma::mat>::from(compactDataloader.TestFeatures()),
+      "absdiff", 0));
+
+  BatchIterator<arma::mat, arma::mat, arma::Mat<uint8_t>> batches =
+      compactDataloader.TestBatches<arma::mat>(128, 1.0 / 255.0);
+  REQUIRE(batches.NumBatches() == 8);
+
+  arma::mat features, labels;
+  size_t column = 0;
+  while (batches.Next(features, labels))
+  {
+    REQUIRE(features.min() >= 0.0);
+    REQUIRE(features.max() <= 1.0);
+    const arma::mat expected = dataloader.TestFeatures().cols(column,
+        column + features.n_cols - 1);
+    REQUIRE(arma::approx_equal(features * 255.0, expected, "absdiff", 1e-8));
+    REQUIRE(arma::approx_equal(labels, dataloader.TestLabels().cols(column,
+        column + labels.n_cols - 1), "absdiff", 0));
+    column += features.n_cols;
+  }
+
+  REQUIRE(column == 1000);
+}
+
+/**
+ * Check that IDX files and CIFAR-10 batches are read into the layout of the
+ * text and image loaders.
+ */
+TEST_CASE("BinaryDatasetReaderTest", "[DataLoadersTest]")
+{
+  // IDX file of three 2 x 4 images.
+  const std::string imagesPath = "./../data/binary_reader_test-idx3-ubyte";
+  std::ofstream idx(imagesPath, std::ios::binary);
+  const unsigned char idxHeader[] = {0, 0, 0x08, 3, 0, 0, 0, 3, 0, 0, 0, 2,
+      0, 0, 0, 4};
+  idx.write(reinterpret_cast<const char*>(idxHeader), sizeof(idxHeader));
+  for (size_t i = 0; i < 3 * 8; i++)
+    idx.put(char(10 * i));
+  idx.close();
+
+  arma::mat images;
+  REQUIRE(BinaryDatasetReader::LoadIDX(imagesPath, images));
+  REQUIRE(images.n_rows == 8);
+  REQUIRE(images.n_cols == 3);
+  for (size_t i = 0; i < images.n_elem; i++)
+    REQUIRE(images(i) == Approx(10.0 * i));
+
+  // Truncated files are rejected.
+  idx.open(imagesPath, std::ios::binary);
+  idx.write(reinterpret_cast<const char*>(idxHeader), sizeof(idxHeader));
+  idx.close();
+  REQUIRE(!BinaryDatasetReader::LoadIDX(imagesPath, images));
+
+  // Two CIFAR batches with one and two records.
+  const std::vector<std::string> batches = {
+      "./../data/binary_reader_test_1.bin",
+      "./../data/binary_reader_test_2.bin"};
+  for (size_t b = 0; b < batches.size(); b++)
+  {
+    std::ofstream batch(batches[b], std::ios::binary);
+    for (size_t r = 0; r <= b; r++)
+    {
+      batch.put(char(b + r));
+      for (size_t c = 0; c < 3; c++)
+      {
+        for (size_t p = 0; p < 1024; p++)
+          batch.put(char((p + 50 * c + r) % 256));
+      }
+    }
+  }
+
+  arma::Mat<uint8_t> cifarImages;
+  arma::mat cifarLabels;
+  REQUIRE(BinaryDatasetReader::LoadCIFAR(batches, cifarImages, cifarLabels));
+  REQUIRE(cifarImages.n_rows == 3072);
+  REQUIRE(cifarImages.n_cols == 3);
+  REQUIRE(arma::approx_equal(cifarLabels, arma::mat({{0, 1, 2}}), "absdiff",
+      0));
+
+  // Channels of every pixel are interleaved.
+  const size_t records[] = {0, 0, 1};
+  for (size_t i = 0; i < 3; i++)
+  {
+    for (size_t p = 0; p < 1024; p += 37)
+    {
+      for (size_t c = 0; c < 3; c++)
+      {
+        REQUIRE(cifarImages(c + 3 * p, i) ==
+            (p + 50 * c + records[i]) % 256);
+      }
+    }
+  }
+
+  Utils::RemoveFile(imagesPath);
+  Utils::RemoveFile(batches[0]);
+  Utils::RemoveFile(batches[1]);
+}
+
+/**
+ * Test that shards of a dataset are disjoint, cover the dataset and only hold
+ * the data points of the shard.
+ */
+TEST_CASE("ShardedDataLoaderTest", "[DataLoadersTest]")
+{
+  // Every data point is its own index followed by a label.
+  const std::string path = "./../data/shard_test.csv";
+  const size_t numPoints = 101;
+  std::ofstream csv(path);
+  for (size_t i = 0; i < numPoints; i++)
+    csv << i << "," << i % 3 << "\n";
+  csv.close();
+
+  const size_t worldSize = 3;
+  std::vector<size_t> owner(numPoints, worldSize);
+  for (size_t rank = 0; rank < worldSize; rank++)
+  {
+    DataLoader<> dataloader;
+    dataloader.Shard(rank, worldSize, 7);
+    dataloader.LoadCSV(path, false, false, 0.25, false, 0, 0);
+
+    const arma::mat& features = dataloader.TestFeatures();
+    REQUIRE(features.n_rows == 1);
+    REQUIRE(features.n_cols >= numPoints / worldSize);
+    REQUIRE(features.n_cols <= numPoints / worldSize + 1);
+    for (size_t i = 0; i < features.n_cols; i++)
+    {
+      const size_t point = size_t(features(0, i));
+      REQUIRE(owner[point] == worldSize);
+      owner[point] = rank;
+    }
+
+    // The shard is split into training and validation sets.
+    DataLoader<> trainDataloader;
+    trainDataloader.Shard(rank, worldSize, 7);
+    trainDataloader.LoadCSV(path, true, true, 0.25, false, 0, 0, 1, 1);
+    REQUIRE(trainDataloader.TrainFeatures().n_cols +
+        trainDataloader.ValidFeatures().n_cols == features.n_cols);
+    for (size_t i = 0; i < trainDataloader.TrainFeatures().n_cols; i++)
+    {
+      const size_t point = size_t(trainDataloader.TrainFeatures()(0, i));
+      REQUIRE(owner[point] == rank);
+      REQUIRE(trainDataloader.TrainLabels()(0, i) == point % 3);
+    }
+  }
+
+  // Every data point belongs to exactly one shard.
+  for (size_t i = 0; i < numPoints; i++)
+    REQUIRE(owner[i] < worldSize);
+
+  // Shuffled splits are drawn from the shard seed.
+  DataLoader<> first, second;
+  first.Shard(1, worldSize, 7);
+  second.Shard(1, worldSize, 7);
+  first.LoadCSV(path, true, true, 0.25, true, 0, 0, 1, 1);
+  second.LoadCSV(path, true, true, 0.25, true, 0, 0, 1, 1);
+  REQUIRE(arma::approx_equal(first.TrainFeatures(), second.TrainFeatures(),
+      "absdiff", 0));
+  REQUIRE(arma::approx_equal(first.ValidFeatures(), second.ValidFeatures(),
+      "absdiff", 0));
+
+  // Unsharded splits are only drawn from a seed that is passed to Shard().
+  DataLoader<> seeded, unseeded;
+  seeded.Shard(0, 1, 7);
+  seeded.LoadCSV(path, true, true, 0.25, false, 0, 0, 1, 1);
+  first.Shard(0, 1, 7);
+  first.LoadCSV(path, true, true, 0.25, false, 0, 0, 1, 1);
+  REQUIRE(arma::approx_equal(first.TrainFeatures(), seeded.TrainFeatures(),
+      "absdiff", 0));
+
+  first.Shard(0, 1);
+  first.LoadCSV(path, true, true, 0.25, false, 0, 0, 1, 1);
+  unseeded.LoadCSV(path, true, true, 0.25, false, 0, 0, 1, 1);
+  REQUIRE(!arma::approx_equal(first.TrainFeatures(), unseeded.TrainFeatures(),
+      "absdiff", 0));
+
+  // Binary readers convert only the selected items.
+  const std::string idxPath = "./../data/shard_test-idx1-ubyte";
+  std::ofstream idx(idxPath, std::ios::binary);
+  const unsigned char idxHeader[] = {0, 0, 0x08, 1, 0, 0, 0, 10};
+  idx.write(reinterpret_cast<const char*>(idxHeader), sizeof(idxHeader));
+  for (size_t i = 0; i < 10; i++)
+    idx.put(char(i));
+  idx.close();
+
+  arma::mat items;
+  REQUIRE(BinaryDatasetReader::LoadIDX(idxPath, items,
+      [](const size_t /* items */) { return arma::uvec({1, 4, 9}); }));
+  REQUIRE(arma::approx_equal(items, arma::mat({{1, 4, 9}}), "absdiff", 0));
+
+  Utils::RemoveFile(path);
+  Utils::RemoveFile(idxPath);
+}
+
+/**
+ * Test that random augmentations are applied to batches of the training set
+ * without changing the dataset.
+ */
+TEST_CASE("AugmentedBatchIteratorTest", "[DataLoadersTest]")
+{
+  // Ten 4 x 2 single channel images.
+  arma::mat features = arma::reshape(arma::linspace(0, 79, 80), 8, 10);
+  arma::mat labels = arma::linspace<arma::rowvec>(0, 9, 10);
+  const arma::mat original = features;
+
+  BatchIterator<> batches(features, labels, 4, true, 1.0,
+      {"horizontal-flip"}, 1.0, 4, 2, 1);
+  REQUIRE(batches.RandomAugmentation());
+
+  arma::mat batch, batchLabels;
+  size_t points = 0;
+  batches.Reset(3);
+  while (batches.Next(batch, batchLabels))
+  {
+    for (size_t i = 0; i < batch.n_cols; i++)
+    {
+      const size_t point = size_t(batchLabels(0, i));
+      for (size_t y = 0; y < 2; y++)
+      {
+        for (size_t x = 0; x < 4; x++)
+          REQUIRE(batch(x + 4 * y, i) == original(3 - x + 4 * y, point));
+      }
+    }
+
+    points += batch.n_cols;
+  }
+
+  REQUIRE(points == 10);
+  REQUIRE(arma::approx_equal(features, original, "absdiff", 0));
+
+  // Epochs started with the same seed are augmented the same way.
+  BatchIterator<> noisy(features, labels, 4, true, 1.0, {"noise = 1"}, 0.5,
+      4, 2, 1);
+  arma::mat first, second;
+  noisy.Reset(7);
+  noisy.Next(first, batchLabels);
+  noisy.Reset(7);
+  noisy.Next(second, batchLabels);
+  REQUIRE(arma::approx_equal(first, second, "absdiff", 0));
+
+  // Augmentations can be disabled, e.g. for validation.
+  noisy.RandomAugmentation() = false;
+  noisy.Reset(7);
+  noisy.Next(first, batchLabels);
+  REQUIRE(arma::approx_equal(first, features.cols(noisy.Order().head(4)),
+      "absdiff", 0));
+}
+
+/**
+ * Test that flips, crops and scales move bounding boxes along with their
+ * images.
+ */
+TEST_CASE("BoxAugmentationTest", "[DataLoadersTest]")
+{
+  // A flipped box of a 10 x 8 image.
+  BoxStore boxes;
+  boxes.Add(arma::vec({3, 1, 2, 4, 6}));
+  arma::mat image(10 * 8, 1, arma::fill::zeros);
+  arma::mat transforms;
+  Augmentation flip({"horizontal-flip"}, 1.0);
+  flip.RandomTransform(image, 10, 8, 1, 0, transforms);
+  REQUIRE(arma::approx_equal(transforms, arma::vec({-1, 10, 1, 0}),
+      "absdiff", 1e-10));
+
+  boxes.Transform(transforms, 10, 8);
+  REQUIRE(arma::approx_equal(boxes.Boxes(0), arma::vec({3, 6, 2, 9, 6}),
+      "absdiff", 1e-10));
+
+  // Moved boxes are clipped and boxes moved out of the image are removed.
+  BoxStore shifted;
+  shifted.Add(arma::vec({0, 1, 1, 3, 3, 1, 7, 0, 9, 3}));
+  shifted.Add(arma::vec({2, 0, 0, 10, 8}));
+  shifted.Transform(arma::mat({{1, 1}, {3, 5}, {1, 1}, {0, -1}}), 10, 8);
+  REQUIRE(shifted.NumBoxes() == 2);
+  REQUIRE(shifted.NumBoxes(0) == 1);
+  REQUIRE(arma::approx_equal(shifted.Boxes(0), arma::vec({0, 4, 1, 6, 3}),
+      "absdiff", 1e-10));
+  REQUIRE(arma::approx_equal(shifted.Boxes(1), arma::vec({2, 5, 0, 10, 7}),
+      "absdiff", 1e-10));
+
+  // Bright pixels of a 12 x 12 image stay inside their moved box.
+  arma::mat images(12 * 12, 10, arma::fill::zeros);
+  BoxStore objects;
+  for (size_t i = 0; i < images.n_cols; i++)
+  {
+    for (size_t y = 3; y < 6; y++)
+      images.submat(3 + 12 * y, i, 5 + 12 * y, i).fill(1.0);
+    objects.Add(arma::vec({1, 3, 3, 6, 6}));
+  }
+
+  Augmentation geometric({"horizontal-flip", "vertical-flip",
+      "random-crop = 2", "random-scale = 0.3"}, 0.5);
+  geometric.RandomTransform(images, 12, 12, 1, 5, transforms);
+  objects.Transform(transforms, 12, 12);
+  for (size_t i = 0; i < images.n_cols; i++)
+  {
+    REQUIRE(objects.NumBoxes(i) == 1);
+    const arma::vec box = objects.Coordinates().col(objects.Offset(i));
+    for (size_t y = 0; y < 12; y++)
+    {
+      for (size_t x = 0; x < 12; x++)
+      {
+        if (images(x + 12 * y, i) > 0.5)
+        {
+          REQUIRE(x + 0.5 >= box(0));
+          REQUIRE(x + 0.5 <= box(2));
+          REQUIRE(y + 0.5 >= box(1));
+          REQUIRE(y + 0.5 <= box(3));
+        }
+      }
+    }
+  }
+
+  // Boxes of field type labels are moved by the batch iterator.
+  arma::field<arma::vec> labels(1, 2);
+  labels(0, 0) = arma::vec({0, 1, 2, 4, 6});
+  labels(0, 1) = arma::vec({1, 0, 0, 5, 8});
+  arma::mat features(10 * 8, 2, arma::fill::zeros);
+  BatchIterator<arma::mat, arma::field<arma::vec>> batches(features, labels,
+      2, false, 1.0, {"horizontal-flip"}, 1.0, 10, 8, 1);
+  arma::mat batch;
+  arma::field<arma::vec> batchLabels;
+  batches.Next(batch, batchLabels);
+  REQUIRE(arma::approx_equal(batchLabels(0, 0), arma::vec({0, 6, 2, 9, 6}),
+      "absdiff", 1e-10));
+  REQUIRE(arma::approx_equal(batchLabels(0, 1), arma::vec({1, 5, 0, 10, 8}),
+      "absdiff", 1e-10));
 }
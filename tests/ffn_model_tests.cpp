@@ -10,14 +10,26 @@
  * http://www.opensource.org/licenses/BSD-3-Clause for more information.
  */
 #include <mlpack.hpp>
-#include <utils/utils.hpp>
-#include <dataloader/dataloader.hpp>
 #include <models/darknet/darknet.hpp>
 #include <models/yolo/yolo.hpp>
 #include <models/resnet/resnet.hpp>
 #include <models/mobilenet/mobilenet_v1.hpp>
+#include <ensmallen_utils/print_metric.hpp>
+#include <ensmallen_utils/profile_training.hpp>
+#include <ensmallen_utils/training_telemetry.hpp>
+#include <models/common/batched_evaluation.hpp>
+#include <models/common/data_parallel.hpp>
+#include <models/common/dynamic_batcher.hpp>
+#include <models/common/feature_cache.hpp>
+#include <models/common/memory_planner.hpp>
+#include <models/common/mixed_precision.hpp>
+#include <models/common/model_summary.hpp>
+#include <models/common/profiler.hpp>
+#include <models/common/weight_file.hpp>
+#include "./test_catch_tools.hpp"
 #include "catch.hpp"
 
+using namespace mlpack;
 using namespace mlpack::models;
 
 /**
@@ -43,7 +55,7 @@ void ModelDimTest(ModelType& model,
 }
 
 /**
- * Checks for the output sum of the model for a 
+ * Checks for the output sum of the model for a
  *     single and multiple batch input.
  *
  * @tparam ModelType Type of model to check.
@@ -74,20 +86,46 @@ void PreTrainedModelTest(ModelType& model,
   REQUIRE(arma::accu(output) == Approx(multipleBatchOutput).epsilon(1e-2));
 }
 
+/**
+ * Checks that a pre-trained model is rejected when it's built, if its weights
+ * aren't published in the weight format of this release.
+ *
+ * @tparam ModelType Type of model to check.
+ *
+ * @param name Name of the weights in the manifest.
+ * @param args Arguments of the constructor of the model.
+ * @return true if the weights are available.
+ */
+template<typename ModelType, typename... Args>
+bool PreTrainedWeightsAvailable(const std::string& name, const Args&... args)
+{
+  if (PublishedWeights::Available(name))
+    return true;
+
+  REQUIRE_THROWS_AS(ModelType(args...), std::runtime_error);
+  return false;
+}
+
 /**
  * Simple test for Darknet model.
  */
 TEST_CASE("DarknetModelTest", "[FFNModelsTests]")
 {
-  arma::mat input(224 * 224 * 3, 1);
-  DarkNet19 darknet19(3, 224, 224, 1000);
+  arma::mat input(224 * 224 * 3, 1, arma::fill::randu);
+  DarkNet19 darknet19(1000);
+  FFN<> model19;
+  model19.InputDimensions() = std::vector<size_t>({224, 224, 3});
+  model19.Add<DarkNet19>(darknet19);
 
   // Check output shape.
-  ModelDimTest(darknet19.GetModel(), input);
+  ModelDimTest(model19, input);
 
   // Repeat for DarkNet-53.
-  DarkNet53 darknet53(3, 224, 224, 1000);
-  ModelDimTest(darknet53.GetModel(), input);
+  DarkNet53 darknet53(1000);
+  FFN<> model53;
+  model53.InputDimensions() = std::vector<size_t>({224, 224, 3});
+  model53.Add<DarkNet53>(darknet53);
+  ModelDimTest(model53, input);
 }
 
 /**
@@ -95,11 +133,14 @@ TEST_CASE("DarknetModelTest", "[FFNModelsTests]")
  */
 TEST_CASE("YOLOV1ModelTest", "[FFNModelsTests]")
 {
-  arma::mat input(448 * 448 * 3, 1);
-  YOLO<> yolo(3, 448, 448);
+  arma::mat input(448 * 448 * 3, 1, arma::fill::randu);
+  YOLO yolo;
+  FFN<NegativeLogLikelihood> model;
+  model.InputDimensions() = std::vector<size_t>({448, 448, 3});
+  model.Add<YOLO>(yolo);
 
   // Check output shape.
-  ModelDimTest(yolo.GetModel(), input, (7 * 7 * (5 * 2 + 20)), 1);
+  ModelDimTest(model, input, (7 * 7 * (5 * 2 + 20)), 1);
 }
 
 /**
@@ -107,19 +148,25 @@ TEST_CASE("YOLOV1ModelTest", "[FFNModelsTests]")
  */
 TEST_CASE("ResNetModelTest", "[FFNModelsTests]")
 {
-  arma::mat input(224 * 224 * 3, 1);
+  arma::mat input(224 * 224 * 3, 1, arma::fill::randu);
 
   // Check output shape for resnet18.
-  ResNet18 resnet18(3, 224, 224);
-  ModelDimTest(resnet18.GetModel(), input);
+  FFN<> model18;
+  model18.InputDimensions() = std::vector<size_t>({224, 224, 3});
+  model18.Add<ResNet18>();
+  ModelDimTest(model18, input);
 
   // Check output shape for resnet34.
-  ResNet34 resnet34(3, 224, 224);
-  ModelDimTest(resnet34.GetModel(), input);
+  FFN<> model34;
+  model34.InputDimensions() = std::vector<size_t>({224, 224, 3});
+  model34.Add<ResNet34>();
+  ModelDimTest(model34, input);
 
   // Check output shape for resnet50.
-  ResNet50 resnet50(3, 224, 224);
-  ModelDimTest(resnet50.GetModel(), input);
+  FFN<> model50;
+  model50.InputDimensions() = std::vector<size_t>({224, 224, 3});
+  model50.Add<ResNet50>();
+  ModelDimTest(model50, input);
 }
 
 /**
@@ -128,11 +175,13 @@ TEST_CASE("ResNetModelTest", "[FFNModelsTests]")
  */
 TEST_CASE("ResNet101ModelTest", "[FFNModelsTests]")
 {
-  arma::mat input(224 * 224 * 3, 1);
+  arma::mat input(224 * 224 * 3, 1, arma::fill::randu);
 
   // Check output shape for resnet101.
-  ResNet101 resnet101(3, 224, 224);
-  ModelDimTest(resnet101.GetModel(), input);
+  FFN<> model;
+  model.InputDimensions() = std::vector<size_t>({224, 224, 3});
+  model.Add<ResNet101>();
+  ModelDimTest(model, input);
 }
 
 /**
@@ -143,13 +192,16 @@ TEST_CASE("ResNet101ModelTest", "[FFNModelsTests]")
 #if !defined(WIN32)
   TEST_CASE("ResNet152ModelTest", "[FFNModelsTests]")
   {
-    arma::mat input(224 * 224 * 3, 1);
+    arma::mat input(224 * 224 * 3, 1, arma::fill::randu);
 
     // Check output shape for resnet152.
-    ResNet152 resnet152(3, 224, 224);
-    ModelDimTest(resnet152.GetModel(), input);
+    FFN<> model;
+    model.InputDimensions() = std::vector<size_t>({224, 224, 3});
+    model.Add<ResNet152>();
+    ModelDimTest(model, input);
   }
 #endif
+
 /**
  * Test for pre-trained ResNet(18, 34, 50) models.
  */
@@ -158,16 +210,31 @@ TEST_CASE("PreTrainedResNetModelTest", "[FFNModelsTests]")
   arma::mat input(224 * 224 * 3, 1);
 
   // Check output(referenced from PyTorch) for resnet18.
-  ResNet18 resnet18(3, 224, 224, true, true);
-  PreTrainedModelTest(resnet18.GetModel(), input, 0.00618362, 0.02469635);
+  if (PreTrainedWeightsAvailable<ResNet18>("resnet18.bin", 1000, true, true))
+  {
+    FFN<> model18;
+    model18.InputDimensions() = std::vector<size_t>({224, 224, 3});
+    model18.Add<ResNet18>(1000, true, true);
+    PreTrainedModelTest(model18, input, 0.00618362, 0.02469635);
+  }
 
   // Check output(referenced from PyTorch) for resnet34.
-  ResNet34 resnet34(3, 224, 224, true, true);
-  PreTrainedModelTest(resnet34.GetModel(), input, 0.00664139, 0.02662659);
+  if (PreTrainedWeightsAvailable<ResNet34>("resnet34.bin", 1000, true, true))
+  {
+    FFN<> model34;
+    model34.InputDimensions() = std::vector<size_t>({224, 224, 3});
+    model34.Add<ResNet34>(1000, true, true);
+    PreTrainedModelTest(model34, input, 0.00664139, 0.02662659);
+  }
 
   // Check output(referenced from PyTorch) for resnet50.
-  ResNet50 resnet50(3, 224, 224, true, true);
-  PreTrainedModelTest(resnet50.GetModel(), input, 0.00266838, 0.01067352);
+  if (PreTrainedWeightsAvailable<ResNet50>("resnet50.bin", 1000, true, true))
+  {
+    FFN<> model50;
+    model50.InputDimensions() = std::vector<size_t>({224, 224, 3});
+    model50.Add<ResNet50>(1000, true, true);
+    PreTrainedModelTest(model50, input, 0.00266838, 0.01067352);
+  }
 }
 
 /**
@@ -180,8 +247,14 @@ TEST_CASE("PreTrainedResNet101ModelTest", "[FFNModelsTests]")
   arma::mat input(224 * 224 * 3, 1);
 
   // Check output(referenced from PyTorch) for resnet101.
-  ResNet101 resnet101(3, 224, 224, true, true);
-  PreTrainedModelTest(resnet101.GetModel(), input, 0.00168228, 0.00670624);
+  if (PreTrainedWeightsAvailable<ResNet101>("resnet101.bin", 1000, true,
+      true))
+  {
+    FFN<> model;
+    model.InputDimensions() = std::vector<size_t>({224, 224, 3});
+    model.Add<ResNet101>(1000, true, true);
+    PreTrainedModelTest(model, input, 0.00168228, 0.00670624);
+  }
 }
 
 /**
@@ -196,8 +269,14 @@ TEST_CASE("PreTrainedResNet101ModelTest", "[FFNModelsTests]")
     arma::mat input(224 * 224 * 3, 1);
 
     // Check output for(referenced from PyTorch) resnet152.
-    ResNet152 resnet152(3, 224, 224, true, true);
-    PreTrainedModelTest(resnet152.GetModel(), input, 0.00199318, 0.00799561);
+    if (PreTrainedWeightsAvailable<ResNet152>("resnet152.bin", 1000, true,
+        true))
+    {
+      FFN<> model;
+      model.InputDimensions() = std::vector<size_t>({224, 224, 3});
+      model.Add<ResNet152>(1000, true, true);
+      PreTrainedModelTest(model, input, 0.00199318, 0.00799561);
+    }
   }
 #endif
 
@@ -206,11 +285,13 @@ TEST_CASE("PreTrainedResNet101ModelTest", "[FFNModelsTests]")
  */
 TEST_CASE("MobileNetV1ModelTest", "[FFNModelsTests]")
 {
-  arma::mat input(224 * 224 * 3, 1);
+  arma::mat input(224 * 224 * 3, 1, arma::fill::randu);
 
-  // Check output shape for resnet152.
-  MobilenetV1 mobilenet(3, 224, 224);
-  ModelDimTest(mobilenet.GetModel(), input);
+  // Check output shape for mobilenet.
+  FFN<> model;
+  model.InputDimensions() = std::vector<size_t>({224, 224, 3});
+  model.Add<MobileNetV1>();
+  ModelDimTest(model, input);
 }
 
 /**
@@ -247,16 +328,36 @@ TEST_CASE("PreTrainedMobileNetV1ModelTest", "[FFNModelsTests]")
   };
   arma::mat input, output;
   std::vector<double> alpha = {0.25, 0.5, 0.75, 1.0};
-  std::vector<int> image_size = {128, 160, 192, 224};
-  for (double alpha_val : alpha)
+  std::vector<std::string> alpha_name = {"0.25", "0.5", "0.75", "1"};
+  std::vector<size_t> image_size = {128, 160, 192, 224};
+  for (size_t a = 0; a < alpha.size(); a++)
   {
-    for (int image_size_val : image_size)
+    for (size_t image_size_val : image_size)
     {
-      MobilenetV1 mobilenet(3, image_size_val, image_size_val, alpha_val, 1,
-          true, true);
       input.set_size(image_size_val * image_size_val * 3, 1);
       input.fill(1);
-      mobilenet.GetModel().Predict(input, output);
+      auto predict = [&]()
+      {
+        FFN<> model;
+        model.InputDimensions() =
+            std::vector<size_t>({image_size_val, image_size_val, 3});
+        model.Add<MobileNetV1>(1000, alpha[a], 1, true, true);
+        model.Predict(input, output);
+      };
+
+      // Weights that aren't published in the weight format of this release
+      // are rejected when the model is built, or once the width of the
+      // input is known.
+      const std::string name = "mobilenetv1_" + alpha_name[a] + "_" +
+          std::to_string(image_size_val) + ".bin";
+      if (!PublishedWeights::Available(name))
+      {
+        REQUIRE_THROWS_AS(predict(), std::runtime_error);
+        counter++;
+        continue;
+      }
+
+      predict();
       REQUIRE(output[0] == Approx(targets[counter][0]).epsilon(1e-4));
       REQUIRE(output[500] == Approx(targets[counter][1]).epsilon(1e-4));
       REQUIRE(output[999] == Approx(targets[counter][2]).epsilon(1e-4));
@@ -264,3 +365,659 @@ TEST_CASE("PreTrainedMobileNetV1ModelTest", "[FFNModelsTests]")
     }
   }
 }
+
+/**
+ * Test that ResNet and MobileNetV1 compute in single precision.
+ */
+TEST_CASE("SinglePrecisionModelTest", "[FFNModelsTests]")
+{
+  arma::fmat input(64 * 64 * 3, 2, arma::fill::randu);
+  arma::fmat output;
+
+  FFN<CrossEntropyError, RandomInitialization, arma::fmat> resnet;
+  resnet.InputDimensions() = std::vector<size_t>({64, 64, 3});
+  resnet.Add<ResNetType<arma::fmat, 18>>(10);
+  resnet.Predict(input, output);
+  REQUIRE(output.n_rows == 10);
+  REQUIRE(output.n_cols == 2);
+
+  FFN<CrossEntropyError, RandomInitialization, arma::fmat> mobilenet;
+  mobilenet.InputDimensions() = std::vector<size_t>({64, 64, 3});
+  mobilenet.Add<MobileNetV1Type<arma::fmat>>(10, 0.25);
+  mobilenet.Predict(input, output);
+  REQUIRE(output.n_rows == 10);
+  REQUIRE(output.n_cols == 2);
+}
+
+/**
+ * Test that the fused DarkNet and ResNet predict as the trained networks, and
+ * that the quantized ResNet stays close to them.
+ */
+TEST_CASE("FusedAndQuantizedModelTest", "[FFNModelsTests]")
+{
+  arma::mat input(64 * 64 * 3, 4, arma::fill::randu);
+  arma::mat expected, actual;
+
+  DarkNet19 darknetLayer(10);
+  FFN<> darknet;
+  darknet.InputDimensions() = std::vector<size_t>({64, 64, 3});
+  darknet.Add<DarkNet19>(darknetLayer);
+  darknet.Predict(input, expected);
+
+  FFN<>* darknetInference = darknetLayer.GetInferenceModel(darknet);
+  darknetInference->Predict(input, actual);
+  CheckMatrices(expected, actual, 1e-8);
+  delete darknetInference;
+
+  ResNet18 resnetLayer(10);
+  FFN<> resnet;
+  resnet.InputDimensions() = std::vector<size_t>({64, 64, 3});
+  resnet.Add<ResNet18>(resnetLayer);
+  resnet.Predict(input, expected);
+
+  FFN<>* resnetInference = resnetLayer.GetInferenceModel(resnet);
+  resnetInference->Predict(input, actual);
+  CheckMatrices(expected, actual, 1e-8);
+  delete resnetInference;
+
+  // 8-bit convolutions lose precision, but not the predictions.
+  FFN<>* quantized = resnetLayer.GetQuantizedModel(resnet, input);
+  quantized->Predict(input, actual);
+  REQUIRE(arma::norm(actual - expected) <= 0.1 * arma::norm(expected));
+  delete quantized;
+}
+
+/**
+ * Test that the summary of ResNet18 holds all its weights and the known
+ * number of multiply-accumulates, and that the batch size it picks fits.
+ */
+TEST_CASE("ModelSummaryTest", "[FFNModelsTests]")
+{
+  ResNet18 resnet(1000);
+  ModelSummary summary = resnet.Summary({224, 224, 3});
+  REQUIRE(summary.Parameters() == resnet.WeightSize());
+  REQUIRE(summary.Layers().back().outputDimensions[0] == 1000);
+
+  // About 1.8 billion multiply-accumulates per image.
+  REQUIRE(summary.MACs() > 1.7e9);
+  REQUIRE(summary.MACs() < 1.9e9);
+  REQUIRE(summary.MACs(4) == 4 * summary.MACs());
+
+  const size_t memory = 1UL << 30;
+  const size_t batchSize = summary.MaxBatchSize(memory);
+  REQUIRE(batchSize > 0);
+  REQUIRE(summary.MemoryBytes(batchSize) <= memory);
+  REQUIRE(summary.MemoryBytes(batchSize + 1) > memory);
+}
+
+/**
+ * Test that the profiler measures every layer inside the containers of a
+ * network during training, and that the network predicts the same once it is
+ * detached.
+ */
+TEST_CASE("ProfilerTest", "[FFNModelsTests]")
+{
+  arma::mat input(8 * 8 * 2, 8, arma::fill::randu);
+  arma::mat target(4, 8, arma::fill::randu);
+
+  MultiLayer<arma::mat>* block = new MultiLayer<arma::mat>();
+  block->Add<Convolution>(4, 3, 3, 1, 1, 1, 1);
+  block->Add<ReLU>();
+  FFN<MeanSquaredError> model;
+  model.InputDimensions() = std::vector<size_t>({8, 8, 2});
+  model.Add(block);
+  model.Add<Linear>(4);
+
+  Profiler profiler;
+  profiler.Attach(model);
+  REQUIRE(profiler.Records().size() == 3);
+  REQUIRE(profiler.Records()[0].name == "0.0 Convolution");
+
+  const std::string tracePath = "profiler_test.trace.json";
+  ens::StandardSGD optimizer(0.01, 4, 8, -100, false);
+  model.Train(input, target, optimizer,
+      ens::ProfileTraining<Profiler>(profiler, tracePath, 0, true));
+  for (const Profiler::Record& record : profiler.Records())
+    REQUIRE(record.timings[Profiler::Forward].calls > 0);
+  REQUIRE(profiler.Records()[2].timings[Profiler::Gradient].calls > 0);
+  REQUIRE(!profiler.Enabled());
+  REQUIRE(boost::filesystem::file_size(tracePath) > 0);
+  std::remove(tracePath.c_str());
+
+  arma::mat expected, actual;
+  model.Predict(input, expected);
+  profiler.Detach();
+  model.Predict(input, actual);
+  CheckMatrices(expected, actual, 1e-12);
+}
+
+/**
+ * Test that inputs predicted from many threads through DynamicBatcher get the
+ * predictions of the network.
+ */
+TEST_CASE("DynamicBatcherTest", "[FFNModelsTests]")
+{
+  arma::mat input(8 * 8 * 3, 16, arma::fill::randu);
+  FFN<>* model = new FFN<>();
+  model->InputDimensions() = std::vector<size_t>({8, 8, 3});
+  model->Add<Convolution>(4, 3, 3, 1, 1, 1, 1);
+  model->Add<ReLU>();
+  model->Add<Linear>(5);
+  arma::mat expected;
+  model->Predict(input, expected);
+
+  DynamicBatcher batcher(model, 8, std::chrono::milliseconds(20));
+  std::vector<std::future<arma::mat>> predictions(input.n_cols);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < input.n_cols; i++)
+  {
+    threads.emplace_back([&, i]()
+    {
+      predictions[i] = batcher.Predict(arma::mat(input.col(i)));
+    });
+  }
+
+  for (std::thread& thread : threads)
+    thread.join();
+
+  for (size_t i = 0; i < input.n_cols; i++)
+    CheckMatrices(arma::mat(expected.col(i)), predictions[i].get(), 1e-10);
+
+  REQUIRE(batcher.Requests() == input.n_cols);
+  REQUIRE(batcher.Batches() >= 2);
+  REQUIRE(batcher.Batches() <= input.n_cols);
+}
+
+/**
+ * Fills the given matrices with random inputs of the network built by
+ * AddTrainingLayers() and random targets.
+ *
+ * @param input Matrix where inputs of 6x6x2 values will be stored.
+ * @param target Matrix where targets of 3 values will be stored.
+ * @param points Number of inputs and targets.
+ */
+template<typename MatType>
+void TrainingData(MatType& input, MatType& target, const size_t points = 40)
+{
+  input.randn(6 * 6 * 2, points);
+  target.randn(3, points);
+}
+
+/**
+ * Adds the layers of the small convolutional network trained by the tests of
+ * training utilities: a convolution of 6x6x2 inputs, optionally followed by
+ * batch normalization, ReLU and a linear layer with 3 outputs.
+ *
+ * @param network Network the layers are added to.
+ * @param batchNorm Whether the convolution is followed by batch
+ *     normalization, whose running statistics are updated by training.
+ */
+template<
+  typename OutputLayerType,
+  typename InitializationRuleType,
+  typename MatType
+>
+void AddTrainingLayers(
+    FFN<OutputLayerType, InitializationRuleType, MatType>& network,
+    const bool batchNorm = false)
+{
+  network.InputDimensions() = std::vector<size_t>({6, 6, 2});
+  network.template Add<DefaultConvolutionType<MatType>>(3, 3, 3, 1, 1, 1, 1);
+  if (batchNorm)
+    network.template Add<BatchNormType<MatType>>();
+  network.template Add<ReLUType<MatType>>();
+  network.template Add<LinearType<MatType>>(3);
+}
+
+/**
+ * Test that training with replicas on shards of every batch takes the same
+ * steps as training the network on whole batches.
+ */
+TEST_CASE("DataParallelTest", "[FFNModelsTests]")
+{
+  arma::mat input, target;
+  TrainingData(input, target);
+  FFN<MeanSquaredError> model;
+  AddTrainingLayers(model);
+  model.Reset();
+  FFN<MeanSquaredError> parallelModel(model);
+
+  // Batches of 10 don't split evenly onto 4 replicas.
+  ens::StandardSGD optimizer(1e-3, 10, 2 * input.n_cols, 1e-10, false);
+  model.Train(input, target, optimizer);
+
+  DataParallel<MeanSquaredError> parallel(parallelModel, 4);
+  parallel.Train(input, target, optimizer);
+
+  REQUIRE(parallel.Replicas() == 4);
+  CheckMatrices(model.Parameters(), parallelModel.Parameters(), 1e-8);
+}
+
+/**
+ * Test that mixed-precision training follows training in double precision,
+ * learns the batch normalization statistics of the network, and recomputes
+ * gradients with a reduced loss scale once they overflow.
+ */
+TEST_CASE("MixedPrecisionTest", "[FFNModelsTests]")
+{
+  arma::mat input, target;
+  TrainingData(input, target);
+  FFN<MeanSquaredError> model;
+  AddTrainingLayers(model, true);
+  model.Reset();
+
+  typedef FFN<MeanSquaredError, RandomInitialization, arma::fmat>
+      FloatNetwork;
+  FloatNetwork floatModel;
+  AddTrainingLayers(floatModel, true);
+  floatModel.Reset();
+  // The layers alias the parameters, so they are copied in place.
+  for (size_t i = 0; i < model.Parameters().n_elem; i++)
+    floatModel.Parameters()[i] = float(model.Parameters()[i]);
+  FloatNetwork overflowModel(floatModel);
+  BatchNormType<arma::fmat>* norm =
+      dynamic_cast<BatchNormType<arma::fmat>*>(floatModel.Network()[1]);
+  const arma::fmat initialMean = norm->TrainingMean();
+
+  ens::StandardSGD optimizer(1e-3, 10, 2 * input.n_cols, 1e-10, false);
+  model.Train(input, target, optimizer);
+
+  MixedPrecision<MeanSquaredError> mixed(floatModel);
+  mixed.Train(arma::conv_to<arma::fmat>::from(input),
+      arma::conv_to<arma::fmat>::from(target), optimizer);
+
+  REQUIRE(mixed.Overflows() == 0);
+  CheckMatrices(model.Parameters(),
+      arma::conv_to<arma::mat>::from(floatModel.Parameters()), 1e-4);
+
+  // The running statistics are learned by the copies of the layers.
+  BatchNormType<arma::mat>* doubleNorm =
+      dynamic_cast<BatchNormType<arma::mat>*>(model.Network()[1]);
+  REQUIRE(arma::any(arma::vectorise(norm->TrainingMean() != initialMean)));
+  CheckMatrices(doubleNorm->TrainingMean(),
+      arma::conv_to<arma::mat>::from(norm->TrainingMean()), 1e-3);
+
+  // A scaled loss of 1e38 overflows single precision; the gradients are
+  // recomputed instead of skipped, so training takes the same steps.
+  MixedPrecision<MeanSquaredError> overflow(overflowModel, 1e38);
+  overflow.Train(arma::conv_to<arma::fmat>::from(input),
+      arma::conv_to<arma::fmat>::from(target), optimizer);
+
+  REQUIRE(overflow.Overflows() > 0);
+  REQUIRE(overflow.LossScale() < 1e38);
+  CheckMatrices(model.Parameters(),
+      arma::conv_to<arma::mat>::from(overflowModel.Parameters()), 1e-3);
+}
+
+/**
+ * Test that a ResNet whose blocks are checkpointed computes the outputs and
+ * gradients of the ResNet that keeps all outputs.
+ */
+TEST_CASE("CheckpointTest", "[FFNModelsTests]")
+{
+  arma::mat input(32 * 32 * 3, 3, arma::fill::randu);
+  arma::mat target(10, 3, arma::fill::randn);
+
+  FFN<MeanSquaredError> resnet, checkpointed;
+  resnet.InputDimensions() = std::vector<size_t>({32, 32, 3});
+  resnet.Add<ResNet18>(10);
+  resnet.Reset();
+  checkpointed.InputDimensions() = std::vector<size_t>({32, 32, 3});
+  checkpointed.Add<ResNet18>(10, true, false, false, true);
+  checkpointed.Reset();
+  checkpointed.Parameters() = resnet.Parameters();
+
+  arma::mat expected, actual, expectedGradient, actualGradient;
+  resnet.SetNetworkMode(true);
+  resnet.Forward(input, expected);
+  const double expectedLoss = resnet.Backward(input, target,
+      expectedGradient);
+
+  checkpointed.SetNetworkMode(true);
+  checkpointed.Forward(input, actual);
+  const double actualLoss = checkpointed.Backward(input, target,
+      actualGradient);
+
+  CheckMatrices(expected, actual, 1e-10);
+  REQUIRE(actualLoss == Approx(expectedLoss).epsilon(1e-10));
+  CheckMatrices(expectedGradient, actualGradient, 1e-8);
+}
+
+/**
+ * Squared error of predictions, a metric for PrintMetric.
+ */
+struct SquaredErrorMetric
+{
+  static double Evaluate(const arma::mat& predictions,
+                         const arma::mat& responses)
+  {
+    return arma::accu(arma::square(predictions - responses)) /
+        predictions.n_cols;
+  }
+};
+
+/**
+ * Test that PrintMetric evaluates every epoch in batches and on subsets, and
+ * that asynchronous evaluation is printed before training returns and uses
+ * the batch normalization statistics of the epoch.
+ */
+TEST_CASE("PrintMetricTest", "[FFNModelsTests]")
+{
+  arma::mat input, target;
+  TrainingData(input, target);
+  FFN<MeanSquaredError> model;
+  AddTrainingLayers(model, true);
+
+  typedef ens::PrintMetric<FFN<MeanSquaredError>, SquaredErrorMetric>
+      Metric;
+  std::ostringstream full, subset, background;
+  ens::StandardSGD optimizer(1e-3, 10, 3 * input.n_cols, -1, false);
+  model.Train(input, target, optimizer,
+      Metric(model, input, target, "error", true, full, 7),
+      Metric(model, input, target, "error", true, subset, 7, 5),
+      Metric(model, input, target, "error", true, background, 7, 0, true));
+
+  // The last evaluation in the background is waited for at the end.
+  arma::mat predictions;
+  model.Predict(input, predictions);
+  const std::string last = "Train error : " + std::to_string(
+      SquaredErrorMetric::Evaluate(predictions, target)) + "\n";
+  const std::string fullOutput = full.str();
+  const std::string subsetOutput = subset.str();
+  REQUIRE(fullOutput.size() >= last.size());
+  REQUIRE(fullOutput.substr(fullOutput.size() - last.size()) == last);
+  REQUIRE(std::count(subsetOutput.begin(), subsetOutput.end(), '\n') == 3);
+  REQUIRE(background.str().find("Train error (epoch") != std::string::npos);
+
+  // Every epoch evaluated in the background has the metric of the network.
+  std::vector<std::string> metrics;
+  std::istringstream fullLines(fullOutput);
+  std::string line;
+  while (std::getline(fullLines, line))
+    metrics.push_back(line.substr(line.find(" : ")));
+
+  std::istringstream backgroundLines(background.str());
+  while (std::getline(backgroundLines, line))
+  {
+    const size_t epoch = std::stoul(line.substr(line.find("epoch") + 6));
+    REQUIRE(epoch >= 1);
+    REQUIRE(epoch <= metrics.size());
+    REQUIRE(line.substr(line.find(" : ")) == metrics[epoch - 1]);
+  }
+}
+
+/**
+ * Test that TrainingTelemetry times every step and reports every given number
+ * of steps and at the end of the optimization.
+ */
+TEST_CASE("TrainingTelemetryTest", "[FFNModelsTests]")
+{
+  arma::mat input, target;
+  TrainingData(input, target);
+  FFN<MeanSquaredError> model;
+  AddTrainingLayers(model);
+
+  std::ostringstream output;
+  ens::TrainingTelemetry telemetry(output, 3, true);
+  ens::StandardSGD optimizer(1e-3, 10, 3 * input.n_cols, -1, false);
+  model.Train(input, target, optimizer, telemetry);
+
+  REQUIRE(telemetry.Steps() == 12);
+  for (const double time : telemetry.StepTimes())
+    REQUIRE(time >= 0.0);
+
+  std::vector<std::string> lines;
+  std::istringstream reports(output.str());
+  std::string line;
+  while (std::getline(reports, line))
+    lines.push_back(line);
+
+  REQUIRE(lines.size() == 5);
+  REQUIRE(lines[0].find("{\"event\":\"window\"") == 0);
+  REQUIRE(lines[0].find("\"steps\":3,") != std::string::npos);
+  REQUIRE(lines[4].find("{\"event\":\"total\"") == 0);
+  REQUIRE(lines[4].find("\"steps\":12,") != std::string::npos);
+  REQUIRE(lines[4].find("\"samples_per_second\":") != std::string::npos);
+}
+
+/**
+ * Test that the loss of a dataset evaluated in batches by several replicas,
+ * with a smaller last batch, is the loss of the whole dataset.
+ */
+TEST_CASE("BatchedEvaluationTest", "[FFNModelsTests]")
+{
+  arma::mat input, target;
+  TrainingData(input, target, 45);
+  FFN<MeanSquaredError> model;
+  AddTrainingLayers(model);
+  model.Reset();
+
+  const double expected = model.Evaluate(input, target);
+  REQUIRE(BatchedEvaluation::Evaluate(model, input, target, 10, 1) ==
+      Approx(expected).epsilon(1e-10));
+  REQUIRE(BatchedEvaluation::Evaluate(model, input, target, 10, 4) ==
+      Approx(expected).epsilon(1e-10));
+  REQUIRE(BatchedEvaluation::Evaluate(model, input, target, 64) ==
+      Approx(expected).epsilon(1e-10));
+}
+
+/**
+ * Test that 3x3 fused convolutions of stride 1 computed with Winograd's
+ * algorithm give the outputs of the unrolled convolution, for odd output sizes
+ * and with and without padding, and after the weights were changed.
+ */
+TEST_CASE("WinogradConvolutionTest", "[FFNModelsTests]")
+{
+  arma::mat input(9 * 7 * 5, 3, arma::fill::randn);
+  for (size_t pad = 0; pad < 2; pad++)
+  {
+    FusedConvolution* convolution = new FusedConvolution(6, 3, 3, 1, 1, pad,
+        pad, FusedActivation::LeakyReLU);
+    FFN<> model;
+    model.InputDimensions() = std::vector<size_t>({9, 7, 5});
+    model.Add(convolution);
+    model.Reset();
+
+    arma::mat expected, actual;
+    convolution->Winograd() = false;
+    model.Predict(input, expected);
+    convolution->Winograd() = true;
+    model.Predict(input, actual);
+    CheckMatrices(expected, actual, 1e-10);
+
+    // Kernels are transformed again once new weights are set.
+    model.Parameters().randn();
+    convolution->SetWeights(model.Parameters());
+    model.Predict(input, actual);
+    convolution->Winograd() = false;
+    model.Predict(input, expected);
+    CheckMatrices(expected, actual, 1e-10);
+  }
+}
+
+/**
+ * Test that Residual gives the outputs and gradients of AddMerge followed by
+ * ReLU, both while training and for inference.
+ */
+TEST_CASE("ResidualTest", "[FFNModelsTests]")
+{
+  arma::mat input(8 * 8 * 4, 3, arma::fill::randn);
+  arma::mat target(4 * 4 * 6, 3, arma::fill::randu);
+
+  MultiLayer<arma::mat>* expectedBlock = new MultiLayer<arma::mat>();
+  expectedBlock->Add<Convolution>(6, 3, 3, 2, 2, 1, 1);
+  expectedBlock->Add<ReLU>();
+  expectedBlock->Add<Convolution>(6, 3, 3, 1, 1, 1, 1);
+  AddMerge* merge = new AddMerge();
+  merge->Add(expectedBlock);
+  merge->Add<Convolution>(6, 1, 1, 2, 2, 0, 0);
+
+  FFN<MeanSquaredError> expectedModel;
+  expectedModel.InputDimensions() = std::vector<size_t>({8, 8, 4});
+  expectedModel.Add(merge);
+  expectedModel.Add<ReLU>();
+  expectedModel.Reset();
+
+  MultiLayer<arma::mat>* block = new MultiLayer<arma::mat>();
+  block->Add<Convolution>(6, 3, 3, 2, 2, 1, 1);
+  block->Add<ReLU>();
+  block->Add<Convolution>(6, 3, 3, 1, 1, 1, 1);
+  Residual* residual = new Residual(FusedActivation::ReLU);
+  residual->Add(block);
+  residual->Add<Convolution>(6, 1, 1, 2, 2, 0, 0);
+
+  FFN<MeanSquaredError> model;
+  model.InputDimensions() = std::vector<size_t>({8, 8, 4});
+  model.Add(residual);
+  model.Reset();
+  REQUIRE(model.Parameters().n_elem == expectedModel.Parameters().n_elem);
+  model.Parameters() = expectedModel.Parameters();
+
+  arma::mat expected, actual;
+  expectedModel.SetNetworkMode(true);
+  model.SetNetworkMode(true);
+  expectedModel.Forward(input, expected);
+  model.Forward(input, actual);
+  CheckMatrices(expected, actual, 1e-10);
+
+  arma::mat expectedGradient, gradient;
+  expectedModel.Backward(input, target, expectedGradient);
+  model.Backward(input, target, gradient);
+  CheckMatrices(expectedGradient, gradient, 1e-10);
+
+  // For inference the main branch accumulates into the output in place.
+  expectedModel.Predict(input, expected);
+  model.Predict(input, actual);
+  CheckMatrices(expected, actual, 1e-10);
+}
+
+/**
+ * Test that the memory planner predicts what the network predicts, with
+ * fewer buffers than layers.
+ */
+TEST_CASE("MemoryPlannerTest", "[FFNModelsTests]")
+{
+  arma::mat input(64 * 64 * 3, 5, arma::fill::randu);
+  arma::mat expected, actual;
+
+  FFN<> resnet;
+  resnet.InputDimensions() = std::vector<size_t>({64, 64, 3});
+  resnet.Add<ResNet18>(10);
+  resnet.Predict(input, expected);
+
+  MemoryPlanner planner(resnet);
+  REQUIRE(planner.Buffers() <= 4);
+
+  // A batch size that doesn't divide the number of inputs.
+  planner.Predict(input, actual, 2);
+  CheckMatrices(expected, actual, 1e-10);
+
+  planner.Predict(input, actual);
+  CheckMatrices(expected, actual, 1e-10);
+}
+
+/**
+ * Test that a network whose weights are mapped from a weight file predicts
+ * what the saved network predicts.
+ */
+TEST_CASE("WeightFileTest", "[FFNModelsTests]")
+{
+  arma::mat input(64 * 64 * 3, 2, arma::fill::randu);
+  arma::mat expected, actual;
+
+  FFN<> resnet;
+  resnet.InputDimensions() = std::vector<size_t>({64, 64, 3});
+  resnet.Add<ResNet18>(10);
+  resnet.Predict(input, expected);
+  REQUIRE(WeightFile::Save("./resnet18_test.weights", resnet));
+
+  FFN<> mapped;
+  mapped.InputDimensions() = std::vector<size_t>({64, 64, 3});
+  mapped.Add<ResNet18>(10);
+
+  WeightFile weights;
+  REQUIRE(weights.Load("./resnet18_test.weights", mapped));
+  mapped.Predict(input, actual);
+  CheckMatrices(expected, actual, 1e-10);
+
+  // A network of other shape is refused.
+  FFN<> other;
+  other.InputDimensions() = std::vector<size_t>({64, 64, 3});
+  other.Add<ResNet18>(20);
+  WeightFile otherWeights;
+  REQUIRE(!otherWeights.Load("./resnet18_test.weights", other));
+
+  std::remove("./resnet18_test.weights");
+}
+
+/**
+ * Test that weights saved by SaveModel() are loaded by LoadModel(), also
+ * before the network holding the model is reset.
+ */
+TEST_CASE("SaveAndLoadModelTest", "[FFNModelsTests]")
+{
+  arma::mat input(64 * 64 * 3, 2, arma::fill::randu);
+  arma::mat expected, actual;
+
+  FFN<> trained;
+  trained.InputDimensions() = std::vector<size_t>({64, 64, 3});
+  trained.Add<ResNet18>(10);
+  trained.Reset();
+
+  // Give the batch normalization layers statistics of their own.
+  arma::mat labels(1, 2, arma::fill::ones);
+  ens::StandardSGD optimizer(1e-3, 2, 2);
+  trained.Train(input, labels, optimizer);
+  trained.Predict(input, expected);
+  static_cast<ResNet18*>(trained.Network()[0])->SaveModel(
+      "./resnet18_test.bin");
+
+  ResNet18 resnet(10);
+  resnet.LoadModel("./resnet18_test.bin");
+  FFN<> loaded;
+  loaded.InputDimensions() = std::vector<size_t>({64, 64, 3});
+  loaded.Add<ResNet18>(resnet);
+  loaded.Predict(input, actual);
+  CheckMatrices(expected, actual, 1e-10);
+
+  std::remove("./resnet18_test.bin");
+}
+
+/**
+ * Test that cached backbone features are the pooled outputs of the backbone,
+ * and that they are mapped from the cache file once it exists.
+ */
+TEST_CASE("FeatureCacheTest", "[FFNModelsTests]")
+{
+  arma::mat input(64 * 64 * 3, 5, arma::fill::randu);
+  arma::mat labels(1, 5, arma::fill::randu);
+
+  FFN<> backbone;
+  backbone.InputDimensions() = std::vector<size_t>({64, 64, 3});
+  backbone.Add<ResNet18>(10, false);
+
+  // Without classifier layers, ResNet18 outputs 2 x 2 x 512 maps.
+  arma::mat output;
+  backbone.Predict(input, output);
+  arma::mat expected(512, input.n_cols);
+  for (size_t i = 0; i < input.n_cols; i++)
+  {
+    arma::mat maps(output.colptr(i), 4, 512, false, true);
+    expected.col(i) = arma::mean(maps, 0).t();
+  }
+
+  arma::mat features, featureLabels;
+  FeatureCache cache;
+  REQUIRE(!cache.Load("./feature_cache_test.bin", backbone, input, labels,
+      features, featureLabels, 2));
+  CheckMatrices(expected, features, 1e-10);
+  CheckMatrices(labels, featureLabels, 1e-10);
+
+  arma::mat mappedFeatures, mappedLabels;
+  FeatureCache mappedCache;
+  REQUIRE(mappedCache.Load("./feature_cache_test.bin", backbone, input,
+      labels, mappedFeatures, mappedLabels));
+  CheckMatrices(expected, mappedFeatures, 1e-10);
+
+  std::remove("./feature_cache_test.bin");
+}
@@ -11,6 +11,7 @@
  */
 #include <dataloader/preprocessor.hpp>
 #include <dataloader/dataloader.hpp>
+#include <models/yolo/yolo_detection.hpp>
 #include "catch.hpp"
 
 using namespace mlpack::models;
@@ -95,3 +96,176 @@ TEST_CASE("YOLOPreProcessor", "[PreProcessorsTest]")
       REQUIRE(desiredOutput(i) == Approx(output(i)).epsilon(1e-2));
   }
 }
+
+/**
+ * Check that BoxStore type annotations are encoded the same as field type
+ * annotations.
+ */
+TEST_CASE("YOLOPreProcessorBoxStore", "[PreProcessorsTest]")
+{
+  arma::field<arma::vec> input(1, 3);
+  input(0, 0) = arma::vec({2, 84, 48, 493, 387});
+  input(0, 1) = arma::vec({8, 341, 217, 487, 375, 8, 114, 209, 183, 298,
+      19, 237, 110, 320, 176});
+  input(0, 2) = arma::vec({7, 157, 90, 486, 372});
+
+  BoxStore boxes;
+  for (size_t i = 0; i < input.n_cols; i++)
+    boxes.Add(input(0, i));
+
+  for (size_t version = 1; version <= 3; version++)
+  {
+    arma::mat fieldOutput, boxStoreOutput;
+    PreProcessor<arma::mat, arma::field<arma::vec>>::YOLOPreProcessor(
+        input, fieldOutput, version, 500, 387);
+    PreProcessor<arma::mat, BoxStore>::YOLOPreProcessor(
+        boxes, boxStoreOutput, version, 500, 387);
+
+    REQUIRE(arma::approx_equal(fieldOutput, boxStoreOutput, "absdiff",
+        1e-10));
+  }
+}
+
+/**
+ * Check that boxes beyond numBoxes in a single grid cell are dropped for
+ * YOLOv2 and higher and that the batch is encoded independently per image.
+ */
+TEST_CASE("YOLOPreProcessorGridCellLimit", "[PreProcessorsTest]")
+{
+  // Three boxes with the same centre, only two fit in the grid cell.
+  BoxStore boxes;
+  boxes.Add(arma::vec({0, 100, 100, 200, 200, 1, 110, 110, 190, 190,
+      1, 120, 120, 180, 180}));
+  boxes.Add(arma::vec({1, 100, 100, 200, 200}));
+
+  arma::mat output;
+  PreProcessor<arma::mat, BoxStore>::YOLOPreProcessor(boxes, output, 2, 224,
+      224, 7, 7, 2, 2);
+
+  REQUIRE(output.n_rows == 7 * 7 * 2 * (5 + 2));
+  REQUIRE(output.n_cols == 2);
+
+  // Two confidences and two class labels are set for the first image.
+  const size_t gridSize = 7 * 7;
+  arma::mat firstImage = arma::reshape(output.col(0), gridSize, 2 * 7);
+  REQUIRE(arma::accu(firstImage.col(4)) == 1.0);
+  REQUIRE(arma::accu(firstImage.col(7 + 4)) == 1.0);
+  REQUIRE(arma::accu(firstImage.cols(5, 6)) == 1.0);
+  REQUIRE(arma::accu(firstImage.cols(7 + 5, 7 + 6)) == 1.0);
+
+  // Grid occupancy of the first image doesn't affect the second one.
+  arma::mat secondImage = arma::reshape(output.col(1), gridSize, 2 * 7);
+  REQUIRE(arma::accu(secondImage.col(4)) == 1.0);
+  REQUIRE(arma::accu(secondImage.col(7 + 4)) == 0.0);
+  REQUIRE(secondImage.col(6).max() == 1.0);
+}
+
+/**
+ * Check channel first conversion of non-square images against the layout of
+ * the image loader, and that converting back restores the images.
+ */
+TEST_CASE("ChannelFirstImagesTest", "[PreProcessorsTest]")
+{
+  const size_t width = 5, height = 3, depth = 2;
+  arma::Mat<uint8_t> images(width * height * depth, 4);
+  for (size_t i = 0; i < images.n_elem; i++)
+    images(i) = i % 251;
+
+  arma::mat channelFirst;
+  PreProcessor<arma::Mat<uint8_t>>::ChannelFirstImages(images, channelFirst,
+      width, height, depth);
+
+  arma::mat inPlace = arma::conv_to<arma::mat>::from(images);
+  PreProcessor<>::ChannelFirstImages(inPlace, width, height, depth);
+  REQUIRE(arma::approx_equal(channelFirst, inPlace, "absdiff", 1e-12));
+
+  // Pixel (x, y) of channel c is interleaved at c + depth * (x + width * y).
+  for (size_t i = 0; i < images.n_cols; i++)
+  {
+    for (size_t c = 0; c < depth; c++)
+    {
+      for (size_t y = 0; y < height; y++)
+      {
+        for (size_t x = 0; x < width; x++)
+        {
+          REQUIRE(channelFirst(x + width * y + width * height * c, i) ==
+              Approx(images(c + depth * (x + width * y), i) / 255.0));
+        }
+      }
+    }
+  }
+
+  arma::mat restored = 255.0 * channelFirst;
+  PreProcessor<>::ChannelLastImages(restored, width, height, depth);
+  REQUIRE(arma::approx_equal(restored,
+      arma::conv_to<arma::mat>::from(images), "absdiff", 1e-9));
+}
+
+/**
+ * Check that YOLODetection::Decode() recovers the boxes encoded by
+ * YOLOPreProcessor().
+ */
+TEST_CASE("YOLODetectionDecode", "[PreProcessorsTest]")
+{
+  BoxStore boxes;
+  boxes.Add(arma::vec({2, 84, 48, 493, 387}));
+  boxes.Add(arma::vec({8, 341, 217, 487, 375, 8, 114, 209, 183, 298,
+      19, 237, 110, 320, 176}));
+  boxes.Add(arma::vec());
+
+  for (size_t version = 1; version <= 3; version++)
+  {
+    arma::mat output;
+    PreProcessor<arma::mat, BoxStore>::YOLOPreProcessor(boxes, output, version,
+        500, 387);
+
+    BoxStore detections;
+    arma::vec scores;
+    YOLODetection::Decode(output, detections, scores, version, 500, 387);
+    REQUIRE(detections.NumImages() == boxes.NumImages());
+    REQUIRE(scores.n_elem == boxes.Classes().n_elem);
+
+    // YOLOv1 repeats every box for all predictions of its cell, the copies
+    // are suppressed.
+    for (size_t i = 0; i < boxes.NumImages(); i++)
+    {
+      REQUIRE(detections.NumBoxes(i) == boxes.NumBoxes(i));
+      for (size_t b = boxes.Offset(i); b < boxes.Offset(i + 1); b++)
+      {
+        bool found = false;
+        for (size_t d = detections.Offset(i); d < detections.Offset(i + 1);
+            d++)
+        {
+          found |= (detections.Classes()(d) == boxes.Classes()(b) &&
+              arma::approx_equal(detections.Coordinates().col(d),
+              boxes.Coordinates().col(b), "absdiff", 1e-8));
+        }
+
+        REQUIRE(found);
+      }
+    }
+
+    REQUIRE(arma::all(scores == 1.0));
+  }
+}
+
+/**
+ * Check that non-maximum suppression only removes overlapping boxes of the
+ * same class.
+ */
+TEST_CASE("YOLODetectionNonMaxSuppression", "[PreProcessorsTest]")
+{
+  arma::mat boxes = { { 0, 1, 50, 0 },
+                      { 0, 1, 50, 0 },
+                      { 10, 11, 60, 10 },
+                      { 10, 11, 60, 10 } };
+  arma::vec scores = { 0.6, 0.9, 0.8, 0.7 };
+  arma::vec classes = { 0, 0, 0, 1 };
+
+  const arma::uvec keep = YOLODetection::NonMaxSuppression(boxes, scores,
+      classes, 0.5);
+  REQUIRE(keep.n_elem == 3);
+  REQUIRE(keep[0] == 1);
+  REQUIRE(keep[1] == 2);
+  REQUIRE(keep[2] == 3);
+}
@@ -206,3 +206,70 @@ TEST_CASE("SqueezeNet1NoTopTest", "[SqueezenetTests]")
   model.Add<models::SqueezeNet1>(squeezeLayer1);
   ModelDimTest(model, input, 86528, 10);
 }
+
+TEST_CASE("SqueezeNet1FusedTest", "[SqueezenetTests]")
+{
+  arma::mat input(64 * 64 * 3, 4, arma::fill::randu);
+  models::SqueezeNet1 squeezeLayer1(10);
+  FFN<> model;
+  model.InputDimensions() = std::vector<size_t>({64, 64, 3});
+  model.Add<models::SqueezeNet1>(squeezeLayer1);
+
+  arma::mat expected, actual;
+  model.Predict(input, expected);
+
+  // Every ReLU is applied by the convolution before it.
+  FFN<>* inference = squeezeLayer1.GetInferenceModel(model);
+  REQUIRE(inference->Parameters().n_elem == model.Parameters().n_elem);
+  inference->Predict(input, actual);
+  CheckMatrices(expected, actual, 1e-8);
+  delete inference;
+}
+
+/**
+ * Check that ChannelConcat computes the same outputs and gradients as Concat
+ * of a convolution and a ReLU per branch.
+ */
+TEST_CASE("ChannelConcatTest", "[SqueezenetTests]")
+{
+  arma::mat input(8 * 8 * 4, 3, arma::fill::randu);
+  arma::mat target(8 * 8 * 5, 3, arma::fill::randu);
+
+  MultiLayer<arma::mat>* branch1x1 = new MultiLayer<arma::mat>();
+  branch1x1->Add<Convolution>(2, 1, 1, 1, 1, 0, 0);
+  branch1x1->Add<ReLU>();
+  MultiLayer<arma::mat>* branch3x3 = new MultiLayer<arma::mat>();
+  branch3x3->Add<Convolution>(3, 3, 3, 1, 1, 1, 1);
+  branch3x3->Add<ReLU>();
+  Concat* concat = new Concat(2);
+  concat->Add(branch1x1);
+  concat->Add(branch3x3);
+
+  FFN<MeanSquaredError> expectedModel;
+  expectedModel.InputDimensions() = std::vector<size_t>({8, 8, 4});
+  expectedModel.Add(concat);
+  expectedModel.Reset();
+
+  models::ChannelConcat* channelConcat = new models::ChannelConcat();
+  channelConcat->Add<models::FusedConvolution>(2, 1, 1, 1, 1, 0, 0,
+      models::FusedActivation::ReLU);
+  channelConcat->Add<models::FusedConvolution>(3, 3, 3, 1, 1, 1, 1,
+      models::FusedActivation::ReLU);
+
+  FFN<MeanSquaredError> model;
+  model.InputDimensions() = std::vector<size_t>({8, 8, 4});
+  model.Add(channelConcat);
+  model.Reset();
+  REQUIRE(model.Parameters().n_elem == expectedModel.Parameters().n_elem);
+  model.Parameters() = expectedModel.Parameters();
+
+  arma::mat expected, actual;
+  expectedModel.Forward(input, expected);
+  model.Forward(input, actual);
+  CheckMatrices(expected, actual, 1e-10);
+
+  arma::mat expectedGradient, gradient;
+  expectedModel.Backward(input, target, expectedGradient);
+  model.Backward(input, target, gradient);
+  CheckMatrices(expectedGradient, gradient, 1e-10);
+}
@@ -11,6 +11,7 @@
  */
 #include <mlpack.hpp>
 #include <utils/utils.hpp>
+#include <utils/weight_cache.hpp>
 #include "catch.hpp"
 
 using namespace mlpack::models;
@@ -109,3 +110,130 @@ TEST_CASE("CurlDownloadTest", "[UtilsTest]")
   // Clean up.
   Utils::RemoveFile("./../data/test_image.jpg");
 }
+
+/**
+ * Check that checksums computed while a file is written match the checksums
+ * of the file on disk.
+ */
+TEST_CASE("CRC32StreamTest", "[UtilsTest]")
+{
+  std::string contents;
+  for (size_t i = 0; i < 10000; i++)
+    contents += char((i * 7919) % 256);
+
+  std::ofstream file("./../data/crc_stream_test.bin", std::ios::binary);
+  file.write(contents.data(), contents.size());
+  file.close();
+
+  // Chunks of any size give the checksum of the file.
+  CRC32Stream hash;
+  for (size_t begin = 0, size = 1; begin < contents.size(); size += 357)
+  {
+    const size_t count = std::min(size, contents.size() - begin);
+    hash.Update(contents.data() + begin, count);
+    begin += count;
+  }
+
+  REQUIRE(hash.Checksum() ==
+      Utils::GetCRC32("./../data/crc_stream_test.bin"));
+
+  hash.Reset();
+  REQUIRE(hash.Checksum() == CRC32Stream().Checksum());
+
+  Utils::RemoveFile("./../data/crc_stream_test.bin");
+}
+
+/**
+ * Download files concurrently, resume a partial download and reject a file
+ * whose checksum doesn't match.
+ */
+TEST_CASE("DownloadFilesTest", "[UtilsTest]")
+{
+  std::vector<DownloadTask> tasks;
+  tasks.emplace_back("/datasets/iris.csv", "./../data/iris.csv", "7c30e225");
+  tasks.emplace_back("/datasets/iris_test.csv", "./../data/iris_test.csv",
+      "3be1f79e");
+  tasks.emplace_back("/datasets/iris.csv", "./../data/iris_corrupted.csv",
+      "00000000");
+
+  std::vector<char> downloaded = Utils::DownloadFiles(tasks, 3);
+  REQUIRE(downloaded[0] == 1);
+  REQUIRE(downloaded[1] == 1);
+  REQUIRE(downloaded[2] == 0);
+  REQUIRE(Utils::PathExists("./../data/iris_corrupted.csv") == false);
+
+  // Keep the first bytes of the file as a partial download and resume it.
+  std::ifstream file("./../data/iris.csv", std::ios::binary);
+  std::vector<char> prefix(1000);
+  file.read(prefix.data(), prefix.size());
+  file.close();
+  Utils::RemoveFile("./../data/iris.csv");
+
+  std::ofstream partialFile("./../data/iris.csv.part", std::ios::binary);
+  partialFile.write(prefix.data(), prefix.size());
+  partialFile.close();
+
+  Utils::DownloadFile("/datasets/iris.csv", "./../data/iris.csv");
+  REQUIRE(Utils::PathExists("./../data/iris.csv.part") == false);
+  REQUIRE(Utils::CompareCRC32("./../data/iris.csv", "7c30e225") == true);
+
+  // Clean up.
+  Utils::RemoveFile("./../data/iris.csv");
+  Utils::RemoveFile("./../data/iris_test.csv");
+}
+
+/**
+ * Prefetch files of a manifest into a cache folder, fetch them again from
+ * the cache and reject a file whose checksum doesn't match.
+ */
+TEST_CASE("WeightCacheTest", "[UtilsTest]")
+{
+  std::ofstream manifest("./../data/weights.manifest");
+  manifest << "# name url size checksum" << std::endl;
+  manifest << "iris.csv /datasets/iris.csv 0 7c30e225" << std::endl;
+  manifest << "iris_test.csv /datasets/iris_test.csv 0 3be1f79e" << std::endl;
+  manifest << "corrupted.csv /datasets/iris.csv 0 00000000" << std::endl;
+  manifest.close();
+
+  WeightCache cache("./../data/weight_cache");
+  REQUIRE(cache.LoadManifest("./../data/weights.manifest") == 3);
+
+  // The same file twice is downloaded once.
+  std::vector<char> cached = cache.Prefetch({ "iris.csv", "iris_test.csv",
+      "iris.csv", "corrupted.csv" }, 4);
+  REQUIRE(cached[0] == 1);
+  REQUIRE(cached[1] == 1);
+  REQUIRE(cached[2] == 1);
+  REQUIRE(cached[3] == 0);
+  REQUIRE(Utils::PathExists(cache.Path("corrupted.csv")) == false);
+
+  REQUIRE(cache.Fetch("iris.csv") == cache.Path("iris.csv"));
+  REQUIRE(cache.Verify("iris.csv"));
+  REQUIRE(Utils::CompareCRC32(cache.Path("iris_test.csv"), "3be1f79e"));
+  REQUIRE(cache.Fetch("missing.csv").empty());
+
+  // Clean up.
+  boost::filesystem::remove_all("./../data/weight_cache");
+  Utils::RemoveFile("./../data/weights.manifest");
+}
+
+/**
+ * Load a manifest built into the code, skipping comments and invalid lines.
+ */
+TEST_CASE("WeightCacheStreamManifestTest", "[UtilsTest]")
+{
+  std::stringstream manifest(
+      "# name url size checksum\n"
+      "\n"
+      "iris.csv /datasets/iris.csv 0 7c30e225\n"
+      "invalid.csv /datasets/iris.csv\n"
+      "iris_test.csv /datasets/iris_test.csv 0 3be1f79e models.mlpack.org\n");
+
+  WeightCache cache("./../data/weight_cache");
+  REQUIRE(cache.LoadManifest(manifest, "built-in manifest") == 2);
+  REQUIRE(cache.Contains("iris.csv"));
+  REQUIRE(cache.Contains("iris_test.csv"));
+  REQUIRE(!cache.Contains("invalid.csv"));
+  const boost::filesystem::path folder("./../data/weight_cache");
+  REQUIRE(cache.Path("iris.csv") == (folder / "iris.csv").string());
+}
@@ -10,6 +10,8 @@
  * http://www.opensource.org/licenses/BSD-3-Clause for more information.
  */
 #include "../models/vgg/vgg.hpp"
+#include "../ensmallen_utils/periodic_save.hpp"
+#include "../utils/utils.hpp"
 
 #include "test_catch_tools.hpp"
 #include "catch.hpp"
@@ -506,3 +508,86 @@ TEST_CASE("VGG19BNNoTopTest", "[VGGTests]")
   model.Add<models::VGG19BN>(vggbnLayer19);
   ModelDimTest(model, input, 25088, 10);
 }
+
+/**
+ * Check that folding batch normalization into the convolutions doesn't change
+ * the predictions of a trained network.
+ */
+TEST_CASE("VGG11BNFoldingTest", "[VGGTests]")
+{
+  arma::mat input(32 * 32 * 3, 4, arma::fill::randu);
+  arma::mat output(512, 4, arma::fill::randu);
+  models::VGG11BN vggLayer11(1000, false);
+  FFN<MeanSquaredError> model;
+  model.InputDimensions() = std::vector<size_t>({32, 32, 3});
+  model.Add<models::VGG11BN>(vggLayer11);
+
+  // Training updates the running statistics of batch normalization.
+  ens::StandardSGD opt(0.01, 4, 8, -100, false);
+  model.Train(input, output, opt);
+
+  arma::mat expected, actual;
+  model.Predict(input, expected);
+
+  FFN<MeanSquaredError>* inference = vggLayer11.GetInferenceModel(model);
+  REQUIRE(inference->Parameters().n_elem < model.Parameters().n_elem);
+  inference->Predict(input, actual);
+  CheckMatrices(expected, actual, 1e-5);
+  delete inference;
+}
+
+/**
+ * Test that PeriodicSave keeps only the latest models, and that the model
+ * saved last in the background is the trained network, named after the last
+ * epoch and with its batch normalization statistics.
+ */
+TEST_CASE("PeriodicSaveTest", "[VGGTests]")
+{
+  arma::mat input(10, 40, arma::fill::randn);
+  arma::mat target(3, 40, arma::fill::randn);
+  FFN<MeanSquaredError> model;
+  model.Add<Linear>(8);
+  model.Add<BatchNorm>();
+  model.Add<ReLU>();
+  model.Add<Linear>(3);
+
+  for (const bool asynchronous : { false, true })
+  {
+    std::ostringstream output;
+    ens::StandardSGD opt(1e-3, 10, 4 * input.n_cols, -1, false);
+    model.Train(input, target, opt, ens::PeriodicSave<FFN<MeanSquaredError>>(
+        model, "./", "periodic_save_test", 1, false, output, asynchronous,
+        2));
+
+    // Names of the saved models, oldest first.
+    std::vector<std::string> names;
+    std::istringstream lines(output.str());
+    std::string line;
+    while (std::getline(lines, line))
+    {
+      REQUIRE(line.find("Model saved as ") == 0);
+      names.push_back("./" + line.substr(15) + ".bin");
+    }
+
+    REQUIRE(names.size() >= 2);
+    if (!asynchronous)
+      REQUIRE(names.size() == 4);
+    for (size_t i = 0; i < names.size(); i++)
+    {
+      const std::string temporary = names[i].substr(0, names[i].size() - 4) +
+          ".tmp.bin";
+      REQUIRE(models::Utils::PathExists(names[i]) == (i + 2 >= names.size()));
+      REQUIRE(!models::Utils::PathExists(temporary));
+    }
+
+    REQUIRE(names.back().find("periodic_save_test_4_") != std::string::npos);
+    FFN<MeanSquaredError> saved;
+    REQUIRE(data::Load(names.back(), "periodic_save_test", saved));
+    CheckMatrices(model.Parameters(), saved.Parameters(), 1e-12);
+    CheckMatrices(dynamic_cast<BatchNorm*>(model.Network()[1])->TrainingMean(),
+        dynamic_cast<BatchNorm*>(saved.Network()[1])->TrainingMean(), 1e-12);
+
+    for (const std::string& name : names)
+      std::remove(name.c_str());
+  }
+}
@@ -156,3 +156,74 @@ TEST_CASE("XceptionNoTopTest", "[XceptionTests]")
   model.Add<models::Xception>(xceptionLayer);
   ModelDimTest(model, input, 100352, 10);
 }
+
+/**
+ * Check that folding batch normalization into the convolutions doesn't change
+ * the predictions of a trained network.
+ */
+TEST_CASE("XceptionFoldingTest", "[XceptionTests]")
+{
+  arma::mat input(71 * 71 * 3, 2, arma::fill::randu);
+  arma::mat output(10, 2, arma::fill::randu);
+  models::Xception xceptionLayer(10);
+  FFN<MeanSquaredError> model;
+  model.InputDimensions() = std::vector<size_t>({71, 71, 3});
+  model.Add<models::Xception>(xceptionLayer);
+
+  // Training updates the running statistics of batch normalization.
+  ens::StandardSGD opt(0.01, 2, 4, -100, false);
+  model.Train(input, output, opt);
+
+  arma::mat expected, actual;
+  model.Predict(input, expected);
+
+  FFN<MeanSquaredError>* inference = xceptionLayer.GetInferenceModel(model);
+  inference->Predict(input, actual);
+  CheckMatrices(expected, actual, 1e-5);
+  delete inference;
+}
+
+/**
+ * Check that the depthwise convolution computes the same outputs and
+ * gradients as a grouped convolution with one group per input map.
+ */
+TEST_CASE("DepthwiseConvolutionTest", "[XceptionTests]")
+{
+  // Strides one and two, with a depth multiplier of two.
+  for (size_t stride = 1; stride <= 2; stride++)
+  {
+    models::DepthwiseConvolution depthwise(8, 3, 3, stride, stride, 1, 1);
+    models::DefaultGroupedConvolutionType<arma::mat> grouped(8, 3, 3, 4,
+        stride, stride, 1, 1);
+    depthwise.InputDimensions() = std::vector<size_t>({9, 8, 4});
+    grouped.InputDimensions() = std::vector<size_t>({9, 8, 4});
+    depthwise.ComputeOutputDimensions();
+    grouped.ComputeOutputDimensions();
+    REQUIRE(depthwise.OutputDimensions() == grouped.OutputDimensions());
+    REQUIRE(depthwise.WeightSize() == grouped.WeightSize());
+
+    arma::mat parameters(depthwise.WeightSize(), 1, arma::fill::randn);
+    depthwise.SetWeights(parameters);
+    grouped.SetWeights(parameters);
+
+    const size_t outputSize = depthwise.OutputDimensions()[0] *
+        depthwise.OutputDimensions()[1] * 8;
+    arma::mat input(9 * 8 * 4, 3, arma::fill::randu);
+    arma::mat gy(outputSize, 3, arma::fill::randn);
+    arma::mat expected(outputSize, 3), actual(outputSize, 3);
+    grouped.Forward(input, expected);
+    depthwise.Forward(input, actual);
+    CheckMatrices(expected, actual, 1e-10);
+
+    arma::mat expectedG(input.n_rows, 3), actualG(input.n_rows, 3);
+    grouped.Backward(input, expected, gy, expectedG);
+    depthwise.Backward(input, actual, gy, actualG);
+    CheckMatrices(expectedG, actualG, 1e-10);
+
+    arma::mat expectedGradient(parameters.n_elem, 1);
+    arma::mat actualGradient(parameters.n_elem, 1);
+    grouped.Gradient(input, gy, expectedGradient);
+    depthwise.Gradient(input, gy, actualGradient);
+    CheckMatrices(expectedGradient, actualGradient, 1e-10);
+  }
+}
@@ -0,0 +1,424 @@
+/**
+ * @file downloader.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of HTTPDownloader, which downloads files over HTTP and resumes
+ * interrupted downloads, and CRC32Stream, which computes checksums of files
+ * while they are written.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+
+#ifndef MODELS_UTILS_DOWNLOADER_HPP
+#define MODELS_UTILS_DOWNLOADER_HPP
+
+#include <mlpack.hpp>
+#include <boost/asio.hpp>
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * CRC32Stream computes the CRC-32 checksum of a file from chunks of any size,
+ * so the checksum of a download is known as soon as its last byte is written.
+ *
+ * Checksums of the datasets were computed by reading files in blocks of 2048
+ * bytes and hashing complete blocks only, so the trailing bytes of a file
+ * that don't fill a block aren't part of the checksum. CRC32Stream follows
+ * the same convention, which keeps it compatible with Utils::GetCRC32().
+ */
+class CRC32Stream
+{
+ public:
+  //! Create an empty CRC32Stream object.
+  CRC32Stream() : pending(0)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Adds the next bytes of the file.
+   *
+   * @param data Pointer to the bytes.
+   * @param size Number of bytes.
+   */
+  void Update(const char* data, size_t size)
+  {
+    while (size > 0)
+    {
+      const size_t count = std::min(size, blockSize - pending);
+      std::memcpy(block + pending, data, count);
+      pending += count;
+      data += count;
+      size -= count;
+
+      if (pending == blockSize)
+      {
+        hash.process_bytes(block, blockSize);
+        pending = 0;
+      }
+    }
+  }
+
+  //! Removes all bytes added so far.
+  void Reset()
+  {
+    hash.reset();
+    pending = 0;
+  }
+
+  //! Get the checksum of all complete blocks added so far.
+  std::string Checksum() const
+  {
+    std::stringstream hashString;
+    hashString << std::hex << hash.checksum();
+    return hashString.str();
+  }
+
+ private:
+  //! Number of bytes hashed at once.
+  static constexpr size_t blockSize = 2048;
+
+  //! Locally stored checksum of the complete blocks.
+  boost::crc_32_type hash;
+
+  //! Locally stored bytes of the incomplete block.
+  char block[blockSize];
+
+  //! Locally stored number of bytes of the incomplete block.
+  size_t pending;
+};
+
+/**
+ * Description of a single file to download, used by Utils::DownloadFiles().
+ */
+struct DownloadTask
+{
+  //! Create an empty DownloadTask object.
+  DownloadTask() :
+      serverName("www.mlpack.org"),
+      zipFile(false),
+      pathForExtraction("./../data/")
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Create a DownloadTask object.
+   *
+   * @param url URL for file which is to be downloaded.
+   * @param downloadPath Output file path, relative to the working directory.
+   * @param hash CRC-32 checksum of the file. Not checked if empty.
+   * @param serverName Server to connect to, for downloading.
+   * @param zipFile Determines if the file needs to be extracted or not.
+   * @param pathForExtraction Path where files will be extracted if zipFile is
+   *     true.
+   */
+  DownloadTask(const std::string& url,
+               const std::string& downloadPath,
+               const std::string& hash = "",
+               const std::string& serverName = "www.mlpack.org",
+               const bool zipFile = false,
+               const std::string& pathForExtraction = "./../data/") :
+      url(url),
+      downloadPath(downloadPath),
+      hash(hash),
+      serverName(serverName),
+      zipFile(zipFile),
+      pathForExtraction(pathForExtraction)
+  {
+    // Nothing to do here.
+  }
+
+  //! Locally stored URL of the file.
+  std::string url;
+
+  //! Locally stored path where the file will be written.
+  std::string downloadPath;
+
+  //! Locally stored CRC-32 checksum of the file.
+  std::string hash;
+
+  //! Locally stored server to download from.
+  std::string serverName;
+
+  //! Locally stored boolean to determine whether the file is extracted.
+  bool zipFile;
+
+  //! Locally stored path where the file will be extracted.
+  std::string pathForExtraction;
+};
+
+/**
+ * HTTPDownloader downloads a file with HTTP/1.1 GET requests. Bytes are
+ * written to a partial file next to the destination, which is renamed once
+ * the download is complete. If the connection drops, or a partial file of an
+ * earlier run exists, the download is resumed with a Range request, so only
+ * the missing bytes are fetched. Servers that don't support ranges send the
+ * whole file again. The checksum is computed while bytes are written, so the
+ * file doesn't have to be read again afterwards.
+ *
+ * @code
+ * std::string checksum;
+ * if (HTTPDownloader::Download("www.mlpack.org", "/datasets/iris.csv",
+ *     "./../data/iris.csv", checksum) && checksum == "7c30e225")
+ *   std::cout << "Downloaded iris.csv." << std::endl;
+ * @endcode
+ */
+class HTTPDownloader
+{
+ public:
+  /**
+   * Downloads the file, resuming it if it's interrupted.
+   *
+   * @param serverName Server to connect to, for downloading.
+   * @param url URL for file which is to be downloaded.
+   * @param filePath Output file path.
+   * @param checksum Set to the CRC-32 checksum of the file.
+   * @param silent Boolean to display details of file being downloaded.
+   * @param retries Number of times an interrupted download is resumed.
+   * @return true if the whole file was downloaded.
+   */
+  static bool Download(const std::string& serverName,
+                       const std::string& url,
+                       const std::string& filePath,
+                       std::string& checksum,
+                       const bool silent = true,
+                       const size_t retries = 3)
+  {
+    const std::string partialPath = filePath + ".part";
+    CRC32Stream hash;
+
+    // Bytes of an earlier run are hashed once, later bytes are hashed as
+    // they arrive.
+    size_t offset = 0;
+    if (boost::filesystem::exists(partialPath))
+    {
+      std::ifstream partialFile(partialPath, std::ios::in | std::ios::binary);
+      std::vector<char> buffer(1 << 16);
+      while (partialFile)
+      {
+        partialFile.read(buffer.data(), buffer.size());
+        hash.Update(buffer.data(), partialFile.gcount());
+        offset += partialFile.gcount();
+      }
+    }
+
+    for (size_t attempt = 0; attempt <= retries; attempt++)
+    {
+      if (!silent && offset > 0)
+      {
+        mlpack::Log::Info << "Resuming download of " << url << " at byte " <<
+            offset << "." << std::endl;
+      }
+
+      const Status status = Request(serverName, url, partialPath, offset,
+          hash, silent);
+      if (status == Status::Failed)
+        return false;
+      else if (status == Status::Interrupted)
+        continue;
+
+      boost::system::error_code error;
+      boost::filesystem::rename(partialPath, filePath, error);
+      if (error)
+      {
+        mlpack::Log::Warn << "Unable to move download to " << filePath << "."
+            << std::endl;
+        return false;
+      }
+
+      checksum = hash.Checksum();
+      return true;
+    }
+
+    mlpack::Log::Warn << "Download of " << url << " was interrupted "
+        << retries + 1 << " times." << std::endl;
+    return false;
+  }
+
+ private:
+  //! Result of a single request.
+  enum class Status
+  {
+    //! The file is complete.
+    Complete,
+    //! The connection dropped, the request can be resumed.
+    Interrupted,
+    //! The server refused the request.
+    Failed
+  };
+
+  /**
+   * Sends a single request for the bytes of the file starting at the given
+   * offset and appends the response to the partial file.
+   *
+   * @param serverName Server to connect to, for downloading.
+   * @param url URL for file which is to be downloaded.
+   * @param partialPath Path of the partial file.
+   * @param offset Number of bytes in the partial file, updated as bytes are
+   *     written.
+   * @param hash Checksum of the partial file, updated as bytes are written.
+   * @param silent Boolean to display details of file being downloaded.
+   */
+  static Status Request(const std::string& serverName,
+                        const std::string& url,
+                        const std::string& partialPath,
+                        size_t& offset,
+                        CRC32Stream& hash,
+                        const bool silent)
+  {
+    // IO functionality by boost core.
+    boost::asio::io_service ioService;
+    // Use TCP protocol by boost asio to make a connection to desired server.
+    boost::asio::ip::tcp::resolver resolver(ioService);
+    boost::asio::ip::tcp::resolver::query query(serverName, "80",
+        boost::asio::ip::resolver_query_base::numeric_service);
+    boost::system::error_code error;
+    boost::asio::ip::tcp::resolver::iterator endPoint =
+        resolver.resolve(query, error);
+    boost::asio::ip::tcp::resolver::iterator end;
+    if (error)
+      return Status::Interrupted;
+
+    // Establish a connection by trying every end-point.
+    boost::asio::ip::tcp::socket socket(ioService);
+    error = boost::asio::error::host_not_found;
+    while (error && endPoint != end)
+    {
+      socket.close();
+      socket.connect(*endPoint++, error);
+    }
+
+    if (error)
+      return Status::Interrupted;
+
+    boost::asio::streambuf request;
+    std::ostream requestStream(&request);
+    requestStream << "GET " << url << " HTTP/1.1\r\n";
+    requestStream << "Host: " << serverName << "\r\n";
+    requestStream << "Accept: */*\r\n";
+    if (offset > 0)
+      requestStream << "Range: bytes=" << offset << "-\r\n";
+    requestStream << "Connection: close\r\n\r\n";
+
+    if (!silent)
+    {
+      mlpack::Log::Info << "Connected to " << serverName <<
+          ". Attempting download of " << url << std::endl;
+    }
+
+    boost::asio::write(socket, request, error);
+    if (error)
+      return Status::Interrupted;
+
+    // Read the response status line.
+    boost::asio::streambuf response;
+    boost::asio::read_until(socket, response, "\r\n", error);
+    if (error)
+      return Status::Interrupted;
+
+    std::istream responseStream(&response);
+    std::string httpVersion;
+    unsigned int statusCode = 0;
+    responseStream >> httpVersion >> statusCode;
+
+    // The partial file already holds the whole file.
+    if (statusCode == 416 && offset > 0)
+      return Status::Complete;
+
+    if (statusCode != 200 && statusCode != 206)
+    {
+      mlpack::Log::Warn << "Connection returned with status " << statusCode
+          << ". Terminating Connection." << std::endl;
+      return Status::Failed;
+    }
+
+    // Read the response headers.
+    boost::asio::read_until(socket, response, "\r\n\r\n", error);
+    if (error && error != boost::asio::error::eof)
+      return Status::Interrupted;
+
+    bool lengthKnown = false;
+    size_t contentLength = 0;
+    std::string header;
+    while (std::getline(responseStream, header) && header != "\r")
+    {
+      std::transform(header.begin(), header.end(), header.begin(), ::tolower);
+      if (header.compare(0, 15, "content-length:") == 0)
+      {
+        contentLength = std::strtoull(header.c_str() + 15, nullptr, 10);
+        lengthKnown = true;
+      }
+    }
+
+    // Without a partial response the whole file is sent again.
+    if (statusCode == 200)
+    {
+      offset = 0;
+      hash.Reset();
+    }
+
+    std::ofstream partialFile(partialPath, std::ios::out | std::ios::binary |
+        (statusCode == 206 ? std::ios::app : std::ios::trunc));
+    if (!partialFile.is_open())
+    {
+      mlpack::Log::Warn << "Unable to write " << partialPath << "."
+          << std::endl;
+      return Status::Failed;
+    }
+
+    // Body that was read along with the headers.
+    size_t received = 0;
+    std::vector<char> buffer(1 << 16);
+    while (response.size() > 0)
+    {
+      const size_t count = response.sgetn(buffer.data(), buffer.size());
+      Write(partialFile, buffer.data(), count, hash);
+      received += count;
+    }
+
+    error = boost::system::error_code();
+    while (!error)
+    {
+      const size_t count = socket.read_some(boost::asio::buffer(buffer),
+          error);
+      Write(partialFile, buffer.data(), count, hash);
+      received += count;
+    }
+
+    partialFile.close();
+    offset += received;
+
+    if (!partialFile || error != boost::asio::error::eof ||
+        (lengthKnown && received != contentLength))
+    {
+      return Status::Interrupted;
+    }
+
+    return Status::Complete;
+  }
+
+  //! Writes bytes to the partial file and adds them to the checksum.
+  static void Write(std::ofstream& file,
+                    const char* data,
+                    const size_t size,
+                    CRC32Stream& hash)
+  {
+    file.write(data, size);
+    hash.Update(data, size);
+  }
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
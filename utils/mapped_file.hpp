@@ -0,0 +1,189 @@
+/**
+ * @file mapped_file.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of MappedFile class, a read-only view of a file mapped into
+ * memory.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+
+#ifndef MODELS_UTILS_MAPPED_FILE_HPP
+#define MODELS_UTILS_MAPPED_FILE_HPP
+
+#include <mlpack.hpp>
+
+#ifdef _WIN32
+  #include <fstream>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace mlpack {
+namespace models {
+
+/**
+ * MappedFile maps a file into memory so that its contents can be used without
+ * reading it up front. Pages are mapped copy-on-write, so memory of the file
+ * can be modified without changing the file itself. On platforms without
+ * mmap() the file is read into memory instead.
+ *
+ * @code
+ * MappedFile file("./../data/cache.bin");
+ * if (file.IsOpen())
+ *   std::cout << file.Size() << " bytes mapped." << std::endl;
+ * @endcode
+ */
+class MappedFile
+{
+ public:
+  //! Create an empty MappedFile object.
+  MappedFile() : data(nullptr), size(0)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Create MappedFile object and map the given file.
+   *
+   * @param path Path to the file.
+   */
+  MappedFile(const std::string& path) : data(nullptr), size(0)
+  {
+    Open(path);
+  }
+
+  //! Unmap the file.
+  ~MappedFile() { Close(); }
+
+  // A mapping can't be shared between two objects.
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  //! Move constructor.
+  MappedFile(MappedFile&& other) : data(other.data), size(other.size)
+  {
+    #ifdef _WIN32
+    buffer = std::move(other.buffer);
+    #endif
+    other.data = nullptr;
+    other.size = 0;
+  }
+
+  //! Move assignment operator.
+  MappedFile& operator=(MappedFile&& other)
+  {
+    if (this != &other)
+    {
+      Close();
+      data = other.data;
+      size = other.size;
+      #ifdef _WIN32
+      buffer = std::move(other.buffer);
+      #endif
+      other.data = nullptr;
+      other.size = 0;
+    }
+
+    return *this;
+  }
+
+  /**
+   * Maps the given file. Any previously mapped file is unmapped.
+   *
+   * @param path Path to the file.
+   * @return true if the file was mapped.
+   */
+  bool Open(const std::string& path)
+  {
+    Close();
+
+    #ifdef _WIN32
+    std::ifstream file(path, std::ios::in | std::ios::binary |
+        std::ios::ate);
+    if (!file.is_open())
+      return false;
+
+    buffer.resize(file.tellg());
+    file.seekg(0, std::ios::beg);
+    if (!file.read(buffer.data(), buffer.size()))
+    {
+      buffer.clear();
+      return false;
+    }
+
+    data = buffer.data();
+    size = buffer.size();
+    #else
+    const int fileDescriptor = open(path.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+      return false;
+
+    struct stat fileInfo;
+    if (fstat(fileDescriptor, &fileInfo) != 0 || fileInfo.st_size == 0)
+    {
+      close(fileDescriptor);
+      return false;
+    }
+
+    void* mapping = mmap(nullptr, fileInfo.st_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE, fileDescriptor, 0);
+    // The mapping stays valid after the descriptor is closed.
+    close(fileDescriptor);
+    if (mapping == MAP_FAILED)
+      return false;
+
+    data = static_cast<char*>(mapping);
+    size = fileInfo.st_size;
+    #endif
+
+    return true;
+  }
+
+  //! Unmap the file.
+  void Close()
+  {
+    #ifdef _WIN32
+    buffer.clear();
+    buffer.shrink_to_fit();
+    #else
+    if (data != nullptr)
+      munmap(data, size);
+    #endif
+
+    data = nullptr;
+    size = 0;
+  }
+
+  //! Returns true if a file is mapped.
+  bool IsOpen() const { return data != nullptr; }
+
+  //! Get the memory of the mapped file.
+  char* Data() const { return data; }
+
+  //! Get the size of the mapped file in bytes.
+  size_t Size() const { return size; }
+
+ private:
+  //! Locally stored pointer to the mapped memory.
+  char* data;
+
+  //! Locally stored size of the mapped file.
+  size_t size;
+
+  #ifdef _WIN32
+  //! Locally stored contents of the file where mmap() isn't available.
+  std::vector<char> buffer;
+  #endif
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -19,6 +19,10 @@
 #include <sys/stat.h>
 #include <boost/crc.hpp>
 #include <boost/filesystem.hpp>
+#include <utils/downloader.hpp>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 namespace mlpack {
 namespace models {
@@ -86,10 +90,9 @@ class Utils
   }
 
   /**
-   * Downloads files using boost asio.
-   *
-   * For more information on how to download using boost asio, refer to
-   * the following boost_asio/example/cpp03 on boost asio examples.
+   * Downloads files using boost asio, or curl for servers other than the
+   * mlpack server. Interrupted downloads are resumed, refer to
+   * HTTPDownloader for details.
    *
    * @param url URL for file which is to be downloaded.
    * @param downloadPath Output file path.
@@ -125,121 +128,19 @@ class Utils
           << " created." << std::endl;
     }
 
-    if (serverName != "www.mlpack.org")
-    {
-      // NOTE : curl is supported for all windows after 2018.
-      // Update to new version of windows if an error occurs,
-      // Else try downloading files from mlpack server or
-      // downloading curl executable for earlier version of windows.
-      std::string command = "curl ";
-      if (!silent)
-        command += "-# ";
-
-      command += "-o ";
-      #ifdef _WIN32
-        std::string downloadPathTemp = downloadPath;
-        std::replace(downloadPathTemp.begin(), downloadPathTemp.end(), '/',
-            '\\');
-        command = command + downloadPathTemp;
-      #else
-        command = command + downloadPath;
-      #endif
-
-      command = command + " " + serverName + url;
-      std::system(command.c_str());
-      if (zipFile)
-        Utils::ExtractFiles(downloadPath, pathForExtraction);
-
-      return 0;
-    }
-
-    // IO functionality by boost core.
-    boost::asio::io_service ioService;
-    // Use TCP protocol by boost asio to make a connection to desired server.
-    boost::asio::ip::tcp::resolver resolver(ioService);
-    // Resolver will converts the the query object into list of end-points.
-    boost::asio::ip::tcp::resolver::query query(serverName, "80",
-        boost::asio::ip::resolver_query_base::numeric_service);
-    // The list of endpoints is returned using an iterator.
-    boost::asio::ip::tcp::resolver::iterator endPoint = resolver.resolve(query);
-    boost::asio::ip::tcp::resolver::iterator end;
-
-    // Establish a connection by trying to connect with each port.
-    boost::asio::ip::tcp::socket socket(ioService);
-    boost::system::error_code error = boost::asio::error::host_not_found;
-    // Iterate over ports.
-    while (error && endPoint != end)
-    {
-      socket.close();
-      socket.connect(*endPoint++, error);
-    }
-
-    boost::asio::streambuf request;
-    std::ostream requestStream(&request);
-    requestStream << "GET " << url << " HTTP/1.1\r\n";
-    requestStream << "Host: " << serverName << "\r\n";
-    requestStream << "Accept: */*\r\n";
-    requestStream << "Connection: close\r\n\r\n";
-
-    if (!silent)
-    {
-      mlpack::Log::Info << "Connected to " << serverName <<
-          ". Attempting download of "<< name << std::endl;
-    }
-
-    // Sending the request.
-    boost::asio::write(socket, request);
-
-    // Read the response status line.
-    boost::asio::streambuf response;
-    boost::asio::read_until(socket, response, "\r\n");
-    // Check that response is OK.
-    std::istream responseStream(&response);
-    std::string httpVer;
-    responseStream >> httpVer;
-    unsigned int statusCode;
-    responseStream >> statusCode;
-    if (statusCode != 200)
-    {
-      mlpack::Log::Fatal << "Connection returned with status " <<
-          statusCode << ". Terminating Connection." << std::endl;
-      return 1;
-    }
-
-    boost::asio::read_until(socket, response, "\r\n\r\n");
-    // Read the response headers.
-    std::string header;
-    while (std::getline(responseStream, header) && header != "\r")
-    {
-      // Nothing to do here.
-    }
-
-    // Write remaining data in response if any.
     std::string filePath = absolutePath ? downloadPath :
       boost::filesystem::current_path().string() + "/" + downloadPath;
 
-    std::ofstream outputFile(filePath.c_str(), std::ofstream::out |
-        std::ofstream::binary);
-    if (response.size() > 0)
-    {
-      outputFile << &response;
-    }
-
-    // Read the response and write to desired file.
-    while (boost::asio::read(socket, response,
-        boost::asio::transfer_at_least(1), error))
-    {
-      outputFile << &response;
-    }
+    if (!silent)
+      mlpack::Log::Info << "Downloading " << name << std::endl;
 
-    if (error != boost::asio::error::eof)
+    std::string checksum;
+    if (!Download(url, filePath, serverName, silent, checksum))
     {
       mlpack::Log::Fatal << "Download Failed!" << std::endl;
       return 1;
     }
 
-    outputFile.close();
-
     // Extract Files.
     if (zipFile)
     {
@@ -249,6 +150,83 @@ class Utils
     return 0;
   }
 
+  /**
+   * Downloads multiple files concurrently. Every file is checked against its
+   * checksum and extracted as soon as its own download completes, while the
+   * remaining files are still being downloaded. Files whose checksum doesn't
+   * match are removed.
+   *
+   * @code
+   * std::vector<DownloadTask> tasks;
+   * tasks.emplace_back("/datasets/iris.csv", "./../data/iris.csv", "7c30e225");
+   * tasks.emplace_back("/datasets/iris_test.csv", "./../data/iris_test.csv",
+   *     "3be1f79e");
+   * std::vector<char> downloaded = Utils::DownloadFiles(tasks);
+   * @endcode
+   *
+   * @param tasks Files to download, relative to the working directory.
+   * @param workers Maximum number of concurrent downloads.
+   * @param silent Boolean to display details of files being downloaded.
+   * @returns Vector with 1 for every file that was downloaded, matched its
+   *     checksum and was extracted, and 0 otherwise.
+   */
+  static std::vector<char> DownloadFiles(const std::vector<DownloadTask>& tasks,
+                                         const size_t workers = 4,
+                                         const bool silent = true)
+  {
+    std::vector<char> downloaded(tasks.size(), 0);
+    std::atomic<size_t> nextTask(0);
+    std::mutex logMutex;
+
+    auto worker = [&]()
+    {
+      for (size_t i = nextTask++; i < tasks.size(); i = nextTask++)
+      {
+        const DownloadTask& task = tasks[i];
+        const std::string filePath = boost::filesystem::current_path().string()
+            + "/" + task.downloadPath;
+        boost::system::error_code error;
+        boost::filesystem::create_directories(
+            boost::filesystem::path(filePath).parent_path(), error);
+
+        std::string checksum;
+        if (!Download(task.url, filePath, task.serverName, silent, checksum))
+        {
+          std::lock_guard<std::mutex> lock(logMutex);
+          mlpack::Log::Warn << "Unable to download " << task.url << "."
+              << std::endl;
+          continue;
+        }
+
+        if (task.hash.length() > 0 && checksum != task.hash)
+        {
+          std::lock_guard<std::mutex> lock(logMutex);
+          mlpack::Log::Warn << "Checksum of " << task.downloadPath << " is "
+              << checksum << ", expected " << task.hash << "." << std::endl;
+          RemoveFile(task.downloadPath);
+          continue;
+        }
+
+        if (task.zipFile)
+          ExtractFiles(task.downloadPath, task.pathForExtraction);
+
+        downloaded[i] = 1;
+      }
+    };
+
+    std::vector<std::thread> threads;
+    const size_t totalWorkers = std::min(std::max<size_t>(workers, 1),
+        tasks.size());
+    for (size_t i = 1; i < totalWorkers; i++)
+      threads.emplace_back(worker);
+
+    worker();
+    for (std::thread& thread : threads)
+      thread.join();
+
+    return downloaded;
+  }
+
   /**
    * Compare CheckSum for provided file and hash.
    *
@@ -271,17 +249,32 @@ class Utils
   static std::string GetCRC32(const std::string path,
                               const bool absolutePath = false)
   {
-    boost::crc_32_type hash;
+    CRC32Stream hash;
     std::string filePath = absolutePath ? path :
       boost::filesystem::current_path().string() + "/" + path;
     std::ifstream inputFile(path.c_str(), std::ios::in | std::ios::binary);
     // Read File in chunks to prevent reading whole file into memory.
-    std::vector<char> buffer(2048);
-    while (inputFile.read(&buffer[0], buffer.size()))
+    std::vector<char> buffer(1 << 16);
+    while (inputFile)
     {
-      hash.process_bytes(&buffer[0], inputFile.gcount());
+      inputFile.read(&buffer[0], buffer.size());
+      hash.Update(&buffer[0], inputFile.gcount());
     }
 
+    return hash.Checksum();
+  }
+
+  /**
+   * Calculates CRC32 checksum for the given string.
+   *
+   * @param contents String whose checksum is to be calculated.
+   * @returns String of CRC32 checksum.
+   */
+  static std::string GetStringCRC32(const std::string& contents)
+  {
+    boost::crc_32_type hash;
+    hash.process_bytes(contents.data(), contents.size());
+
     std::stringstream hashString;
     hashString << std::hex << hash.checksum();
     return hashString.str();
@@ -345,6 +338,56 @@ class Utils
       mlpack::Log::Warn << "The " << path << " doesn't exist." << std::endl;
     }
   }
+
+  /**
+   * Downloads a single file. Files of the mlpack server are fetched with
+   * HTTPDownloader, other servers are fetched with curl. Both resume partial
+   * downloads.
+   *
+   * @param url URL for file which is to be downloaded.
+   * @param filePath Output file path.
+   * @param serverName Server to connect to, for downloading.
+   * @param silent Boolean to display details of file being downloaded.
+   * @param checksum Set to the CRC-32 checksum of the file.
+   * @returns true if the whole file was downloaded.
+   */
+  static bool Download(const std::string& url,
+                       const std::string& filePath,
+                       const std::string& serverName,
+                       const bool silent,
+                       std::string& checksum)
+  {
+    if (serverName == "www.mlpack.org")
+    {
+      return HTTPDownloader::Download(serverName, url, filePath, checksum,
+          silent);
+    }
+
+    // NOTE : curl is supported for all windows after 2018.
+    // Update to new version of windows if an error occurs,
+    // Else try downloading files from mlpack server or
+    // downloading curl executable for earlier version of windows.
+    std::string command = "curl --retry 3 -C - ";
+    if (!silent)
+      command += "-# ";
+
+    std::string partialPath = filePath + ".part";
+    #ifdef _WIN32
+      std::replace(partialPath.begin(), partialPath.end(), '/', '\\');
+    #endif
+
+    command = command + "-o " + partialPath + " " + serverName + url;
+    if (std::system(command.c_str()) != 0)
+      return false;
+
+    boost::system::error_code error;
+    boost::filesystem::rename(filePath + ".part", filePath, error);
+    if (error)
+      return false;
+
+    checksum = GetCRC32(filePath, true);
+    return true;
+  }
 };
 
 } // namespace models
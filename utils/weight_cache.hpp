@@ -0,0 +1,342 @@
+/**
+ * @file weight_cache.hpp
+ * @author Kartik Dutt
+ *
+ * Definition of WeightCache class, which downloads pretrained weights into a
+ * cache folder shared by all models and processes.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+
+#ifndef MODELS_UTILS_WEIGHT_CACHE_HPP
+#define MODELS_UTILS_WEIGHT_CACHE_HPP
+
+#include <mlpack.hpp>
+#include <utils/utils.hpp>
+#include <boost/interprocess/sync/file_lock.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <cstdlib>
+#include <memory>
+
+namespace mlpack {
+namespace models {
+
+/**
+ * WeightCache keeps a manifest of weight files, with the URL, size and CRC-32
+ * checksum of every file, and downloads them into a single cache folder.
+ * A file is only visible in the cache once it is complete and matches its
+ * size and checksum: it is downloaded under a temporary name, resumed if a
+ * previous download was interrupted, verified and then renamed. Processes
+ * that fetch the same file at once take turns through a lock file next to
+ * it, so the file is downloaded once and never by two processes at the same
+ * time. Prefetch() downloads many files concurrently, e.g. before a job
+ * starts.
+ *
+ * The cache folder is $MLPACK_MODELS_CACHE if set, and
+ * ~/.cache/mlpack/models/weights/ otherwise. Downloaded files are typically
+ * loaded with WeightFile.
+ *
+ * @code
+ * WeightCache cache;
+ * cache.LoadManifest("./weights.manifest");
+ * cache.Prefetch({ "resnet50", "mobilenet_v1" });
+ *
+ * WeightFile weights;
+ * weights.Load(cache.Fetch("resnet50"), model);
+ * @endcode
+ */
+class WeightCache
+{
+ public:
+  /**
+   * Create a WeightCache object with an empty manifest.
+   *
+   * @param cacheFolder Folder the files are stored in.
+   */
+  WeightCache(const std::string& cacheFolder = DefaultFolder()) :
+      cacheFolder(cacheFolder)
+  {
+    // Nothing to do here.
+  }
+
+  /**
+   * Adds a file to the manifest, or replaces the file of the given name.
+   *
+   * @param name Name of the file, also its name in the cache folder.
+   * @param url URL of the file on the server.
+   * @param size Size of the file in bytes. Not checked if 0.
+   * @param hash CRC-32 checksum of the file. Not checked if empty.
+   * @param serverName Server to download from.
+   */
+  void Register(const std::string& name,
+                const std::string& url,
+                const size_t size = 0,
+                const std::string& hash = "",
+                const std::string& serverName = "www.mlpack.org")
+  {
+    Entry& entry = entries[name];
+    entry.url = url;
+    entry.size = size;
+    entry.hash = hash;
+    entry.serverName = serverName;
+    if (!entry.mutex)
+      entry.mutex.reset(new std::mutex());
+  }
+
+  /**
+   * Adds the files of the given manifest. Every line holds the name, URL,
+   * size and checksum of a file, and optionally the server, separated by
+   * whitespace. Empty lines and lines starting with '#' are skipped.
+   *
+   * @param path Path of the manifest.
+   * @return Number of files added.
+   */
+  size_t LoadManifest(const std::string& path)
+  {
+    std::ifstream manifest(path);
+    if (!manifest.is_open())
+    {
+      mlpack::Log::Warn << "Unable to open weight manifest " << path << "."
+          << std::endl;
+      return 0;
+    }
+
+    return LoadManifest(manifest, path);
+  }
+
+  /**
+   * Adds the files of the given manifest, e.g. a manifest built into the
+   * code; see LoadManifest(path) for the format.
+   *
+   * @param manifest Stream the manifest is read from.
+   * @param path Name of the manifest in warnings.
+   * @return Number of files added.
+   */
+  size_t LoadManifest(std::istream& manifest, const std::string& path)
+  {
+    size_t files = 0;
+    std::string line;
+    while (std::getline(manifest, line))
+    {
+      if (line.empty() || line[0] == '#')
+        continue;
+
+      std::stringstream fields(line);
+      std::string name, url, hash, serverName = "www.mlpack.org";
+      size_t size = 0;
+      if (!(fields >> name >> url >> size >> hash))
+      {
+        mlpack::Log::Warn << "Ignoring invalid line of weight manifest "
+            << path << ": " << line << std::endl;
+        continue;
+      }
+
+      fields >> serverName;
+      Register(name, url, size, hash, serverName);
+      files++;
+    }
+
+    return files;
+  }
+
+  /**
+   * Returns the path of the given file in the cache, downloading it first if
+   * it isn't cached yet.
+   *
+   * @param name Name of the file in the manifest.
+   * @param silent Boolean to display details of the download.
+   * @return Path of the cached file, or an empty string if it couldn't be
+   *     downloaded or doesn't match the manifest.
+   */
+  std::string Fetch(const std::string& name, const bool silent = true)
+  {
+    std::map<std::string, Entry>::iterator it = entries.find(name);
+    if (it == entries.end())
+    {
+      mlpack::Log::Warn << "WeightCache::Fetch(): " << name << " isn't part "
+          << "of the manifest." << std::endl;
+      return "";
+    }
+
+    const Entry& entry = it->second;
+    const std::string path = Path(name);
+    if (IsCached(entry, path))
+      return path;
+
+    boost::system::error_code error;
+    boost::filesystem::create_directories(cacheFolder, error);
+
+    // File locks only exclude other processes, threads of this process take
+    // turns on the mutex of the file.
+    std::lock_guard<std::mutex> threadLock(*entry.mutex);
+    const std::string lockPath = path + ".lock";
+    std::ofstream(lockPath, std::ios::app).close();
+    boost::interprocess::file_lock fileLock(lockPath.c_str());
+    boost::interprocess::scoped_lock<boost::interprocess::file_lock>
+        processLock(fileLock);
+
+    // Another process may have completed the file meanwhile.
+    if (IsCached(entry, path))
+      return path;
+
+    const std::string unverifiedPath = path + ".unverified";
+    std::string checksum;
+    if (!Utils::Download(entry.url, unverifiedPath, entry.serverName, silent,
+        checksum))
+    {
+      mlpack::Log::Warn << "Unable to download " << entry.url << "."
+          << std::endl;
+      return "";
+    }
+
+    const size_t size = boost::filesystem::file_size(unverifiedPath, error);
+    if ((entry.size > 0 && size != entry.size) ||
+        (!entry.hash.empty() && checksum != entry.hash))
+    {
+      mlpack::Log::Warn << "Downloaded " << name << " has " << size
+          << " bytes and checksum " << checksum << ", expected "
+          << entry.size << " bytes and checksum " << entry.hash << "."
+          << std::endl;
+      std::remove(unverifiedPath.c_str());
+      return "";
+    }
+
+    boost::filesystem::rename(unverifiedPath, path, error);
+    if (error)
+    {
+      std::remove(unverifiedPath.c_str());
+      return "";
+    }
+
+    return path;
+  }
+
+  /**
+   * Fetches the given files concurrently.
+   *
+   * @param names Names of the files in the manifest.
+   * @param workers Maximum number of concurrent downloads.
+   * @param silent Boolean to display details of the downloads.
+   * @return Vector with 1 for every file that is cached, and 0 otherwise.
+   */
+  std::vector<char> Prefetch(const std::vector<std::string>& names,
+                             const size_t workers = 4,
+                             const bool silent = true)
+  {
+    std::vector<char> cached(names.size(), 0);
+    std::atomic<size_t> nextName(0);
+    auto worker = [&]()
+    {
+      for (size_t i = nextName++; i < names.size(); i = nextName++)
+        cached[i] = Fetch(names[i], silent).empty() ? 0 : 1;
+    };
+
+    std::vector<std::thread> threads;
+    const size_t totalWorkers = std::min(std::max<size_t>(workers, 1),
+        names.size());
+    for (size_t i = 1; i < totalWorkers; i++)
+      threads.emplace_back(worker);
+
+    worker();
+    for (std::thread& thread : threads)
+      thread.join();
+
+    return cached;
+  }
+
+  /**
+   * Checks the checksum of the given cached file and removes the file if it
+   * doesn't match, e.g. after the disk was corrupted. Fetch() only checks the
+   * size of files that are already cached.
+   *
+   * @param name Name of the file in the manifest.
+   * @return true if the file is cached and matches its checksum.
+   */
+  bool Verify(const std::string& name)
+  {
+    std::map<std::string, Entry>::iterator it = entries.find(name);
+    const std::string path = Path(name);
+    if (it == entries.end() || !IsCached(it->second, path))
+      return false;
+
+    if (!it->second.hash.empty() &&
+        Utils::GetCRC32(path, true) != it->second.hash)
+    {
+      mlpack::Log::Warn << "Removing corrupted cached file " << path << "."
+          << std::endl;
+      std::remove(path.c_str());
+      return false;
+    }
+
+    return true;
+  }
+
+  //! Returns true if the given file is part of the manifest.
+  bool Contains(const std::string& name) const
+  {
+    return entries.count(name) > 0;
+  }
+
+  //! Get the path of the given file in the cache.
+  std::string Path(const std::string& name) const
+  {
+    return (boost::filesystem::path(cacheFolder) / name).string();
+  }
+
+  //! Get the folder the files are stored in.
+  const std::string& CacheFolder() const { return cacheFolder; }
+
+  //! Get the default cache folder.
+  static std::string DefaultFolder()
+  {
+    const char* folder = std::getenv("MLPACK_MODELS_CACHE");
+    if (folder != nullptr && folder[0] != '\0')
+      return folder;
+
+    #ifdef _WIN32
+    const char* home = std::getenv("USERPROFILE");
+    #else
+    const char* home = std::getenv("HOME");
+    #endif
+    return std::string(home != nullptr ? home : ".") +
+        "/.cache/mlpack/models/weights";
+  }
+
+ private:
+  //! A file of the manifest.
+  struct Entry
+  {
+    //! URL of the file on the server.
+    std::string url;
+    //! Size of the file in bytes, 0 if unknown.
+    size_t size;
+    //! CRC-32 checksum of the file, empty if unknown.
+    std::string hash;
+    //! Server to download from.
+    std::string serverName;
+    //! Serializes downloads of the file by threads of this process.
+    std::shared_ptr<std::mutex> mutex;
+  };
+
+  //! Returns true if the given file is complete in the cache.
+  static bool IsCached(const Entry& entry, const std::string& path)
+  {
+    boost::system::error_code error;
+    const boost::uintmax_t size = boost::filesystem::file_size(path, error);
+    return !error && (entry.size == 0 || size == entry.size);
+  }
+
+  //! Locally stored folder the files are stored in.
+  std::string cacheFolder;
+
+  //! Locally stored files of the manifest.
+  std::map<std::string, Entry> entries;
+};
+
+} // namespace models
+} // namespace mlpack
+
+#endif
@@ -16,62 +16,50 @@ import numpy as np
 def ImagesFromCSV(filename,
                   imgShape = (28, 28),
                   destination = 'samples',
+                  columns = 20,
                   saveIndividual = False):
 
-  # Import the data into a numpy matrix.
-  samples = np.genfromtxt(filename, delimiter = ',', dtype = np.uint8)
+  # Import the data into a numpy matrix, one sample per row.
+  samples = np.genfromtxt(filename, delimiter = ',', dtype = np.uint8,
+      ndmin = 2)
+  images = np.reshape(samples, (samples.shape[0],) + imgShape)
 
-  # Reshape and save it as an image in the destination.
-  tempImage = Image.fromarray(np.reshape(samples[:, 0], imgShape), 'L')
   if saveIndividual:
-    tempImage.save(destination + '/sample0.jpg')
+    for i in range(images.shape[0]):
+      Image.fromarray(images[i], 'L').save(destination + '/sample' + str(i) +
+          '.jpg')
 
-  # All the images will be concatenated to this for a combined image.
-  allSamples = tempImage
+  # Concatenate the samples into rows of the given number of images and the
+  # rows into a combined image; a last incomplete row is padded with black.
+  rows = []
+  for i in range(0, images.shape[0], columns):
+    row = np.concatenate(images[i : i + columns], axis = 1)
+    padding = columns * imgShape[1] - row.shape[1]
+    rows.append(np.pad(row, ((0, 0), (0, padding)), 'constant'))
 
-  for i in range(1, samples.shape[1]):
-    tempImage = np.reshape(samples[:, i], imgShape)
-
-    allSamples = np.concatenate((allSamples, tempImage), axis = 1)
-
-    tempImage = Image.fromarray(tempImage, 'L')
-    if saveIndividual:
-      tempImage.save(destination + '/sample' + str(i) + '.jpg')
-
-  tempImage = allSamples
-  allSamples = Image.fromarray(allSamples, 'L')
-  allSamples.save(destination + '/allSamples' + '.jpg')
+  allSamples = np.concatenate(rows, axis = 0)
+  Image.fromarray(allSamples, 'L').save(destination + '/allSamples' + '.jpg')
 
   print ('Samples saved in ' + destination + '/.')
 
-  return tempImage
+  return allSamples
 
 # Save posterior samples.
 ImagesFromCSV('./samples_csv_files/samples_posterior.csv', destination =
     'samples_posterior')
 
-# Save prior samples with individual latent varying.
-latentSize = 10
-allLatent = ImagesFromCSV('./samples_csv_files/samples_prior_latent0.csv',
-    destination = 'samples_prior')
-
-for i in range(1, latentSize):
-  allLatent = np.concatenate((allLatent,
-      (ImagesFromCSV('./samples_csv_files/samples_prior_latent' + str(i) + '.csv',
-      destination = 'samples_prior'))), axis = 0)
+# Save prior samples with individual latent varying, a row per latent
+# variable.
+nofSamples = 20
+allLatent = ImagesFromCSV('./samples_csv_files/samples_prior_latent.csv',
+    destination = 'samples_prior', columns = nofSamples)
 
 saved = Image.fromarray(allLatent, 'L')
 saved.save('./samples_prior/allLatent.jpg')
 
 # Save prior samples with 2d latent varying.
-nofSamples = 20
-allLatent = ImagesFromCSV('./samples_csv_files/samples_prior_latent_2d0.csv',
-    destination = 'latent')
-
-for i in range(1, nofSamples):
-  allLatent = np.concatenate((allLatent,
-      (ImagesFromCSV('./samples_csv_files/samples_prior_latent_2d' + str(i) +
-      '.csv', destination = 'samples_prior'))), axis = 0)
+allLatent = ImagesFromCSV('./samples_csv_files/samples_prior_latent_2d.csv',
+    destination = 'samples_prior', columns = nofSamples)
 
 saved = Image.fromarray(allLatent, 'L')
 saved.save('./samples_prior/2dLatent.jpg')
@@ -12,7 +12,8 @@
 #define MLPACK_ENABLE_ANN_SERIALIZATION
 #include <mlpack.hpp>
 
-#include "vae_utils.hpp"
+#include "vae_generation.hpp"
+#include <fstream>
 
 using namespace mlpack;
 
@@ -74,54 +75,28 @@ int main()
     data::Load("./saved_models/vaeCNN.bin", "vaeMS", vaeModel);
   }
 
-  arma::mat gaussianSamples, outputDists, samples;
+  // Samples are decoded in batches and every set of samples is streamed to a
+  // single file, one sample per line.
+  constexpr size_t batchSize = 256;
+  // Index of the decoder.
+  constexpr size_t decoder = 3;
+  // Index of the last layer (the Sigmoid layer in case of binary).
+  constexpr size_t last = 3 + (size_t) isBinary;
 
   /*
    * Sampling from the prior.
    */
-  gaussianSamples = arma::randn<arma::mat>(latentSize, nofSamples);
-
-  // Forward pass only through the decoder(and Sigmod layer in case of binary).
-  vaeModel.Forward(gaussianSamples,
-                   outputDists,
-                   3 /* Index of the decoder */,
-                   3 + (size_t)isBinary /* Index of the last layer */);
-
-  GetSample(outputDists, samples, isBinary);
-  // Save the prior samples as csv.
-  data::Save("./samples_csv_files/samples_prior.csv", samples, false, false);
+  std::ofstream prior("./samples_csv_files/samples_prior.csv");
+  models::Generate(vaeModel, models::PriorSamples(latentSize, nofSamples),
+      decoder, last, isBinary, prior, batchSize);
 
   /*
-   * Sampling from the prior by varying all latent variables.
+   * Sampling from the prior by varying all latent variables, a row of
+   * nofSamples samples per latent variable.
    */
-  arma::mat gaussianVaried;
-
-  for (size_t i = 0; i < latentSize; i++)
-  {
-    gaussianSamples = arma::randn<arma::mat>(latentSize, 1);
-    gaussianVaried = arma::zeros(latentSize, nofSamples);
-    gaussianVaried.each_col() = gaussianSamples;
-
-    for (size_t j = 0; j < nofSamples; j++)
-    {
-      gaussianVaried.col(j)(i) = -1.5 + j * (3.0 / nofSamples);
-    }
-
-    // Forward pass only through the decoder
-    // (and Sigmod layer in case of binary).
-    vaeModel.Forward(gaussianVaried,
-                     outputDists,
-                     3 /* Index of the decoder */,
-                     3 + (size_t)isBinary /* Index of the last layer */);
-
-    GetSample(outputDists, samples, isBinary);
-    // Save the prior samples as csv.
-    data::Save(
-        "./samples_csv_files/samples_prior_latent" + std::to_string(i) + ".csv",
-        samples,
-        false,
-        false);
-  }
+  std::ofstream latent("./samples_csv_files/samples_prior_latent.csv");
+  models::Generate(vaeModel, models::LatentTraversal(latentSize, nofSamples),
+      decoder, last, isBinary, latent, batchSize);
 
   /*
    * Sampling from the prior by varying two latent variables in 2d.
@@ -129,30 +104,9 @@ int main()
   size_t latent1 = 3; // Latent variable to be varied vertically.
   size_t latent2 = 4; // Latent variable to be varied horizontally.
 
-  for (size_t i = 0; i < nofSamples; i++)
-  {
-    gaussianVaried = arma::zeros(latentSize, nofSamples);
-
-    for (size_t j = 0; j < nofSamples; j++)
-    {
-      // Set the vertical variable to a constant value for the outer loop.
-      gaussianVaried.col(j)(latent1) = 1.5 - i * (3.0 / nofSamples);
-      // Vary the horizontal variable from -1.5 to 1.5.
-      gaussianVaried.col(j)(latent2) = -1.5 + j * (3.0 / nofSamples);
-    }
-
-    // Forward pass only through the decoder
-    // (and Sigmod layer in case of binary).
-    vaeModel.Forward(gaussianVaried,
-                     outputDists,
-                     3 /* Index of the decoder */,
-                     3 + (size_t)isBinary /* Index of the last layer */);
-
-    GetSample(outputDists, samples, isBinary);
-    // Save the prior samples as csv.
-    data::Save("./samples_csv_files/samples_prior_latent_2d" + std::to_string(i)
-        + ".csv", samples, false, false);
-  }
+  std::ofstream latent2d("./samples_csv_files/samples_prior_latent_2d.csv");
+  models::Generate(vaeModel, models::LatentGrid(latentSize, latent1, latent2,
+      nofSamples), decoder, last, isBinary, latent2d, batchSize);
 
   /*
    * Sampling from the posterior.
@@ -160,17 +114,8 @@ int main()
   if (loadData)
   {
     // Forward pass through the entire network given an input datapoint.
-    vaeModel.Forward(validation.cols(0, 19),
-                     outputDists,
-                     1 /* Index of the encoder */,
-                     3 + (size_t)isBinary /* Index of the last layer */);
-
-    GetSample(outputDists, samples, isBinary);
-    // Save the posterior samples as csv.
-    data::Save(
-      "./samples_csv_files/samples_posterior.csv",
-      samples,
-      false,
-      false);
+    std::ofstream posterior("./samples_csv_files/samples_posterior.csv");
+    models::Generate(vaeModel, arma::mat(validation.cols(0, 19)),
+        1 /* Index of the encoder */, last, isBinary, posterior, batchSize);
   }
 }
@@ -0,0 +1,164 @@
+/**
+ * @file vae_generation.hpp
+ * @author Atharva Khandait
+ *
+ * Functions for building latent codes and generating samples from them with
+ * the decoder of a trained VAE model, in large batches.
+ *
+ * mlpack is free software; you may redistribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef MODELS_VAE_GENERATION_HPP
+#define MODELS_VAE_GENERATION_HPP
+
+#include <mlpack.hpp>
+#include <models/common/data_parallel.hpp>
+#include "vae_utils.hpp"
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+namespace mlpack {
+namespace models {
+
+// Draws the given number of latent codes from the standard normal prior, one
+// code per column.
+template<typename DataType = arma::mat>
+DataType PriorSamples(const size_t latentSize, const size_t nofSamples)
+{
+  return arma::randn<DataType>(latentSize, nofSamples);
+}
+
+// Builds the codes that vary every latent variable in turn. For latent
+// variable i, a code is drawn from the prior and repeated in columns
+// i * steps to (i + 1) * steps - 1, with variable i going from low towards
+// high in equal steps.
+template<typename DataType = arma::mat>
+DataType LatentTraversal(const size_t latentSize,
+                         const size_t steps,
+                         const double low = -1.5,
+                         const double high = 1.5)
+{
+  DataType codes(latentSize, latentSize * steps);
+  for (size_t i = 0; i < latentSize; i++)
+  {
+    codes.cols(i * steps, (i + 1) * steps - 1).each_col() =
+        arma::randn<arma::Col<typename DataType::elem_type>>(latentSize);
+    for (size_t j = 0; j < steps; j++)
+      codes(i, i * steps + j) = low + j * (high - low) / steps;
+  }
+
+  return codes;
+}
+
+// Builds a steps x steps grid of codes, row by row, that are zero except for
+// two latent variables. The first one goes from high towards low over the
+// rows, the second one goes from low towards high over the columns.
+template<typename DataType = arma::mat>
+DataType LatentGrid(const size_t latentSize,
+                    const size_t latent1,
+                    const size_t latent2,
+                    const size_t steps,
+                    const double low = -1.5,
+                    const double high = 1.5)
+{
+  DataType codes(latentSize, steps * steps, arma::fill::zeros);
+  for (size_t i = 0; i < steps; i++)
+  {
+    for (size_t j = 0; j < steps; j++)
+    {
+      codes(latent1, i * steps + j) = high - i * (high - low) / steps;
+      codes(latent2, i * steps + j) = low + j * (high - low) / steps;
+    }
+  }
+
+  return codes;
+}
+
+// Passes the given inputs through layers begin to end of the model, e.g. only
+// through the decoder of a VAE, samples from the outputs with GetSample() and
+// writes one sample per line to the output, as comma separated pixel values.
+// Inputs are passed in batches of the given size, decoded in parallel (if
+// OpenMP is available) by copies of the model that share its weights, and
+// written as soon as they are sampled, so whatever the number of inputs only
+// a few batches are held in memory. Returns the number of written samples.
+template<typename OutputLayerType,
+         typename InitializationRuleType,
+         typename DataType>
+size_t Generate(FFN<OutputLayerType, InitializationRuleType, DataType>& model,
+                const DataType& inputs,
+                const size_t begin,
+                const size_t end,
+                const bool isBinary,
+                std::ostream& output,
+                const size_t batchSize = 256,
+                const size_t replicas = std::thread::hardware_concurrency())
+{
+  typedef FFN<OutputLayerType, InitializationRuleType, DataType> NetworkType;
+
+  if (batchSize == 0)
+  {
+    mlpack::Log::Fatal << "Generate(): the batch size must be positive."
+        << std::endl;
+  }
+
+  const size_t batches = (inputs.n_cols + batchSize - 1) / batchSize;
+  const size_t numReplicas = std::max<size_t>(1, std::min(replicas,
+      batches));
+
+  std::vector<std::unique_ptr<NetworkType>> copies;
+  for (size_t i = 1; i < numReplicas; i++)
+  {
+    copies.emplace_back(new NetworkType(model));
+    DataParallel<OutputLayerType, InitializationRuleType, DataType>::
+        ShareParameters(*copies.back(), model.Parameters());
+  }
+
+  // Every round decodes a batch per replica, then writes them in order.
+  std::vector<DataType> outputDists(numReplicas);
+  DataType samples;
+  for (size_t first = 0; first < batches; first += numReplicas)
+  {
+    const size_t round = std::min(numReplicas, batches - first);
+
+    #pragma omp parallel for num_threads(round) schedule(static)
+    for (size_t r = 0; r < round; r++)
+    {
+      NetworkType& replica = (r == 0) ? model : *copies[r - 1];
+      const size_t column = (first + r) * batchSize;
+      const size_t size = std::min(batchSize, size_t(inputs.n_cols) - column);
+      const DataType batch(const_cast<DataType&>(inputs).colptr(column),
+          inputs.n_rows, size, false, true);
+      replica.Forward(batch, outputDists[r], begin, end);
+    }
+
+    for (size_t r = 0; r < round; r++)
+    {
+      GetSample(outputDists[r], samples, isBinary);
+
+      std::ostringstream lines;
+      for (size_t i = 0; i < samples.n_cols; i++)
+      {
+        for (size_t j = 0; j < samples.n_rows; j++)
+        {
+          lines << (j > 0 ? "," : "")
+              << (unsigned int) std::lround(samples(j, i));
+        }
+        lines << "\n";
+      }
+
+      output << lines.str();
+    }
+  }
+
+  output << std::flush;
+  return inputs.n_cols;
+}
+
+} // namespace models
+} // namespace mlpack
+
+#endif
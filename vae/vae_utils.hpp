@@ -13,36 +13,19 @@
 #define MODELS_VAE_UTILS_HPP
 
 #include <mlpack.hpp>
+#include <models/common/batched_evaluation.hpp>
 
 namespace mlpack {
 namespace models {
 
-// Calculates mean loss over batches.
+// Calculates mean loss over batches. Batches are evaluated in parallel, and a
+// last batch smaller than the others counts by its size.
 template<typename NetworkType = FFN<MeanSquaredError<>, HeInitialization>,
          typename DataType = arma::mat>
 double MeanTestLoss(NetworkType& model, DataType& testSet, size_t batchSize)
 {
-  double loss = 0;
-  size_t nofPoints = testSet.n_cols;
-  size_t i;
-
-  for (i = 0; i < (size_t) nofPoints / batchSize; ++i)
-  {
-    loss +=
-        model.Evaluate(testSet.cols(batchSize * i, batchSize * (i + 1) - 1),
-                       testSet.cols(batchSize * i, batchSize * (i + 1) - 1));
-  }
-
-  if (nofPoints % batchSize != 0)
-  {
-    loss += model.Evaluate(testSet.cols(batchSize * i, nofPoints - 1),
-                           testSet.cols(batchSize * i, nofPoints - 1));
-    loss /= (int)nofPoints / batchSize + 1;
-  }
-  else
-    loss /= nofPoints / batchSize;
-
-  return loss;
+  return BatchedEvaluation::Evaluate(model, testSet, testSet, batchSize) *
+      batchSize / testSet.n_cols;
 }
 
 // Sample from the output distribution and post-process the outputs(because